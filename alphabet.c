@@ -0,0 +1,72 @@
+/*
+ *  ======== alphabet.c ========
+ *  MORSE ALPHABETS PAST ASCII, LOOKED UP BY PERFECT HASH.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "alphabet.h"
+#include "morse.h"
+
+/* read once a character by the sequencer, written by the console */
+static volatile alphabet_id selected = ALPHABET_LATIN;
+
+/* key code points past ASCII in another alphabet, from the next character
+ * @return -> ALPHABET_STATUS_SUCCESS, or ALPHABET_STATUS_ERROR if there is
+ *            no such alphabet */
+int alphabet_select(alphabet_id id) {
+
+    if ((unsigned int)id >= ALPHABET_COUNT) {
+        return ALPHABET_STATUS_ERROR;
+    }
+    selected = id;
+
+    return ALPHABET_STATUS_SUCCESS;
+}
+
+/* @return -> the alphabet selected */
+alphabet_id alphabet_current(void) {
+
+    return selected;
+}
+
+/* @return -> the slot holding a code point, or NULL if the alphabet does
+ *            not have it */
+const alphabet_slot *alphabet_lookup(const alphabet_table *table, uint32_t code_point) {
+
+    const alphabet_slot *slot;
+    uint32_t bucket;
+
+    if (table->size == 0 || code_point == 0 || code_point > 0xffff) {
+        return NULL;
+    }
+    bucket = ALPHABET_REDUCE(ALPHABET_HASH(code_point, 0), table->buckets);
+    slot = &table->slots[ALPHABET_REDUCE(ALPHABET_HASH(code_point, table->seeds[bucket] + 1), table->size)];
+
+    return slot->code_point == code_point ? slot : NULL;
+}
+
+/* @param mark -> set to a second code, to be keyed after the first as a
+ *                character of its own, or to NULL
+ * @return -> the code for a code point: '.' and '-', or " " if it has none
+ *            in the alphabet selected */
+const char *alphabet_code(uint32_t code_point, const char **mark) {
+
+    const alphabet_slot *slot;
+
+    *mark = NULL;
+    if (code_point < 0x80) {
+        return get_morse((char)code_point);
+    }
+
+    slot = alphabet_lookup(&alphabet_tables[selected], code_point);
+    if (slot == NULL) {
+        return " ";
+    }
+    if (slot->mark != 0) {
+        *mark = alphabet_codes[slot->mark];
+    }
+
+    return alphabet_codes[slot->code];
+}
@@ -0,0 +1,79 @@
+/*
+ *  ======== alphabet.h ========
+ *  MORSE ALPHABETS PAST ASCII: CYRILLIC (RUSSIAN), GREEK AND WABUN
+ *  (JAPANESE KANA), ONE OF WHICH IS SELECTED AT A TIME. MESSAGES ARE UTF-8
+ *  (SEE utf8.h); ASCII IS KEYED AS get_morse() HAS IT WHATEVER IS
+ *  SELECTED, AND EVERY OTHER CODE POINT IS LOOKED UP IN THE SELECTED
+ *  ALPHABET'S TABLE, OR KEYED AS A SPACE IF IT IS NOT THERE.
+ *
+ *  Each table is a minimal-ish perfect hash generated by tools/alphabet.c
+ *  into alphabet_tables.c: a code point picks a bucket, the bucket's seed
+ *  picks the one slot the code point can be in, and the slot says whether
+ *  it is. A lookup is two multiplies and a compare however large the
+ *  alphabet, and a slot is four bytes, the codes themselves being shared
+ *  by every table. Capitals and small letters, and hiragana and katakana,
+ *  are all in the tables, so nothing is folded at run time.
+ *
+ *  The same code stands for different letters in different alphabets, so
+ *  the receiver has to be told which one is in use; that is why only one
+ *  is, and why selecting another takes effect from the next character.
+ *
+ *  Wabun keys a voiced kana as the kana and then its mark, as a character
+ *  of its own; a code point can therefore key as two characters.
+ */
+
+#ifndef ALPHABET_H
+#define ALPHABET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* --- the alphabets; latin has no table, ASCII being get_morse()'s --- */
+typedef enum {
+    ALPHABET_LATIN,
+    ALPHABET_CYRILLIC,
+    ALPHABET_GREEK,
+    ALPHABET_WABUN,
+    ALPHABET_COUNT
+} alphabet_id;
+
+/* --- status codes --- */
+#define ALPHABET_STATUS_SUCCESS (0)
+#define ALPHABET_STATUS_ERROR   (-1)
+
+/* the hash of a code point under a seed, and the reduction of a hash to
+ * 0..n-1 by its top bits; tools/alphabet.c builds the tables with these,
+ * so they cannot change without the tables being generated again */
+#define ALPHABET_HASH(code_point, seed) \
+    ((((uint32_t)(code_point) ^ ((uint32_t)(seed) * 0x9e3779b9u)) * 0x85ebca6bu))
+#define ALPHABET_REDUCE(hash, n) ((uint32_t)(((uint64_t)(hash) * (uint32_t)(n)) >> 32))
+
+/* --- one slot: a code point and its code, as indices into
+ * alphabet_codes[], where 0 is none --- */
+typedef struct {
+    uint16_t code_point;            /* 0 for an empty slot */
+    uint8_t code;
+    uint8_t mark;                   /* keyed after it as a character of its own */
+} alphabet_slot;
+
+/* --- one alphabet --- */
+typedef struct {
+    const char *name;
+    const uint8_t *seeds;           /* one for each bucket */
+    const alphabet_slot *slots;
+    uint16_t buckets;
+    uint16_t size;                  /* slots */
+    uint16_t count;                 /* code points in it */
+} alphabet_table;
+
+/* in alphabet_tables.c */
+extern const char *const alphabet_codes[];
+extern const alphabet_table alphabet_tables[ALPHABET_COUNT];
+
+/* function prototypes */
+int alphabet_select(alphabet_id id);
+alphabet_id alphabet_current(void);
+const alphabet_slot *alphabet_lookup(const alphabet_table *table, uint32_t code_point);
+const char *alphabet_code(uint32_t code_point, const char **mark);
+
+#endif /* ALPHABET_H */
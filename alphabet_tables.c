@@ -0,0 +1,140 @@
+/*
+ *  ======== alphabet_tables.c ========
+ *  PERFECT-HASH TABLES FOR THE ALPHABETS OF alphabet.h. GENERATED BY
+ *  tools/alphabet.c - DO NOT EDIT.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "alphabet.h"
+
+const char *const alphabet_codes[54] = {
+    "", ".-", "-...", ".--", "--.", "-..", ".", "...-",
+    "--..", "..", ".---", "-.-", ".-..", "--", "-.", "---",
+    ".--.", ".-.", "...", "-", "..-", "..-.", "....", "-.-.",
+    "---.", "----", "--.-", "--.--", "-.--", "-..-", "..-..", "..--",
+    ".-.-", "-.---", ".-...", "-.-..", "-.-.-", "--.-.", "---.-", ".---.",
+    ".-.--", "--..-", "..-.-", "-...-", "-..-.", "-..--", "-.--.", ".-..-",
+    ".--..", ".-.-.", "..--.", ".--.-", ".-.-.-", ".-.-.."
+};
+
+/* cyrillic: 66 code points in 66 slots, through 33 buckets (297 bytes) */
+static const uint8_t cyrillic_seeds[33] = {
+      0,   0,   0,   0,   0,   3,   0,   0,   0,  17,   0,   3,
+      3,   0,   0,   0,   0,  29,   3,   2,   1,   9,   4,   1,
+      0,   4,   5,  88,  54,  20,  37, 124, 108
+};
+
+static const alphabet_slot cyrillic_slots[66] = {
+    {0x0444, 21, 0}, {0x0451,  6, 0}, {0x0448, 25, 0}, {0x0446, 23, 0},
+    {0x0410,  1, 0}, {0x042d, 30, 0}, {0x0436,  7, 0}, {0x0412,  3, 0},
+    {0x042f, 32, 0}, {0x0423, 20, 0}, {0x0414,  5, 0}, {0x0438,  9, 0},
+    {0x043a, 11, 0}, {0x0416,  7, 0}, {0x0432,  3, 0}, {0x043c, 13, 0},
+    {0x042a, 27, 0}, {0x0425, 22, 0}, {0x043e, 15, 0}, {0x0413,  4, 0},
+    {0x0427, 24, 0}, {0x0445, 22, 0}, {0x042b, 28, 0}, {0x044f, 32, 0},
+    {0x0419, 10, 0}, {0x0417,  8, 0}, {0x041a, 11, 0}, {0x0441, 18, 0},
+    {0x0411,  2, 0}, {0x0443, 20, 0}, {0x0415,  6, 0}, {0x0424, 21, 0},
+    {0x043f, 16, 0}, {0x041b, 12, 0}, {0x044b, 28, 0}, {0x0433,  4, 0},
+    {0x0426, 23, 0}, {0x0449, 26, 0}, {0x0430,  1, 0}, {0x043d, 14, 0},
+    {0x0439, 10, 0}, {0x041d, 14, 0}, {0x0428, 25, 0}, {0x042e, 31, 0},
+    {0x044d, 30, 0}, {0x0434,  5, 0}, {0x0420, 17, 0}, {0x043b, 12, 0},
+    {0x042c, 29, 0}, {0x0422, 19, 0}, {0x041f, 16, 0}, {0x044a, 27, 0},
+    {0x0421, 18, 0}, {0x0431,  2, 0}, {0x044c, 29, 0}, {0x041e, 15, 0},
+    {0x0440, 17, 0}, {0x044e, 31, 0}, {0x0418,  9, 0}, {0x0435,  6, 0},
+    {0x0401,  6, 0}, {0x0447, 24, 0}, {0x0437,  8, 0}, {0x0442, 19, 0},
+    {0x041c, 13, 0}, {0x0429, 26, 0}
+};
+
+/* greek: 67 code points in 69 slots, through 23 buckets (299 bytes) */
+static const uint8_t greek_seeds[23] = {
+      0, 120,   4,   0,  45,   3,   0,   0,   0,   4,   4, 201,
+      4,  21,   8,  23,  45,   0,  42,  65,   0,  77, 226
+};
+
+static const alphabet_slot greek_slots[69] = {
+    {0x03c8, 26, 0}, {0x039b, 12, 0}, {0x03cc, 15, 0}, {0x0000,  0, 0},
+    {0x03b7, 22, 0}, {0x03b1,  1, 0}, {0x03ba, 11, 0}, {0x03cb, 28, 0},
+    {0x038f,  3, 0}, {0x03b4,  5, 0}, {0x03ab, 28, 0}, {0x0398, 23, 0},
+    {0x0393,  4, 0}, {0x0000,  0, 0}, {0x039a, 11, 0}, {0x03a4, 19, 0},
+    {0x03b9,  9, 0}, {0x039c, 13, 0}, {0x03a9,  3, 0}, {0x03c4, 19, 0},
+    {0x038e, 28, 0}, {0x03a0, 16, 0}, {0x03b5,  6, 0}, {0x03c6, 21, 0},
+    {0x03ad,  6, 0}, {0x03c0, 16, 0}, {0x0392,  2, 0}, {0x03af,  9, 0},
+    {0x03b8, 23, 0}, {0x0394,  5, 0}, {0x03ae, 22, 0}, {0x0396,  8, 0},
+    {0x03b3,  4, 0}, {0x03c9,  3, 0}, {0x03a3, 18, 0}, {0x03c5, 28, 0},
+    {0x0388,  6, 0}, {0x03b6,  8, 0}, {0x03be, 29, 0}, {0x03cd, 28, 0},
+    {0x03aa,  9, 0}, {0x03a1, 17, 0}, {0x038c, 15, 0}, {0x038a,  9, 0},
+    {0x03b2,  2, 0}, {0x03bc, 13, 0}, {0x03a6, 21, 0}, {0x039f, 15, 0},
+    {0x03c2, 18, 0}, {0x03c3, 18, 0}, {0x039d, 14, 0}, {0x03a7, 25, 0},
+    {0x0399,  9, 0}, {0x0386,  1, 0}, {0x03c7, 25, 0}, {0x03a5, 28, 0},
+    {0x03ce,  3, 0}, {0x03bf, 15, 0}, {0x03bb, 12, 0}, {0x0389, 22, 0},
+    {0x03ac,  1, 0}, {0x03c1, 17, 0}, {0x0391,  1, 0}, {0x03ca,  9, 0},
+    {0x03bd, 14, 0}, {0x0395,  6, 0}, {0x0397, 22, 0}, {0x039e, 29, 0},
+    {0x03a8, 26, 0}
+};
+
+/* wabun: 175 code points in 175 slots, through 88 buckets (788 bytes) */
+static const uint8_t wabun_seeds[88] = {
+      0,   0,   6,   5,   2,   0,   0,  25,   0,  36,   0,   8,
+      2,   9,   3,   0,   3,   9,   6,   0,   2,  18,   0,   1,
+     21,  39,   2,   0,   3,   7,  12,   0,   2,  54,   4,   0,
+      1,   0,   4,   0,  90,  12,   0,   0,   2,   0,   1,  16,
+      4,   9,   0,   6,   5,  11,   1,   7,   4,   6,   0,  20,
+      0,  10,   3,  12,   0,  22,   1,   1,   0,  13,  16,   1,
+      4,   1,  15,   1,  21,   1,  11,   2,  13,   2,  33,  21,
+     91,   1,  77, 255
+};
+
+static const alphabet_slot wabun_slots[175] = {
+    {0x3048, 33, 0}, {0x30ce, 31, 0}, {0x308f, 11, 0}, {0x3001, 52, 0},
+    {0x309a, 50, 0}, {0x30db,  5, 0}, {0x30c4, 16, 0}, {0x305c, 39, 9},
+    {0x30b0,  7, 9}, {0x30de, 29, 0}, {0x308d, 32, 0}, {0x3073, 41, 9},
+    {0x3042, 27, 0}, {0x3083,  3, 0}, {0x30e6, 45, 0}, {0x30f1, 48, 0},
+    {0x304c, 12, 9}, {0x309b,  9, 0}, {0x30b1, 28, 0}, {0x305b, 39, 0},
+    {0x3044,  1, 0}, {0x30c6, 40, 0}, {0x305a, 38, 9}, {0x30a5, 20, 0},
+    {0x30e8, 13, 0}, {0x306a, 17, 0}, {0x306c, 22, 0}, {0x3059, 38, 0},
+    {0x30d6,  8, 9}, {0x3064, 16, 0}, {0x30ea,  4, 0}, {0x30ab, 12, 0},
+    {0x3070,  2, 9}, {0x30b6, 36, 9}, {0x30ad, 35, 0}, {0x30fc, 51, 0},
+    {0x30b4, 25, 9}, {0x3085, 45, 0}, {0x307b,  5, 0}, {0x30a9, 34, 0},
+    {0x30ec, 15, 0}, {0x30ee, 11, 0}, {0x30dc,  5, 9}, {0x305d, 24, 0},
+    {0x30bb, 39, 0}, {0x3068, 30, 0}, {0x3078,  6, 0}, {0x30af,  7, 0},
+    {0x30be, 24, 9}, {0x3060, 14, 9}, {0x30a1, 27, 0}, {0x30e0, 19, 0},
+    {0x3092, 10, 0}, {0x306e, 31, 0}, {0x30d7,  8, 50}, {0x3049, 34, 0},
+    {0x3075,  8, 0}, {0x3062, 21, 9}, {0x30ba, 38, 9}, {0x30e2, 44, 0},
+    {0x3051, 28, 0}, {0x3084,  3, 0}, {0x30c9, 30, 9}, {0x304b, 12, 0},
+    {0x30a3,  1, 0}, {0x307a,  6, 50}, {0x30dd,  5, 50}, {0x3057, 37, 0},
+    {0x30c5, 16, 9}, {0x3088, 13, 0}, {0x30cb, 23, 0}, {0x304d, 35, 0},
+    {0x30e4,  3, 0}, {0x3066, 40, 0}, {0x309c, 50, 0}, {0x30b7, 37, 0},
+    {0x30a2, 27, 0}, {0x308a,  4, 0}, {0x30cd, 26, 0}, {0x30c0, 14, 9},
+    {0x30a7, 33, 0}, {0x3058, 37, 9}, {0x30eb, 46, 0}, {0x30e3,  3, 0},
+    {0x30f3, 49, 0}, {0x308c, 15, 0}, {0x30cf,  2, 0}, {0x3099,  9, 0},
+    {0x304f,  7, 0}, {0x30bc, 39, 9}, {0x30aa, 34, 0}, {0x30e1, 43, 0},
+    {0x305e, 24, 9}, {0x308e, 11, 0}, {0x30c1, 21, 0}, {0x3043,  1, 0},
+    {0x30da,  6, 50}, {0x3069, 30, 9}, {0x30ef, 11, 0}, {0x30d5,  8, 0},
+    {0x3045, 20, 0}, {0x3080, 19, 0}, {0x30c3, 16, 0}, {0x3002, 53, 0},
+    {0x30c2, 21, 9}, {0x3081, 43, 0}, {0x30ae, 35, 9}, {0x30e9, 18, 0},
+    {0x30f2, 10, 0}, {0x30b9, 38, 0}, {0x3082, 44, 0}, {0x3047, 33, 0},
+    {0x30d8,  6, 0}, {0x306d, 26, 0}, {0x3050,  7, 9}, {0x30a8, 33, 0},
+    {0x30f0, 47, 0}, {0x30ac, 12, 9}, {0x30c7, 40, 9}, {0x3061, 21, 0},
+    {0x3091, 48, 0}, {0x30d0,  2, 9}, {0x3072, 41, 0}, {0x3053, 25, 0},
+    {0x305f, 14, 0}, {0x30ed, 32, 0}, {0x3086, 45, 0}, {0x306f,  2, 0},
+    {0x308b, 46, 0}, {0x30d2, 41, 0}, {0x3094, 20, 9}, {0x30e7, 13, 0},
+    {0x307f, 42, 0}, {0x30f4, 20, 9}, {0x307d,  5, 50}, {0x304a, 34, 0},
+    {0x30b3, 25, 0}, {0x30d4, 41, 50}, {0x30a6, 20, 0}, {0x3052, 28, 9},
+    {0x3076,  8, 9}, {0x3063, 16, 0}, {0x306b, 23, 0}, {0x307c,  5, 9},
+    {0x3087, 13, 0}, {0x3093, 49, 0}, {0x3065, 16, 9}, {0x30b8, 37, 9},
+    {0x30d3, 41, 9}, {0x3074, 41, 50}, {0x3055, 36, 0}, {0x3046, 20, 0},
+    {0x30cc, 22, 0}, {0x30df, 42, 0}, {0x30d1,  2, 50}, {0x3090, 47, 0},
+    {0x30e5, 45, 0}, {0x3067, 40, 9}, {0x3056, 36, 9}, {0x307e, 29, 0},
+    {0x30ca, 17, 0}, {0x30bd, 24, 0}, {0x3079,  6, 9}, {0x30a4,  1, 0},
+    {0x30b5, 36, 0}, {0x30bf, 14, 0}, {0x3071,  2, 50}, {0x3054, 25, 9},
+    {0x30c8, 30, 0}, {0x3089, 18, 0}, {0x3041, 27, 0}, {0x304e, 35, 9},
+    {0x30d9,  6, 9}, {0x3077,  8, 50}, {0x30b2, 28, 9}
+};
+
+const alphabet_table alphabet_tables[ALPHABET_COUNT] = {
+    {"latin", NULL, NULL, 0, 0, 0},
+    {"cyrillic", cyrillic_seeds, cyrillic_slots, 33, 66, 66},
+    {"greek", greek_seeds, greek_slots, 23, 69, 67},
+    {"wabun", wabun_seeds, wabun_slots, 88, 175, 175},
+};
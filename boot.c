@@ -0,0 +1,96 @@
+/*
+ *  ======== boot.c ========
+ *  START-UP PHASE TIMESTAMPS.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "boot.h"
+#include "console.h"
+#include "profile.h"
+
+#if !defined(MORSE_HOST)
+#include <ti/devices/cc32xx/inc/hw_types.h>
+#include <ti/devices/cc32xx/driverlib/prcm.h>
+#endif
+
+volatile uint32_t boot_stamps[BOOT_NUM_PHASES];
+volatile uint32_t boot_power_on_us = 0;
+
+/* one bit per phase stamped, so that each is stamped only the first time */
+static volatile uint32_t reached = 0;
+
+/* what the stamps count from: zero on target, where the counter started
+ * at reset, and the first stamp on the host */
+static uint32_t origin = 0;
+
+/* names for boot_report(), in boot_phase order */
+static const char *const phase_names[BOOT_NUM_PHASES] = {
+    "main",
+    "Board_init",
+    "mainThread",
+    "leds ready",
+    "first edge",
+    "peripherals",
+    "timer started",
+};
+
+#if !defined(MORSE_HOST)
+/* called by the run-time library's _c_int00() before .data and .bss are
+ * initialised, in place of its own empty version, to start the clock
+ * that every stamp is taken from
+ * @return -> 1, to go on and initialise them */
+int _system_pre_init(void) {
+
+    profile_start_counter();
+
+    return 1;
+}
+#endif
+
+/* stamp a phase of start-up, unless it has been already; cheap enough to
+ * be left in the LED path for BOOT_FIRST_EDGE
+ * @param phase -> the phase just reached */
+void boot_mark(boot_phase phase) {
+
+    uint32_t now;
+
+    if (reached & (1UL << phase)) {
+        return;
+    }
+    now = profile_now();
+
+#if defined(MORSE_HOST)
+    if (reached == 0) {
+        origin = now;
+    }
+#else
+    if (phase == BOOT_MAIN) {
+        boot_power_on_us = (uint32_t)(PRCMSlowClkCtrGet() * 15625 / 512);
+    }
+#endif
+
+    boot_stamps[phase] = now - origin;
+    reached |= 1UL << phase;
+}
+
+/* print the time to each phase reached so far over the console */
+void boot_report(void) {
+
+    short unsigned int i;
+
+#if defined(MORSE_HOST)
+    console_printf("boot (us since the first phase stamped):\r\n");
+#else
+    console_printf("boot (us since reset; %u us from power-on to main):\r\n", boot_power_on_us);
+#endif
+    for (i = 0; i < BOOT_NUM_PHASES; ++i) {
+        if (reached & (1UL << i)) {
+            console_printf("  %-15s %u\r\n", phase_names[i], boot_stamps[i] / PROFILE_COUNTS_PER_US);
+        }
+        else {
+            console_printf("  %-15s -\r\n", phase_names[i]);
+        }
+    }
+}
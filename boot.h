@@ -0,0 +1,50 @@
+/*
+ *  ======== boot.h ========
+ *  TIMESTAMPS FOR EACH PHASE OF START-UP, FROM RESET TO THE FIRST LED EDGE.
+ *
+ *  The DWT cycle counter is started from zero in _system_pre_init(), which
+ *  the run-time library calls from resetISR() before it sets up .data and
+ *  .bss, so every stamp is in cycles since then. What came before (the
+ *  boot ROM loading the image from serial flash) is measured on the slow
+ *  clock, which counts at 32768 Hz from power-on; it is read once, in
+ *  main(), so boot_power_on_us only means something after a cold start.
+ *  On the host (MORSE_HOST defined) the stamps are in nanoseconds and
+ *  count from the first one taken.
+ *
+ *  The stamps live in boot_stamps[], readable from the debugger, and are
+ *  printed by boot_report() (the console's boot command).
+ */
+
+#ifndef BOOT_H
+#define BOOT_H
+
+#include <stdint.h>
+
+/* set MORSE_FAST_START to 1 to key the first tick as soon as the LEDs can
+ * be driven, without the usual start-up delay, and to set up the buttons,
+ * the console and the timer only after that first edge; the jitter
+ * self-test, set up with them, then misses the first message */
+#ifndef MORSE_FAST_START
+#define MORSE_FAST_START 0
+#endif
+
+/* --- phases of start-up, in the order they are reached --- */
+typedef enum {
+    BOOT_MAIN = 0,              /* main() entered, .data and .bss set up */
+    BOOT_BOARD_INIT,            /* Board_init() done */
+    BOOT_MAIN_THREAD,           /* mainThread() entered, RTOS or NoRTOS running */
+    BOOT_LEDS_READY,            /* LED pins configured */
+    BOOT_FIRST_EDGE,            /* first LED lit */
+    BOOT_PERIPHERALS_READY,     /* buttons, console and self-tests set up */
+    BOOT_TIMER_STARTED,         /* tick timer running */
+    BOOT_NUM_PHASES
+} boot_phase;
+
+extern volatile uint32_t boot_stamps[BOOT_NUM_PHASES];
+extern volatile uint32_t boot_power_on_us;
+
+/* function prototypes */
+void boot_mark(boot_phase phase);
+void boot_report(void);
+
+#endif /* BOOT_H */
@@ -31,7 +31,7 @@
  */
 
 --stack_size=0x1000
---heap_size=0x8000
+--heap_size=0x7800
 --entry_point=resetISR
 --diag_suppress=10063  /* suppress warning about non _c_int00 entry point */
 
@@ -0,0 +1,558 @@
+/*
+ *  ======== command.c ========
+ *  COMMAND CONSOLE, PARSING IN PLACE IN THE CONSOLE RECEIVE RING.
+ */
+
+#include <limits.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#include "alphabet.h"
+#include "boot.h"
+#include "command.h"
+#include "console.h"
+#include "dsp.h"
+#include "energy.h"
+#include "link.h"
+#include "lpds.h"
+#include "msgqueue.h"
+#include "msgstore.h"
+#include "optical.h"
+#include "profile.h"
+#include "rope.h"
+#include "slab.h"
+#include "speed.h"
+
+#if MORSE_STORE || defined(MORSE_HOST)
+#define HAVE_STORE 1
+#else
+#define HAVE_STORE 0
+#endif
+
+/* firmware entry points, see gpiointerrupt.c */
+extern int queue_message(const char *text, unsigned char priority, msgqueue_release_fxn release);
+extern int queue_rope(rope *r, unsigned char priority);
+extern int set_wpm(unsigned int wpm);
+extern int set_unit_us(uint32_t unit_us);
+extern int set_farnsworth(unsigned int wpm);
+extern void set_beacon(unsigned char enabled);
+extern void set_link(unsigned char enabled);
+extern void press_button(unsigned char button);
+extern uint32_t tick_period_us;
+
+volatile command_stat command_stats;
+
+/* --- a stretch of the receive ring, from pos up to but not including end,
+ * both as offsets from the oldest waiting byte --- */
+typedef struct {
+    size_t pos;
+    size_t end;
+} command_cursor;
+
+/* the streamed message the console is appending to, if it is live */
+static rope stream;
+
+/* how far into the ring the current line has been searched for its end,
+ * and whether the line is the rest of one too long to hold, to be ignored */
+static size_t scanned = 0;
+static unsigned char overlong = 0;
+
+/* a command whose output comes a step per command_poll(), so that the
+ * polling build can get back to the sequencer between steps: handed the
+ * step to do, it returns 1 if there is another */
+typedef int (*command_step_fxn)(unsigned char step);
+
+static command_step_fxn pending = NULL;
+static unsigned char pending_step;
+
+static void skip_spaces(command_cursor *cursor) {
+
+    while (cursor->pos < cursor->end && console_rx_peek(cursor->pos) == ' ') {
+        ++cursor->pos;
+    }
+}
+
+/* @return -> 1, past the word and any spaces after it, if the cursor is on
+ *            word followed by a space or the end of the line; 0 if not */
+static int match_word(command_cursor *cursor, const char *word) {
+
+    size_t pos = cursor->pos;
+
+    for (; *word != '\0'; ++word, ++pos) {
+        if (pos >= cursor->end || console_rx_peek(pos) != *word) {
+            return 0;
+        }
+    }
+    if (pos < cursor->end && console_rx_peek(pos) != ' ') {
+        return 0;
+    }
+
+    cursor->pos = pos;
+    skip_spaces(cursor);
+
+    return 1;
+}
+
+/* @return -> 1, past the number, if the cursor is on an unsigned decimal
+ *            number that fills the rest of the line; 0 if not */
+static int parse_uint(command_cursor *cursor, unsigned int *value) {
+
+    size_t pos = cursor->pos;
+    char c;
+
+    *value = 0;
+    for (; pos < cursor->end && (c = console_rx_peek(pos)) >= '0' && c <= '9'; ++pos) {
+        /* too large for an unsigned int; the command checks its own range */
+        if (*value > (UINT_MAX - (unsigned int)(c - '0')) / 10) {
+            return 0;
+        }
+        *value = *value * 10 + (unsigned int)(c - '0');
+    }
+    if (pos == cursor->pos) {
+        return 0;
+    }
+
+    cursor->pos = pos;
+    skip_spaces(cursor);
+
+    return cursor->pos == cursor->end;
+}
+
+/* hand a queued text's block back to the text pool; queued as the
+ * message's msgqueue_release_fxn */
+static void release_text(const char *text) {
+
+    slab_free(&slab_text, (void *)text);
+}
+
+/* queue the rest of the line, which is the one place it is copied */
+static const char *queue_command(command_cursor *cursor) {
+
+    unsigned char priority = MSGQUEUE_ROUTINE;
+    size_t length = cursor->end - cursor->pos;
+    char *slot;
+    size_t i;
+
+    /* only a digit and a colon make a priority; "a:b" is text */
+    if (length >= 2 && console_rx_peek(cursor->pos + 1) == ':' &&
+        console_rx_peek(cursor->pos) >= '0' && console_rx_peek(cursor->pos) <= '9') {
+        priority = (unsigned char)(console_rx_peek(cursor->pos) - '0');
+        cursor->pos += 2;
+        length -= 2;
+        if (priority >= MSGQUEUE_NUM_PRIORITIES) {
+            return "bad priority";
+        }
+    }
+    if (length == 0) {
+        return "no text";
+    }
+    if (length >= SLAB_TEXT_LEN) {
+        return "text too long";
+    }
+
+    slot = slab_alloc(&slab_text);
+    if (slot == NULL) {
+        return "too many queued";
+    }
+
+    for (i = 0; i < length; ++i) {
+        slot[i] = console_rx_peek(cursor->pos + i);
+    }
+    slot[length] = '\0';
+
+    if (queue_message(slot, priority, release_text) != MSGQUEUE_STATUS_SUCCESS) {
+        slab_free(&slab_text, slot);
+        return "queue full";
+    }
+
+    return NULL;
+}
+
+/* start a streamed message, queued straight away and keyed as its text is
+ * added with more, or close the one under way */
+static const char *stream_command(command_cursor *cursor) {
+
+    unsigned int priority = MSGQUEUE_ROUTINE;
+
+    if (match_word(cursor, "end") && cursor->pos == cursor->end) {
+        if (!stream.live || !stream.open) {
+            return "no stream open";
+        }
+        rope_close(&stream);
+        return NULL;
+    }
+    if (cursor->pos != cursor->end && !parse_uint(cursor, &priority)) {
+        return "stream [PRIORITY] or stream end";
+    }
+    if (priority >= MSGQUEUE_NUM_PRIORITIES) {
+        return "bad priority";
+    }
+    if (stream.live) {
+        return "stream under way";
+    }
+
+    rope_open(&stream);
+    if (queue_rope(&stream, (unsigned char)priority) != MSGQUEUE_STATUS_SUCCESS) {
+        rope_release(&stream);
+        return "queue full";
+    }
+
+    return NULL;
+}
+
+/* add the rest of the line to the streamed message, after a space if it
+ * is not the first; it is copied out of the ring a piece at a time */
+static const char *more_command(command_cursor *cursor) {
+
+    char piece[16];
+    size_t count = 0;
+
+    if (!stream.live || !stream.open) {
+        return "no stream open";
+    }
+    if (cursor->pos == cursor->end) {
+        return "no text";
+    }
+
+    if (stream.appended != 0) {
+        piece[count++] = ' ';
+    }
+    while (cursor->pos < cursor->end) {
+        for (; count < sizeof(piece) && cursor->pos < cursor->end; ++count) {
+            piece[count] = console_rx_peek(cursor->pos++);
+        }
+        if (rope_append(&stream, piece, count) != count) {
+            return "stream full, rest of line dropped";
+        }
+        count = 0;
+    }
+
+    return NULL;
+}
+
+#if HAVE_STORE
+/* keep the rest of the line in the store; its timeline is compiled at
+ * the current speed */
+static const char *store_command(command_cursor *cursor) {
+
+    char text[MSGSTORE_TEXT_LEN + 1];
+    size_t length = cursor->end - cursor->pos;
+    size_t i;
+    int32_t id;
+
+    if (length == 0) {
+        return "no text";
+    }
+    if (length > MSGSTORE_TEXT_LEN) {
+        return "text too long";
+    }
+    for (i = 0; i < length; ++i) {
+        text[i] = console_rx_peek(cursor->pos + i);
+    }
+    text[length] = '\0';
+
+    id = msgstore_append(text, tick_period_us);
+    if (id < 0) {
+        return "store failed";
+    }
+    console_printf("id %ld\r\n", (long)id);
+
+    return NULL;
+}
+
+/* queue a stored message, read straight into a block of the text pool */
+static const char *play_command(command_cursor *cursor) {
+
+    unsigned int id, priority = MSGQUEUE_ROUTINE;
+    command_cursor rest;
+    char *slot;
+    int status;
+
+    /* the ID may be followed by a priority */
+    rest = *cursor;
+    while (rest.pos < rest.end && console_rx_peek(rest.pos) != ' ') {
+        ++rest.pos;
+    }
+    cursor->end = rest.pos;
+    skip_spaces(&rest);
+    if (!parse_uint(cursor, &id) ||
+        (rest.pos != rest.end && !parse_uint(&rest, &priority))) {
+        return "play ID [PRIORITY]";
+    }
+    if (priority >= MSGQUEUE_NUM_PRIORITIES) {
+        return "bad priority";
+    }
+
+    slot = slab_alloc(&slab_text);
+    if (slot == NULL) {
+        return "too many queued";
+    }
+    status = msgstore_get_text((int32_t)id, slot, SLAB_TEXT_LEN);
+    if (status != MSGSTORE_STATUS_SUCCESS) {
+        slab_free(&slab_text, slot);
+        return status == MSGSTORE_STATUS_NO_SPACE ? "text too long" : "no such message";
+    }
+
+    if (queue_message(slot, (unsigned char)priority, release_text) != MSGQUEUE_STATUS_SUCCESS) {
+        slab_free(&slab_text, slot);
+        return "queue full";
+    }
+
+    return NULL;
+}
+#endif
+
+/* select the alphabet for characters past ASCII, or with no name list
+ * them, and their tables, with the one selected marked */
+static const char *alphabet_command(command_cursor *cursor) {
+
+    const alphabet_table *table;
+    unsigned int id;
+
+    if (cursor->pos == cursor->end) {
+        for (id = 0; id < ALPHABET_COUNT; ++id) {
+            table = &alphabet_tables[id];
+            console_printf("%c %-8s %3u code points in %3u slots, %4u bytes\r\n",
+                           id == (unsigned int)alphabet_current() ? '*' : ' ', table->name, table->count,
+                           table->size, table->buckets + table->size * (uint32_t)sizeof(alphabet_slot));
+        }
+        return NULL;
+    }
+    for (id = 0; id < ALPHABET_COUNT; ++id) {
+        if (match_word(cursor, alphabet_tables[id].name) && cursor->pos == cursor->end) {
+            alphabet_select((alphabet_id)id);
+            return NULL;
+        }
+    }
+
+    return "alphabet is latin, cyrillic, greek or wabun";
+}
+
+static void report_link(void) {
+
+    link_report(tick_period_us);
+}
+
+/* what stats prints, a report a step */
+static void (*const stats_reports[])(void) = {
+    profile_report, msgqueue_report, slab_report, rope_report,
+    command_report, speed_report, report_link, energy_report,
+#if HAVE_STORE
+    msgstore_report,
+#endif
+#if MORSE_OPTICAL_RX
+    optical_report,
+#endif
+#if MORSE_LPDS
+    lpds_report,
+#endif
+};
+
+#define NUM_STATS_REPORTS (sizeof(stats_reports) / sizeof(stats_reports[0]))
+
+static int stats_step(unsigned char step) {
+
+    stats_reports[step]();
+    return step + 1 < NUM_STATS_REPORTS;
+}
+
+/* carry out one line
+ * @return -> NULL on success, or the reason it failed */
+static const char *execute(command_cursor *cursor) {
+
+    unsigned int value;
+
+    if (match_word(cursor, "wpm")) {
+        if (!parse_uint(cursor, &value) || set_wpm(value) != 0) {
+            return "wpm is 1 to 60000";
+        }
+        return NULL;
+    }
+    if (match_word(cursor, "unit")) {
+        if (!parse_uint(cursor, &value) || set_unit_us(value) != 0) {
+            return "unit is 20 to 2000000 us";
+        }
+        return NULL;
+    }
+    if (match_word(cursor, "farnsworth")) {
+        if (!parse_uint(cursor, &value) || set_farnsworth(value) != 0) {
+            return "farnsworth is 0 (off) to 60000 wpm";
+        }
+        return NULL;
+    }
+    if (match_word(cursor, "sweep") && cursor->pos == cursor->end) {
+        if (speed_start() != SPEED_STATUS_SUCCESS) {
+            return "sweep under way";
+        }
+        return NULL;
+    }
+    if (match_word(cursor, "queue")) {
+        return queue_command(cursor);
+    }
+    if (match_word(cursor, "stream")) {
+        return stream_command(cursor);
+    }
+    if (match_word(cursor, "more")) {
+        return more_command(cursor);
+    }
+    if (match_word(cursor, "stats")) {
+        pending = stats_step;
+        pending_step = 0;
+        return NULL;
+    }
+    if (match_word(cursor, "boot") && cursor->pos == cursor->end) {
+        boot_report();
+        return NULL;
+    }
+    if (match_word(cursor, "energy") && cursor->pos == cursor->end) {
+        energy_report();
+        return NULL;
+    }
+    if (match_word(cursor, "current")) {
+        static const char *const names[ENERGY_NUM_CURRENTS] = {"led0", "led1", "active", "idle", "lpds"};
+        unsigned char which;
+
+        for (which = 0; which < ENERGY_NUM_CURRENTS && !match_word(cursor, names[which]); ++which) {
+        }
+        if (which == ENERGY_NUM_CURRENTS || !parse_uint(cursor, &value)) {
+            return "current is led0, led1, active, idle or lpds, then uA";
+        }
+        energy_set_current((energy_current)which, value);
+        return NULL;
+    }
+#if MORSE_LPDS
+    if (match_word(cursor, "sleep")) {
+        if (!parse_uint(cursor, &value) || (value != 0 && value < LPDS_MIN_GAP_US)) {
+            return "sleep is 0 (never) or a gap of 20000 us or more";
+        }
+        lpds_min_gap_us = value;
+        return NULL;
+    }
+#endif
+    if (match_word(cursor, "dsp") && cursor->pos == cursor->end) {
+        pending = dsp_benchmark_step;
+        pending_step = 0;
+        return NULL;
+    }
+    if (match_word(cursor, "mode")) {
+        if (match_word(cursor, "beacon") && cursor->pos == cursor->end) {
+            set_beacon(1);
+            return NULL;
+        }
+        if (match_word(cursor, "quiet") && cursor->pos == cursor->end) {
+            set_beacon(0);
+            return NULL;
+        }
+        if (match_word(cursor, "link") && cursor->pos == cursor->end) {
+            set_link(1);
+            return NULL;
+        }
+        if (match_word(cursor, "morse") && cursor->pos == cursor->end) {
+            set_link(0);
+            return NULL;
+        }
+        return "mode is beacon, quiet, link or morse";
+    }
+    if (match_word(cursor, "alphabet")) {
+        return alphabet_command(cursor);
+    }
+    if (match_word(cursor, "press")) {
+        if (!parse_uint(cursor, &value) || value > 1) {
+            return "button is 0 or 1";
+        }
+        press_button((unsigned char)value);
+        return NULL;
+    }
+#if HAVE_STORE
+    if (match_word(cursor, "store")) {
+        return store_command(cursor);
+    }
+    if (match_word(cursor, "play")) {
+        return play_command(cursor);
+    }
+#endif
+
+    return "unknown command";
+}
+
+/* carry out the oldest complete line waiting, if there is one, or the
+ * next step of a command that prints a step at a time; call it whenever
+ * there is time to spare, as each call does a bounded amount of work
+ * @return -> 1 if a line or a step was dealt with, 0 if there is no
+ *            complete line yet */
+int command_poll(void) {
+
+    command_cursor cursor;
+    size_t count;
+    const char *error;
+    char c = 0;
+
+    if (pending != NULL) {
+        PROFILE_BEGIN(step);
+
+        if (!pending(pending_step++)) {
+            pending = NULL;
+            console_write("ok\r\n", 4);
+        }
+
+        PROFILE_TASK_END(PROFILE_TASK_CONSOLE, step);
+        return 1;
+    }
+
+    console_rx_poll();
+    count = console_rx_count();
+
+    /* only look at what arrived since the last call */
+    while (scanned < count && (c = console_rx_peek(scanned)) != '\n' && c != '\r') {
+        ++scanned;
+    }
+    if (scanned == count) {
+        if (count == CONSOLE_RX_LEN) {
+            /* the ring is full without a line end: nothing can follow */
+            console_rx_consume(count);
+            scanned = 0;
+            if (!overlong) {
+                ++command_stats.overlong;
+                overlong = 1;
+            }
+        }
+        return 0;
+    }
+
+    cursor.pos = 0;
+    cursor.end = scanned;
+    skip_spaces(&cursor);
+
+    if (overlong) {
+        overlong = 0;
+        console_write("error: line too long\r\n", 22);
+    }
+    else if (cursor.pos != cursor.end) {
+        PROFILE_BEGIN(busy);
+
+        ++command_stats.commands;
+        error = execute(&cursor);
+        if (error != NULL) {
+            ++command_stats.errors;
+            console_printf("error: %s\r\n", error);
+        }
+        else if (pending == NULL) {
+            /* one that prints a step at a time answers after the last */
+            console_write("ok\r\n", 4);
+        }
+
+        PROFILE_TASK_END(PROFILE_TASK_CONSOLE, busy);
+    }
+
+    console_rx_consume(scanned + 1);
+    scanned = 0;
+
+    return 1;
+}
+
+/* print the totals over the console */
+void command_report(void) {
+
+    console_printf("console: %u commands, %u errors, %u overlong lines, %u output bytes dropped\r\n",
+                   command_stats.commands, command_stats.errors, command_stats.overlong, console_tx_dropped);
+}
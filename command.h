@@ -0,0 +1,77 @@
+/*
+ *  ======== command.h ========
+ *  LINE-BASED COMMAND CONSOLE OVER THE UART. LINES ARE PARSED WHERE THE
+ *  DMA LEFT THEM IN THE CONSOLE'S RECEIVE RING (SEE console.h), WITHOUT
+ *  BEING COPIED OUT FIRST; ONLY THE TEXT OF A QUEUED MESSAGE IS COPIED,
+ *  INTO A BLOCK OF THE TEXT POOL (SEE slab.h) THAT OUTLIVES THE RING.
+ *
+ *  Commands, one per line ending in CR, LF or both, each answered with
+ *  "ok" or "error: <reason>":
+ *
+ *    wpm N             key at N words per minute, 1 to 60000 (one tick per dot)
+ *    unit N            key with a tick of N us, 20 to 2000000
+ *    farnsworth N      space characters out to an overall N wpm, keying
+ *                      them at the wpm above; 0 for off
+ *    sweep             find the fastest speed this build keeps up with
+ *                      (see speed.h); the results follow some 10 s later
+ *    queue [P:]TEXT    queue TEXT at priority P (0 routine, 1 priority,
+ *                      2 distress; routine if left out)
+ *    stream [P]        queue a streamed message at priority P, of any
+ *                      length, keyed as its text arrives (see rope.h)
+ *    more TEXT         add TEXT to the streamed message, after a space
+ *    stream end        close the streamed message, which ends once the
+ *                      text added so far has been keyed
+ *    stats             print the profile, queue, memory pool, stream,
+ *                      console, speed, link, energy and deep sleep
+ *                      statistics
+ *    boot              print the time taken to reach each phase of start-up
+ *    dsp               time the signal processing kernels (see dsp.h)
+ *    energy            print what each message has cost (see energy.h)
+ *    current W N       take N uA as the current drawn by W: led0, led1, the
+ *                      CPU active or idle, or the device in deep sleep (lpds)
+ *    sleep N           with MORSE_LPDS, sleep through dark gaps of N us or
+ *                      more, at least 20000 (see lpds.h); 0 for never
+ *    mode beacon       key messages[] whenever the queue is empty
+ *    mode quiet        key queued messages only
+ *    mode link         key messages as data frames (see link.h), from the
+ *                      next one on
+ *    mode morse        key messages as Morse, from the next one on
+ *    alphabet [NAME]   key characters past ASCII in NAME's code: latin
+ *                      (none), cyrillic, greek or wabun (see alphabet.h),
+ *                      from the next character on; with no NAME, list them
+ *    press N           act as if button N (0 or 1) had been pressed
+ *    store TEXT        keep TEXT in the message store (see msgstore.h) and
+ *                      print its ID
+ *    play N [P]        queue stored message N at priority P (routine if
+ *                      left out)
+ *
+ *  Speeds take effect from the next tick and Farnsworth from the next gap,
+ *  even part-way through a message, without stretching the one under way.
+ *
+ *  stats and dsp print a report or a kernel for each call to
+ *  command_poll(), and answer once the last is out, so that in the polling
+ *  build the sequencer is kept waiting for one step at most.
+ *
+ *  store and play are there when the store is built in: with MORSE_STORE
+ *  on target, and always on the host, where they fail until a store is open.
+ */
+
+#ifndef COMMAND_H
+#define COMMAND_H
+
+#include <stdint.h>
+
+/* --- running totals --- */
+typedef struct {
+    uint32_t commands;
+    uint32_t errors;
+    uint32_t overlong;          /* lines too long for the ring, discarded */
+} command_stat;
+
+extern volatile command_stat command_stats;
+
+/* function prototypes */
+int command_poll(void);
+void command_report(void);
+
+#endif /* COMMAND_H */
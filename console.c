@@ -0,0 +1,297 @@
+/*
+ *  ======== console.c ========
+ *  RING BUFFERED TEXT OUTPUT AND DMA RING INPUT OVER THE BACKCHANNEL UART.
+ */
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "console.h"
+
+#if defined(MORSE_HOST)
+#include <fcntl.h>
+#include <unistd.h>
+
+static int console_fd = -1;
+#else
+#include <ti/drivers/UART.h>
+#include "ti_drivers_config.h"
+
+static UART_Handle uart = NULL;
+#endif
+
+#define RX_MASK (CONSOLE_RX_LEN - 1)
+#define TX_MASK (CONSOLE_TX_LEN - 1)
+
+/* output bytes dropped for want of room */
+volatile uint32_t console_tx_dropped = 0;
+
+/* receive ring; head counts bytes written into it and tail bytes consumed,
+ * both free-running, so head - tail is the number waiting */
+static char rx_ring[CONSOLE_RX_LEN];
+static volatile size_t rx_head = 0;
+static volatile size_t rx_tail = 0;
+
+#if !defined(MORSE_HOST)
+/* nonzero while a read is in flight; zero when stalled on a full ring */
+static volatile unsigned char rx_reading = 0;
+
+/* nonzero while receiving is stopped by console_suspend() */
+static volatile unsigned char rx_suspended = 0;
+
+/* transmit ring, counted as the receive ring is; tail only moves on once
+ * the UART has sent the bytes, so everything from tail to head is taken */
+static char tx_ring[CONSOLE_TX_LEN];
+static volatile size_t tx_head = 0;
+static volatile size_t tx_tail = 0;
+
+/* nonzero while a write is in flight */
+static volatile unsigned char tx_writing = 0;
+#endif
+
+static void (*rx_notify)(void) = NULL;
+
+/* @return -> how many bytes the next read can take in one contiguous run */
+static size_t rx_space(void) {
+
+    size_t space = CONSOLE_RX_LEN - (rx_head - rx_tail);
+    size_t contiguous = CONSOLE_RX_LEN - (rx_head & RX_MASK);
+
+    if (space > contiguous) {
+        space = contiguous;
+    }
+    return space < CONSOLE_RX_CHUNK ? space : CONSOLE_RX_CHUNK;
+}
+
+#if !defined(MORSE_HOST)
+/* point the next DMA read at the free space, if there is any */
+static void start_read(void) {
+
+    size_t length = rx_space();
+
+    rx_reading = length != 0;
+    if (rx_reading) {
+        UART_read(uart, &rx_ring[rx_head & RX_MASK], length);
+    }
+}
+
+/* a read has finished, full or at an idle line: take the bytes in and
+ * start the next one straight away */
+static void rx_callback(UART_Handle handle, void *buffer, size_t count) {
+
+    rx_head += count;
+    if (rx_suspended) {
+        rx_reading = 0;
+    }
+    else {
+        start_read();
+    }
+
+    if (count != 0 && rx_notify != NULL) {
+        rx_notify();
+    }
+}
+
+/* hand the UART what is waiting, up to the end of the ring; called with
+ * interrupts off or from tx_callback() */
+static void start_write(void) {
+
+    size_t length = tx_head - tx_tail;
+    size_t contiguous = CONSOLE_TX_LEN - (tx_tail & TX_MASK);
+
+    if (length > contiguous) {
+        length = contiguous;
+    }
+    tx_writing = length != 0;
+    if (tx_writing) {
+        UART_write(uart, &tx_ring[tx_tail & TX_MASK], length);
+    }
+}
+
+/* a write has been sent: give its bytes back and send whatever came meanwhile */
+static void tx_callback(UART_Handle handle, void *buffer, size_t count) {
+
+    tx_tail += count;
+    start_write();
+}
+#endif
+
+/* open the UART and start receiving; output written before this is discarded */
+void console_init(void) {
+
+#if !defined(MORSE_HOST)
+    UART_Params params;
+
+    UART_init();
+    UART_Params_init(&params);
+    params.baudRate = CONSOLE_BAUD_RATE;
+    params.writeDataMode = UART_DATA_BINARY;
+    params.readDataMode = UART_DATA_BINARY;
+    params.readMode = UART_MODE_CALLBACK;
+    params.readCallback = rx_callback;
+    params.readReturnMode = UART_RETURN_PARTIAL;
+    params.readEcho = UART_ECHO_OFF;
+    params.writeMode = UART_MODE_CALLBACK;
+    params.writeCallback = tx_callback;
+
+    /* the console is optional, so carry on without it on failure */
+    uart = UART_open(CONFIG_UART_0, &params);
+    if (uart != NULL) {
+        start_read();
+    }
+#endif
+}
+
+#if defined(MORSE_HOST)
+/* use a file descriptor, such as the master side of a pty, for both
+ * output and input in place of stdout
+ * @return -> 0, or -1 if it cannot be made non-blocking */
+int console_attach(int fd) {
+
+    if (fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0) {
+        return -1;
+    }
+    console_fd = fd;
+
+    return 0;
+}
+#endif
+
+/* write raw text without waiting: it is copied into the transmit ring,
+ * and whatever does not fit is dropped and counted; safe from any thread
+ * or interrupt */
+void console_write(const char *text, size_t length) {
+
+#if defined(MORSE_HOST)
+    /* nobody may be reading an attached pty, so drop what it cannot take */
+    ssize_t written = write(console_fd >= 0 ? console_fd : STDOUT_FILENO, text, length);
+
+    if (written < (ssize_t)length) {
+        console_tx_dropped += length - (written < 0 ? 0 : (size_t)written);
+    }
+#else
+    uintptr_t key;
+    size_t space, i;
+
+    if (uart == NULL) {
+        return;
+    }
+
+    /* interrupts are held off for the copy, a line at a time, so that a
+     * thread printing over another's line cannot split it */
+    key = HwiP_disable();
+    space = CONSOLE_TX_LEN - (tx_head - tx_tail);
+    if (length > space) {
+        console_tx_dropped += length - space;
+        length = space;
+    }
+    for (i = 0; i < length; ++i) {
+        tx_ring[(tx_head + i) & TX_MASK] = text[i];
+    }
+    tx_head += length;
+    if (!tx_writing) {
+        start_write();
+    }
+    HwiP_restore(key);
+#endif
+}
+
+/* write formatted text, as printf(); longer than CONSOLE_LINE_LEN - 1
+ * bytes it is truncated. Formatted on the caller's stack, so that two
+ * threads can print at once */
+void console_printf(const char *format, ...) {
+
+    char line[CONSOLE_LINE_LEN];
+    va_list args;
+    int length;
+
+    va_start(args, format);
+    length = vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+
+    if (length > 0) {
+        console_write(line, length < (int)sizeof(line) ? (size_t)length : sizeof(line) - 1);
+    }
+}
+
+/* stop receiving, so that the UART no longer keeps the device out of deep
+ * sleep; whatever arrives before console_resume() is lost */
+void console_suspend(void) {
+
+#if !defined(MORSE_HOST)
+    rx_suspended = 1;
+    if (uart != NULL && rx_reading) {
+        /* the read finishes with whatever it has, through rx_callback() */
+        UART_readCancel(uart);
+    }
+#endif
+}
+
+/* start receiving again after console_suspend() */
+void console_resume(void) {
+
+#if !defined(MORSE_HOST)
+    rx_suspended = 0;
+    if (uart != NULL && !rx_reading) {
+        start_read();
+    }
+#endif
+}
+
+/* have a function called, from the UART interrupt, whenever input arrives
+ * @param notify -> the function, or NULL for none */
+void console_rx_notify(void (*notify)(void)) {
+
+    rx_notify = notify;
+}
+
+/* bring in any input waiting; the DMA does this by itself on target, and
+ * on the host it reads whatever the attached descriptor has ready */
+void console_rx_poll(void) {
+
+#if defined(MORSE_HOST)
+    ssize_t count;
+    size_t length;
+
+    while (console_fd >= 0 && (length = rx_space()) != 0) {
+        count = read(console_fd, &rx_ring[rx_head & RX_MASK], length);
+        if (count <= 0) {
+            break;
+        }
+        rx_head += (size_t)count;
+    }
+#endif
+}
+
+/* @return -> the number of received bytes waiting to be consumed */
+size_t console_rx_count(void) {
+
+    return rx_head - rx_tail;
+}
+
+/* @param offset -> position past the oldest waiting byte, less than console_rx_count()
+ * @return -> the byte at that position, read where it landed */
+char console_rx_peek(size_t offset) {
+
+    return rx_ring[(rx_tail + offset) & RX_MASK];
+}
+
+/* give received bytes back to the ring once they have been dealt with
+ * @param length -> how many of the oldest waiting bytes to give back */
+void console_rx_consume(size_t length) {
+
+    uintptr_t key = HwiP_disable();
+
+    rx_tail += length;
+#if !defined(MORSE_HOST)
+    /* a read stalled on a full ring can go again */
+    if (!rx_reading && uart != NULL) {
+        start_read();
+    }
+#endif
+    HwiP_restore(key);
+}
@@ -0,0 +1,60 @@
+/*
+ *  ======== console.h ========
+ *  TEXT OUTPUT OVER THE LAUNCHPAD'S XDS110 BACKCHANNEL UART (CONFIG_UART_0),
+ *  AND INPUT RECEIVED BY DMA INTO A RING THAT IS READ IN PLACE. ON THE HOST
+ *  (MORSE_HOST DEFINED) OUTPUT GOES TO STDOUT, OR TO A FILE DESCRIPTOR SUCH
+ *  AS A PTY GIVEN TO console_attach(), WHICH INPUT IS THEN READ FROM.
+ *
+ *  The receive ring is filled in chunks: each UART_read() in callback mode
+ *  hands the DMA the free space up to the end of the ring (at most
+ *  CONSOLE_RX_CHUNK bytes) and returns early once the line goes idle. The
+ *  reader looks at the bytes where they landed with console_rx_peek() and
+ *  gives them back with console_rx_consume(). When the ring is full the
+ *  next read waits for space, and the UART's FIFO overflows meanwhile.
+ *  console_suspend() stops receiving for a deep sleep (see lpds.h).
+ *
+ *  Output never waits for the UART, so printing cannot hold up a tick
+ *  from whatever context it is done in: console_write() copies the text
+ *  into a transmit ring and returns, and UART_write() in callback mode
+ *  sends it from there, each write starting the next as it finishes.
+ *  The ring holds a whole "stats" report, about 2 KB with every option
+ *  built in, with room for mainThread()'s reports besides; what does not
+ *  fit is dropped and counted in console_tx_dropped.
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CONSOLE_BAUD_RATE   115200
+
+/* receive ring size, a power of two, and the most handed to one read */
+#define CONSOLE_RX_LEN      256
+#define CONSOLE_RX_CHUNK    64
+
+/* transmit ring size, a power of two, and the longest console_printf() */
+#define CONSOLE_TX_LEN      4096
+#define CONSOLE_LINE_LEN    160
+
+extern volatile uint32_t console_tx_dropped;
+
+/* function prototypes */
+void console_init(void);
+void console_write(const char *text, size_t length);
+void console_printf(const char *format, ...);
+
+void console_suspend(void);
+void console_resume(void);
+void console_rx_notify(void (*notify)(void));
+void console_rx_poll(void);
+size_t console_rx_count(void);
+char console_rx_peek(size_t offset);
+void console_rx_consume(size_t length);
+
+#if defined(MORSE_HOST)
+int console_attach(int fd);
+#endif
+
+#endif /* CONSOLE_H */
@@ -0,0 +1,118 @@
+/*
+ *  ======== decoder.c ========
+ *  STREAMING MORSE DECODER.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "decoder.h"
+#include "morse.h"
+
+/* how quickly the unit estimate follows the marks: each mark moves it
+ * 1/2^UNIT_TRACKING_SHIFT of the way */
+#define UNIT_TRACKING_SHIFT 3
+
+/* start a decoder
+ * @param unit -> the expected length of one tick, in the caller's counts
+ * @param emit -> called with each character decoded, and ' ' between words */
+void decoder_init(morse_decoder *decoder, uint32_t unit, decoder_emit_fxn emit) {
+
+    decoder->unit = (unit != 0 ? unit : 1) << DECODER_UNIT_SHIFT;
+    decoder->count = 0;
+    decoder->overflowed = 0;
+    decoder->word_pending = 0;
+    decoder->emit = emit;
+    decoder->characters = 0;
+    decoder->unknown = 0;
+}
+
+/* @param half_ticks -> a boundary, in half ticks since the boundaries fall
+ *                      half way between whole ticks
+ * @return -> 1 if length is longer than the boundary */
+static unsigned char longer_than(const morse_decoder *decoder, uint32_t length, uint32_t half_ticks) {
+
+    return ((uint64_t)length << (DECODER_UNIT_SHIFT + 1)) > (uint64_t)half_ticks * decoder->unit;
+}
+
+/* hand back the character whose symbols have been collected, if any */
+static void finish_character(morse_decoder *decoder) {
+
+    char character;
+
+    if (decoder->count == 0) {
+        return;
+    }
+    decoder->symbols[decoder->count] = '\0';
+    character = decoder->overflowed ? '\0' : get_character(decoder->symbols);
+    if (character == '\0') {
+        character = '?';
+        ++decoder->unknown;
+    }
+
+    decoder->emit(character);
+    ++decoder->characters;
+    decoder->count = 0;
+    decoder->overflowed = 0;
+    decoder->word_pending = 1;
+}
+
+/* a mark has ended
+ * @param length -> how long it lasted, in the caller's counts */
+void decoder_mark(morse_decoder *decoder, uint32_t length) {
+
+    uint32_t dot = (uint32_t)(dot_len - 1);
+    uint32_t dash = (uint32_t)(dash_len - 1);
+    unsigned char is_dash = longer_than(decoder, length, dot + dash);
+    uint32_t measured = ((length << DECODER_UNIT_SHIFT) / (is_dash ? dash : dot));
+
+    /* follow the sender's speed */
+    if (measured > decoder->unit) {
+        decoder->unit += (measured - decoder->unit) >> UNIT_TRACKING_SHIFT;
+    }
+    else {
+        decoder->unit -= (decoder->unit - measured) >> UNIT_TRACKING_SHIFT;
+    }
+    if (decoder->unit == 0) {
+        decoder->unit = 1;
+    }
+
+    if (decoder->count < DECODER_MAX_SYMBOLS) {
+        decoder->symbols[decoder->count++] = is_dash ? '-' : '.';
+    }
+    else {
+        decoder->overflowed = 1;
+    }
+}
+
+/* a space is still going on; call it as often as convenient to have each
+ * character, and the space after a word, handed back without waiting for
+ * the next mark
+ * @param length -> how long the space has lasted so far */
+void decoder_idle(morse_decoder *decoder, uint32_t length) {
+
+    uint32_t character_gap = (uint32_t)(character_pause_len + 4);
+    uint32_t message_gap = character_gap + (uint32_t)(word_pause_len + 1);
+
+    if (longer_than(decoder, length, 2 + character_gap)) {
+        finish_character(decoder);
+    }
+    if (decoder->word_pending && longer_than(decoder, length, character_gap + message_gap)) {
+        decoder->emit(' ');
+        ++decoder->characters;
+        decoder->word_pending = 0;
+    }
+}
+
+/* a space has ended, and a mark begun
+ * @param length -> how long the space lasted */
+void decoder_space(morse_decoder *decoder, uint32_t length) {
+
+    decoder_idle(decoder, length);
+}
+
+/* @return -> the current estimate of one tick, in the caller's counts */
+uint32_t decoder_unit(const morse_decoder *decoder) {
+
+    return decoder->unit >> DECODER_UNIT_SHIFT;
+}
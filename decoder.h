@@ -0,0 +1,54 @@
+/*
+ *  ======== decoder.h ========
+ *  STREAMING MORSE DECODER, THE INVERSE OF THE SEQUENCER. IT IS GIVEN THE
+ *  LENGTH OF EACH MARK AND SPACE AS THEY END, IN WHATEVER UNIT THE CALLER
+ *  COUNTS IN, AND HANDS BACK THE TEXT A CHARACTER AT A TIME, FOLLOWING THE
+ *  SENDER'S SPEED AS IT GOES. NOTHING IN HERE DEPENDS ON THE TI DRIVERS.
+ *
+ *  Lengths are judged in units of one sequencer tick, whose length in the
+ *  caller's counts is estimated from the marks. The boundaries are taken
+ *  half way between the lengths the sequencer keys (see run_sequencer()):
+ *
+ *    mark    dot dot_len - 1, dash dash_len - 1
+ *    space   between symbols 2, between characters character_pause_len + 4,
+ *            between messages that plus word_pause_len + 1; a space
+ *            between words is longer still
+ *
+ *  so a space the length of the gap between messages, or longer, ends a
+ *  word. A character is finished as soon as its space is long enough, not
+ *  when the next mark starts, via decoder_idle().
+ */
+
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <stdint.h>
+
+/* longest code of any character in get_morse() */
+#define DECODER_MAX_SYMBOLS 6
+
+/* unit estimates are held with this many fraction bits */
+#define DECODER_UNIT_SHIFT  4
+
+typedef void (*decoder_emit_fxn)(char character);
+
+/* --- decoder state --- */
+typedef struct {
+    uint32_t unit;                  /* estimated tick, in counts << DECODER_UNIT_SHIFT */
+    char symbols[DECODER_MAX_SYMBOLS + 1];
+    unsigned char count;            /* symbols of the character so far */
+    unsigned char overflowed;       /* more symbols than any character has */
+    unsigned char word_pending;     /* a character has been emitted since the last space */
+    decoder_emit_fxn emit;
+    uint32_t characters;            /* emitted, spaces included */
+    uint32_t unknown;               /* codes with no character, emitted as '?' */
+} morse_decoder;
+
+/* function prototypes */
+void decoder_init(morse_decoder *decoder, uint32_t unit, decoder_emit_fxn emit);
+void decoder_mark(morse_decoder *decoder, uint32_t length);
+void decoder_space(morse_decoder *decoder, uint32_t length);
+void decoder_idle(morse_decoder *decoder, uint32_t length);
+uint32_t decoder_unit(const morse_decoder *decoder);
+
+#endif /* DECODER_H */
@@ -0,0 +1,353 @@
+/*
+ *  ======== dsp.c ========
+ *  FIXED-POINT SIGNAL PROCESSING KERNELS.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "console.h"
+#include "dsp.h"
+#include "profile.h"
+
+/* --- the two M4 DSP instructions everything is built on --- */
+#if defined(__TI_COMPILER_VERSION__) && defined(__TI_ARM_V7M4__)
+#define SMLAD(a, b, acc)    ((int32_t)_smlad((int)(a), (int)(b), (int)(acc)))
+#define QADD16(a, b)        ((uint32_t)_qadd16((int)(a), (int)(b)))
+#elif defined(__ARM_FEATURE_DSP)
+#include <arm_acle.h>
+#define SMLAD(a, b, acc)    ((int32_t)__smlad((int16x2_t)(a), (int16x2_t)(b), (int32_t)(acc)))
+#define QADD16(a, b)        ((uint32_t)__qadd16((int16x2_t)(a), (int16x2_t)(b)))
+#else
+#define SMLAD(a, b, acc)    smlad((a), (b), (acc))
+#define QADD16(a, b)        qadd16((a), (b))
+#endif
+
+/* the halves of a packed pair, and a pair packed */
+#define LO(pair)            ((int16_t)(pair))
+#define HI(pair)            ((int16_t)((pair) >> 16))
+#define PACK(lo, hi)        ((uint32_t)(uint16_t)(lo) | ((uint32_t)(uint16_t)(hi) << 16))
+
+/* @return -> value clamped to a Q15 sample, as SSAT #16 does */
+static inline int16_t saturate(int32_t value) {
+
+    return (int16_t)(value > 32767 ? 32767 : value < -32768 ? -32768 : value);
+}
+
+#if !(defined(__TI_COMPILER_VERSION__) && defined(__TI_ARM_V7M4__)) && !defined(__ARM_FEATURE_DSP)
+/* acc + a.lo * b.lo + a.hi * b.hi, wrapping on overflow as SMLAD does */
+static inline int32_t smlad(uint32_t a, uint32_t b, int32_t acc) {
+
+    return (int32_t)((uint32_t)acc + (uint32_t)((int32_t)LO(a) * LO(b)) +
+                     (uint32_t)((int32_t)HI(a) * HI(b)));
+}
+
+/* both halves added and saturated, as QADD16 does */
+static inline uint32_t qadd16(uint32_t a, uint32_t b) {
+
+    return PACK(saturate((int32_t)LO(a) + LO(b)), saturate((int32_t)HI(a) + HI(b)));
+}
+#endif
+
+/* @return -> two samples from anywhere in memory; the M4 loads them in one go */
+static inline uint32_t load_pair(const q15 *samples) {
+
+    uint32_t pair;
+
+    memcpy(&pair, samples, sizeof(pair));
+    return pair;
+}
+
+/* set up a Goertzel detector
+ * @param coeff -> 2cos(2 pi f / fs) in Q14
+ * @param shift -> how far the input is shifted down first (see dsp.h) */
+void dsp_goertzel_init(dsp_goertzel *goertzel, int16_t coeff, unsigned char shift) {
+
+    goertzel->coeffs = PACK(coeff, -16384);
+    goertzel->shift = shift;
+    dsp_goertzel_reset(goertzel);
+}
+
+/* start a new block */
+void dsp_goertzel_reset(dsp_goertzel *goertzel) {
+
+    goertzel->state = 0;
+}
+
+/* s[n] = x[n] + 2cos(w) s[n-1] - s[n-2]: both products in one SMLAD, with
+ * x[n] riding in the accumulator */
+void dsp_goertzel_feed(dsp_goertzel *goertzel, const q15 *samples, size_t count) {
+
+    uint32_t state = goertzel->state;
+    uint32_t coeffs = goertzel->coeffs;
+    unsigned char shift = goertzel->shift;
+    int16_t next;
+
+    while (count-- != 0) {
+        next = saturate(SMLAD(state, coeffs, (int32_t)(*samples++ >> shift) * 16384) >> 14);
+        state = PACK(next, state);
+    }
+    goertzel->state = state;
+}
+
+/* @return -> the squared magnitude at the detector's frequency over the
+ *            block so far, in the units of the shifted input squared */
+uint32_t dsp_goertzel_power(const dsp_goertzel *goertzel) {
+
+    int32_t s1 = LO(goertzel->state);
+    int32_t s2 = HI(goertzel->state);
+    int64_t power = (int64_t)s1 * s1 + (int64_t)s2 * s2 - (((int64_t)LO(goertzel->coeffs) * s1) >> 14) * s2;
+
+    return power < 0 ? 0 : power > UINT32_MAX ? UINT32_MAX : (uint32_t)power;
+}
+
+/* set up a biquad, coefficients in Q14, a0 taken as 1 */
+void dsp_biquad_init(dsp_biquad *biquad, int16_t b0, int16_t b1, int16_t b2, int16_t a1, int16_t a2) {
+
+    biquad->b0 = b0;
+    biquad->b12 = PACK(b1, b2);
+    biquad->a12 = PACK(-a1, -a2);
+    biquad->x12 = 0;
+    biquad->y12 = 0;
+}
+
+/* y[n] = b0 x[n] + b1 x[n-1] + b2 x[n-2] - a1 y[n-1] - a2 y[n-2], rounded;
+ * in and out may be the same run */
+void dsp_biquad_run(dsp_biquad *biquad, const q15 *in, q15 *out, size_t count) {
+
+    uint32_t x12 = biquad->x12;
+    uint32_t y12 = biquad->y12;
+    int32_t acc;
+    int16_t x, y;
+
+    while (count-- != 0) {
+        x = *in++;
+        acc = (int32_t)biquad->b0 * x + (1 << 13);
+        acc = SMLAD(x12, biquad->b12, acc);
+        acc = SMLAD(y12, biquad->a12, acc);
+        y = saturate(acc >> 14);
+        *out++ = y;
+        x12 = PACK(x, x12);
+        y12 = PACK(y, y12);
+    }
+    biquad->x12 = x12;
+    biquad->y12 = y12;
+}
+
+/* set up a moving average
+ * @param history -> room for the window, 1 << shift samples
+ * @param shift -> log2 of the window length */
+void dsp_average_init(dsp_average *average, q15 *history, unsigned char shift) {
+
+    memset(history, 0, sizeof(*history) << shift);
+    average->history = history;
+    average->sum = 0;
+    average->pos = 0;
+    average->shift = shift;
+}
+
+/* each output the mean of the last 1 << shift inputs */
+void dsp_average_run(dsp_average *average, const q15 *in, q15 *out, size_t count) {
+
+    uint16_t mask = (uint16_t)((1u << average->shift) - 1);
+    int32_t sum = average->sum;
+    uint16_t pos = average->pos;
+    q15 x;
+
+    while (count-- != 0) {
+        x = *in++;
+        sum += x - average->history[pos];
+        average->history[pos] = x;
+        pos = (pos + 1) & mask;
+        *out++ = (q15)(sum >> average->shift);
+    }
+    average->sum = sum;
+    average->pos = pos;
+}
+
+/* set up an envelope follower; each step closes 1/2^shift of the gap */
+void dsp_envelope_init(dsp_envelope *envelope, unsigned char attack_shift, unsigned char release_shift) {
+
+    envelope->level = 0;
+    envelope->attack_shift = attack_shift;
+    envelope->release_shift = release_shift;
+}
+
+/* follow the magnitude of the input */
+void dsp_envelope_run(dsp_envelope *envelope, const q15 *in, q15 *out, size_t count) {
+
+    int32_t level = envelope->level;
+    int32_t magnitude;
+
+    while (count-- != 0) {
+        magnitude = saturate(*in < 0 ? -(int32_t)*in : *in) * 32768;
+        in++;
+        if (magnitude > level) {
+            level += (magnitude - level) >> envelope->attack_shift;
+        }
+        else {
+            level -= (level - magnitude) >> envelope->release_shift;
+        }
+        *out++ = (q15)(level >> 15);
+    }
+    envelope->level = level;
+}
+
+/* @return -> the sum of a[i] * b[i], wrapping as SMLAD does; Q30 for Q15 inputs */
+int32_t dsp_dot(const q15 *a, const q15 *b, size_t count) {
+
+    int32_t acc = 0;
+
+    for (; count >= 2; count -= 2, a += 2, b += 2) {
+        acc = SMLAD(load_pair(a), load_pair(b), acc);
+    }
+    if (count != 0) {
+        acc = (int32_t)((uint32_t)acc + (uint32_t)((int32_t)*a * *b));
+    }
+    return acc;
+}
+
+/* out[i] = a[i] + b[i], saturated; out may be a or b */
+void dsp_add(const q15 *a, const q15 *b, q15 *out, size_t count) {
+
+    uint32_t sum;
+
+    for (; count >= 2; count -= 2, a += 2, b += 2, out += 2) {
+        sum = QADD16(load_pair(a), load_pair(b));
+        memcpy(out, &sum, sizeof(sum));
+    }
+    if (count != 0) {
+        *out = saturate((int32_t)*a + *b);
+    }
+}
+
+/* --- benchmark --- */
+#define BENCH_LEN       256
+#define BENCH_SHIFT     4       /* moving average over 16 */
+
+static q15 bench_in[BENCH_LEN];
+static q15 bench_other[BENCH_LEN];
+static q15 bench_out[BENCH_LEN];
+static q15 bench_history[1 << BENCH_SHIFT];
+
+/* @return -> a checksum of a run of samples, the same on every build */
+static uint32_t checksum(const q15 *samples, size_t count) {
+
+    uint32_t sum = 0;
+
+    while (count-- != 0) {
+        sum = sum * 31 + (uint16_t)*samples++;
+    }
+    return sum;
+}
+
+/* print one kernel's cost per sample, to a tenth, and its checksum */
+static void bench_line(const char *name, uint32_t elapsed, uint32_t check) {
+
+    uint32_t tenths = (uint32_t)((uint64_t)elapsed * 10 / BENCH_LEN);
+
+    console_printf("  %-10s %6u.%u  %08x\r\n", name, tenths / 10, tenths % 10, check);
+}
+
+/* run each kernel over a fixed block, a tone at fs/16 in noise, and print
+ * the cost per sample and a checksum of the output, which must be the same
+ * on target and on the host. Step 0 makes the block; each step after it
+ * times one kernel, so that the console can take them a step at a time
+ * @param step -> the step to do, from 0
+ * @return -> 1 if there is another step */
+int dsp_benchmark_step(unsigned char step) {
+
+    dsp_goertzel goertzel;
+    dsp_biquad biquad;
+    dsp_average average;
+    dsp_envelope envelope;
+    uint32_t seed = 1, start, elapsed = 0;
+    int32_t dot = 0;
+    short unsigned int i, pass;
+
+    /* each kernel twice, timing the second, so that nothing is measured cold */
+    switch (step) {
+        case 0:
+            for (i = 0; i < BENCH_LEN; ++i) {
+                seed = seed * 1103515245u + 12345u;
+                bench_in[i] = (q15)((((i / 8) & 1) ? 8000 : -8000) + (int16_t)(seed >> 16) / 8);
+                bench_other[i] = (q15)(seed >> 8);
+            }
+#if defined(MORSE_HOST)
+            console_printf("dsp (ns per sample, checksum):\r\n");
+#else
+            console_printf("dsp (cycles per sample, checksum):\r\n");
+#endif
+            break;
+
+        case 1:
+            for (pass = 0; pass < 2; ++pass) {
+                dsp_goertzel_init(&goertzel, DSP_Q14(1.8477590650225735), 8);   /* fs/16 */
+                start = profile_now();
+                dsp_goertzel_feed(&goertzel, bench_in, BENCH_LEN);
+                elapsed = profile_now() - start;
+            }
+            bench_line("goertzel", elapsed, dsp_goertzel_power(&goertzel));
+            break;
+
+        case 2:
+            for (pass = 0; pass < 2; ++pass) {
+                /* low pass at fs/16, Q of 0.7 */
+                dsp_biquad_init(&biquad, DSP_Q14(0.0302), DSP_Q14(0.0605), DSP_Q14(0.0302),
+                                DSP_Q14(-1.4514), DSP_Q14(0.5724));
+                start = profile_now();
+                dsp_biquad_run(&biquad, bench_in, bench_out, BENCH_LEN);
+                elapsed = profile_now() - start;
+            }
+            bench_line("biquad", elapsed, checksum(bench_out, BENCH_LEN));
+            break;
+
+        case 3:
+            for (pass = 0; pass < 2; ++pass) {
+                dsp_average_init(&average, bench_history, BENCH_SHIFT);
+                start = profile_now();
+                dsp_average_run(&average, bench_in, bench_out, BENCH_LEN);
+                elapsed = profile_now() - start;
+            }
+            bench_line("average", elapsed, checksum(bench_out, BENCH_LEN));
+            break;
+
+        case 4:
+            for (pass = 0; pass < 2; ++pass) {
+                dsp_envelope_init(&envelope, 2, 6);
+                start = profile_now();
+                dsp_envelope_run(&envelope, bench_in, bench_out, BENCH_LEN);
+                elapsed = profile_now() - start;
+            }
+            bench_line("envelope", elapsed, checksum(bench_out, BENCH_LEN));
+            break;
+
+        case 5:
+            for (pass = 0; pass < 2; ++pass) {
+                start = profile_now();
+                dot = dsp_dot(bench_in, bench_other, BENCH_LEN);
+                elapsed = profile_now() - start;
+            }
+            bench_line("dot", elapsed, (uint32_t)dot);
+            break;
+
+        default:
+            for (pass = 0; pass < 2; ++pass) {
+                start = profile_now();
+                dsp_add(bench_in, bench_other, bench_out, BENCH_LEN);
+                elapsed = profile_now() - start;
+            }
+            bench_line("add", elapsed, checksum(bench_out, BENCH_LEN));
+            return 0;
+    }
+    return 1;
+}
+
+/* the whole of dsp_benchmark_step(), in one go */
+void dsp_benchmark(void) {
+
+    unsigned char step = 0;
+
+    while (dsp_benchmark_step(step++)) {}
+}
@@ -0,0 +1,91 @@
+/*
+ *  ======== dsp.h ========
+ *  FIXED-POINT SIGNAL PROCESSING KERNELS FOR RECEIVE PATHS, AUDIO OR
+ *  OPTICAL. SAMPLES ARE Q15; FILTER COEFFICIENTS ARE Q14, SO THAT THEY CAN
+ *  REACH +/-2. THE CC3220S HAS NO FPU, SO EVERYTHING HERE IS INTEGER.
+ *
+ *  The kernels are written once, in terms of the Cortex-M4's dual 16-bit
+ *  multiply-accumulate (SMLAD) and saturating 16-bit add (QADD16). Built
+ *  for the M4 those are single instructions; anywhere else (MORSE_HOST)
+ *  they are C that does exactly what the instruction does, wrapping
+ *  included, so every kernel gives bit-identical results on both. The
+ *  checksums dsp_benchmark() prints are there to show it.
+ *
+ *    goertzel    power at one frequency over a block; SMLAD per sample
+ *    biquad      direct form I second-order section; two SMLADs per sample
+ *    average     moving average over a power-of-two window
+ *    envelope    peak follower with separate attack and release
+ *    dot         dot product of two sample runs; SMLAD per two samples
+ *    add         saturating sum of two sample runs; QADD16 per two samples
+ *
+ *  Coefficients are worked out offline, or at compile time with DSP_Q14():
+ *  a Goertzel at f Hz sampled at fs takes DSP_Q14(2 * cos(2 * pi * f / fs)).
+ *  Its state saturates unless the input is shifted down far enough; a
+ *  shift of log2(block length) is enough for any frequency between fs/12
+ *  and 5fs/12; nearer 0 or fs/2 the state grows faster and needs more.
+ */
+
+#ifndef DSP_H
+#define DSP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef int16_t q15;
+
+/* a constant in Q14, rounded; for constant expressions only */
+#define DSP_Q14(x)  ((int16_t)((x) * 16384.0 + ((x) >= 0 ? 0.5 : -0.5)))
+
+/* --- Goertzel detector for one frequency --- */
+typedef struct {
+    uint32_t state;             /* s[n-1] in the low half, s[n-2] in the high */
+    uint32_t coeffs;            /* 2cos(w) in Q14 low, -1 in Q14 high */
+    unsigned char shift;        /* input shifted down by this, so the state cannot saturate */
+} dsp_goertzel;
+
+/* --- biquad, direct form I --- */
+typedef struct {
+    int16_t b0;                 /* Q14 */
+    uint32_t b12;               /* b1, b2 in Q14 */
+    uint32_t a12;               /* -a1, -a2 in Q14 */
+    uint32_t x12;               /* x[n-1], x[n-2] */
+    uint32_t y12;               /* y[n-1], y[n-2] */
+} dsp_biquad;
+
+/* --- moving average --- */
+typedef struct {
+    q15 *history;               /* the window, 1 << shift samples */
+    int32_t sum;
+    uint16_t pos;
+    unsigned char shift;
+} dsp_average;
+
+/* --- envelope follower --- */
+typedef struct {
+    int32_t level;              /* Q15 << 15, for resolution at slow rates */
+    unsigned char attack_shift;
+    unsigned char release_shift;
+} dsp_envelope;
+
+/* function prototypes */
+void dsp_goertzel_init(dsp_goertzel *goertzel, int16_t coeff, unsigned char shift);
+void dsp_goertzel_reset(dsp_goertzel *goertzel);
+void dsp_goertzel_feed(dsp_goertzel *goertzel, const q15 *samples, size_t count);
+uint32_t dsp_goertzel_power(const dsp_goertzel *goertzel);
+
+void dsp_biquad_init(dsp_biquad *biquad, int16_t b0, int16_t b1, int16_t b2, int16_t a1, int16_t a2);
+void dsp_biquad_run(dsp_biquad *biquad, const q15 *in, q15 *out, size_t count);
+
+void dsp_average_init(dsp_average *average, q15 *history, unsigned char shift);
+void dsp_average_run(dsp_average *average, const q15 *in, q15 *out, size_t count);
+
+void dsp_envelope_init(dsp_envelope *envelope, unsigned char attack_shift, unsigned char release_shift);
+void dsp_envelope_run(dsp_envelope *envelope, const q15 *in, q15 *out, size_t count);
+
+int32_t dsp_dot(const q15 *a, const q15 *b, size_t count);
+void dsp_add(const q15 *a, const q15 *b, q15 *out, size_t count);
+
+int dsp_benchmark_step(unsigned char step);
+void dsp_benchmark(void);
+
+#endif /* DSP_H */
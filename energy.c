@@ -0,0 +1,228 @@
+/*
+ *  ======== energy.c ========
+ *  PER-MESSAGE ENERGY AND DUTY-CYCLE ACCOUNTING.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "console.h"
+#include "energy.h"
+#include "profile.h"
+
+energy_entry energy_messages[ENERGY_MESSAGES];
+energy_stat energy_total;
+uint32_t energy_current_ua[ENERGY_NUM_CURRENTS] = { ENERGY_LED0_UA, ENERGY_LED1_UA, ENERGY_ACTIVE_UA, ENERGY_IDLE_UA,
+                                                    ENERGY_LPDS_UA };
+uint32_t energy_supply_mv = ENERGY_SUPPLY_MV;
+
+/* interrupts taken so far; the only count written from interrupt context */
+static volatile uint32_t wakeups = 0;
+
+static unsigned char sleeps = 0;
+
+/* the message being keyed, what it has cost since it was last taken up,
+ * and where the CPU counters stood then */
+static energy_entry *current = NULL;
+static energy_stat segment;
+static uint64_t start_busy;
+static uint32_t start_wakeups;
+
+/* start accounting
+ * @param cpu_sleeps -> 1 if the CPU sleeps between interrupts in this build */
+void energy_start(unsigned char cpu_sleeps) {
+
+    sleeps = cpu_sleeps;
+}
+
+/* count an interrupt; call from each handler */
+void energy_wakeup(void) {
+
+    ++wakeups;
+}
+
+/* add a stat to another */
+static void accumulate(energy_stat *total, const energy_stat *stat) {
+
+    unsigned char i;
+
+    total->messages += stat->messages;
+    total->ticks += stat->ticks;
+    total->elapsed_us += stat->elapsed_us;
+    for (i = 0; i < ENERGY_NUM_LEDS; ++i) {
+        total->led_on_us[i] += stat->led_on_us[i];
+    }
+    total->active_us += stat->active_us;
+    total->idle_us += stat->idle_us;
+    total->lpds_us += stat->lpds_us;
+    total->wakeups += stat->wakeups;
+}
+
+/* charge what the CPU has done since the segment started to it, and the
+ * segment to its message and the total */
+static void close_segment(void) {
+
+    uint64_t active;
+
+    segment.wakeups = wakeups - start_wakeups;
+#if MORSE_PROFILE
+    active = (profile_busy_cycles() - start_busy) / PROFILE_COUNTS_PER_US;
+#else
+    active = (uint64_t)segment.wakeups * ENERGY_WAKE_US;
+#endif
+    if (segment.lpds_us > segment.elapsed_us) {
+        segment.lpds_us = segment.elapsed_us;
+    }
+    if (!sleeps || active > segment.elapsed_us - segment.lpds_us) {
+        active = segment.elapsed_us - segment.lpds_us;
+    }
+    segment.active_us = active;
+    segment.idle_us = segment.elapsed_us - segment.lpds_us - active;
+
+    accumulate(&current->stat, &segment);
+    accumulate(&energy_total, &segment);
+}
+
+/* @return -> the entry for a message, taking over the one taken up least
+ *            recently if it has none */
+static energy_entry *find_entry(const char *text) {
+
+    /* with the beacon off, the empty message that keeps watch on the queue */
+    const char *name = text[0] != '\0' ? text : "(quiet)";
+    static uint32_t taken_up = 0;
+    energy_entry *entry = &energy_messages[0];
+    unsigned char i;
+
+    for (i = 0; i < ENERGY_MESSAGES; ++i) {
+        if (energy_messages[i].name[0] != '\0' &&
+            strncmp(energy_messages[i].name, name, ENERGY_NAME_LEN) == 0) {
+            entry = &energy_messages[i];
+            entry->taken_up = ++taken_up;
+            return entry;
+        }
+        /* an unused slot was never taken up at all */
+        if (energy_messages[i].taken_up < entry->taken_up) {
+            entry = &energy_messages[i];
+        }
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    strncpy(entry->name, name, ENERGY_NAME_LEN);
+    entry->taken_up = ++taken_up;
+
+    return entry;
+}
+
+/* charge the ticks from here on to a message, when the sequencer takes it
+ * up; call from the sequencer's context
+ * @param text -> the message
+ * @param from_start -> 1 if it is keyed from its first character, 0 if it
+ *                      is carrying on after being preempted */
+void energy_begin_message(const char *text, unsigned char from_start) {
+
+    if (current != NULL) {
+        close_segment();
+    }
+    current = find_entry(text);
+
+    memset(&segment, 0, sizeof(segment));
+    segment.messages = from_start;
+    start_busy = profile_busy_cycles();
+    start_wakeups = wakeups;
+}
+
+/* charge what the message being keyed has cost so far to it and the
+ * total, as if it had been preempted and taken up again at once; call
+ * from the sequencer's context, or once it has stopped */
+void energy_flush(void) {
+
+    if (current != NULL) {
+        energy_begin_message(current->name, 0);
+    }
+}
+
+/* charge one tick to the message being keyed; call from the sequencer's
+ * context once the tick's LEDs are out
+ * @param leds -> the LEDs lit over the tick, as set_leds(): bit 0 red, bit 1 green
+ * @param period_us -> the tick's length */
+void energy_tick(unsigned char leds, uint32_t period_us) {
+
+    unsigned char i;
+
+    if (current == NULL) {
+        return;
+    }
+    ++segment.ticks;
+    segment.elapsed_us += period_us;
+    for (i = 0; i < ENERGY_NUM_LEDS; ++i) {
+        if (leds & (1 << i)) {
+            segment.led_on_us[i] += period_us;
+        }
+    }
+}
+
+/* charge time spent in deep sleep to the message being keyed, out of its
+ * ticks; call from the sequencer's context
+ * @param slept_us -> the time asleep */
+void energy_sleep(uint32_t slept_us) {
+
+    if (current != NULL) {
+        segment.lpds_us += slept_us;
+    }
+}
+
+/* @param which -> what the figure is for
+ * @param ua -> the current it draws, in uA */
+void energy_set_current(energy_current which, uint32_t ua) {
+
+    if (which < ENERGY_NUM_CURRENTS) {
+        energy_current_ua[which] = ua;
+    }
+}
+
+/* @return -> the energy a stat comes to at the current figures, in nJ */
+uint64_t energy_nanojoules(const energy_stat *stat) {
+
+    /* uA x us is pC, and pC x mV is fJ */
+    uint64_t picocoulombs = stat->led_on_us[0] * energy_current_ua[ENERGY_LED0] +
+                            stat->led_on_us[1] * energy_current_ua[ENERGY_LED1] +
+                            stat->active_us * energy_current_ua[ENERGY_ACTIVE] +
+                            stat->idle_us * energy_current_ua[ENERGY_IDLE] +
+                            stat->lpds_us * energy_current_ua[ENERGY_LPDS];
+
+    return picocoulombs * energy_supply_mv / 1000000;
+}
+
+static void report_line(const char *name, const energy_stat *stat) {
+
+    uint32_t microjoules = (uint32_t)(energy_nanojoules(stat) / 1000);
+    uint32_t duty = stat->elapsed_us == 0 ? 0 :
+                    (uint32_t)((stat->led_on_us[0] + stat->led_on_us[1]) * 1000 / stat->elapsed_us);
+
+    console_printf("  %-12s %5u %8u %8u %8u %3u.%u%% %8u %8u %8u %8u %9u %8u\r\n", name,
+                   stat->messages, (uint32_t)(stat->elapsed_us / 1000),
+                   (uint32_t)(stat->led_on_us[0] / 1000), (uint32_t)(stat->led_on_us[1] / 1000),
+                   duty / 10, duty % 10, (uint32_t)(stat->active_us / 1000),
+                   (uint32_t)(stat->idle_us / 1000), (uint32_t)(stat->lpds_us / 1000), stat->wakeups, microjoules,
+                   stat->messages == 0 ? 0 : microjoules / stat->messages);
+}
+
+/* print what each message has cost, up to the last one to be taken up,
+ * over the console */
+void energy_report(void) {
+
+    unsigned char i;
+
+    console_printf("energy at %u mV; led0 %u uA, led1 %u uA, active %u uA, idle %u uA, lpds %u uA%s:\r\n",
+                   energy_supply_mv, energy_current_ua[ENERGY_LED0], energy_current_ua[ENERGY_LED1],
+                   energy_current_ua[ENERGY_ACTIVE], energy_current_ua[ENERGY_IDLE], energy_current_ua[ENERGY_LPDS],
+                   MORSE_PROFILE ? "" : ", awake time estimated");
+    console_printf("  message          n  time ms  led0 ms  led1 ms   duty awake ms  idle ms  lpds ms  wakeups        uJ   uJ/msg\r\n");
+    for (i = 0; i < ENERGY_MESSAGES; ++i) {
+        if (energy_messages[i].name[0] != '\0') {
+            report_line(energy_messages[i].name, &energy_messages[i].stat);
+        }
+    }
+    report_line("total", &energy_total);
+}
@@ -0,0 +1,106 @@
+/*
+ *  ======== energy.h ========
+ *  PER-MESSAGE ENERGY AND DUTY-CYCLE ACCOUNTING. EVERY TICK IS CHARGED TO
+ *  THE MESSAGE BEING KEYED: HOW LONG EACH LED WAS LIT, HOW LONG THE CPU
+ *  WAS AWAKE AND HOW OFTEN IT WAS WOKEN. FROM THOSE AND A SET OF CURRENT
+ *  FIGURES COMES AN ESTIMATE OF THE CHARGE AND ENERGY EACH MESSAGE COSTS,
+ *  SO THAT A BEACON'S MESSAGES CAN BE GIVEN A BATTERY BUDGET.
+ *
+ *  Messages are told apart by their first ENERGY_NAME_LEN characters, and
+ *  the ENERGY_MESSAGES most recently keyed are kept in energy_messages[],
+ *  along with the running energy_total; both can be read from the
+ *  debugger, from energy_report() over the console, or by a simulator.
+ *  A message is counted once it has been keyed from its first character;
+ *  a preempted one is charged for its ticks either side of the preemption.
+ *
+ *  The CPU is awake for the cycles profile_busy_cycles() measures, which
+ *  needs MORSE_PROFILE; without it each wakeup is reckoned to take
+ *  ENERGY_WAKE_US. Builds that sleep between interrupts (the ISR and RTOS
+ *  sequencers) are idle for the rest of each tick; the polling build never
+ *  is. Time in deep sleep, given by energy_sleep(), is neither. On the
+ *  host the cycles are the host's, so only the LED figures carry over to
+ *  the board.
+ *
+ *  The currents below are starting points only, of the order of the
+ *  CC3220S datasheet's MCU-only figures and a LaunchPad LED; measure the
+ *  board and set them with energy_set_current() or the console.
+ */
+
+#ifndef ENERGY_H
+#define ENERGY_H
+
+#include <stdint.h>
+
+/* default currents in uA, and the supply in mV */
+#ifndef ENERGY_LED0_UA
+#define ENERGY_LED0_UA      4000
+#endif
+#ifndef ENERGY_LED1_UA
+#define ENERGY_LED1_UA      4000
+#endif
+#ifndef ENERGY_ACTIVE_UA
+#define ENERGY_ACTIVE_UA    12200
+#endif
+#ifndef ENERGY_IDLE_UA
+#define ENERGY_IDLE_UA      8700
+#endif
+#ifndef ENERGY_LPDS_UA
+#define ENERGY_LPDS_UA      120
+#endif
+#ifndef ENERGY_SUPPLY_MV
+#define ENERGY_SUPPLY_MV    3300
+#endif
+
+/* how long a wakeup is reckoned to keep the CPU awake without profiling */
+#define ENERGY_WAKE_US      10
+
+#define ENERGY_MESSAGES     8
+#define ENERGY_NAME_LEN     12
+#define ENERGY_NUM_LEDS     2
+
+/* --- what the current figures are for --- */
+typedef enum {
+    ENERGY_LED0 = 0,
+    ENERGY_LED1,
+    ENERGY_ACTIVE,
+    ENERGY_IDLE,
+    ENERGY_LPDS,
+    ENERGY_NUM_CURRENTS
+} energy_current;
+
+/* --- what a message, or everything, has cost --- */
+typedef struct {
+    uint32_t messages;                  /* keyed from their first character */
+    uint32_t ticks;
+    uint64_t elapsed_us;
+    uint64_t led_on_us[ENERGY_NUM_LEDS];
+    uint64_t active_us;
+    uint64_t idle_us;
+    uint64_t lpds_us;                   /* in deep sleep (see lpds.h) */
+    uint32_t wakeups;
+} energy_stat;
+
+/* --- a message by name, and what it has cost over every time it was keyed --- */
+typedef struct {
+    char name[ENERGY_NAME_LEN + 1];     /* "" for an unused slot */
+    uint32_t taken_up;                  /* when it last was, to find the least recent */
+    energy_stat stat;
+} energy_entry;
+
+extern energy_entry energy_messages[ENERGY_MESSAGES];
+extern energy_stat energy_total;
+extern uint32_t energy_current_ua[ENERGY_NUM_CURRENTS];
+extern uint32_t energy_supply_mv;
+
+/* function prototypes */
+void energy_start(unsigned char cpu_sleeps);
+void energy_wakeup(void);
+void energy_begin_message(const char *text, unsigned char from_start);
+void energy_flush(void);
+void energy_tick(unsigned char leds, uint32_t period_us);
+void energy_sleep(uint32_t slept_us);
+void energy_set_current(energy_current which, uint32_t ua);
+uint64_t energy_nanojoules(const energy_stat *stat);
+void energy_report(void);
+
+#endif /* ENERGY_H */
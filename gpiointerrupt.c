@@ -47,77 +47,887 @@
 #include "ti_drivers_config.h"
 #include <ti/drivers/Timer.h>
 
+/* set MORSE_RTOS to 1 when building under FreeRTOS or TI-RTOS with
+ * main_freertos.c: the sequencer, the buttons and the console then run as
+ * separate threads, each woken from its interrupt instead of polling */
+#ifndef MORSE_RTOS
+#define MORSE_RTOS 0
+#endif
+
+#if MORSE_INGEST && !MORSE_RTOS
+#error "MORSE_INGEST needs MORSE_RTOS: the network receive blocks in a thread of its own"
+#endif
+
+#if MORSE_STORE && !MORSE_RTOS
+#error "MORSE_STORE needs MORSE_RTOS: the file system is reached through sl_Task()"
+#endif
+
+#if MORSE_LINK_RX && MORSE_JITTER_TEST
+#error "MORSE_LINK_RX and MORSE_JITTER_TEST both take CONFIG_GPIO_LOOPBACK"
+#endif
+
+#if MORSE_LPDS && !MORSE_SEQUENCER_IN_ISR
+#error "MORSE_LPDS needs MORSE_SEQUENCER_IN_ISR: only its main loop has nothing to do between ticks"
+#endif
+
+#if MORSE_LPDS && (MORSE_OPTICAL_RX || MORSE_LINK_RX)
+#error "MORSE_LPDS cannot be built with a receiver: edges that arrive in deep sleep are lost"
+#endif
+
+#if MORSE_RTOS
+#include <pthread.h>
+#include <ti/drivers/dpl/HwiP.h>
+#include <ti/drivers/dpl/SemaphoreP.h>
+#endif
+
+#if MORSE_INGEST || MORSE_STORE
+#include <ti/drivers/net/wifi/simplelink.h>
+#endif
+
+#if MORSE_LPDS
+#include <ti/drivers/dpl/HwiP.h>
+#endif
+
+#include "alphabet.h"
+#include "boot.h"
+#include "command.h"
+#include "console.h"
+#include "energy.h"
+#include "ingest.h"
+#include "jitter.h"
+#include "link.h"
+#include "lpds.h"
+#include "morse.h"
+#include "msgqueue.h"
+#include "msgstore.h"
+#include "optical.h"
+#include "profile.h"
+#include "pt.h"
+#include "replay.h"
+#include "rope.h"
+#include "slab.h"
+#include "speed.h"
+#include "timeline.h"
+#include "utf8.h"
+
+/* set MORSE_PLAY_TIMELINE to 1 to key the precompiled images in
+ * timeline_image.c instead of encoding messages[] tick by tick */
+#ifndef MORSE_PLAY_TIMELINE
+#define MORSE_PLAY_TIMELINE 0
+#endif
+
+/* set MORSE_JITTER_TEST to 1, and wire the red LED to CONFIG_GPIO_LOOPBACK,
+ * to measure every red edge against the ideal timeline (see jitter.h) */
+#ifndef MORSE_JITTER_TEST
+#define MORSE_JITTER_TEST 0
+#endif
+
+/* set MORSE_SEQUENCER_IN_ISR to 1 to run the whole sequencer in the timer
+ * interrupt: each tick writes the LED levels worked out on the previous
+ * tick first thing, then works out the next ones, leaving main() idle */
+#ifndef MORSE_SEQUENCER_IN_ISR
+#define MORSE_SEQUENCER_IN_ISR 0
+#endif
+
+/* time between reports of the interrupt's cost when it runs the
+ * sequencer, or of the threads' load and wakeup latency under an RTOS */
+#define REPORT_US 10000000
+
+#if MORSE_RTOS
+/* thread priorities, highest first: a button press has to take effect
+ * before the sequencer's next update_message(), as it would from an ISR */
+#define BUTTON_THREAD_PRIORITY      4
+#define SEQUENCER_THREAD_PRIORITY   3
+#define CONSOLE_THREAD_PRIORITY     2
+#define INGEST_THREAD_PRIORITY      1
+#define THREAD_STACK_SIZE           1024
+
+/* the SimpleLink host driver's own thread has to outrank every caller */
+#define SL_TASK_PRIORITY            9
+#define SL_TASK_STACK_SIZE          2048
+#define INGEST_STACK_SIZE           2048
+
+/* the console thread needs more once it makes store calls through SimpleLink */
+#define CONSOLE_STORE_STACK_SIZE    2048
+
+/* semaphores posted from the interrupts, and from the sequencer to mainThread() */
+SemaphoreP_Handle tick_sem;
+SemaphoreP_Handle button_sem;
+SemaphoreP_Handle report_sem;
+SemaphoreP_Handle console_sem;
+
+/* presses waiting for buttonThread(), one bit per button */
+volatile unsigned char buttons_pending = 0;
+
+/* when each semaphore was last posted from an interrupt */
+volatile uint32_t tick_post_time = 0;
+volatile uint32_t button_post_time = 0;
+#endif
+
 /* --- Housekeeping variables --- */
 volatile unsigned char TimerFlag = 0;
 volatile short int message_ended = 0;
 volatile unsigned char button_pressed = 0;
 volatile unsigned char next_message_index = 0;
 
-/* indices for message components */
+/* tick counter and main loop position, stamped on recorded button edges:
+ * loop_stage is 0 from a tick until update_message() has run, 1 after */
+volatile uint32_t tick_count = 0;
+volatile unsigned char loop_stage = 0;
+
+/* LED levels to be written at the start of the next timer interrupt */
+volatile unsigned char next_leds = 0;
+
+/* LED levels last written, as set_leds() */
+unsigned char leds_lit = 0;
+
+/* set when a jitter report is due but has to wait for thread context */
+volatile unsigned char report_due = 0;
+
+/* timer variables; one tick is one dot, so the period sets the speed;
+ * checkTime counts up, in microseconds, to the start-up delay checkPeriod.
+ * timer0 is opened once and kept: a new period is left in
+ * requested_period_us and taken up by timerCallback() at the rollover */
+Timer_Handle timer0 = NULL;
+uint32_t tick_period_us = 500000;
+volatile uint32_t requested_period_us = 500000;
+
+/* set when timer0 has been reopened after a deep sleep with a shorter
+ * first period, to be put back to tick_period_us at the next rollover */
+unsigned char timer_reopened = 0;
+
+#if MORSE_LPDS
+/* profile_now() at the last rollover */
+volatile uint32_t rollover_time = 0;
+#endif
+unsigned long checkTime = 0;
+const unsigned long checkPeriod = 2500000;
+
+/* Farnsworth speed in words per minute, 0 for off: characters are keyed
+ * at the tick's speed, with the gaps between them drawn out to this */
+volatile unsigned int farnsworth_wpm = 0;
+
+/* ticks that came round before the work of the one before was done */
+volatile uint32_t tick_overruns = 0;
+
+/* indices for message components; a streamed message can run to any
+ * length, so the character count is a full word */
 short unsigned int message_index = 0;
-short unsigned int character_index = 0;
-short unsigned int symbol_index = 0;
-short unsigned int phase = 0;
+uint32_t character_index = 0;
+
+/* where signal_message() resumes on the next tick; 0 at the start of a message */
+pt_state sequencer_pt = 0;
+
+/* ticks still to come of the PT_HOLD() under way, whichever of
+ * run_sequencer() and run_link() has sequencer_pt; during them the LEDs
+ * stay as they are and the sequencer does nothing else */
+short unsigned int sequencer_hold = 0;
+
+/* where run_sequencer() is in the UTF-8 of the current message */
+utf8_decoder sequencer_utf8;
+
+/* message being keyed: the most urgent queued one, or else the beacon
+ * messages[message_index]; and where a preempted beacon carries on from */
+msgqueue_entry current;
+unsigned char current_queued = 0;
+uint32_t beacon_resume_index = 0;
+
+/* 0 to key queued messages only, staying dark while the queue is empty */
+volatile unsigned char beacon_enabled = 1;
+
+/* 1 to key messages as data frames (see link.h) rather than as Morse; the
+ * sequencer takes it up at the start of the next message */
+volatile unsigned char link_enabled = MORSE_LINK_TX;
+unsigned char keying_link = 0;
 
 /* array of messages */
 char *messages[] = {"ss", "oo", "sos"};
 short int num_messages = 3;
 
-/* lengths of Morse code symbols */
-const int dot_len = 2;
-const int dash_len = 4;
-const int character_pause_len = 2;
-const int word_pause_len = 4;
+#if MORSE_PLAY_TIMELINE
+/* one timeline per entry of messages[], generated by tools/mtl.c */
+extern const uint8_t *const timeline_images[];
+extern const size_t timeline_image_sizes[];
+timeline_player player;
+unsigned char player_started = 0;
+#endif
 
 /* function prototypes */
 void timerCallback(Timer_Handle myHandle, int_fast16_t status);
+void retime_at_rollover();
 void initTimer(void);
+int open_timer(uint32_t period_us);
 void gpioButtonFxn0(uint_least8_t index);
 void gpioButtonFxn1(uint_least8_t index);
+void press_button(unsigned char button);
 void set_leds(unsigned char led_settings);
-void signal_dot(short int phase);
-void signal_dash(int phase);
-void character_pause(int phase);
-void word_pause(int phase);
-const char* get_morse(char character);
+void write_leds(unsigned char led_settings);
+void cpu_idle();
+unsigned char deep_sleep();
+void catch_up_ticks(uint32_t ticks, uint32_t since_us, uint32_t slept_us);
 void signal_message();
+void run_sequencer();
+void run_link();
+void play_timeline();
+void sequencer_tick();
+void update_message();
+void wait_for_tick();
+void count_startup_delay();
+unsigned char report_interval_passed(uint32_t *last_report);
+unsigned char at_message_start();
+void select_message();
+void preempt_message();
+void release_message();
+int current_char();
+void next_char();
+int queue_message(const char *text, unsigned char priority, msgqueue_release_fxn release);
+int queue_rope(rope *r, unsigned char priority);
+int set_wpm(unsigned int wpm);
+int set_unit_us(uint32_t unit_us);
+int set_farnsworth(unsigned int wpm);
+short unsigned int farnsworth_ticks(unsigned char units);
+void set_beacon(unsigned char enabled);
+void set_link(unsigned char enabled);
+void service_console();
+#if MORSE_RTOS
+void start_threads();
+void *sequencerThread(void *arg0);
+void *buttonThread(void *arg0);
+void *consoleThread(void *arg0);
+void console_rx_post(void);
+#if MORSE_INGEST
+void *ingestThread(void *arg0);
+#endif
+#endif
 short unsigned int normalize_message_index(short unsigned int next_message_index);
+void start_leds();
+void start_peripherals();
+void key_first_tick();
 void configure_board();
+void configure_leds();
+void configure_buttons();
 
 /*
  *  ======== mainThread ========
  */
 void *mainThread(void *arg0)
 {
-    /* initialize timer and counter variables */
+    boot_mark(BOOT_MAIN_THREAD);
+
+    start_leds();
+#if MORSE_FAST_START
+    key_first_tick();
+#endif
+    start_peripherals();
+
+#if MORSE_SEQUENCER_IN_ISR
+    /* work out the first tick the timer keys, then hand over to timerCallback() */
+    sequencer_tick();
+    update_message();
     initTimer();
-    unsigned long checkTime = 0;
-    const unsigned long checkPeriod = 500;
 
-    /* configure TI board */
-    configure_board();
+    /* sleep between interrupts, waking every so often to report on them */
+    uint32_t last_report = 0;
+    while(1) {
+        cpu_idle();
+        service_console();
+
+        if (report_interval_passed(&last_report)) {
+            profile_report();
+            msgqueue_report();
+        }
+        if (report_due) {
+            report_due = 0;
+            jitter_report();
+        }
+    }
+#elif MORSE_RTOS
+    /* hand the work to the threads and stay behind to report on them */
+    start_threads();
+    initTimer();
+
+    while(1) {
+        SemaphoreP_pend(report_sem, SemaphoreP_WAIT_FOREVER);
+        profile_report();
+        profile_load_report();
+        msgqueue_report();
+#if MORSE_INGEST
+        ingest_report();
+#endif
+    }
+#else
+    /* initialize timer */
+    initTimer();
+
+#if MORSE_FAST_START
+    /* tick 0 has been keyed already */
+    wait_for_tick();
+#endif
+
+    /* main loop to toggle between 'SOS' and 'OK' messages; each step is a
+     * function of its own so that the host simulator can drive them */
+    while(1) {
+        PROFILE_BEGIN(busy);
+        sequencer_tick();
+        update_message();
+        PROFILE_TASK_END(PROFILE_TASK_SEQUENCER, busy);
+        service_console();
+        wait_for_tick();
+    }
+#endif
+}
+
+/* the start-up the first edge cannot do without: the LED pins, and what
+ * the sequencer itself needs; with MORSE_FAST_START the start-up delay
+ * is skipped as well, so that the very next tick is keyed */
+void start_leds()
+{
+    /* start the cycle counter before anything that gets measured */
+    profile_init();
+    msgqueue_init();
+    slab_init();
+    energy_start(MORSE_SEQUENCER_IN_ISR || MORSE_RTOS);
+
+    configure_leds();
+    boot_mark(BOOT_LEDS_READY);
+
+#if MORSE_FAST_START
+    checkTime = checkPeriod;
+#endif
+}
+
+/* the rest of start-up, which can wait until after the first edge */
+void start_peripherals()
+{
+    configure_buttons();
+    console_init();
+
+#if MORSE_JITTER_TEST
+    jitter_init();
+#endif
+
+#if MORSE_OPTICAL_RX
+    /* expect the far end to key at our own speed until it shows otherwise */
+    optical_start(tick_period_us);
+#endif
+
+#if MORSE_LINK_RX
+    link_rx_start(tick_period_us);
+#endif
+
+#if MORSE_LPDS
+    lpds_init();
+#endif
+
+    boot_mark(BOOT_PERIPHERALS_READY);
+}
+
+/* key tick 0 straight away, ahead of the timer */
+void key_first_tick()
+{
+    sequencer_tick();
+    update_message();
+
+#if MORSE_SEQUENCER_IN_ISR
+    /* nothing else will write it until the first interrupt */
+    write_leds(next_leds);
+#endif
+}
+
+#if MORSE_RTOS
+/* create the semaphores and threads; any failure here is fatal */
+void start_threads()
+{
+    pthread_t thread;
+    pthread_attr_t attrs;
+    struct sched_param priParam;
+    int retc;
+
+    tick_sem = SemaphoreP_createBinary(0);
+    button_sem = SemaphoreP_createBinary(0);
+    report_sem = SemaphoreP_createBinary(0);
+    console_sem = SemaphoreP_createBinary(0);
+    if (tick_sem == NULL || button_sem == NULL || report_sem == NULL || console_sem == NULL) {
+        while (1) {}
+    }
+    console_rx_notify(console_rx_post);
+    speed_notify(console_rx_post);
+#if MORSE_OPTICAL_RX
+    optical_notify(console_rx_post);
+#endif
+#if MORSE_LINK_RX
+    link_rx_notify(console_rx_post);
+#endif
+
+    pthread_attr_init(&attrs);
+    retc = pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
+    retc |= pthread_attr_setstacksize(&attrs, THREAD_STACK_SIZE);
+
+    priParam.sched_priority = BUTTON_THREAD_PRIORITY;
+    retc |= pthread_attr_setschedparam(&attrs, &priParam);
+    retc |= pthread_create(&thread, &attrs, buttonThread, NULL);
+
+    priParam.sched_priority = SEQUENCER_THREAD_PRIORITY;
+    retc |= pthread_attr_setschedparam(&attrs, &priParam);
+    retc |= pthread_create(&thread, &attrs, sequencerThread, NULL);
+
+#if MORSE_STORE
+    retc |= pthread_attr_setstacksize(&attrs, CONSOLE_STORE_STACK_SIZE);
+#endif
+    priParam.sched_priority = CONSOLE_THREAD_PRIORITY;
+    retc |= pthread_attr_setschedparam(&attrs, &priParam);
+    retc |= pthread_create(&thread, &attrs, consoleThread, NULL);
+
+#if MORSE_INGEST || MORSE_STORE
+    retc |= pthread_attr_setstacksize(&attrs, SL_TASK_STACK_SIZE);
+    priParam.sched_priority = SL_TASK_PRIORITY;
+    retc |= pthread_attr_setschedparam(&attrs, &priParam);
+    retc |= pthread_create(&thread, &attrs, sl_Task, NULL);
+#endif
+
+#if MORSE_INGEST
+    retc |= pthread_attr_setstacksize(&attrs, INGEST_STACK_SIZE);
+    priParam.sched_priority = INGEST_THREAD_PRIORITY;
+    retc |= pthread_attr_setschedparam(&attrs, &priParam);
+    retc |= pthread_create(&thread, &attrs, ingestThread, NULL);
+#endif
+
+    if (retc != 0) {
+        /* failed to create a thread */
+        while (1) {}
+    }
+}
+
+/*
+ *  ======== sequencerThread ========
+ *  The NoRTOS main loop, with wait_for_tick() pending on tick_sem.
+ */
+void *sequencerThread(void *arg0)
+{
+#if MORSE_FAST_START
+    /* tick 0 was keyed by mainThread() */
+    wait_for_tick();
+#endif
+
+    uint32_t last_report = 0;
 
-    /* main loop to toggle between 'SOS' and 'OK' messages */
     while(1) {
+        PROFILE_BEGIN(busy);
+        sequencer_tick();
+        update_message();
+        if (report_interval_passed(&last_report)) {
+            SemaphoreP_post(report_sem);
+        }
+        PROFILE_TASK_END(PROFILE_TASK_SEQUENCER, busy);
+        wait_for_tick();
+    }
+}
 
-        /* call signal_message() every 500ms */
-        if (checkTime >= checkPeriod) {
-           signal_message();
+/*
+ *  ======== buttonThread ========
+ *  Applies the presses posted by gpioButtonFxn0/1.
+ */
+void *buttonThread(void *arg0)
+{
+    uintptr_t key;
+    unsigned char pressed;
+
+    while(1) {
+        SemaphoreP_pend(button_sem, SemaphoreP_WAIT_FOREVER);
+        PROFILE_END(PROFILE_BUTTON_WAKE, button_post_time);
+        PROFILE_BEGIN(busy);
+
+        key = HwiP_disable();
+        pressed = buttons_pending;
+        buttons_pending = 0;
+        HwiP_restore(key);
+
+        if (pressed & 0b01) {
+            press_button(0);
         }
+        if (pressed & 0b10) {
+            press_button(1);
+        }
+
+        PROFILE_TASK_END(PROFILE_TASK_BUTTONS, busy);
+    }
+}
+
+/*
+ *  ======== consoleThread ========
+ *  Carries out console commands (see command.h), sleeping until the UART
+ *  interrupt says that more input has landed in the receive ring. With
+ *  MORSE_OPTICAL_RX or MORSE_LINK_RX it is woken as well whenever the
+ *  receiver has text, and prints it straight away, so that the receiver's
+ *  small buffer never has to wait for the report thread; the same goes
+ *  for the results of a speed sweep. With
+ *  MORSE_STORE it first opens the message store, which only it uses, and
+ *  fills a new one with messages[].
+ */
+void *consoleThread(void *arg0)
+{
+#if MORSE_STORE
+    short int i;
 
-        /* change message and reset message_ended and button_pressed flags to 0
-         * if button(s) have been pressed and current message has reached its end */
-        if (next_message_index != message_index && message_ended == 1) {
-          message_index = next_message_index = normalize_message_index(next_message_index);
-          message_ended = 0;
-          button_pressed = 0;
+    if (msgstore_open(MSGSTORE_PATH) == MSGSTORE_STATUS_SUCCESS && msgstore_stats.entries == 0) {
+        for (i = 0; i < num_messages; ++i) {
+            msgstore_append(messages[i], tick_period_us);
         }
+    }
+#endif
+
+    while(1) {
+        SemaphoreP_pend(console_sem, SemaphoreP_WAIT_FOREVER);
+#if MORSE_OPTICAL_RX
+        optical_service();
+#endif
+#if MORSE_LINK_RX
+        link_service();
+#endif
+        speed_service();
+        while (command_poll()) {}
+    }
+}
+
+/* called from the UART interrupt when input has arrived, and from the
+ * receivers when they have text for the console */
+void console_rx_post(void)
+{
+    SemaphoreP_post(console_sem);
+}
+
+#if MORSE_INGEST
+/*
+ *  ======== ingestThread ========
+ *  Brings up the network and queues the messages that arrive on
+ *  INGEST_PORT, sleeping in the socket between datagrams. It runs below
+ *  every other thread, so a flood of traffic can only ever delay itself.
+ */
+void *ingestThread(void *arg0)
+{
+    if (ingest_open(INGEST_PORT) != INGEST_STATUS_SUCCESS) {
+        /* no network to listen on */
+        return NULL;
+    }
+
+    while(1) {
+        ingest_poll(tick_count);
+    }
+}
+#endif
+#endif
+
+/* call signal_message() once the start-up delay has passed */
+void sequencer_tick()
+{
+    speed_tick();
+
+    if (checkTime >= checkPeriod) {
+       unsigned char starting = at_message_start();
+
+       if (starting) {
+           select_message();
+#if MORSE_JITTER_TEST
+           /* a streamed message's edges cannot be known in advance */
+           jitter_begin_message(current.rope == NULL ? current.text : "", tick_period_us);
+#endif
+       }
+
+#if MORSE_PLAY_TIMELINE
+       play_timeline();
+#else
+       signal_message();
+#endif
+       /* the tick's LEDs are out by now, in any build */
+       energy_tick(leds_lit, tick_period_us);
+
+#if MORSE_JITTER_TEST
+       /* the UART write is well clear of the next tick's LED write */
+       if (starting) {
+#if MORSE_SEQUENCER_IN_ISR
+           report_due = 1;
+#else
+           jitter_report();
+#endif
+       }
+#endif
+    }
+}
+
+/* choose the next message to key: the most urgent queued one, or else
+ * the beacon, from where it was preempted if it was */
+void select_message()
+{
+#if !MORSE_PLAY_TIMELINE
+    if (msgqueue_pop(&current, tick_count)) {
+        current_queued = 1;
+        character_index = current.resume_index;
+        energy_begin_message(current.text, character_index == 0);
+        return;
+    }
+#endif
+
+    current.text = messages[message_index];
+    current.rope = NULL;
+    current.priority = MSGQUEUE_ROUTINE;
+    current_queued = 0;
+    character_index = beacon_resume_index;
+    beacon_resume_index = 0;
+
+    /* with the beacon off, an empty message keeps watch on the queue */
+    if (!beacon_enabled) {
+        current.text = "";
+        character_index = 0;
+    }
+    energy_begin_message(current.text, character_index == 0);
+}
+
+/* set the current message aside at character_index, to be carried on
+ * with once the more urgent traffic is through, and start on that */
+void preempt_message()
+{
+    if (current_char() == '\0') {
+        release_message();
+    }
+    else if (current_queued) {
+        current.resume_index = character_index;
+        if (msgqueue_requeue(&current) != MSGQUEUE_STATUS_SUCCESS) {
+            release_message();
+        }
+    }
+    else {
+        beacon_resume_index = character_index;
+    }
+    select_message();
+}
+
+/* the current message's text will not be read again: hand it back to
+ * wherever it was queued from */
+void release_message()
+{
+    if (current_queued) {
+        msgqueue_release(&current);
+    }
+    current_queued = 0;
+}
+
+/* @return -> the current message's character at character_index: '\0' at
+ *            its end, or ROPE_WAITING if it is streamed and the sequencer
+ *            has caught up with its text */
+int current_char()
+{
+    if (current.rope != NULL) {
+        return rope_peek(current.rope);
+    }
+    return (unsigned char)current.text[character_index];
+}
+
+/* move character_index on past the character current_char() returned,
+ * letting a streamed message hand back what it has done with */
+void next_char()
+{
+    if (current.rope != NULL) {
+        rope_advance(current.rope);
+    }
+    ++character_index;
+}
+
+/* queue a message to be keyed after the beacon's current message, or
+ * sooner if it is more urgent than what is being keyed; safe from any context
+ * @param text -> the message, which must stay put until it has been keyed
+ * @param priority -> one of MSGQUEUE_ROUTINE, MSGQUEUE_PRIORITY, MSGQUEUE_DISTRESS
+ * @param release -> called with the text once it is finished with (may be NULL)
+ * @return -> MSGQUEUE_STATUS_SUCCESS, or a negative status if it was not queued */
+int queue_message(const char *text, unsigned char priority, msgqueue_release_fxn release)
+{
+    return msgqueue_push(text, priority, tick_count, release);
+}
+
+/* queue a streamed message, keyed as its text is appended (see rope.h);
+ * safe from any context
+ * @param r -> the rope, opened; it is released once keyed or dropped
+ * @return -> MSGQUEUE_STATUS_SUCCESS, or a negative status if it was not queued */
+int queue_rope(rope *r, unsigned char priority)
+{
+    return msgqueue_push_rope(r, priority, tick_count);
+}
+
+/* change the keying speed from the next tick on; with one tick per dot,
+ * as in PARIS timing, a tick lasts 1200 ms / wpm
+ * @param wpm -> words per minute, 1 to 60000
+ * @return -> 0, or -1 if out of range or the timer refused it */
+int set_wpm(unsigned int wpm)
+{
+    if (wpm < 1 || wpm > 1200000 / SPEED_MIN_UNIT_US) {
+        return -1;
+    }
+    return set_unit_us(1200000 / wpm);
+}
+
+/* change the tick period from the next tick on; safe from any context.
+ * The tick under way keeps its length: the timer takes the new period up
+ * at the rollover that ends it (see retime_at_rollover())
+ * @param unit_us -> SPEED_MIN_UNIT_US to SPEED_MAX_UNIT_US
+ * @return -> 0, or -1 if out of range */
+int set_unit_us(uint32_t unit_us)
+{
+    if (unit_us < SPEED_MIN_UNIT_US || unit_us > SPEED_MAX_UNIT_US) {
+        return -1;
+    }
+    requested_period_us = unit_us;
+
+    /* before the timer is started it simply opens at the new period */
+    if (timer0 == NULL) {
+        tick_period_us = unit_us;
+    }
+    return 0;
+}
+
+/* called from timerCallback(), just after the rollover: reload the timer
+ * with a newly requested period, so that it starts with the tick that is
+ * starting now, or with its own after the short one that brought it back
+ * in phase from a deep sleep. The count restarts when the period is
+ * written, which is only a few microseconds into the tick here rather
+ * than anywhere in it */
+void retime_at_rollover()
+{
+    uint32_t unit_us = requested_period_us;
+
+    if (unit_us == tick_period_us && !timer_reopened) {
+        return;
+    }
+    if (Timer_setPeriod(timer0, Timer_PERIOD_US, unit_us) != Timer_STATUS_SUCCESS) {
+        /* keep to the old speed rather than try every tick */
+        requested_period_us = tick_period_us;
+        return;
+    }
+    tick_period_us = unit_us;
+    timer_reopened = 0;
+
+#if MORSE_LINK_RX
+    /* frames come back at the new speed */
+    link_rx_expect(unit_us);
+#endif
+}
+
+/* draw out the gaps between characters and words to an overall speed of
+ * wpm, from the next gap on; characters keep the tick's speed. Morse only:
+ * the two-LED code and precompiled timelines keep their own gaps
+ * @param wpm -> 1 to 60000, or 0 for off; at or above the tick's speed it
+ *               has no effect
+ * @return -> 0, or -1 if out of range */
+int set_farnsworth(unsigned int wpm)
+{
+    if (wpm > 1200000 / SPEED_MIN_UNIT_US) {
+        return -1;
+    }
+    farnsworth_wpm = wpm;
+    return 0;
+}
 
-        /* reset TimerFlag and increment checkTime with every period */
-        while (!TimerFlag) {}
-        TimerFlag = 0;
-        checkTime += 100;
+/* by ARRL Farnsworth timing, a PARIS word at the Farnsworth speed takes
+ * (character wpm / Farnsworth wpm) * 50 ticks, and the extra over 50 is
+ * shared among its 19 units of gap
+ * @param units -> the gap in standard units: 3 after a character, 7 after a word
+ * @return -> the ticks to add to such a gap at the current speed */
+short unsigned int farnsworth_ticks(unsigned char units)
+{
+    uint32_t effective = farnsworth_wpm;
+    uint32_t character = 1200000 / tick_period_us;
+
+    if (effective == 0 || effective >= character) {
+        return 0;
     }
+    return (short unsigned int)(((uint32_t)units * 50 * (character - effective) + 19 * effective / 2) /
+                                (19 * effective));
+}
+
+/* @param enabled -> 1 to key messages[] while the queue is empty, 0 to stay dark */
+void set_beacon(unsigned char enabled)
+{
+    beacon_enabled = enabled;
+}
+
+/* @param enabled -> 1 to key messages as data frames from the next one on, 0 as Morse */
+void set_link(unsigned char enabled)
+{
+    link_enabled = enabled;
+}
+
+/* carry out console commands until there are none left, or, in the
+ * polling build, until the next tick is due, so that they only ever use
+ * time the sequencer has no need of */
+void service_console()
+{
+#if MORSE_OPTICAL_RX
+    optical_service();
+#endif
+#if MORSE_LINK_RX
+    link_service();
+#endif
+    speed_service();
+
+#if MORSE_SEQUENCER_IN_ISR || MORSE_RTOS
+    while (command_poll()) {}
+#else
+    while (!TimerFlag && command_poll()) {}
+#endif
+}
+
+/* @return -> 1 if the next call to the sequencer keys the first tick of a message */
+unsigned char at_message_start()
+{
+#if MORSE_PLAY_TIMELINE
+    return !player_started || (player.units_left == 0 && player.cursor.runs_left == 0);
+#else
+    return sequencer_pt == 0;
+#endif
+}
+
+/* change message and reset message_ended and button_pressed flags to 0
+ * if button(s) have been pressed and current message has reached its end */
+void update_message()
+{
+    if (next_message_index != message_index && message_ended == 1) {
+      message_index = next_message_index = normalize_message_index(next_message_index);
+      message_ended = 0;
+      button_pressed = 0;
+      beacon_resume_index = 0;
+    }
+    loop_stage = 1;
+}
+
+/* reset TimerFlag and count the period towards the start-up delay */
+void wait_for_tick()
+{
+#if MORSE_RTOS
+    SemaphoreP_pend(tick_sem, SemaphoreP_WAIT_FOREVER);
+    PROFILE_END(PROFILE_SEQUENCER_WAKE, tick_post_time);
+#else
+    while (!TimerFlag) {}
+#endif
+    TimerFlag = 0;
+    count_startup_delay();
+}
+
+/* add a tick's worth of time to checkTime until the start-up delay has
+ * passed, the same time whatever the speed, and then leave it be */
+void count_startup_delay()
+{
+    if (checkTime < checkPeriod) {
+        checkTime += tick_period_us;
+    }
+}
+
+/* @return -> 1, and a new interval started, once REPORT_US has passed
+ *            since *last_report; 0 until then */
+unsigned char report_interval_passed(uint32_t *last_report)
+{
+    if ((uint64_t)(tick_count - *last_report) * tick_period_us < REPORT_US) {
+        return 0;
+    }
+    *last_report = tick_count;
+    return 1;
 }
 
 /*
@@ -126,7 +936,55 @@ void *mainThread(void *arg0)
  */
 void timerCallback(Timer_Handle myHandle, int_fast16_t status)
 {
+    /* only the cycle counter is read ahead of the edge */
+    PROFILE_BEGIN(isr_entry);
+
+#if MORSE_SEQUENCER_IN_ISR
+    /* the edge goes out before anything else can add to its latency */
+    write_leds(next_leds);
+    PROFILE_ISR_ENTRY(isr_entry, 1);
+#else
+    PROFILE_ISR_ENTRY(isr_entry, 0);
+#endif
+
+#if MORSE_LPDS
+    /* a little after the rollover, which only errs deep_sleep()'s way */
+    rollover_time = profile_now();
+#endif
+
+    /* and then the new period, as close to the rollover as it can be */
+    retime_at_rollover();
+    energy_wakeup();
+
+    PROFILE_BEGIN(start);
+
+    ++tick_count;
+    loop_stage = 0;
+
+#if MORSE_SEQUENCER_IN_ISR
+    uint32_t entry = profile_now();
+
+    count_startup_delay();
+    sequencer_tick();
+    update_message();
+
+    /* the work ran on past the next tick, which will come round late */
+    if (profile_now() - entry > tick_period_us * PROFILE_COUNTS_PER_US) {
+        ++tick_overruns;
+    }
+#else
+    /* the sequencer has yet to get through the last tick */
+    if (TimerFlag) {
+        ++tick_overruns;
+    }
     TimerFlag = 1;
+#if MORSE_RTOS
+    tick_post_time = profile_now();
+    SemaphoreP_post(tick_sem);
+#endif
+#endif
+
+    PROFILE_END(PROFILE_TIMER_CALLBACK, start);
 }
 
 /*
@@ -134,27 +992,33 @@ void timerCallback(Timer_Handle myHandle, int_fast16_t status)
  */
 void initTimer(void)
 {
-    Timer_Handle timer0;
+    Timer_init();
+
+    if (open_timer(tick_period_us) != 0) {
+        /* Failed to initialize or start timer */
+        while (1) {}
+    }
+    boot_mark(BOOT_TIMER_STARTED);
+}
+
+/* open timer0 and start it, with its first rollover after period_us
+ * @return -> 0, or -1 on failure */
+int open_timer(uint32_t period_us)
+{
     Timer_Params params;
 
-    Timer_init();
     Timer_Params_init(&params);
-    params.period = 500000;
+    params.period = period_us;
     params.periodUnits = Timer_PERIOD_US;
     params.timerMode = Timer_CONTINUOUS_CALLBACK;
     params.timerCallback = timerCallback;
 
     timer0 = Timer_open(CONFIG_TIMER_0, &params);
 
-    if (timer0 == NULL) {
-        /* Failed to initialize timer */
-        while (1) {}
-    }
-
-    if (Timer_start(timer0) == Timer_STATUS_ERROR) {
-        /* Failed to start timer */
-        while (1) {}
+    if (timer0 == NULL || Timer_start(timer0) == Timer_STATUS_ERROR) {
+        return -1;
     }
+    return 0;
 }
 
 /*
@@ -165,12 +1029,20 @@ void initTimer(void)
  */
 void gpioButtonFxn0(uint_least8_t index)
 {
-    /* set change_message = 1 if button pressed
-     * at least during the message's cycle */
-    if (!button_pressed) {
-      next_message_index = next_message_index + 1;
-      button_pressed = 1;
-    }
+    PROFILE_BEGIN(start);
+    energy_wakeup();
+
+    replay_record(0, tick_count, loop_stage);
+
+#if MORSE_RTOS
+    buttons_pending |= 0b01;
+    button_post_time = profile_now();
+    SemaphoreP_post(button_sem);
+#else
+    press_button(0);
+#endif
+
+    PROFILE_END(PROFILE_BUTTON_FXN0, start);
 }
 
 /*
@@ -182,10 +1054,29 @@ void gpioButtonFxn0(uint_least8_t index)
  */
 void gpioButtonFxn1(uint_least8_t index)
 {
-    /* set change_message = 1 if button pressed
-     * at least during the message's cycle */
+    PROFILE_BEGIN(start);
+    energy_wakeup();
+
+    replay_record(1, tick_count, loop_stage);
+
+#if MORSE_RTOS
+    buttons_pending |= 0b10;
+    button_post_time = profile_now();
+    SemaphoreP_post(button_sem);
+#else
+    press_button(1);
+#endif
+
+    PROFILE_END(PROFILE_BUTTON_FXN1, start);
+}
+
+/* move next_message_index on (button 0) or back (button 1) one message;
+ * set change_message = 1 if button pressed at least during the message's cycle
+ * @param button -> 0 for CONFIG_GPIO_BUTTON_0, 1 for CONFIG_GPIO_BUTTON_1 */
+void press_button(unsigned char button) {
+
     if (!button_pressed) {
-      next_message_index = next_message_index + num_messages - 1;
+      next_message_index = next_message_index + (button ? num_messages - 1 : 1);
       button_pressed = 1;
     }
 }
@@ -193,122 +1084,254 @@ void gpioButtonFxn1(uint_least8_t index)
 /* --- functions to switch on one or other, or both, or neither of the LEDs --- */
 void set_leds(unsigned char led_settings) {
 
-  /* assume both off */
-  GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_OFF);
-  GPIO_write(CONFIG_GPIO_LED_1, CONFIG_GPIO_LED_OFF);
+#if MORSE_SEQUENCER_IN_ISR
+  /* written by the next timer interrupt */
+  next_leds = led_settings;
+#else
+  write_leds(led_settings);
+#endif
+}
 
-  /* switch red on */
-  if (0b01 & led_settings) {
-     GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_ON);
-  }
+/* drive the LEDs now: bit 0 red, bit 1 green */
+void write_leds(unsigned char led_settings) {
 
-  /* switch green on */
-  if (0b10 & led_settings) {
-     GPIO_write(CONFIG_GPIO_LED_1, CONFIG_GPIO_LED_ON);
+  PROFILE_BEGIN(start);
+
+  /* write each LED once with its final level, so that an LED which stays
+   * lit is never pulsed off in between */
+  GPIO_write(CONFIG_GPIO_LED_0, (0b01 & led_settings) ? CONFIG_GPIO_LED_ON : CONFIG_GPIO_LED_OFF);
+  GPIO_write(CONFIG_GPIO_LED_1, (0b10 & led_settings) ? CONFIG_GPIO_LED_ON : CONFIG_GPIO_LED_OFF);
+
+  /* only real edges count towards latency */
+  if (led_settings != leds_lit) {
+     PROFILE_EDGE();
+     boot_mark(BOOT_FIRST_EDGE);
+     leds_lit = led_settings;
   }
+
+  PROFILE_END(PROFILE_SET_LEDS, start);
 }
 
-/* iterate over message, character by character,
- * convert each character to Morse code, then
- * iterate over the Morse string symbol by symbol
- * and display each in turn, phase by phase, with the
- * intermediate pauses added */
+/* key the current message for one tick */
 void signal_message()
 {
-  /* initialize character and string variables */
-  char character;
-  char symbol;
+  PROFILE_BEGIN(start);
 
-  /* iterate over characters in message */
-  character = messages[message_index][character_index];
-  if (character != '\0') {
+  /* Morse or frames, chosen afresh at the start of each message */
+  if (sequencer_pt == 0) {
+    keying_link = link_enabled;
+  }
+  if (keying_link) {
+    run_link();
+  }
+  else {
+    run_sequencer();
+  }
 
-    /* assume that message is still in progress */
-    message_ended = 0;
+  PROFILE_END(PROFILE_SIGNAL_MESSAGE, start);
+}
+
+/* iterate over message, character by character, convert each character
+ * to Morse code, then iterate over the Morse string symbol by symbol and
+ * display each in turn with the intermediate pauses added. This is a
+ * protothread (see pt.h) that yields once per tick, so each call does one
+ * tick's work and carries straight on from where the last one left off:
+ *   - a dot or dash is keyed for its length less one tick, then dark for
+ *     one tick plus one more before the next symbol
+ *   - a space, or any character with no Morse code, is dark for
+ *     word_pause_len + 1 ticks
+ *   - each character is followed by character_pause_len + 2 dark ticks
+ *   - the message is followed by word_pause_len + 1 dark ticks and then
+ *     the tick on which message_ended is set
+ *   - a streamed message (see rope.h) that has run dry is dark, a tick at
+ *     a time, until more of it arrives
+ * The text is UTF-8: the bytes of a character past ASCII are gathered
+ * before it is keyed, in the alphabet selected (see alphabet.h), and a
+ * Wabun voiced kana is keyed as two characters.
+ * With a Farnsworth speed set, farnsworth_ticks() more are added to each
+ * gap: the space's share of a word gap, a character's 3 units and the
+ * rest of the 7 after a message, each worked out as its gap starts.
+ * Built with MORSE_PARALLEL it keys the two-LED code of morse.h instead,
+ * with the same message handling around it. */
+void run_sequencer()
+{
+  /* these outlive a yield, so they cannot be automatic */
+  static const char *symbol;
+  static const char *mark;
+#if !MORSE_PARALLEL
+  static unsigned char leds;
+#endif
+  int32_t code_point;
+  int c;
+
+  /* most ticks just carry on holding the level already set */
+  PT_HOLDING(sequencer_hold);
+
+  PT_BEGIN(sequencer_pt);
 
-    /* iterate over symbols in character */
-    symbol = get_morse(character)[symbol_index];
-    if (symbol != '\0') {
-
-      /* signal current symbol, phase by phase */
-      switch (symbol) {
-        case '.':
-            if (phase < dot_len) {
-                signal_dot(phase);
-                ++phase;
-            }
-            else {
-                ++symbol_index;
-                symbol = get_morse(character)[symbol_index];
-                phase = 0;
-            }
-          break;
-
-        case '-':
-          if (phase < dash_len) {
-            signal_dash(phase);
-            ++phase;
-          }
-          else {
-              ++symbol_index;
-              symbol = get_morse(character)[symbol_index];
-              phase = 0;
-          }
-          break;
-
-        /* space will fall through to default case, which will effectively replace unknown characters with a space */
-        case ' ':
-
-        default:
-          if (phase < word_pause_len) {
-            word_pause(phase);
-            ++phase;
-          }
-
-          /* get next symbol and reset phase to 0 */
-          else {
-              ++symbol_index;
-              symbol = get_morse(character)[symbol_index];
-              phase = 0;
-          }
-          break;
+  /* the message is in progress until its last tick */
+  message_ended = 0;
+  utf8_reset(&sequencer_utf8);
+
+  while ((c = current_char()) != '\0') {
+    /* a streamed message that has run dry stays dark a tick at a time,
+     * still giving way to more urgent traffic, until more arrives; but
+     * not part-way into a character, which could not be taken up again */
+    if (c == ROPE_WAITING) {
+      PT_YIELD(sequencer_pt);
+      if (utf8_idle(&sequencer_utf8) && msgqueue_top_priority() > current.priority) {
+        preempt_message();
       }
+      continue;
     }
 
-    else {
-      /* pause between characters */
-      if (phase <= character_pause_len) {
-        character_pause(phase);
-        ++phase;
-      }
+    /* the bytes before the last of a character are keyed as nothing */
+    code_point = utf8_decode(&sequencer_utf8, (uint8_t)c);
+    if (code_point == UTF8_MORE) {
+      next_char();
+      continue;
+    }
+    symbol = alphabet_code((uint32_t)code_point, &mark);
 
-      /* get next character and reset symbol_index and phase to 0 */
-      else {
-        ++character_index;
-        character = messages[message_index][character_index];
-        symbol_index = 0;
-        phase = 0;
+    do {
+      for (; *symbol != '\0'; ++symbol) {
+#if MORSE_PARALLEL
+        /* the two-LED code: one tick of red for a dot, green for a dash or
+         * both for a space, then dark */
+        set_leds((*symbol == '.') ? 0b01 : (*symbol == '-') ? 0b10 : 0b11);
+        PT_HOLD(sequencer_pt, sequencer_hold, 1);
+        set_leds(0);
+        PT_HOLD(sequencer_pt, sequencer_hold, parallel_symbol_pause_len);
+#else
+        /* red for dots, green for dashes, and dark for a space, which
+         * will also stand in for unknown characters */
+        leds = (*symbol == '.') ? 0b01 : (*symbol == '-') ? 0b10 : 0;
+        set_leds(leds);
+        PT_HOLD(sequencer_pt, sequencer_hold, leds == 0b01 ? dot_len - 1 : leds == 0b10 ? dash_len - 1 :
+                                              word_pause_len + 1 + farnsworth_ticks(1));
+
+        /* pause after a dot or dash */
+        if (leds != 0) {
+          set_leds(0);
+          PT_HOLD(sequencer_pt, sequencer_hold, 2);
+        }
+#endif
       }
+
+      /* pause between characters */
+#if MORSE_PARALLEL
+      PT_HOLD(sequencer_pt, sequencer_hold, parallel_character_pause_len - parallel_symbol_pause_len);
+#else
+      PT_HOLD(sequencer_pt, sequencer_hold, character_pause_len + 2 + farnsworth_ticks(3));
+#endif
+
+      /* and, for a voiced kana, again for its mark */
+      symbol = mark;
+      mark = NULL;
+    } while (symbol != NULL);
+    next_char();
+
+    /* between characters is the safe place to give way to more urgent traffic */
+    if (msgqueue_top_priority() > current.priority) {
+      preempt_message();
     }
   }
+  release_message();
 
-  else {
-    /* pause between messages */
-    if (phase <= word_pause_len) {
-      word_pause(phase);
-      ++phase;
+  /* pause between messages */
+#if MORSE_PARALLEL
+  PT_HOLD(sequencer_pt, sequencer_hold, word_pause_len + 1);
+#else
+  PT_HOLD(sequencer_pt, sequencer_hold, word_pause_len + 1 + farnsworth_ticks(4));
+#endif
+
+  /* set message_ended flag to 1 and start again on the next tick */
+  message_ended = 1;
+
+  PT_END(sequencer_pt);
+}
+
+/* key the current message as data frames (see link.h), one half-bit per
+ * tick and up to LINK_MAX_PAYLOAD characters to a frame, on both LEDs for
+ * the most light. Each frame is followed by LINK_GAP_TICKS dark ticks, and
+ * the message by the tick on which message_ended is set; like
+ * run_sequencer() it gives way to more urgent traffic in between. */
+void run_link()
+{
+  /* these outlive a yield, so they cannot be automatic */
+  static link_transmitter tx;
+  static int level;
+  uint8_t payload[LINK_MAX_PAYLOAD];
+  size_t length;
+  int c;
+
+  PT_HOLDING(sequencer_hold);
+
+  PT_BEGIN(sequencer_pt);
+
+  message_ended = 0;
+
+  while ((c = current_char()) != '\0') {
+    if (c == ROPE_WAITING) {
+      PT_YIELD(sequencer_pt);
+      if (msgqueue_top_priority() > current.priority) {
+        preempt_message();
+      }
+      continue;
     }
 
-    /* set message_ended flag to 1 and reset phase, smbol_index and character_index to 0 */
-    else {
-      message_ended = 1;
-      phase = 0;
-      symbol_index = 0;
-      character_index = 0;
+    /* a frame takes as much of the text as there is, up to a payload */
+    for (length = 0; length < LINK_MAX_PAYLOAD && (c = current_char()) != '\0' && c != ROPE_WAITING; ++length) {
+      payload[length] = (uint8_t)c;
+      next_char();
+    }
+    link_tx_start(&tx, payload, length);
+
+    while ((level = link_tx_next(&tx)) >= 0) {
+      set_leds(level ? 0b11 : 0);
+      PT_YIELD(sequencer_pt);
+    }
+    set_leds(0);
+    PT_HOLD(sequencer_pt, sequencer_hold, LINK_GAP_TICKS);
+
+    if (msgqueue_top_priority() > current.priority) {
+      preempt_message();
     }
   }
+  release_message();
+
+  message_ended = 1;
+
+  PT_END(sequencer_pt);
 }
 
+#if MORSE_PLAY_TIMELINE
+/* key the current message's precompiled timeline, one unit per tick;
+ * the image is read in place, with the same message_ended handshake as
+ * signal_message() so that the buttons still cycle between messages */
+void play_timeline()
+{
+  unsigned char level_mask;
+
+  /* (re)start at the top of the current message once the last one has
+   * finished; mainThread() may already have cleared message_ended */
+  if (!player_started || (player.units_left == 0 && player.cursor.runs_left == 0)) {
+    timeline_player_start(&player, timeline_images[message_index], timeline_image_sizes[message_index]);
+    player_started = 1;
+    message_ended = 0;
+  }
+
+  if (timeline_player_tick(&player, &level_mask)) {
+    set_leds(level_mask);
+  }
+
+  /* flag the end once the last unit has been keyed */
+  if (player.units_left == 0 && player.cursor.runs_left == 0) {
+    message_ended = 1;
+  }
+}
+#endif
+
 /* normalize index to ensure that it is a valid index for the messages array
  * @params next_message_index -> the variable as incremented/decremented by button interrupts
  * @ return -> the message mod num_messages
@@ -318,70 +1341,154 @@ short unsigned int normalize_message_index(short unsigned int index) {
   return index % num_messages;
 }
 
-/* --- functions to signal Morse code symbols (and pauses) ---
- * signal a 'dot' (500ms red LED, 500ms pause)
- * @param phase -> the current step in the dot symbol */
-void signal_dot(short int phase) {
+/* wait for the next interrupt with the core clock gated, or, with
+ * MORSE_LPDS, sleep through to the end of a long enough dark gap */
+void cpu_idle() {
 
-    if (phase <= 0) {
-      set_leds(1);
+#if MORSE_LPDS
+    if (deep_sleep()) {
+        return;
     }
+#endif
 
-    else {
-      set_leds(0);
-      phase = 0;
-    }
+#if !defined(MORSE_HOST)
+    __asm(" wfi");
+#endif
 }
 
-/* signal a 'dash' (1500ms green LED, 500ms pause)
- * @param phase -> the current step in the dash symbol */
-void signal_dash(int phase) {
+#if MORSE_LPDS
+/* if the LEDs are dark now and the sequencer is holding them dark for
+ * long enough, sleep in LPDS until just before the tick on which it has
+ * work again (see lpds.h). The timer is closed for the sleep and opened
+ * again with a first period that brings it back in phase; the ticks slept
+ * through are then caught up with, and a button press that woke the
+ * device is taken as if it had come in on the tick it did
+ * @return -> 1 if the timer was stopped, 0 if there was no gap to sleep in */
+unsigned char deep_sleep() {
+
+    uintptr_t key = HwiP_disable();
+    uint32_t period = tick_period_us;
+    uint32_t hold = sequencer_hold;
+    uint32_t since, before, slept, skipped, first;
+    uint64_t gap, elapsed;
+    unsigned char button;
+    int status;
 
-    if (phase <= 2) {
-      set_leds(2);
+    /* a rollover still pending shows up as a tick more than half gone */
+    if (lpds_min_gap_us == 0 || leds_lit != 0 || next_leds != 0 || hold == 0 || timer0 == NULL ||
+        timer_reopened || requested_period_us != period ||
+        (profile_now() - rollover_time) / PROFILE_COUNTS_PER_US >= period / 2) {
+        HwiP_restore(key);
+        return 0;
     }
 
-    else {
-      set_leds(0);
-      phase = 0;    // reset the phase counter
+    /* the timers count up within the period, at the system clock;
+     * rollovers up to the one hold ticks on have nothing to do */
+    since = Timer_getCount(timer0) / LPDS_TIMER_COUNTS_PER_US;
+    gap = (uint64_t)(hold + 1) * period - since;
+    if (gap < lpds_min_gap_us || gap > UINT32_MAX) {
+        HwiP_restore(key);
+        return 0;
     }
-}
 
-/* pause between dots, dashes, characters and words:
- *    500ms - 500ms = 0ms between dots/dashes,
- *    1500ms - 500ms = 1000ms between characters,
- *    3500ms - 1500ms between words
- * @param phase -> the current step in the pause
- * Inter-character pause */
-void character_pause(int phase) {
+    before = profile_now();
+    console_suspend();
+    Timer_close(timer0);
+    timer0 = NULL;
 
-    if (phase <= 1) {
-         set_leds(0);
+    status = lpds_sleep((uint32_t)gap, &slept, &button);
+
+    /* where the sleep left off on the tick grid. Waking past the tick with
+     * work on it is no matter, as its own edge is dark: the work is caught
+     * up with and the next edge still goes out on time. Waking past that
+     * edge, it goes out as soon as it can, late, and the ticks after it
+     * keep to time from there */
+    elapsed = (uint64_t)since + slept;
+    skipped = (uint32_t)(elapsed / period);
+    first = period - (uint32_t)(elapsed % period);
+    if (skipped > hold + 1) {
+        skipped = hold + 1;
+        first = LPDS_LATE_RESTART_US;
+        ++lpds_stats.late;
+    }
+
+    profile_resume(before + slept * PROFILE_COUNTS_PER_US);
+    if (open_timer(first) != 0) {
+        /* Failed to restart timer */
+        while (1) {}
+    }
+    timer_reopened = 1;
+    console_resume();
+
+    if (status == LPDS_STATUS_SUCCESS) {
+        catch_up_ticks(skipped, since, slept);
+        lpds_stats.ticks_skipped += skipped;
+        if (button) {
+            gpioButtonFxn0(CONFIG_GPIO_BUTTON_0);
+        }
     }
+
+    HwiP_restore(key);
+    return 1;
 }
 
-/* Inter-word/message pause */
-void word_pause(int phase) {
+/* do the work of ticks whose interrupts were slept through, as
+ * timerCallback() would have but for the LEDs, which stayed dark. The
+ * sleep is charged a tick at a time, each share to the message that tick
+ * was keying, so that a sleep across the end of a message is split
+ * between the two
+ * @param ticks -> the ticks slept through
+ * @param since_us -> how far into its tick the sleep began
+ * @param slept_us -> how long it lasted */
+void catch_up_ticks(uint32_t ticks, uint32_t since_us, uint32_t slept_us) {
+
+    uint32_t share = tick_period_us - since_us;
+
+    /* the rest of the tick the sleep began in */
+    if (share > slept_us || ticks == 0) {
+        share = slept_us;
+    }
+    energy_sleep(share);
+    slept_us -= share;
+
+    while (ticks-- != 0) {
+        ++tick_count;
+        loop_stage = 0;
+        count_startup_delay();
+        sequencer_tick();
+        update_message();
 
-    if (phase <= 3) {
-         set_leds(0);
+        /* the last tick takes whatever is left, waking late or not */
+        share = ticks == 0 || tick_period_us > slept_us ? slept_us : tick_period_us;
+        energy_sleep(share);
+        slept_us -= share;
     }
 }
+#endif
 
 /* Configure the TI board */
 void configure_board() {
+    configure_leds();
+    configure_buttons();
+}
+
+/* Configure the LED pins and turn both LEDs off */
+void configure_leds() {
     /* Call driver init functions */
     GPIO_init();
 
-    /* Configure the LED and button pins */
+    /* Configure the LED pins */
     GPIO_setConfig(CONFIG_GPIO_LED_0, GPIO_CFG_OUT_STD | GPIO_CFG_OUT_LOW);
     GPIO_setConfig(CONFIG_GPIO_LED_1, GPIO_CFG_OUT_STD | GPIO_CFG_OUT_LOW);
-    GPIO_setConfig(CONFIG_GPIO_BUTTON_0, GPIO_CFG_IN_PU | GPIO_CFG_IN_INT_FALLING);
 
     /* Turn all LEDs off to begin with */
     GPIO_write(CONFIG_GPIO_LED_0, CONFIG_GPIO_LED_OFF);
     GPIO_write(CONFIG_GPIO_LED_1, CONFIG_GPIO_LED_OFF);
+}
 
+/* Configure the button pins and their interrupts; GPIO_init() must have been called */
+void configure_buttons() {
+    GPIO_setConfig(CONFIG_GPIO_BUTTON_0, GPIO_CFG_IN_PU | GPIO_CFG_IN_INT_FALLING);
 
     /* Install Button callback */
     GPIO_setCallback(CONFIG_GPIO_BUTTON_0, gpioButtonFxn0);
@@ -404,71 +1511,3 @@ void configure_board() {
         GPIO_enableInt(CONFIG_GPIO_BUTTON_1);
     }
 }
-
-/* This function converts a character to its Morse code equivalent
- *   n.b. each 'symbol' (dot/dash) postpends a dot-length pause, and
- *   each character postpends a dash-length pause; each is then
- *   subtracted from the character- or word-pause when it occurs
- * @param character -> the character to be converted to Morse code
- * @return -> a string containting the Morse code for the character
- * */
-const char* get_morse(char character)
-{
-
-  switch (character) {
-    case 'a':
-      return ".-";
-    case 'b':
-      return "-...";
-    case 'c':
-      return "-.-.";
-    case 'd':
-      return "-..";
-    case 'e':
-      return ".";
-    case 'f':
-      return "..-.";
-    case 'g':
-      return "--.";
-    case 'h':
-      return "....";
-    case 'i':
-      return "..";
-    case 'j':
-      return ".---";
-    case 'k':
-      return "-.-";
-    case 'l':
-      return ".-..";
-    case 'm':
-      return "--";
-    case 'n':
-      return "-.";
-    case 'o':
-      return "---";
-    case 'p':
-      return ".--.";
-    case 'q':
-      return "--.-";
-    case 'r':
-      return ".-.";
-    case 's':
-      return "...";
-    case 't':
-      return "-";
-    case 'u':
-      return "..-";
-    case 'v':
-      return "...-";
-    case 'w':
-      return ".--";
-    case 'x':
-      return "-..-";
-    case 'y':
-      return "-.--";
-    case 'z':
-      return "--..";
-    default:
-      return " ";
-  }
-}
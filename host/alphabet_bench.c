@@ -0,0 +1,311 @@
+/*
+ *  ======== alphabet_bench.c ========
+ *  ENCODE THROUGHPUT FOR EACH ALPHABET OF alphabet.h. FOR EACH ONE A
+ *  RANDOM TEXT OF ITS CHARACTERS, AS UTF-8, IS TIMED THROUGH THE LOOKUP
+ *  ALONE (utf8_decode() AND alphabet_code(), AS THE SEQUENCER CALLS THEM
+ *  EACH CHARACTER) AND THROUGH timeline_encode_message(), WHICH TURNS IT
+ *  INTO A TIMELINE IMAGE TICK FOR TICK AS IT WOULD BE KEYED. THE LOOKUP IS
+ *  ALSO TIMED AGAINST A PLAIN SEARCH OF THE SAME TABLE, FOR SCALE.
+ *
+ *    alphabet_bench [-n CHARACTERS] [-l LENGTH] [-r REPEATS] [-s SEED]
+ *
+ *    -n  characters of text for each alphabet (default 1000000)
+ *    -l  characters in each message it is encoded as (default 48)
+ *    -r  passes over the text; the fastest counts (default 10)
+ *    -s  random seed (default 1)
+ *
+ *  Latin is the ASCII get_morse() has codes for, and has no table. Before
+ *  anything is timed, every code point in every table is looked up, and
+ *  every other one up to U+FFFF checked not to be found, and the text is
+ *  checked to decode back to the code points it was made from.
+ *
+ *  Build from the repository root with:
+ *    gcc -O2 -DMORSE_HOST -I. -o alphabet_bench host/alphabet_bench.c \
+ *        alphabet.c alphabet_tables.c morse.c timeline.c utf8.c
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "alphabet.h"
+#include "morse.h"
+#include "timeline.h"
+#include "utf8.h"
+
+/* an image is at most this many bytes for each character of a message */
+#define BYTES_PER_CHARACTER 32
+
+static unsigned long num_characters = 1000000;
+static unsigned long message_len = 48;
+static unsigned long repeats = 10;
+static unsigned long seed = 1;
+
+static volatile uintptr_t sink;
+
+/* @return -> nanoseconds on a monotonic clock */
+static uint64_t now_ns(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* @return -> the bytes of a code point written as UTF-8 */
+static size_t put_utf8(char *out, uint32_t code_point) {
+
+    if (code_point < 0x80) {
+        out[0] = (char)code_point;
+        return 1;
+    }
+    if (code_point < 0x800) {
+        out[0] = (char)(0xc0 | (code_point >> 6));
+        out[1] = (char)(0x80 | (code_point & 0x3f));
+        return 2;
+    }
+    out[0] = (char)(0xe0 | (code_point >> 12));
+    out[1] = (char)(0x80 | ((code_point >> 6) & 0x3f));
+    out[2] = (char)(0x80 | (code_point & 0x3f));
+    return 3;
+}
+
+/* @return -> the code points an alphabet has codes for, into points */
+static size_t code_points(alphabet_id id, uint32_t *points) {
+
+    const alphabet_table *table = &alphabet_tables[id];
+    size_t count = 0;
+    uint32_t c;
+
+    if (table->size == 0) {
+        for (c = 0x20; c < 0x7f; ++c) {
+            if (c == ' ' || get_morse((char)c)[0] != ' ') {
+                points[count++] = c;
+            }
+        }
+        return count;
+    }
+    for (c = 0; c < table->size; ++c) {
+        if (table->slots[c].code_point != 0) {
+            points[count++] = table->slots[c].code_point;
+        }
+    }
+    return count;
+}
+
+/* @return -> code points the table misplaces, or finds that it should not */
+static unsigned long check_table(alphabet_id id) {
+
+    const alphabet_table *table = &alphabet_tables[id];
+    const alphabet_slot *slot;
+    unsigned long bad = 0;
+    uint32_t c, s;
+
+    for (c = 0x80; c < 0x10000; ++c) {
+        slot = alphabet_lookup(table, c);
+        for (s = 0; s < table->size && table->slots[s].code_point != c; ++s) {
+        }
+        if ((slot != NULL) != (s < table->size) || (slot != NULL && slot != &table->slots[s])) {
+            ++bad;
+        }
+    }
+    return bad;
+}
+
+/* the same lookup as alphabet_code(), by searching the table */
+static const char *scan_code(const alphabet_table *table, uint32_t code_point, const char **mark) {
+
+    uint32_t s;
+
+    *mark = NULL;
+    if (code_point < 0x80) {
+        return get_morse((char)code_point);
+    }
+    for (s = 0; s < table->size; ++s) {
+        if (table->slots[s].code_point == code_point) {
+            if (table->slots[s].mark != 0) {
+                *mark = alphabet_codes[table->slots[s].mark];
+            }
+            return alphabet_codes[table->slots[s].code];
+        }
+    }
+    return " ";
+}
+
+/* @return -> the fastest pass of decoding text and looking each character up */
+static uint64_t time_lookup(const char *text, size_t length, const alphabet_table *table) {
+
+    utf8_decoder utf8;
+    const char *mark;
+    uintptr_t total;
+    uint64_t best = UINT64_MAX, start;
+    int32_t code_point;
+    unsigned long r;
+    size_t i;
+
+    for (r = 0; r < repeats; ++r) {
+        total = 0;
+        utf8_reset(&utf8);
+        start = now_ns();
+        for (i = 0; i < length; ++i) {
+            code_point = utf8_decode(&utf8, (uint8_t)text[i]);
+            if (code_point != UTF8_MORE) {
+                total += (uintptr_t)(table == NULL ? alphabet_code((uint32_t)code_point, &mark) :
+                                                     scan_code(table, (uint32_t)code_point, &mark));
+                total += (uintptr_t)mark;
+            }
+        }
+        start = now_ns() - start;
+        sink = total;
+        if (start < best) {
+            best = start;
+        }
+    }
+    return best;
+}
+
+/* @return -> the fastest pass of encoding every message, or 0 if one failed */
+static uint64_t time_encode(char *const *messages, size_t num_messages, uint8_t *image, size_t capacity) {
+
+    timeline_writer writer;
+    uint64_t best = UINT64_MAX, start;
+    uintptr_t total;
+    unsigned long r;
+    size_t m;
+
+    for (r = 0; r < repeats; ++r) {
+        total = 0;
+        start = now_ns();
+        for (m = 0; m < num_messages; ++m) {
+            timeline_writer_init(&writer, image, capacity, 2);
+            if (timeline_encode_message(&writer, messages[m]) != TIMELINE_STATUS_SUCCESS) {
+                return 0;
+            }
+            total += (uintptr_t)timeline_writer_finish(&writer, 1000);
+        }
+        start = now_ns() - start;
+        sink = total;
+        if (start < best) {
+            best = start;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char **argv) {
+
+    uint32_t points[512];
+    uint32_t *drawn;
+    char *text, **messages;
+    uint8_t *image;
+    size_t num_points, length, num_messages, m, i, capacity;
+    utf8_decoder utf8;
+    int32_t code_point;
+    unsigned long bad, id;
+    uint64_t hash_ns, scan_ns, encode_ns;
+    const alphabet_table *table;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:r:s:")) != -1) {
+        switch (opt) {
+            case 'n':
+                num_characters = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                message_len = strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                repeats = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: alphabet_bench [-n CHARACTERS] [-l LENGTH] [-r REPEATS] [-s SEED]\n");
+                return 2;
+        }
+    }
+    if (num_characters == 0 || message_len == 0 || repeats == 0) {
+        fprintf(stderr, "alphabet_bench: CHARACTERS, LENGTH and REPEATS must be at least 1\n");
+        return 2;
+    }
+
+    num_messages = (num_characters + message_len - 1) / message_len;
+    capacity = message_len * BYTES_PER_CHARACTER + TIMELINE_HEADER_LEN;
+    drawn = malloc(num_characters * sizeof(*drawn));
+    text = malloc(num_characters * 3 + num_messages);
+    messages = malloc(num_messages * sizeof(*messages));
+    image = malloc(capacity);
+    if (drawn == NULL || text == NULL || messages == NULL || image == NULL) {
+        fprintf(stderr, "alphabet_bench: out of memory\n");
+        return 2;
+    }
+    srand((unsigned int)seed);
+
+    printf("%lu characters for each alphabet, in messages of %lu\n", num_characters, message_len);
+    printf("%-9s %6s %6s %5s %10s %10s %10s %8s %5s\n", "", "points", "bytes", "B/chr", "hash ns", "scan ns",
+           "encode ns", "MB/s", "bad");
+    for (id = 0; id < ALPHABET_COUNT; ++id) {
+        table = &alphabet_tables[id];
+        alphabet_select((alphabet_id)id);
+        num_points = code_points((alphabet_id)id, points);
+
+        /* the text, a NUL after every message so that each can be encoded
+         * where it lies, and the whole of it timed through the lookup as
+         * if it were one; the NULs key as nothing either way */
+        length = 0;
+        for (i = 0; i < num_characters; ++i) {
+            if (i % message_len == 0) {
+                if (i != 0) {
+                    text[length++] = '\0';
+                }
+                messages[i / message_len] = &text[length];
+            }
+            drawn[i] = points[(unsigned int)rand() % num_points];
+            length += put_utf8(&text[length], drawn[i]);
+        }
+        text[length++] = '\0';
+
+        /* check the table, and that the text decodes to what it was made of */
+        bad = check_table((alphabet_id)id);
+        utf8_reset(&utf8);
+        for (i = 0, m = 0; i < length; ++i) {
+            code_point = utf8_decode(&utf8, (uint8_t)text[i]);
+            if (code_point > 0 && (m >= num_characters || (uint32_t)code_point != drawn[m++])) {
+                ++bad;
+            }
+        }
+        if (m != num_characters) {
+            ++bad;
+        }
+
+        hash_ns = time_lookup(text, length, NULL);
+        scan_ns = time_lookup(text, length, table);
+        encode_ns = time_encode(messages, num_messages, image, capacity);
+        if (encode_ns == 0) {
+            ++bad;
+            encode_ns = 1;
+        }
+
+        printf("%-9s %6u %6u %5.2f %10.2f %10.2f %10.2f %8.1f %5lu\n", table->name, (uint32_t)num_points,
+               (uint32_t)(table->buckets + table->size * sizeof(alphabet_slot)),
+               (double)(length - num_messages) / num_characters, (double)hash_ns / num_characters,
+               (double)scan_ns / num_characters, (double)encode_ns / num_characters,
+               (double)(length - num_messages) * 1000.0 / encode_ns, bad);
+    }
+    alphabet_select(ALPHABET_LATIN);
+
+    free(drawn);
+    free(text);
+    free(messages);
+    free(image);
+
+    return 0;
+}
+
+#endif /* MORSE_HOST */
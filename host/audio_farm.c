@@ -0,0 +1,505 @@
+/*
+ *  ======== audio_farm.c ========
+ *  OFFLINE AUDIO RENDERER FOR PRE-RECORDED BROADCASTS. RENDERS A LIST OF
+ *  MESSAGES TO 16-BIT PCM ON A POOL OF THREADS, ONE FILE PER MESSAGE, AND
+ *  REPORTS HOW MANY SECONDS OF AUDIO IT RENDERS PER SECOND OF WALL TIME.
+ *
+ *    audio_farm [-j THREADS] [-r RATE] [-w WPM] [-f TONE] [-a ALPHABET] [-m REPEAT] [-o DIR [-F FORMAT]]
+ *               [-S] FILE
+ *
+ *    -j  worker threads (default 4)
+ *    -r  samples per second (default 48000)
+ *    -w  keying speed, one unit per dot as on the device (default 20)
+ *    -f  tone in Hz (default 700), moved to a whole number of cycles per
+ *        unit so that units join up without a click
+ *    -a  latin (default), cyrillic, greek or wabun: the alphabet characters
+ *        past ASCII are keyed in, as the console's alphabet command selects
+ *    -m  render the list this many times over, for a longer benchmark
+ *    -o  write the audio into DIR, as NNNNNN.wav or NNNNNN.pcm; without it
+ *        the audio is rendered and thrown away, to time the rendering alone.
+ *        Files that cannot be written are counted, and the farm exits 1
+ *    -F  wav (default), or pcm for bare little-endian samples
+ *    -S  synthesise sample by sample, with sin() and the envelope worked
+ *        out for each sample, instead of from the templates, to compare
+ *
+ *  FILE has one message per line, in UTF-8, keyed as the device keys it:
+ *  capitals as small letters, the digits and ITU punctuation as get_morse()
+ *  has them, and anything past ASCII in the -a alphabet (see alphabet.h),
+ *  with whatever has no code keyed as a space; lines starting '#' are
+ *  skipped. Each message is turned into the same
+ *  timeline the device plays (timeline_encode_message(), from morse.c's
+ *  tables), so the audio keeps the device's timing to the unit.
+ *
+ *  The waveform is assembled rather than synthesised: at start-up one
+ *  unit of tone is rendered four ways, with a 5 ms raised-cosine rise,
+ *  with a fall, with both (a mark one unit long) and with neither, and a
+ *  mark is then memcpy'd together from them unit by unit; dark units are
+ *  memset. Every worker has one buffer, allocated before the clock starts
+ *  and big enough for the longest message, so nothing is allocated while
+ *  rendering. The templates are shared and only ever read.
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -I. -O2 -pthread -o audio_farm host/audio_farm.c \
+ *        alphabet.c alphabet_tables.c morse.c timeline.c utf8.c -lm
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "alphabet.h"
+#include "timeline.h"
+
+#define MAX_THREADS 64
+#define MAX_LINE    4096
+
+/* the rise and fall of each mark, so that it does not click */
+#define RAMP_MS     5
+
+/* peak sample */
+#define AMPLITUDE   24000
+
+/* --- one message to render --- */
+typedef struct {
+    uint8_t *image;
+    size_t image_len;
+    uint32_t units;
+} farm_job;
+
+/* --- one worker, and what it got through --- */
+typedef struct {
+    pthread_t thread;
+    int16_t *buffer;
+    uint32_t messages;
+    uint32_t failed;                /* files that could not be written */
+    uint64_t samples;
+} farm_worker;
+
+static uint32_t threads = 4;
+static uint32_t sample_rate = 48000;
+static uint32_t wpm = 20;
+static double tone = 700;
+static uint32_t repeat = 1;
+static const char *out_dir = NULL;
+static unsigned char raw_pcm = 0;
+static unsigned char per_sample = 0;
+
+static farm_job *jobs = NULL;
+static size_t num_jobs = 0;
+static size_t next_job = 0;
+static pthread_mutex_t job_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint32_t unit_samples;
+static uint32_t ramp_samples;
+
+/* one unit of tone: with a rise, with a fall, with both and with neither */
+static int16_t *template_attack;
+static int16_t *template_release;
+static int16_t *template_lone;
+static int16_t *template_steady;
+
+/* @return -> nanoseconds on a monotonic clock */
+static uint64_t now_ns(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* @return -> the envelope, 0 to 1, n samples into a mark of length samples */
+static double envelope(uint64_t n, uint64_t length) {
+
+    uint64_t from_end = length - 1 - n;
+
+    if (n < ramp_samples) {
+        return 0.5 - 0.5 * cos(M_PI * n / ramp_samples);
+    }
+    if (from_end < ramp_samples) {
+        return 0.5 - 0.5 * cos(M_PI * from_end / ramp_samples);
+    }
+    return 1;
+}
+
+/* @return -> sample n of the tone, which has a whole number of cycles
+ *            in every unit, so it is the same in each */
+static double carrier(uint64_t n) {
+
+    return sin(2 * M_PI * tone * (double)n / sample_rate);
+}
+
+/* render the four templates, each one unit long
+ * @return -> 0, or -1 if out of memory */
+static int make_templates(void) {
+
+    uint32_t n;
+
+    template_attack = malloc(unit_samples * sizeof(int16_t));
+    template_release = malloc(unit_samples * sizeof(int16_t));
+    template_lone = malloc(unit_samples * sizeof(int16_t));
+    template_steady = malloc(unit_samples * sizeof(int16_t));
+    if (template_attack == NULL || template_release == NULL || template_lone == NULL || template_steady == NULL) {
+        return -1;
+    }
+
+    for (n = 0; n < unit_samples; ++n) {
+        double c = AMPLITUDE * carrier(n);
+
+        /* as the first, last and only unit of a long mark */
+        template_attack[n] = (int16_t)lrint(c * envelope(n, (uint64_t)unit_samples * 2));
+        template_release[n] = (int16_t)lrint(c * envelope(n + unit_samples, (uint64_t)unit_samples * 2));
+        template_lone[n] = (int16_t)lrint(c * envelope(n, unit_samples));
+        template_steady[n] = (int16_t)lrint(c);
+    }
+    return 0;
+}
+
+/* render a message from the templates
+ * @return -> the samples rendered */
+static uint64_t render_templates(const farm_job *job, int16_t *out) {
+
+    timeline_header header;
+    timeline_cursor cursor;
+    unsigned char mask;
+    uint32_t units, i;
+    int16_t *pos = out;
+    size_t unit_bytes = unit_samples * sizeof(int16_t);
+
+    timeline_open(job->image, job->image_len, &header, &cursor);
+    while (timeline_next(&cursor, &mask, &units) == 1) {
+        if (mask == 0) {
+            memset(pos, 0, units * unit_bytes);
+            pos += (size_t)units * unit_samples;
+        }
+        else if (units == 1) {
+            memcpy(pos, template_lone, unit_bytes);
+            pos += unit_samples;
+        }
+        else {
+            memcpy(pos, template_attack, unit_bytes);
+            pos += unit_samples;
+            for (i = 2; i < units; ++i) {
+                memcpy(pos, template_steady, unit_bytes);
+                pos += unit_samples;
+            }
+            memcpy(pos, template_release, unit_bytes);
+            pos += unit_samples;
+        }
+    }
+    return (uint64_t)(pos - out);
+}
+
+/* render a message sample by sample, for comparison
+ * @return -> the samples rendered */
+static uint64_t render_samples(const farm_job *job, int16_t *out) {
+
+    timeline_header header;
+    timeline_cursor cursor;
+    unsigned char mask;
+    uint32_t units;
+    uint64_t n = 0, length, i;
+
+    timeline_open(job->image, job->image_len, &header, &cursor);
+    while (timeline_next(&cursor, &mask, &units) == 1) {
+        length = (uint64_t)units * unit_samples;
+        for (i = 0; i < length; ++i, ++n) {
+            out[n] = mask == 0 ? 0 : (int16_t)lrint(AMPLITUDE * carrier(n) * envelope(i, length));
+        }
+    }
+    return n;
+}
+
+/* store a 32-bit or 16-bit value little-endian */
+static void put32(uint8_t *p, uint32_t value) {
+
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static void put16(uint8_t *p, uint16_t value) {
+
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+/* write a message's audio as WAV or bare PCM; the host is little-endian
+ * @param quiet -> nonzero not to say why it failed, once it has been said
+ * @return -> 0, or -1 on failure */
+static int write_audio(size_t index, const int16_t *samples, uint64_t count, int quiet) {
+
+    char path[4096];
+    uint8_t header[44];
+    uint32_t data_bytes = (uint32_t)(count * sizeof(int16_t));
+    FILE *out;
+    int status = 0;
+
+    snprintf(path, sizeof(path), "%s/%06zu.%s", out_dir, index, raw_pcm ? "pcm" : "wav");
+    out = fopen(path, "wb");
+    if (out == NULL) {
+        if (!quiet) {
+            perror(path);
+        }
+        return -1;
+    }
+
+    if (!raw_pcm) {
+        memcpy(header, "RIFF", 4);
+        put32(header + 4, 36 + data_bytes);
+        memcpy(header + 8, "WAVEfmt ", 8);
+        put32(header + 16, 16);
+        put16(header + 20, 1);                      /* PCM */
+        put16(header + 22, 1);                      /* mono */
+        put32(header + 24, sample_rate);
+        put32(header + 28, sample_rate * sizeof(int16_t));
+        put16(header + 32, sizeof(int16_t));
+        put16(header + 34, 16);
+        memcpy(header + 36, "data", 4);
+        put32(header + 40, data_bytes);
+        if (fwrite(header, sizeof(header), 1, out) != 1) {
+            status = -1;
+        }
+    }
+    if (fwrite(samples, sizeof(int16_t), count, out) != count) {
+        status = -1;
+    }
+    if (fclose(out) != 0 || status != 0) {
+        if (!quiet) {
+            perror(path);
+        }
+        return -1;
+    }
+    return 0;
+}
+
+/* take messages off the list and render them until there are none left;
+ * a file that cannot be written is counted, and the rest still tried */
+static void *work(void *arg) {
+
+    farm_worker *worker = arg;
+    size_t index;
+    uint64_t count;
+
+    for (;;) {
+        pthread_mutex_lock(&job_lock);
+        index = next_job++;
+        pthread_mutex_unlock(&job_lock);
+        if (index >= num_jobs * repeat) {
+            break;
+        }
+
+        count = per_sample ? render_samples(&jobs[index % num_jobs], worker->buffer) :
+                             render_templates(&jobs[index % num_jobs], worker->buffer);
+        if (out_dir != NULL && write_audio(index, worker->buffer, count, worker->failed != 0) != 0) {
+            ++worker->failed;
+        }
+        ++worker->messages;
+        worker->samples += count;
+    }
+    return NULL;
+}
+
+/* encode every message in a file into a timeline of its own
+ * @return -> 0, or -1 on failure */
+static int load_jobs(const char *path, uint32_t unit_us) {
+
+    static char line[MAX_LINE];
+    static uint8_t image[1 << 16];
+    timeline_writer writer;
+    size_t capacity = 0, length;
+    FILE *in;
+    int size;
+
+    in = fopen(path, "r");
+    if (in == NULL) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), in) != NULL) {
+        length = strcspn(line, "\r\n");
+        line[length] = '\0';
+        if (line[0] == '#' || length == 0) {
+            continue;
+        }
+
+        timeline_writer_init(&writer, image, sizeof(image), 2);
+        if (timeline_encode_message(&writer, line) != TIMELINE_STATUS_SUCCESS ||
+            (size = timeline_writer_finish(&writer, unit_us)) < 0) {
+            fprintf(stderr, "audio_farm: cannot encode '%s'\n", line);
+            fclose(in);
+            return -1;
+        }
+
+        if (num_jobs == capacity) {
+            capacity = capacity != 0 ? capacity * 2 : 64;
+            jobs = realloc(jobs, capacity * sizeof(*jobs));
+            if (jobs == NULL) {
+                fclose(in);
+                return -1;
+            }
+        }
+        jobs[num_jobs].image = malloc((size_t)size);
+        if (jobs[num_jobs].image == NULL) {
+            fclose(in);
+            return -1;
+        }
+        memcpy(jobs[num_jobs].image, image, (size_t)size);
+        jobs[num_jobs].image_len = (size_t)size;
+        jobs[num_jobs].units = 0;
+        {
+            timeline_header header;
+            timeline_cursor cursor;
+            unsigned char mask;
+            uint32_t units;
+
+            timeline_open(image, (size_t)size, &header, &cursor);
+            while (timeline_next(&cursor, &mask, &units) == 1) {
+                jobs[num_jobs].units += units;
+            }
+        }
+        ++num_jobs;
+    }
+    fclose(in);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+
+    static farm_worker workers[MAX_THREADS];
+    const char *format = "wav";
+    uint32_t unit_us, cycles, longest = 0, i;
+    uint64_t start, elapsed, samples = 0, failed = 0;
+    double seconds;
+    size_t j;
+    int opt, alphabet = ALPHABET_LATIN;
+
+    while ((opt = getopt(argc, argv, "j:r:w:f:a:m:o:F:S")) != -1) {
+        switch (opt) {
+            case 'j':
+                threads = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                sample_rate = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'w':
+                wpm = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                tone = strtod(optarg, NULL);
+                break;
+            case 'a':
+                for (alphabet = 0; alphabet < ALPHABET_COUNT && strcmp(optarg, alphabet_tables[alphabet].name) != 0;
+                     ++alphabet) {
+                }
+                break;
+            case 'm':
+                repeat = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'o':
+                out_dir = optarg;
+                break;
+            case 'F':
+                format = optarg;
+                break;
+            case 'S':
+                per_sample = 1;
+                break;
+            default:
+                optind = argc;
+                break;
+        }
+    }
+    raw_pcm = strcmp(format, "pcm") == 0;
+    if (optind != argc - 1 || threads == 0 || threads > MAX_THREADS || sample_rate == 0 || wpm == 0 ||
+        tone <= 0 || alphabet == ALPHABET_COUNT || repeat == 0 || (!raw_pcm && strcmp(format, "wav") != 0)) {
+        fprintf(stderr, "usage: audio_farm [-j THREADS] [-r RATE] [-w WPM] [-f TONE] [-a ALPHABET] [-m REPEAT] "
+                        "[-o DIR [-F FORMAT]] [-S] FILE\n");
+        return 2;
+    }
+    alphabet_select((alphabet_id)alphabet);
+
+    /* the device's tick, in whole samples, with a whole number of cycles */
+    unit_us = 1200000 / wpm;
+    unit_samples = (uint32_t)((uint64_t)unit_us * sample_rate / 1000000);
+    cycles = (uint32_t)lrint(tone * unit_samples / sample_rate);
+    if (unit_samples == 0 || cycles == 0) {
+        fprintf(stderr, "audio_farm: the unit is too short for the tone\n");
+        return 2;
+    }
+    tone = (double)cycles * sample_rate / unit_samples;
+    ramp_samples = sample_rate * RAMP_MS / 1000;
+    if (ramp_samples > unit_samples / 2) {
+        ramp_samples = unit_samples / 2;
+    }
+    if (ramp_samples == 0) {
+        ramp_samples = 1;
+    }
+
+    if (load_jobs(argv[optind], unit_us) != 0 || make_templates() != 0) {
+        return 2;
+    }
+    if (num_jobs == 0) {
+        fprintf(stderr, "audio_farm: no messages in %s\n", argv[optind]);
+        return 2;
+    }
+    for (j = 0; j < num_jobs; ++j) {
+        if (jobs[j].units > longest) {
+            longest = jobs[j].units;
+        }
+    }
+
+    /* every buffer up front, and touched, so that no page faults are timed */
+    for (i = 0; i < threads; ++i) {
+        workers[i].buffer = malloc((size_t)longest * unit_samples * sizeof(int16_t));
+        if (workers[i].buffer == NULL) {
+            fprintf(stderr, "audio_farm: out of memory\n");
+            return 2;
+        }
+        memset(workers[i].buffer, 0, (size_t)longest * unit_samples * sizeof(int16_t));
+    }
+
+    start = now_ns();
+    for (i = 0; i < threads; ++i) {
+        if (pthread_create(&workers[i].thread, NULL, work, &workers[i]) != 0) {
+            fprintf(stderr, "audio_farm: cannot start thread %u\n", i);
+            return 2;
+        }
+    }
+    for (i = 0; i < threads; ++i) {
+        pthread_join(workers[i].thread, NULL);
+    }
+    elapsed = now_ns() - start;
+
+    for (i = 0; i < threads; ++i) {
+        samples += workers[i].samples;
+        failed += workers[i].failed;
+    }
+    seconds = (double)samples / sample_rate;
+
+    printf("%zu messages x %u, %u wpm (%u us units of %u samples), %.1f Hz tone, %u samples/s, %s\n",
+           num_jobs, repeat, wpm, unit_us, unit_samples, tone, sample_rate,
+           per_sample ? "sample by sample" : "from templates");
+    for (i = 0; i < threads; ++i) {
+        printf("  thread %-3u %8u messages %10.1f s of audio\n", i, workers[i].messages,
+               (double)workers[i].samples / sample_rate);
+    }
+    printf("%.1f s of audio in %.3f s on %u threads: %.0f rendered seconds per wall second\n",
+           seconds, elapsed / 1e9, threads, elapsed == 0 ? 0 : seconds * 1e9 / elapsed);
+    if (out_dir != NULL) {
+        printf("%llu files written to %s, %llu failed\n", (unsigned long long)(num_jobs * repeat - failed), out_dir,
+               (unsigned long long)failed);
+    }
+
+    return failed != 0;
+}
+
+#endif /* MORSE_HOST */
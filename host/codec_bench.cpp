@@ -0,0 +1,469 @@
+/*
+ *  ======== codec_bench.cpp ========
+ *  CHECKS THE C++ ENCODER AND DECODER (morse.hpp) AGAINST THE C THEY
+ *  MIRROR, AND TIMES THEM AGAINST IT. EVERY CHARACTER'S CODE IS COMPARED
+ *  WITH get_morse() AND get_character(), AND EVERY MESSAGE OF A RANDOM
+ *  CORPUS IS ENCODED BOTH WAYS, IN BOTH KEYINGS, AND THE IMAGES COMPARED
+ *  BYTE FOR BYTE, THEN DECODED BACK. A FEW MESSAGES ARE ALSO ENCODED AT
+ *  COMPILE TIME, WHICH ONLY BUILDS IF THE LIBRARY IS REALLY constexpr.
+ *
+ *    codec_bench [-n MESSAGES] [-l LENGTH] [-r REPEATS] [-s SEED]
+ *
+ *    -n  messages in the corpus (default 4096)
+ *    -l  characters in each (default 48)
+ *    -r  passes over the corpus; the fastest counts (default 50)
+ *    -s  random seed (default 1)
+ *
+ *  Three things are timed, in nanoseconds per character of the corpus:
+ *    runs      morse::encode() into an array of runs, against the same
+ *              loop written by hand in C over get_morse(), merging as
+ *              timeline_writer_add() does
+ *    range     the same runs, copied out of morse::runs() one at a time,
+ *              against the same C loop; the range is also checked against
+ *              morse::encode() in both keyings and at an odd timing
+ *    timeline  morse::encode_timeline() against timeline_encode_message()
+ *              and timeline_writer_finish(), which write the same image
+ *
+ *  The C calls get_morse() in morse.c where the C++ has its switch inline;
+ *  building everything with -flto changes neither much.
+ *
+ *  Build from the repository root with:
+ *    gcc -std=c99 -O2 -DMORSE_HOST -Ihost -I. -c alphabet.c alphabet_tables.c \
+ *        morse.c timeline.c utf8.c
+ *    g++ -std=c++14 -O2 -DMORSE_HOST -Ihost -I. -o codec_bench \
+ *        host/codec_bench.cpp alphabet.o alphabet_tables.o morse.o \
+ *        timeline.o utf8.o
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+extern "C" {
+#include "morse.h"
+#include "timeline.h"
+}
+
+#include "morse.hpp"
+
+/* --- at compile time: the code, and a whole message both ways round --- */
+static_assert(morse::character(morse::text(morse::code('q'))) == 'q', "code and character disagree");
+
+constexpr std::size_t sos_length() {
+
+    morse::run out[32] = {};
+    morse::result result = morse::encode(morse::text("sos"), out);
+
+    return result.complete ? result.written : 0;
+}
+static_assert(sos_length() == 18, "sos should be eighteen runs, each mark and the dark after it");
+
+constexpr char round_trip() {
+
+    morse::run runs[64] = {};
+    char text[8] = {};
+    morse::result encoded = morse::encode<morse::keying::parallel>(morse::text("hi z"), runs);
+
+    morse::decode<morse::keying::parallel>(morse::span<const morse::run>(runs, encoded.written), text);
+    return text[3];
+}
+static_assert(round_trip() == 'z', "parallel round trip");
+
+constexpr std::uint32_t range_units() {
+
+    std::uint32_t units = 0;
+
+    for (morse::run r : morse::runs(morse::text("sos"))) {
+        units += r.units;
+    }
+    return units;
+}
+static_assert(range_units() == 51, "the runs of sos should last 51 ticks, as the sequencer keys it");
+
+/* an image is at most this many bytes for each character of a message */
+#define BYTES_PER_CHARACTER 16
+
+static unsigned long num_messages = 4096;
+static unsigned long message_len = 48;
+static unsigned long repeats = 50;
+static unsigned long seed = 1;
+
+static volatile uint32_t sink;
+
+/* @return -> nanoseconds on a monotonic clock */
+static uint64_t now_ns(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* the runs of a message as C would write them by hand: get_morse() for
+ * each character and a run merged into the last while the level holds
+ * @return -> runs written, or out_len + 1 had there been more */
+static size_t c_encode(const char *message, morse::run *out, size_t out_len) {
+
+    const char *code;
+    size_t count = 0;
+    unsigned char masks[2];
+    uint32_t units[2];
+    int holds, h;
+
+#define C_ADD(mask, length)                                                 \
+    do {                                                                    \
+        if ((length) == 0) {                                                \
+            break;                                                          \
+        }                                                                   \
+        if (count != 0 && out[count - 1].level_mask == (mask)) {            \
+            out[count - 1].units += (length);                               \
+        }                                                                   \
+        else if (count == out_len) {                                        \
+            return out_len + 1;                                             \
+        }                                                                   \
+        else {                                                              \
+            out[count].level_mask = (mask);                                 \
+            out[count++].units = (length);                                  \
+        }                                                                   \
+    } while (0)
+
+    for (; *message != '\0'; ++message) {
+        for (code = get_morse(*message); *code != '\0'; ++code) {
+            holds = 2;
+            masks[1] = 0;
+            units[1] = 2;
+            if (*code == '.') {
+                masks[0] = 0b01;
+                units[0] = dot_len - 1;
+            }
+            else if (*code == '-') {
+                masks[0] = 0b10;
+                units[0] = dash_len - 1;
+            }
+            else {
+                masks[0] = 0;
+                units[0] = word_pause_len + 1;
+                holds = 1;
+            }
+            for (h = 0; h < holds; ++h) {
+                C_ADD(masks[h], units[h]);
+            }
+        }
+        C_ADD(0, (uint32_t)(character_pause_len + 2));
+    }
+    C_ADD(0, (uint32_t)(word_pause_len + 2));
+#undef C_ADD
+
+    return count;
+}
+
+/* @return -> the image length, or 0 if it did not fit */
+static size_t c_timeline(const char *message, uint8_t *image, size_t capacity, int parallel) {
+
+    timeline_writer writer;
+    int length;
+
+    timeline_writer_init(&writer, image, capacity, 2);
+    if ((parallel ? timeline_encode_parallel(&writer, message) : timeline_encode_message(&writer, message)) !=
+            TIMELINE_STATUS_SUCCESS ||
+        (length = timeline_writer_finish(&writer, 1000)) < 0) {
+        return 0;
+    }
+    return (size_t)length;
+}
+
+/* @return -> 1 if runs() does not give what encode() writes, 0 if it does */
+template <morse::keying K>
+static unsigned long range_differs(const char *message, morse::run *runs, size_t capacity, morse::timing t) {
+
+    morse::result result = morse::encode<K>(morse::text(message), morse::span<morse::run>(runs, capacity), t);
+    size_t i = 0;
+
+    for (morse::run r : morse::runs<K>(morse::text(message), t)) {
+        if (i >= result.written || r != runs[i]) {
+            return 1;
+        }
+        ++i;
+    }
+    return !result.complete || i != result.written;
+}
+
+/* @return -> mismatches between morse.hpp and morse.c, timeline.c */
+static unsigned long check(char *const *messages, uint8_t *image, uint8_t *expected, morse::run *runs,
+                           char *text) {
+
+    size_t capacity = message_len * BYTES_PER_CHARACTER + TIMELINE_HEADER_LEN, length, i;
+    unsigned long bad = 0, m;
+    morse::result result = {0, false};
+    morse::timing odd;
+    int c, parallel;
+
+    odd.dot_len = 1;
+    odd.character_pause_len = 3;
+    odd.parallel_symbol_pause_len = 0;
+    odd.parallel_character_pause_len = 3;
+
+    for (c = -128; c < 128; ++c) {
+        if (strcmp(morse::code((char)c), get_morse((char)c)) != 0 ||
+            morse::character(morse::text(get_morse((char)c))) != get_character(get_morse((char)c))) {
+            printf("  code of %d differs\n", c);
+            ++bad;
+        }
+    }
+    if (morse::character(morse::text("......")) != get_character("......")) {
+        ++bad;
+    }
+
+    for (m = 0; m < num_messages; ++m) {
+        for (parallel = 0; parallel < 2; ++parallel) {
+            length = c_timeline(messages[m], expected, capacity, parallel);
+            result = parallel ?
+                morse::encode_timeline<morse::keying::parallel>(morse::text(messages[m]),
+                                                                morse::span<uint8_t>(image, capacity), 1000) :
+                morse::encode_timeline(morse::text(messages[m]), morse::span<uint8_t>(image, capacity), 1000);
+            if (length == 0 || !result.complete || result.written != length || memcmp(image, expected, length) != 0) {
+                printf("  message %lu image differs (%s)\n", m, parallel ? "parallel" : "serial");
+                ++bad;
+            }
+
+            /* short of space by a byte, it must say so and not overrun */
+            image[length - 1] = 0xa5;
+            result = parallel ?
+                morse::encode_timeline<morse::keying::parallel>(morse::text(messages[m]),
+                                                                morse::span<uint8_t>(image, length - 1), 1000) :
+                morse::encode_timeline(morse::text(messages[m]), morse::span<uint8_t>(image, length - 1), 1000);
+            if (result.complete || image[length - 1] != 0xa5) {
+                printf("  message %lu overran its image\n", m);
+                ++bad;
+            }
+
+            result = parallel ?
+                morse::encode<morse::keying::parallel>(morse::text(messages[m]),
+                                                       morse::span<morse::run>(runs, capacity)) :
+                morse::encode(morse::text(messages[m]), morse::span<morse::run>(runs, capacity));
+            length = result.written;
+            result = parallel ?
+                morse::decode<morse::keying::parallel>(morse::span<const morse::run>(runs, length),
+                                                       morse::span<char>(text, message_len + 1)) :
+                morse::decode(morse::span<const morse::run>(runs, length), morse::span<char>(text, message_len + 1));
+            for (i = 0; i < message_len && result.written == message_len; ++i) {
+                if (text[i] != (get_morse(messages[m][i])[0] == ' ' ? ' ' : messages[m][i])) {
+                    break;
+                }
+            }
+            if (!result.complete || i != message_len) {
+                printf("  message %lu does not decode (%s)\n", m, parallel ? "parallel" : "serial");
+                ++bad;
+            }
+        }
+
+        length = c_encode(messages[m], runs, capacity);
+        result = morse::encode(morse::text(messages[m]), morse::span<morse::run>(runs + capacity, capacity));
+        for (i = 0; i < length && result.written == length && runs[i] == runs[capacity + i]; ++i) {
+        }
+        if (i != length || result.written != length) {
+            printf("  message %lu runs differ\n", m);
+            ++bad;
+        }
+        i = 0;
+        for (morse::run r : morse::runs(morse::text(messages[m]))) {
+            if (i >= length || r != runs[i]) {
+                break;
+            }
+            ++i;
+        }
+        if (i != length) {
+            printf("  message %lu runs differ from the range\n", m);
+            ++bad;
+        }
+
+        /* and in both keyings, at a timing where holds vanish and merge */
+        if (range_differs<morse::keying::serial>(messages[m], runs, capacity, morse::timing()) +
+            range_differs<morse::keying::parallel>(messages[m], runs, capacity, morse::timing()) +
+            range_differs<morse::keying::serial>(messages[m], runs, capacity, odd) +
+            range_differs<morse::keying::parallel>(messages[m], runs, capacity, odd) != 0) {
+            printf("  message %lu range differs from encode()\n", m);
+            ++bad;
+        }
+    }
+
+    return bad;
+}
+
+/* --- one encoder under test; each returns something of its output, so
+ * that none of the work can be thrown away --- */
+typedef struct {
+    const char *name;
+    uint32_t (*encode)(const char *message, uint8_t *buffer, size_t capacity);
+} bench_encoder;
+
+static uint32_t runs_cpp(const char *message, uint8_t *buffer, size_t capacity) {
+
+    morse::result result = morse::encode(morse::text(message),
+                                         morse::span<morse::run>((morse::run *)buffer, capacity / sizeof(morse::run)));
+
+    return (uint32_t)result.written + ((morse::run *)buffer)[result.written - 1].units;
+}
+
+static uint32_t range_cpp(const char *message, uint8_t *buffer, size_t capacity) {
+
+    morse::run *out = (morse::run *)buffer;
+    size_t count = 0;
+
+    for (morse::run r : morse::runs(morse::text(message))) {
+        if (count == capacity / sizeof(morse::run)) {
+            break;
+        }
+        out[count++] = r;
+    }
+    return (uint32_t)count + out[count - 1].units;
+}
+
+static uint32_t runs_c(const char *message, uint8_t *buffer, size_t capacity) {
+
+    size_t count = c_encode(message, (morse::run *)buffer, capacity / sizeof(morse::run));
+
+    return (uint32_t)count + ((morse::run *)buffer)[count - 1].units;
+}
+
+static uint32_t timeline_cpp(const char *message, uint8_t *buffer, size_t capacity) {
+
+    morse::result result = morse::encode_timeline(morse::text(message), morse::span<uint8_t>(buffer, capacity), 1000);
+
+    return (uint32_t)result.written + buffer[result.written - 1];
+}
+
+static uint32_t timeline_c(const char *message, uint8_t *buffer, size_t capacity) {
+
+    size_t length = c_timeline(message, buffer, capacity, 0);
+
+    return (uint32_t)length + buffer[length - 1];
+}
+
+static const bench_encoder encoders[][2] = {
+    {{"runs", runs_cpp}, {"runs", runs_c}},
+    {{"range", range_cpp}, {"range", runs_c}},
+    {{"timeline", timeline_cpp}, {"timeline", timeline_c}},
+};
+#define NUM_ENCODERS (sizeof(encoders) / sizeof(encoders[0]))
+
+/* @return -> the fastest pass over the corpus, in nanoseconds */
+static uint64_t best_pass(const bench_encoder *encoder, char *const *messages, uint8_t *buffer, size_t capacity) {
+
+    uint64_t best = UINT64_MAX, start, elapsed;
+    uint32_t total;
+    unsigned long r, m;
+
+    for (r = 0; r < repeats; ++r) {
+        total = 0;
+        start = now_ns();
+        for (m = 0; m < num_messages; ++m) {
+            total += encoder->encode(messages[m], buffer, capacity);
+        }
+        elapsed = now_ns() - start;
+        sink = total;
+        if (elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    return best;
+}
+
+int main(int argc, char **argv) {
+
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz      eetaoin?";
+    char **messages;
+    char *text;
+    uint8_t *image, *expected;
+    morse::run *runs;
+    size_t capacity;
+    unsigned long m, i, e, bad;
+    uint64_t cpp_ns, c_ns;
+    double characters;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:r:s:")) != -1) {
+        switch (opt) {
+            case 'n':
+                num_messages = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                message_len = strtoul(optarg, NULL, 0);
+                break;
+            case 'r':
+                repeats = strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: codec_bench [-n MESSAGES] [-l LENGTH] [-r REPEATS] [-s SEED]\n");
+                return 2;
+        }
+    }
+    if (num_messages == 0 || message_len == 0 || repeats == 0) {
+        fprintf(stderr, "codec_bench: MESSAGES, LENGTH and REPEATS must be at least 1\n");
+        return 2;
+    }
+
+    /* room for the longest image, and for two sets of runs to compare */
+    capacity = message_len * BYTES_PER_CHARACTER + TIMELINE_HEADER_LEN;
+    messages = (char **)malloc(num_messages * sizeof(*messages));
+    image = (uint8_t *)malloc(capacity * sizeof(morse::run));
+    expected = (uint8_t *)malloc(capacity);
+    runs = (morse::run *)malloc(2 * capacity * sizeof(*runs));
+    text = (char *)malloc(message_len + 1);
+    if (messages == NULL || image == NULL || expected == NULL || runs == NULL || text == NULL) {
+        fprintf(stderr, "codec_bench: out of memory\n");
+        return 2;
+    }
+
+    srand((unsigned int)seed);
+    for (m = 0; m < num_messages; ++m) {
+        messages[m] = (char *)malloc(message_len + 1);
+        if (messages[m] == NULL) {
+            fprintf(stderr, "codec_bench: out of memory\n");
+            return 2;
+        }
+        for (i = 0; i < message_len; ++i) {
+            messages[m][i] = alphabet[(unsigned int)rand() % (sizeof(alphabet) - 1)];
+        }
+        messages[m][message_len] = '\0';
+    }
+
+    bad = check(messages, image, expected, runs, text);
+    printf("%lu messages of %lu characters, %lu mismatches against morse.c and timeline.c\n",
+           num_messages, message_len, bad);
+
+    characters = (double)num_messages * message_len;
+    printf("%-10s %10s %10s %8s\n", "ns/char", "morse.hpp", "C", "ratio");
+    for (e = 0; e < NUM_ENCODERS; ++e) {
+        /* a pass of each first, to warm the caches */
+        best_pass(&encoders[e][0], messages, image, capacity * sizeof(morse::run));
+        best_pass(&encoders[e][1], messages, image, capacity * sizeof(morse::run));
+        cpp_ns = best_pass(&encoders[e][0], messages, image, capacity * sizeof(morse::run));
+        c_ns = best_pass(&encoders[e][1], messages, image, capacity * sizeof(morse::run));
+        printf("%-10s %10.2f %10.2f %8.2f\n", encoders[e][0].name, cpp_ns / characters, c_ns / characters,
+               (double)cpp_ns / (double)c_ns);
+    }
+
+    for (m = 0; m < num_messages; ++m) {
+        free(messages[m]);
+    }
+    free(messages);
+    free(image);
+    free(expected);
+    free(runs);
+    free(text);
+
+    return bad != 0;
+}
+
+#endif /* MORSE_HOST */
@@ -0,0 +1,323 @@
+/*
+ *  ======== command_bench.c ========
+ *  THROUGHPUT TEST FOR THE COMMAND CONSOLE (command.c). THE FIRMWARE RUNS
+ *  ITS NORTOS MAIN LOOP AGAINST THE DRIVER STUBS, KEYING ALL THE WHILE, WITH
+ *  A THREAD FIRING THE TICK TIMER IN REAL TIME AND THE CONSOLE ON A PTY; A
+ *  SECOND THREAD WRITES COMMANDS INTO THE PTY AS FAST AS IT WILL TAKE THEM
+ *  AND A THIRD COUNTS THE REPLIES. REPORTS COMMANDS PER SECOND, THE
+ *  SEQUENCER'S COST PER TICK AND THE TICKS MISSED, WITH AND WITHOUT THE
+ *  CONSOLE TRAFFIC, TO SHOW THAT THE TRAFFIC DOES NOT HOLD UP THE KEYING.
+ *
+ *    command_bench [-n COMMANDS] [-t TICK_US]
+ *
+ *  The tick defaults to 1000 us, far shorter than the firmware's fastest
+ *  (20000 us at 60 wpm), so the console gets less time per tick than it
+ *  would on the board. The commands cycle through wpm, mode, press and
+ *  queue; a queue command is only sent once the last one has been answered
+ *  and the queue has room, and wpm 20 goes in its place otherwise, so that
+ *  the queue is kept full without overflowing and the keying never stops.
+ *  No command should fail: every reply is counted, and the bench exits
+ *  with 1 if any is an error. wpm only changes the stub timer's period,
+ *  which the timer thread ignores. A missed tick is the host's scheduler as often as
+ *  the firmware, so compare the two runs, on a machine with cores to spare.
+ *
+ *  First, numbers at and past the ends of their ranges, and past what an
+ *  unsigned int holds, and a queued text that only looks like it has a
+ *  priority, are each sent alone and the reply checked; the bench exits
+ *  with 1 if any is wrong.
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -Ihost -I. -pthread -o command_bench host/command_bench.c \
+ *        host/stubs.c alphabet.c alphabet_tables.c boot.c command.c console.c \
+ *        dsp.c energy.c gpiointerrupt.c ingest.c jitter.c link.c lpds.c \
+ *        morse.c msgqueue.c msgstore.c profile.c replay.c rope.c slab.c \
+ *        speed.c timeline.c timeline_image.c utf8.c
+ */
+
+#if defined(MORSE_HOST)
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "ti_drivers_config.h"
+#include "console.h"
+#include "host.h"
+#include "msgqueue.h"
+#include "profile.h"
+
+/* firmware entry points, see mainThread() */
+extern void start_leds(void);
+extern void start_peripherals(void);
+extern void initTimer(void);
+extern void sequencer_tick(void);
+extern void update_message(void);
+extern void wait_for_tick(void);
+extern void service_console(void);
+extern volatile unsigned char TimerFlag;
+
+static const char *const commands[] = {
+    "wpm 20\n", "mode beacon\n", "queue 0:eee\n", "wpm 30\n",
+    "press 0\n", "mode quiet\n", "queue 1:t\n", "queue 2:sos\n",
+};
+#define NUM_COMMANDS (sizeof(commands) / sizeof(commands[0]))
+
+/* commands at the edges of their ranges, and the replies they must get */
+static const char *const bounds[][2] = {
+    {"unit 2000000\n", "ok\r\n"},
+    {"unit 2000001\n", "error: unit is 20 to 2000000 us\r\n"},
+    {"unit 20\n", "ok\r\n"},
+    {"unit 19\n", "error: unit is 20 to 2000000 us\r\n"},
+    {"unit 4294967295\n", "error: unit is 20 to 2000000 us\r\n"},
+    {"unit 4294967296\n", "error: unit is 20 to 2000000 us\r\n"},
+    {"wpm 60000\n", "ok\r\n"},
+    {"wpm 60001\n", "error: wpm is 1 to 60000\r\n"},
+    {"wpm 20\n", "ok\r\n"},
+    {"queue 3:x\n", "error: bad priority\r\n"},
+    {"queue a:b\n", "ok\r\n"},
+};
+#define NUM_BOUNDS (sizeof(bounds) / sizeof(bounds[0]))
+
+static unsigned long num_commands = 100000;
+static volatile unsigned long replies = 0;
+static volatile unsigned long errors = 0;
+static unsigned long queued = 0;
+static int slave = -1;
+
+static long tick_us = 1000;
+static volatile int stopping = 0;
+static volatile unsigned long missed = 0;
+
+static uint64_t now_ns(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* fire the tick timer every tick_us, noting each tick the loop had not
+ * yet taken when the next one came */
+static void *ticker(void *arg) {
+
+    struct timespec next;
+
+    (void)arg;
+    clock_gettime(CLOCK_MONOTONIC, &next);
+    while (!stopping) {
+        next.tv_nsec += tick_us * 1000;
+        while (next.tv_nsec >= 1000000000L) {
+            next.tv_nsec -= 1000000000L;
+            ++next.tv_sec;
+        }
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+        if (TimerFlag) {
+            ++missed;
+        }
+        host_fire_timer(CONFIG_TIMER_0);
+    }
+    return NULL;
+}
+
+static void *writer(void *arg) {
+
+    unsigned long i, last_queued = 0;
+    const char *command;
+
+    (void)arg;
+    for (i = 0; i < num_commands; ++i) {
+        command = commands[i % NUM_COMMANDS];
+        if (strncmp(command, "queue", 5) == 0) {
+            /* replies come back in order, so the last one has been
+             * answered once there are more replies than commands before it */
+            if ((queued == 0 || replies > last_queued) && msgqueue_count() < MSGQUEUE_LEN) {
+                last_queued = i;
+                ++queued;
+            }
+            else {
+                command = "wpm 20\n";
+            }
+        }
+        if (write(slave, command, strlen(command)) < 0) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+/* count reply lines; each one ends in a newline */
+static void *reader(void *arg) {
+
+    char buffer[4096];
+    ssize_t count, i;
+
+    (void)arg;
+    while (replies < num_commands && (count = read(slave, buffer, sizeof(buffer))) > 0) {
+        for (i = 0; i < count; ++i) {
+            if (buffer[i] == 'e' && (i == 0 || buffer[i - 1] == '\n')) {
+                ++errors;
+            }
+            if (buffer[i] == '\n') {
+                ++replies;
+            }
+        }
+    }
+    return NULL;
+}
+
+/* open a raw pty, attach its master side to the console and keep the slave */
+static int open_pty(void) {
+
+    struct termios mode;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        return -1;
+    }
+    slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+    if (slave < 0 || tcgetattr(slave, &mode) != 0) {
+        return -1;
+    }
+    cfmakeraw(&mode);
+    tcsetattr(slave, TCSANOW, &mode);
+
+    return console_attach(fd);
+}
+
+/* run the main loop for a number of ticks, or until every reply is in
+ * @return -> the ticks run */
+static unsigned long run(unsigned long ticks, int until_replies, uint64_t *tick_ns, uint64_t *max_tick_ns) {
+
+    unsigned long t;
+    uint64_t start, elapsed;
+
+    *tick_ns = 0;
+    *max_tick_ns = 0;
+    for (t = 0; until_replies ? replies < num_commands : t < ticks; ++t) {
+        start = now_ns();
+        sequencer_tick();
+        update_message();
+        elapsed = now_ns() - start;
+
+        *tick_ns += elapsed;
+        if (elapsed > *max_tick_ns) {
+            *max_tick_ns = elapsed;
+        }
+
+        service_console();
+        wait_for_tick();
+    }
+    return t;
+}
+
+/* send each of bounds[] alone, running the main loop until its reply is in
+ * @return -> the number answered wrongly */
+static unsigned long check_bounds(void) {
+
+    char reply[80];
+    size_t length;
+    struct pollfd ready;
+    unsigned long i, wrong = 0;
+
+    ready.fd = slave;
+    ready.events = POLLIN;
+    for (i = 0; i < NUM_BOUNDS; ++i) {
+        if (write(slave, bounds[i][0], strlen(bounds[i][0])) < 0) {
+            return NUM_BOUNDS;
+        }
+        length = 0;
+        while (length == 0 || reply[length - 1] != '\n') {
+            sequencer_tick();
+            update_message();
+            service_console();
+            wait_for_tick();
+            while (length < sizeof(reply) - 1 && poll(&ready, 1, 0) > 0 &&
+                   read(slave, &reply[length], 1) == 1 && reply[length++] != '\n') {
+            }
+        }
+        reply[length] = '\0';
+        if (strcmp(reply, bounds[i][1]) != 0) {
+            printf("bounds: \"%.*s\" got \"%.*s\"\n", (int)strlen(bounds[i][0]) - 1, bounds[i][0],
+                   (int)length - 2, reply);
+            ++wrong;
+        }
+    }
+    return wrong;
+}
+
+int main(int argc, char **argv) {
+
+    pthread_t tick_thread, write_thread, read_thread;
+    uint64_t start, elapsed, tick_ns, max_tick_ns;
+    unsigned long ticks, wrong;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:t:")) != -1) {
+        switch (opt) {
+            case 'n':
+                num_commands = strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                tick_us = strtol(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: command_bench [-n COMMANDS] [-t TICK_US]\n");
+                return 2;
+        }
+    }
+
+    /* same start-up as mainThread() */
+    start_leds();
+    start_peripherals();
+    initTimer();
+    if (open_pty() != 0) {
+        perror("command_bench: pty");
+        return 2;
+    }
+
+    pthread_create(&tick_thread, NULL, ticker, NULL);
+
+    wrong = check_bounds();
+    printf("bounds: %lu commands at the ends of their ranges, %lu answered wrongly\n",
+           (unsigned long)NUM_BOUNDS, wrong);
+
+    /* a quiet second first, for the sequencer's cost without the console */
+    ticks = run(1000000 / tick_us, 0, &tick_ns, &max_tick_ns);
+    printf("no console traffic: %lu ticks, %lu missed, sequencer %.0f ns/tick mean, %llu ns max\n",
+           ticks, missed, (double)tick_ns / ticks, (unsigned long long)max_tick_ns);
+    missed = 0;
+
+    start = now_ns();
+    pthread_create(&read_thread, NULL, reader, NULL);
+    pthread_create(&write_thread, NULL, writer, NULL);
+    ticks = run(0, 1, &tick_ns, &max_tick_ns);
+    elapsed = now_ns() - start;
+    stopping = 1;
+    pthread_join(tick_thread, NULL);
+    pthread_join(write_thread, NULL);
+    pthread_join(read_thread, NULL);
+
+    printf("console traffic:    %lu ticks, %lu missed, sequencer %.0f ns/tick mean, %llu ns max\n",
+           ticks, missed, (double)tick_ns / ticks, (unsigned long long)max_tick_ns);
+    printf("%lu commands (%lu errors) in %.3f s: %.0f commands/s, %.2f per tick\n",
+           replies, errors, elapsed / 1e9, replies * 1e9 / elapsed, (double)replies / ticks);
+    printf("queue: %lu queued, %u keyed, %u dropped\n", queued,
+           msgqueue_stats[0].started + msgqueue_stats[1].started + msgqueue_stats[2].started,
+           msgqueue_stats[0].dropped + msgqueue_stats[1].dropped + msgqueue_stats[2].dropped);
+
+    return wrong != 0 || errors != 0;
+}
+
+#endif /* MORSE_HOST */
@@ -0,0 +1,188 @@
+/*
+ *  ======== dsp_bench.c ========
+ *  HOST CHECK OF THE SIGNAL PROCESSING KERNELS (dsp.c). RUNS EACH KERNEL
+ *  OVER BLOCKS OF RANDOM SAMPLES AND COMPARES EVERY OUTPUT WITH A PLAIN
+ *  WIDE-INTEGER VERSION OF THE SAME FORMULA, THEN PRINTS WHAT THE CONSOLE'S
+ *  dsp COMMAND PRINTS ON TARGET: COST PER SAMPLE, HERE IN NANOSECONDS, AND
+ *  THE CHECKSUMS, WHICH MUST MATCH THE TARGET'S EXACTLY.
+ *
+ *    dsp_bench [-b BLOCKS]
+ *
+ *    -b  random blocks checked per kernel (default 1000)
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -Ihost -I. -O2 -o dsp_bench host/dsp_bench.c \
+ *        console.c dsp.c profile.c
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "dsp.h"
+
+#define BLOCK_LEN 257       /* odd, to take the kernels' tails too */
+
+static unsigned long num_blocks = 1000;
+static uint32_t seed = 12345;
+
+static q15 in[BLOCK_LEN];
+static q15 other[BLOCK_LEN];
+static q15 out[BLOCK_LEN];
+static q15 history[64];
+
+/* @return -> a random sample, full scale one time in four */
+static q15 random_sample(void) {
+
+    seed = seed * 1103515245u + 12345u;
+    return (q15)((seed >> 16) >> ((seed >> 8) & 3));
+}
+
+static int16_t clamp(int64_t value) {
+
+    return (int16_t)(value > 32767 ? 32767 : value < -32768 ? -32768 : value);
+}
+
+/* @return -> the number of outputs that differ from the reference */
+static unsigned long check_goertzel(int16_t coeff, unsigned char shift) {
+
+    dsp_goertzel goertzel;
+    int64_t s0, s1 = 0, s2 = 0, power;
+    size_t i;
+
+    dsp_goertzel_init(&goertzel, coeff, shift);
+    dsp_goertzel_feed(&goertzel, in, BLOCK_LEN);
+    for (i = 0; i < BLOCK_LEN; ++i) {
+        s0 = clamp(((int64_t)(in[i] >> shift) * 16384 + coeff * s1 - 16384 * s2) >> 14);
+        s2 = s1;
+        s1 = s0;
+    }
+    power = s1 * s1 + s2 * s2 - ((coeff * s1) >> 14) * s2;
+    power = power < 0 ? 0 : power > UINT32_MAX ? UINT32_MAX : power;
+
+    return dsp_goertzel_power(&goertzel) != (uint32_t)power;
+}
+
+static unsigned long check_biquad(const int16_t *c) {
+
+    dsp_biquad biquad;
+    int64_t x1 = 0, x2 = 0, y1 = 0, y2 = 0, y;
+    unsigned long bad = 0;
+    size_t i;
+
+    dsp_biquad_init(&biquad, c[0], c[1], c[2], c[3], c[4]);
+    dsp_biquad_run(&biquad, in, out, BLOCK_LEN);
+    for (i = 0; i < BLOCK_LEN; ++i) {
+        y = clamp((c[0] * in[i] + c[1] * x1 + c[2] * x2 - c[3] * y1 - c[4] * y2 + 8192) >> 14);
+        bad += out[i] != y;
+        x2 = x1;
+        x1 = in[i];
+        y2 = y1;
+        y1 = y;
+    }
+    return bad;
+}
+
+static unsigned long check_average(unsigned char shift) {
+
+    dsp_average average;
+    int64_t sum;
+    unsigned long bad = 0;
+    size_t i, j;
+
+    dsp_average_init(&average, history, shift);
+    dsp_average_run(&average, in, out, BLOCK_LEN);
+    for (i = 0; i < BLOCK_LEN; ++i) {
+        sum = 0;
+        for (j = 0; j < (1u << shift) && j <= i; ++j) {
+            sum += in[i - j];
+        }
+        bad += out[i] != (q15)(sum >> shift);
+    }
+    return bad;
+}
+
+static unsigned long check_envelope(unsigned char attack, unsigned char release) {
+
+    dsp_envelope envelope;
+    int64_t level = 0, magnitude;
+    unsigned long bad = 0;
+    size_t i;
+
+    dsp_envelope_init(&envelope, attack, release);
+    dsp_envelope_run(&envelope, in, out, BLOCK_LEN);
+    for (i = 0; i < BLOCK_LEN; ++i) {
+        magnitude = clamp(in[i] < 0 ? -(int64_t)in[i] : in[i]) * 32768;
+        level += magnitude > level ? (magnitude - level) >> attack : -((level - magnitude) >> release);
+        bad += out[i] != (q15)(level >> 15);
+    }
+    return bad;
+}
+
+static unsigned long check_dot_add(void) {
+
+    int64_t dot = 0;
+    unsigned long bad = 0;
+    size_t i;
+
+    for (i = 0; i < BLOCK_LEN; ++i) {
+        dot += (int64_t)in[i] * other[i];
+    }
+    bad += dsp_dot(in, other, BLOCK_LEN) != (int32_t)(uint32_t)dot;
+
+    dsp_add(in, other, out, BLOCK_LEN);
+    for (i = 0; i < BLOCK_LEN; ++i) {
+        bad += out[i] != clamp((int64_t)in[i] + other[i]);
+    }
+    return bad;
+}
+
+int main(int argc, char **argv) {
+
+    /* low pass, high pass and a resonator near instability */
+    static const int16_t biquads[][5] = {
+        { DSP_Q14(0.0302), DSP_Q14(0.0605), DSP_Q14(0.0302), DSP_Q14(-1.4514), DSP_Q14(0.5724) },
+        { DSP_Q14(0.8561), DSP_Q14(-1.7122), DSP_Q14(0.8561), DSP_Q14(-1.6899), DSP_Q14(0.7344) },
+        { DSP_Q14(0.0100), 0, DSP_Q14(-0.0100), DSP_Q14(-1.8400), DSP_Q14(0.9800) },
+    };
+    unsigned long block, bad[5] = { 0 };
+    size_t i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "b:")) != -1) {
+        switch (opt) {
+            case 'b':
+                num_blocks = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: dsp_bench [-b BLOCKS]\n");
+                return 2;
+        }
+    }
+
+    for (block = 0; block < num_blocks; ++block) {
+        for (i = 0; i < BLOCK_LEN; ++i) {
+            in[i] = random_sample();
+            other[i] = random_sample();
+        }
+        bad[0] += check_goertzel((int16_t)(random_sample() & 0x7fff), (unsigned char)(block % 10));
+        bad[1] += check_biquad(biquads[block % 3]);
+        bad[2] += check_average((unsigned char)(block % 7));
+        bad[3] += check_envelope((unsigned char)(block % 4), (unsigned char)(4 + block % 8));
+        bad[4] += check_dot_add();
+    }
+    printf("%lu blocks of %d: goertzel %lu, biquad %lu, average %lu, envelope %lu, "
+           "dot/add %lu outputs off the reference\n",
+           num_blocks, BLOCK_LEN, bad[0], bad[1], bad[2], bad[3], bad[4]);
+    fflush(stdout);
+
+    dsp_benchmark();
+
+    return bad[0] + bad[1] + bad[2] + bad[3] + bad[4] != 0;
+}
+
+#endif /* MORSE_HOST */
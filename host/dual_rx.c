@@ -0,0 +1,341 @@
+/*
+ *  ======== dual_rx.c ========
+ *  HOST DECODER FOR THE TWO-LED CODE (MORSE_PARALLEL, SEE morse.h). READS
+ *  A TWO-CHANNEL EDGE TRACE, RED AND GREEN, AND PRINTS THE TEXT IT
+ *  CARRIES, ONE LINE PER MESSAGE; OR FIRST SYNTHESISES A TRACE FROM A
+ *  MESSAGE, WITH THE EDGES OFF THEIR TICKS AND THE TWO LEDS OUT OF STEP,
+ *  AND CHECKS IT DECODES BACK.
+ *
+ *    dual_rx [-u UNIT] [-g MESSAGE [-j JITTER] [-k SKEW]] [FILE]
+ *
+ *    -u  trace time units per tick (default 1, for the sim's timeline;
+ *        the tick in us for a logic analyser export in us)
+ *    -g  write FILE from MESSAGE (a-z and spaces) before decoding it, with
+ *        a unit of 1000 per tick, print how many ticks it takes in each
+ *        code, and exit 1 unless it decodes back the same
+ *    -j  move each synthesised edge up to this many percent of a tick
+ *        either way at random (default 20)
+ *    -k  make the green LED's edges this many percent of a tick later
+ *        than the red's (default 10); twice the jitter and the skew
+ *        together have to stay under 50, or dark ticks go missing
+ *
+ *  A trace is text, one "time mask" line per change of either LED, mask
+ *  as set_leds(): bit 0 red, bit 1 green; lines starting '#' are skipped.
+ *  That is what host/sim.c prints, so a sim built with -DMORSE_PARALLEL=1
+ *  can be piped straight in. Without FILE the trace is read from stdin.
+ *
+ *  The decoder needs no clock of its own. Anything lit, up to the next
+ *  dark of half a tick or more, is one symbol, whatever mixture of the
+ *  two LEDs it showed on the way, so the LEDs need not switch together.
+ *  A dark run then ends the symbol, the character or, past
+ *  parallel_character_pause_len + 1.5 ticks, the message.
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -I. -O2 -o dual_rx host/dual_rx.c alphabet.c \
+ *        alphabet_tables.c morse.c timeline.c utf8.c
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "morse.h"
+#include "timeline.h"
+
+/* synthesised traces are written with this many units per tick */
+#define SYNTH_UNIT 1000
+
+/* the most edges either LED makes in a synthesised trace */
+#define MAX_EDGES 8192
+
+static double unit = 1;
+static int jitter_percent = 20;
+static int skew_percent = 10;
+
+static uint8_t image[65536];
+
+/* --- decoder state --- */
+static unsigned char mark_mask = 0;     /* LEDs seen lit since the last dark */
+static double mark_ticks = 0;
+static char symbols[8];                 /* of the character so far */
+static size_t num_symbols = 0;
+static unsigned char overflowed = 0;
+static size_t line_len = 0;             /* characters printed on this line */
+
+static char decoded[4096];
+static size_t decoded_len = 0;
+
+static unsigned long num_characters = 0;
+static unsigned long num_messages = 0;
+
+/* print one decoded character, keeping a copy for -g */
+static void emit(char character) {
+
+    putchar(character);
+    if (decoded_len < sizeof(decoded) - 1) {
+        decoded[decoded_len++] = character;
+    }
+}
+
+/* the lit run is over: add its symbol to the character */
+static void end_mark(void) {
+
+    if (mark_mask != 0 && mark_ticks >= 0.5) {
+        if (num_symbols < sizeof(symbols) - 1) {
+            symbols[num_symbols++] = mark_mask == 0b01 ? '.' : mark_mask == 0b10 ? '-' : ' ';
+        }
+        else {
+            overflowed = 1;
+        }
+    }
+    mark_mask = 0;
+    mark_ticks = 0;
+}
+
+/* the character is over: print it, or '?' if it is no known code */
+static void end_character(void) {
+
+    char character;
+
+    end_mark();
+    if (num_symbols == 0) {
+        return;
+    }
+    symbols[num_symbols] = '\0';
+    character = overflowed ? '\0' : get_character(symbols);
+    emit(character != '\0' ? character : '?');
+    ++line_len;
+    ++num_characters;
+    num_symbols = 0;
+    overflowed = 0;
+}
+
+/* the message is over: end its line */
+static void end_message(void) {
+
+    end_character();
+    if (line_len != 0) {
+        emit('\n');
+        line_len = 0;
+        ++num_messages;
+    }
+}
+
+/* take in one steady stretch of the trace
+ * @param mask -> the LEDs lit throughout it
+ * @param ticks -> how long it lasted */
+static void feed_run(unsigned char mask, double ticks) {
+
+    if (mask != 0) {
+        mark_mask |= mask;
+        mark_ticks += ticks;
+    }
+    else if (ticks < 0.5) {
+        /* one LED went out before the other came on */
+    }
+    else if (ticks < parallel_symbol_pause_len + 0.5) {
+        end_mark();
+    }
+    else if (ticks < parallel_character_pause_len + 1.5) {
+        end_character();
+    }
+    else {
+        end_message();
+    }
+}
+
+/* decode a trace
+ * @return -> the number of ticks from its first edge to its last, or -1 */
+static double decode(FILE *in) {
+
+    char line[128];
+    double time, first = 0, previous = 0;
+    unsigned int mask, previous_mask = 0;
+    unsigned char started = 0;
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (sscanf(line, "%lf %u", &time, &mask) != 2 || mask > 0b11 || (started && time < previous)) {
+            fprintf(stderr, "dual_rx: bad trace line: %s", line);
+            return -1;
+        }
+        if (started) {
+            feed_run((unsigned char)previous_mask, (time - previous) / unit);
+        }
+        else {
+            first = time;
+            started = 1;
+        }
+        previous = time;
+        previous_mask = mask;
+    }
+    end_message();
+
+    return (previous - first) / unit;
+}
+
+/* @return -> a random offset of up to percent of a tick either way, in units */
+static double random_offset(int percent) {
+
+    return ((double)rand() / RAND_MAX * 2 - 1) * percent * SYNTH_UNIT / 100;
+}
+
+/* @return -> the number of ticks one cycle of message takes in a code */
+static long encoded_ticks(const char *message, unsigned char parallel) {
+
+    timeline_writer writer;
+    timeline_cursor cursor;
+    unsigned char level_mask;
+    uint32_t units;
+    long ticks = 0;
+
+    timeline_writer_init(&writer, image, sizeof(image), 2);
+    if ((parallel ? timeline_encode_parallel(&writer, message) : timeline_encode_message(&writer, message)) !=
+            TIMELINE_STATUS_SUCCESS || timeline_writer_finish(&writer, SYNTH_UNIT) < 0 ||
+        timeline_open(image, sizeof(image), NULL, &cursor) != TIMELINE_STATUS_SUCCESS) {
+        return -1;
+    }
+    while (timeline_next(&cursor, &level_mask, &units) == 1) {
+        ticks += units;
+    }
+    return ticks;
+}
+
+/* write a trace of message in the two-LED code, edges moved about
+ * @return -> 0, or -1 if the message is too long */
+static int synthesise(const char *message, const char *path) {
+
+    static long edges[2][MAX_EDGES];
+    size_t num_edges[2] = { 0, 0 };
+    size_t next[2] = { 0, 0 };
+    timeline_writer writer;
+    timeline_cursor cursor;
+    unsigned char level_mask, previous_mask = 0, mask = 0;
+    uint32_t units;
+    long tick = 0;
+    int led;
+    FILE *out;
+
+    timeline_writer_init(&writer, image, sizeof(image), 2);
+    if (timeline_encode_parallel(&writer, message) != TIMELINE_STATUS_SUCCESS ||
+        timeline_writer_finish(&writer, SYNTH_UNIT) < 0 ||
+        timeline_open(image, sizeof(image), NULL, &cursor) != TIMELINE_STATUS_SUCCESS) {
+        return -1;
+    }
+
+    /* each LED's edges, each moved on its own, the green ones later */
+    while (timeline_next(&cursor, &level_mask, &units) == 1) {
+        for (led = 0; led < 2; ++led) {
+            if (((level_mask ^ previous_mask) >> led) & 1) {
+                if (num_edges[led] == MAX_EDGES) {
+                    return -1;
+                }
+                edges[led][num_edges[led]++] = SYNTH_UNIT + tick * SYNTH_UNIT + (long)random_offset(jitter_percent) +
+                                               (led ? skew_percent * SYNTH_UNIT / 100 : 0);
+            }
+        }
+        previous_mask = level_mask;
+        tick += units;
+    }
+
+    out = fopen(path, "w");
+    if (out == NULL) {
+        return -1;
+    }
+    fprintf(out, "# \"%s\" in the two-LED code, %d units per tick\n0 0\n", message, SYNTH_UNIT);
+    while (next[0] < num_edges[0] || next[1] < num_edges[1]) {
+        led = next[1] < num_edges[1] && (next[0] == num_edges[0] || edges[1][next[1]] < edges[0][next[0]]);
+        mask ^= (unsigned char)(1 << led);
+        fprintf(out, "%ld %u\n", edges[led][next[led]++], mask);
+    }
+    /* dark long enough after the last edge to end the message */
+    fprintf(out, "%ld 0\n", edges[0][num_edges[0] - 1] + (word_pause_len + 2) * SYNTH_UNIT);
+    fclose(out);
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+
+    const char *message = NULL;
+    const char *path = NULL;
+    double ticks;
+    long standard, parallel;
+    FILE *in = stdin;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "u:g:j:k:")) != -1) {
+        switch (opt) {
+            case 'u':
+                unit = strtod(optarg, NULL);
+                break;
+            case 'g':
+                message = optarg;
+                break;
+            case 'j':
+                jitter_percent = atoi(optarg);
+                break;
+            case 'k':
+                skew_percent = atoi(optarg);
+                break;
+            default:
+                optind = argc + 1;
+                break;
+        }
+    }
+    if (optind < argc) {
+        path = argv[optind++];
+    }
+    if (optind != argc || unit <= 0 || (message != NULL && path == NULL)) {
+        fprintf(stderr, "usage: dual_rx [-u UNIT] [-g MESSAGE [-j JITTER] [-k SKEW]] [FILE]\n");
+        return 2;
+    }
+
+    if (message != NULL) {
+        if (synthesise(message, path) != 0) {
+            fprintf(stderr, "dual_rx: cannot write %s\n", path);
+            return 2;
+        }
+        unit = SYNTH_UNIT;
+        standard = encoded_ticks(message, 0);
+        parallel = encoded_ticks(message, 1);
+        fprintf(stderr, "%zu characters: %ld ticks in Morse, %ld in the two-LED code, %.2f times the speed\n",
+                strlen(message), standard, parallel, (double)standard / parallel);
+    }
+
+    if (path != NULL && (in = fopen(path, "r")) == NULL) {
+        fprintf(stderr, "dual_rx: cannot open %s\n", path);
+        return 2;
+    }
+    ticks = decode(in);
+    if (in != stdin) {
+        fclose(in);
+    }
+    if (ticks < 0) {
+        return 2;
+    }
+    fprintf(stderr, "%lu characters in %lu messages over %.0f ticks", num_characters, num_messages, ticks);
+    if (num_characters != 0) {
+        fprintf(stderr, ", %.2f ticks per character", ticks / num_characters);
+    }
+    fprintf(stderr, "\n");
+
+    if (message != NULL) {
+        decoded[decoded_len] = '\0';
+        if (decoded_len == 0 || decoded[decoded_len - 1] != '\n' ||
+            strncmp(decoded, message, decoded_len - 1) != 0 || strlen(message) != decoded_len - 1) {
+            fprintf(stderr, "dual_rx: decoded text differs from the message\n");
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif /* MORSE_HOST */
@@ -0,0 +1,33 @@
+/*
+ *  ======== host.h ========
+ *  HOOKS INTO THE HOST DRIVER STUBS (host/stubs.c) FOR SIMULATORS AND
+ *  TOOLS: PIN LEVELS, FIRING THE TIMER, PRESSING BUTTONS AND WAKING FROM LPDS.
+ */
+
+#ifndef HOST_H
+#define HOST_H
+
+#include <stdint.h>
+
+#include "ti_drivers_config.h"
+
+/* time LPDS takes to get into and back out of, in simulated us, by
+ * default the Power driver's own reckoning for resuming plus a little */
+#ifndef HOST_LPDS_LATENCY_US
+#define HOST_LPDS_LATENCY_US 3000
+#endif
+
+/* last level written to each GPIO */
+extern unsigned int host_gpio_level[CONFIG_TI_DRIVERS_GPIO_COUNT];
+
+extern uint32_t host_lpds_latency_us;
+
+/* function prototypes */
+unsigned char host_led_mask(void);
+void host_fire_timer(uint_least8_t index);
+uint32_t host_timer_period(uint_least8_t index);
+uint64_t host_timer_time(uint_least8_t index);
+void host_press_button(uint_least8_t index);
+void host_set_wake_hook(uint64_t (*hook)(uint64_t from_us, uint64_t until_us));
+
+#endif /* HOST_H */
@@ -0,0 +1,174 @@
+/*
+ *  ======== ingest_bench.c ========
+ *  LOAD TEST FOR THE UDP INGEST PATH (ingest.c) OVER LOOPBACK. A SENDER
+ *  THREAD FIRES BATCHED DATAGRAMS AS FAST AS IT CAN WHILE THE MAIN THREAD
+ *  POLLS THE SOCKET AND TAKES MESSAGES OFF THE QUEUE AT A FIXED RATE, AS
+ *  THE SEQUENCER WOULD, THEN REPORTS THROUGHPUT, WHAT WAS DROPPED OR
+ *  COALESCED, AND HOW LONG EACH PRIORITY CLASS WAITED.
+ *
+ *    ingest_bench [-d DATAGRAMS] [-b BATCH] [-k KEY_RATE] [-p PORT]
+ *
+ *    -d  datagrams to send (default 100000)
+ *    -b  messages per datagram (default 4)
+ *    -k  messages keyed per second, 0 to take them as fast as they come
+ *        (default 0)
+ *    -p  UDP port (default INGEST_PORT)
+ *
+ *  One message in ten is distress and one in five priority; one in eight
+ *  repeats an earlier text so that coalescing is exercised.
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -Ihost -I. -pthread -o ingest_bench host/ingest_bench.c \
+ *        console.c ingest.c msgqueue.c profile.c rope.c slab.c
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include "ingest.h"
+#include "msgqueue.h"
+
+static unsigned long num_datagrams = 100000;
+static unsigned int batch = 4;
+static uint16_t port = INGEST_PORT;
+static volatile int sending = 1;
+
+/* @return -> microseconds on a monotonic clock */
+static uint64_t now_us(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000ULL + (uint64_t)now.tv_nsec / 1000;
+}
+
+static void *sender(void *arg) {
+
+    struct sockaddr_in address = {0};
+    char datagram[INGEST_BUFFER_LEN];
+    unsigned long i, message = 0;
+    unsigned int j;
+    int length;
+    int sd;
+
+    sd = socket(AF_INET, SOCK_DGRAM, 0);
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    for (i = 0; i < num_datagrams; ++i) {
+        length = 0;
+        for (j = 0; j < batch; ++j, ++message) {
+            length += snprintf(datagram + length, sizeof(datagram) - (size_t)length, "%c:m%lu\n",
+                               message % 10 == 0 ? '2' : message % 5 == 0 ? '1' : '0',
+                               message % 8 == 7 ? message - 7 : message);
+        }
+        sendto(sd, datagram, (size_t)length, 0, (struct sockaddr *)&address, sizeof(address));
+    }
+
+    close(sd);
+    sending = 0;
+
+    return NULL;
+}
+
+int main(int argc, char **argv) {
+
+    static const char *const class_names[MSGQUEUE_NUM_PRIORITIES] = {"routine", "priority", "distress"};
+    unsigned long key_rate = 0;
+    uint64_t start, last_key, last_datagram, now, poll_start, poll_ns = 0;
+    msgqueue_entry entry;
+    pthread_t thread;
+    unsigned long keyed = 0;
+    unsigned int i;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:b:k:p:")) != -1) {
+        switch (opt) {
+            case 'd':
+                num_datagrams = strtoul(optarg, NULL, 0);
+                break;
+            case 'b':
+                batch = (unsigned int)strtoul(optarg, NULL, 0);
+                break;
+            case 'k':
+                key_rate = strtoul(optarg, NULL, 0);
+                break;
+            case 'p':
+                port = (uint16_t)strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: ingest_bench [-d DATAGRAMS] [-b BATCH] [-k KEY_RATE] [-p PORT]\n");
+                return 2;
+        }
+    }
+    if (batch == 0 || batch * 16 > INGEST_BUFFER_LEN) {
+        fprintf(stderr, "ingest_bench: batch must be 1 to %u\n", INGEST_BUFFER_LEN / 16);
+        return 2;
+    }
+
+    msgqueue_init();
+    if (ingest_open(port) != INGEST_STATUS_SUCCESS) {
+        perror("ingest_bench: ingest");
+        return 2;
+    }
+
+    start = last_key = last_datagram = now_us();
+    pthread_create(&thread, NULL, sender, NULL);
+
+    /* run until the sender is done and the socket has been quiet a while */
+    while (sending || now_us() - last_datagram < 100000) {
+        poll_start = now_us();
+        if (ingest_poll((uint32_t)poll_start) > 0) {
+            now = now_us();
+            poll_ns += (now - poll_start) * 1000;
+            last_datagram = now;
+        }
+
+        now = now_us();
+        while (key_rate == 0 || (now - last_key) * key_rate >= 1000000) {
+            if (!msgqueue_pop(&entry, (uint32_t)now)) {
+                break;
+            }
+            msgqueue_release(&entry);
+            ++keyed;
+            last_key = key_rate == 0 ? now : last_key + 1000000 / key_rate;
+        }
+    }
+    pthread_join(thread, NULL);
+    now = last_datagram - start;
+
+    printf("sent %lu datagrams of %u messages in %.3f s\n", num_datagrams, batch, now / 1e6);
+    printf("received %u datagrams (%.0f/s, %.0f messages/s), %lu lost in the socket\n",
+           ingest_stats.datagrams, ingest_stats.datagrams * 1e6 / (double)now,
+           ingest_stats.datagrams * batch * 1e6 / (double)now,
+           num_datagrams - ingest_stats.datagrams);
+    printf("ingest_poll: %.0f ns per datagram\n",
+           ingest_stats.datagrams ? (double)poll_ns / ingest_stats.datagrams : 0.0);
+    printf("queued %u, coalesced %u, keyed %lu, dropped %u datagrams (no buffer) and %u messages (queue full)\n",
+           ingest_stats.messages, ingest_stats.coalesced, keyed,
+           ingest_stats.dropped_datagrams, ingest_stats.dropped_messages);
+    printf("queue wait (us):\n");
+    for (i = 0; i < MSGQUEUE_NUM_PRIORITIES; ++i) {
+        if (msgqueue_stats[i].started != 0) {
+            printf("  %-9s n=%-8u mean=%-8u max=%u\n", class_names[i], msgqueue_stats[i].started,
+                   msgqueue_stats[i].total_wait / msgqueue_stats[i].started, msgqueue_stats[i].max_wait);
+        }
+    }
+
+    ingest_close();
+
+    return 0;
+}
+
+#endif /* MORSE_HOST */
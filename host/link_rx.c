@@ -0,0 +1,360 @@
+/*
+ *  ======== link_rx.c ========
+ *  HOST RECEIVER FOR THE OOK DATA LINK (link.c). SLICES A RECORDING OF
+ *  PHOTODIODE SAMPLES, OR READS AN EDGE TRACE, DECODES THE FRAMES IN IT
+ *  AND REPORTS THE EFFECTIVE BIT RATE AND FRAME ERROR RATE; OR FIRST
+ *  SYNTHESISES A RECORDING OF RANDOM FRAMES, AS THE LEDS WOULD KEY THEM,
+ *  AND CHECKS THEY ALL COME BACK.
+ *
+ *    link_rx [-u UNIT] [-r RATE] [-t] [-g FRAMES [-l LENGTH] [-k SKEW] [-n NOISE]] FILE
+ *
+ *    -u  the half-bit, which is the sender's tick: in us for a recording
+ *        (default 500, 1 kbit/s), in trace time units with -t (default 1,
+ *        for the sim's timeline)
+ *    -r  samples per second in a recording (default 62500, the CC32xx ADC's)
+ *    -t  FILE is an edge trace rather than a recording
+ *    -g  write FILE as a recording of this many frames of random payload
+ *        before decoding it, and exit 1 unless every one comes back
+ *    -l  payload bytes in each synthesised frame (default 32)
+ *    -k  make the synthesised sender this many percent slower (negative
+ *        for faster) than -u, to exercise the receiver's speed tracking
+ *    -n  peak noise in ADC counts (default 40)
+ *
+ *  A recording is text, one 12-bit sample per line; a trace is one "time
+ *  mask" line per change of the LEDs, lit if the mask is not 0, as
+ *  host/sim.c prints it, so a sim built with -DMORSE_LINK_TX=1 can be
+ *  piped straight in with -t. Lines starting '#' are skipped in both.
+ *
+ *  The payload of each good frame is printed on a line of its own, except
+ *  when synthesising. Samples are first smoothed by a moving average
+ *  (dsp.h) up to a quarter of a half-bit long, then sliced against the
+ *  middle of the light's envelope, with hysteresis, and the runs between
+ *  crossings are handed to the same link_rx_run() the target's edge
+ *  interrupt uses. Without the frames it was made from, the frame error
+ *  rate is out of the frames the receiver synced on, and n/a if none.
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -Ihost -I. -O2 -o link_rx host/link_rx.c \
+ *        console.c dsp.c link.c profile.c -lm
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+
+#include "dsp.h"
+#include "link.h"
+
+/* durations are handed to the receiver in 1/16ths of a sample or trace
+ * unit, so a half-bit need not be a whole number of either */
+#define SUBDIVISIONS 16
+
+/* the slicer waits for this much swing before calling anything lit */
+#define MIN_SWING 64
+
+/* the longest moving average the slicer is given, as a power of two */
+#define MAX_AVERAGE_SHIFT 6
+
+/* dark before, between and after synthesised frames, in half-bits */
+#define LEAD_HALF_BITS 64
+
+static double unit = 0;
+static uint32_t sample_rate = 62500;
+static unsigned char trace = 0;
+static int skew_percent = 0;
+static double noise = 40;
+static size_t payload_length = 32;
+
+static unsigned char synthesising = 0;
+static uint32_t payloads_ok = 0;
+
+/* the level the scene is at and the photodiode's response to it: the LED
+ * through a photodiode settling in a tenth of a half-bit, on daylight and
+ * 100 Hz flicker */
+static int scene(uint64_t n, unsigned char lit, double *response) {
+
+    double t = (double)n / sample_rate;
+    double target = lit ? 300 : 0;
+    double value;
+    int i;
+
+    *response += (target - *response) * (1.0 - exp(-1.0 / (unit * 1e-7 * sample_rate)));
+    value = 800 + 40 * sin(2 * M_PI * 100 * t) + *response;
+    for (i = 0; i < 4; ++i) {
+        value += noise / 2 * ((double)rand() / RAND_MAX - 0.5);
+    }
+    return value < 0 ? 0 : value > 4095 ? 4095 : (int)value;
+}
+
+/* write the samples for a stretch at one level, keeping the sample count
+ * in step with the exact time so that no rounding builds up */
+static void key(FILE *out, unsigned char lit, double half_bits, double *clock, uint64_t *n, double *response) {
+
+    double samples_per_half = unit * (100 + skew_percent) / 100 * 1e-6 * sample_rate;
+
+    *clock += half_bits * samples_per_half;
+    while ((double)*n < *clock) {
+        fprintf(out, "%d\n", scene((*n)++, lit, response));
+    }
+}
+
+/* write a recording of random frames, keyed as run_link() keys them */
+static int synthesise(const char *path, uint32_t frames) {
+
+    static link_transmitter tx;
+    uint8_t payload[LINK_MAX_PAYLOAD];
+    double clock = 0, response = 0;
+    uint64_t n = 0;
+    uint32_t frame;
+    size_t i;
+    int level;
+    FILE *out;
+
+    out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return 1;
+    }
+    fprintf(out, "# %u frames of %zu bytes at %.0f us half-bits %+d%%, %u samples/s\n",
+            frames, payload_length, unit, skew_percent, sample_rate);
+
+    key(out, 0, LEAD_HALF_BITS, &clock, &n, &response);
+    for (frame = 0; frame < frames; ++frame) {
+        for (i = 0; i < payload_length; ++i) {
+            payload[i] = (uint8_t)rand();
+        }
+        link_tx_start(&tx, payload, payload_length);
+        while ((level = link_tx_next(&tx)) >= 0) {
+            key(out, (unsigned char)level, 1, &clock, &n, &response);
+        }
+        key(out, 0, LINK_GAP_TICKS, &clock, &n, &response);
+    }
+    key(out, 0, LEAD_HALF_BITS, &clock, &n, &response);
+
+    fclose(out);
+    return 0;
+}
+
+/* receiver output: counted when synthesised, otherwise printed a line a
+ * frame, anything unprintable as '.' */
+static void emit(const uint8_t *payload, size_t length) {
+
+    size_t i;
+
+    if (synthesising) {
+        if (length == payload_length) {
+            ++payloads_ok;
+        }
+        return;
+    }
+    for (i = 0; i < length; ++i) {
+        putchar(payload[i] >= ' ' && payload[i] < 0x7F ? payload[i] : '.');
+    }
+    putchar('\n');
+}
+
+/* decode a recording
+ * @return -> its length in seconds */
+static double decode_samples(FILE *in, link_receiver *rx) {
+
+    static q15 history[1 << MAX_AVERAGE_SHIFT];
+    dsp_average average;
+    char line[256];
+    uint64_t n = 0, run_start = 0;
+    double high = 0, low = 0, swing, middle;
+    double samples_per_half = unit * 1e-6 * sample_rate;
+    unsigned char level = 0;
+    unsigned char shift = 0;
+    unsigned int i;
+    q15 sample, smoothed;
+
+    /* smooth over up to a quarter of a half-bit; it delays both edges of
+     * a run alike, so leaves its length be */
+    while (shift < MAX_AVERAGE_SHIFT && (double)(2u << shift) <= samples_per_half / 4) {
+        ++shift;
+    }
+    dsp_average_init(&average, history, shift);
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        sample = (q15)strtol(line, NULL, 0);
+        /* the window starts out full of the first sample, not of dark */
+        for (i = n == 0 ? 1u << shift : 1; i != 0; --i) {
+            dsp_average_run(&average, &sample, &smoothed, 1);
+        }
+        sample = smoothed;
+
+        /* the envelope jumps out to a new extreme and relaxes back over
+         * some thousands of samples, long enough to span a frame's gap */
+        if (n == 0) {
+            high = low = sample;
+        }
+        if (sample > high) {
+            high = sample;
+        }
+        if (sample < low) {
+            low = sample;
+        }
+        swing = high - low;
+        high -= swing / 4096;
+        low += swing / 4096;
+        middle = (high + low) / 2;
+
+        if (swing >= MIN_SWING &&
+            ((level == 0 && sample > middle + swing / 8) || (level == 1 && sample < middle - swing / 8))) {
+            link_rx_run(rx, level, (uint32_t)(n - run_start) * SUBDIVISIONS);
+            level ^= 1;
+            run_start = n;
+        }
+        ++n;
+    }
+    link_rx_idle(rx, level);
+
+    return (double)n / sample_rate;
+}
+
+/* decode an edge trace
+ * @return -> its length in half-bits, or a negative number if it is empty */
+static double decode_trace(FILE *in, link_receiver *rx) {
+
+    char line[256];
+    double time, last_time = 0;
+    unsigned int mask;
+    unsigned char level = 0;
+    unsigned char started = 0;
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (line[0] == '#' || sscanf(line, "%lf %u", &time, &mask) != 2) {
+            continue;
+        }
+        if (started) {
+            link_rx_run(rx, level, (uint32_t)((time - last_time) * SUBDIVISIONS));
+        }
+        started = 1;
+        level = mask != 0;
+        last_time = time;
+    }
+    if (!started) {
+        return -1;
+    }
+    link_rx_idle(rx, level);
+
+    return last_time / unit;
+}
+
+int main(int argc, char **argv) {
+
+    static link_receiver receiver;
+    uint32_t frames = 0, lost;
+    double duration, seconds, line_bps, hundredths = -1;
+    FILE *in;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "u:r:tg:l:k:n:")) != -1) {
+        switch (opt) {
+            case 'u':
+                unit = strtod(optarg, NULL);
+                break;
+            case 'r':
+                sample_rate = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 't':
+                trace = 1;
+                break;
+            case 'g':
+                frames = (uint32_t)strtoul(optarg, NULL, 0);
+                synthesising = 1;
+                break;
+            case 'l':
+                payload_length = (size_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'k':
+                skew_percent = atoi(optarg);
+                break;
+            case 'n':
+                noise = strtod(optarg, NULL);
+                break;
+            default:
+                optind = argc;
+                break;
+        }
+    }
+    if (unit == 0) {
+        unit = trace ? 1 : 500;
+    }
+    if (optind != argc - 1 || unit <= 0 || sample_rate == 0 || payload_length > LINK_MAX_PAYLOAD ||
+        (trace && synthesising)) {
+        fprintf(stderr, "usage: link_rx [-u UNIT] [-r RATE] [-t] "
+                        "[-g FRAMES [-l LENGTH] [-k SKEW] [-n NOISE]] FILE\n");
+        return 2;
+    }
+
+    if (synthesising && synthesise(argv[optind], frames) != 0) {
+        return 2;
+    }
+    in = fopen(argv[optind], "r");
+    if (in == NULL) {
+        perror(argv[optind]);
+        return 2;
+    }
+
+    if (trace) {
+        link_rx_init(&receiver, (uint32_t)(unit * SUBDIVISIONS), emit);
+        duration = decode_trace(in, &receiver);
+        seconds = duration * 500e-6;
+        line_bps = 1000;
+    }
+    else {
+        link_rx_init(&receiver, (uint32_t)(unit * 1e-6 * sample_rate * SUBDIVISIONS), emit);
+        seconds = duration = decode_samples(in, &receiver);
+        line_bps = 500000 / unit;
+    }
+    fclose(in);
+    if (duration < 0) {
+        fprintf(stderr, "link_rx: nothing in %s\n", argv[optind]);
+        return 2;
+    }
+
+    /* out of the frames sent when they are known, or else out of those
+     * the receiver synced on */
+    if (synthesising) {
+        lost = frames > payloads_ok ? frames - payloads_ok : 0;
+        hundredths = frames == 0 ? 0 : 100.0 * lost / frames;
+    }
+    else {
+        lost = receiver.bad_frames;
+        if (receiver.frames + lost != 0) {
+            hundredths = 100.0 * lost / (receiver.frames + lost);
+        }
+    }
+
+    if (trace) {
+        printf("%.0f half-bits; ", duration);
+    }
+    else {
+        printf("%.3f s; ", seconds);
+    }
+    printf("%u frames good, %u bad, %u payload bytes; frame error rate ",
+           receiver.frames, receiver.bad_frames, receiver.payload_bytes);
+    if (hundredths < 0) {
+        printf("n/a, nothing synced\n");
+    }
+    else {
+        printf("%.2f%%\n", hundredths);
+    }
+    printf("%.0f bit/s on the line, %.0f bit/s effective%s\n",
+           line_bps, seconds == 0 ? 0 : receiver.payload_bytes * 8 / seconds,
+           trace ? " (at a 500 us tick)" : "");
+
+    return synthesising && lost != 0 ? 1 : 0;
+}
+
+#endif /* MORSE_HOST */
@@ -0,0 +1,256 @@
+/*
+ *  ======== optical_rx.c ========
+ *  HOST HARNESS FOR THE OPTICAL RECEIVER (optical.c). DECODES A RECORDING
+ *  OF PHOTODIODE SAMPLES AND TIMES THE RECEIVER PER SAMPLE; OR FIRST
+ *  SYNTHESISES ONE FROM A MESSAGE, AS THE LEDS WOULD KEY IT, UNDER
+ *  AMBIENT LIGHT, MAINS FLICKER AND NOISE, AND CHECKS IT DECODES BACK.
+ *
+ *    optical_rx [-u UNIT_MS] [-r RATE] [-g MESSAGE [-k SKEW] [-a AMPLITUDE] [-n NOISE]] FILE
+ *
+ *    -u  the sender's expected tick, in ms (default 50, 24 wpm)
+ *    -r  samples per second in FILE (default 62500, the CC32xx ADC's)
+ *    -g  write FILE from MESSAGE (a-z and spaces) before decoding it, and
+ *        exit 1 unless it decodes back the same
+ *    -k  make the synthesised sender this many percent slower (negative
+ *        for faster) than -u, to exercise the decoder's speed tracking
+ *    -a  rise in ADC counts when the LED is lit (default 300)
+ *    -n  peak noise in ADC counts (default 60)
+ *
+ *  A recording is text, one 12-bit sample per line; lines starting '#'
+ *  are skipped. The samples are packed into 32-bit words as the ADC's DMA
+ *  writes them, timestamp bits included, so the receiver runs exactly the
+ *  code it runs on target.
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -Ihost -I. -O2 -o optical_rx host/optical_rx.c \
+ *        alphabet.c alphabet_tables.c console.c decoder.c morse.c optical.c \
+ *        profile.c timeline.c utf8.c -lm
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "decoder.h"
+#include "optical.h"
+#include "timeline.h"
+
+/* dark after the message, long enough to end its last word */
+#define TRAILING_UNITS 24
+
+static uint32_t unit_us = 50000;
+static uint32_t sample_rate = OPTICAL_SAMPLE_RATE;
+static int skew_percent = 0;
+static double amplitude = 300;
+static double noise = 60;
+
+static char decoded[4096];
+static size_t decoded_len = 0;
+
+/* @return -> nanoseconds on a monotonic clock */
+static uint64_t now_ns(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* decoder output */
+static void emit(char character) {
+
+    putchar(character);
+    if (decoded_len + 1 < sizeof(decoded)) {
+        decoded[decoded_len++] = character;
+        decoded[decoded_len] = '\0';
+    }
+}
+
+/* one sample of the scene: the LED through a photodiode whose response
+ * settles in ~1 ms, on top of slowly drifting daylight and 100 Hz flicker */
+static int scene(uint64_t n, unsigned char lit, double *response) {
+
+    double t = (double)n / sample_rate;
+    double target = lit ? amplitude : 0;
+    double value;
+    int i;
+
+    *response += (target - *response) * (1.0 - exp(-1.0 / (0.001 * sample_rate)));
+    value = 800 + 200 * sin(2 * M_PI * t / 20.0) + 40 * sin(2 * M_PI * 100 * t) + *response;
+    for (i = 0; i < 4; ++i) {
+        value += noise / 2 * ((double)rand() / RAND_MAX - 0.5);
+    }
+    return value < 0 ? 0 : value > 4095 ? 4095 : (int)value;
+}
+
+/* write a recording of message, keyed as the sequencer keys it */
+static int synthesise(const char *path, const char *message) {
+
+    static uint8_t image[65536];
+    timeline_writer writer;
+    timeline_header header;
+    timeline_cursor cursor;
+    unsigned char mask;
+    uint32_t units;
+    uint64_t n = 0, unit_samples, i;
+    double response = 0;
+    FILE *out;
+    int length;
+
+    timeline_writer_init(&writer, image, sizeof(image), 2);
+    if (timeline_encode_message(&writer, message) != TIMELINE_STATUS_SUCCESS ||
+        (length = timeline_writer_finish(&writer, unit_us)) < 0 ||
+        timeline_open(image, (size_t)length, &header, &cursor) != TIMELINE_STATUS_SUCCESS) {
+        fprintf(stderr, "optical_rx: cannot encode '%s'\n", message);
+        return 1;
+    }
+
+    out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return 1;
+    }
+    fprintf(out, "# '%s' at %u us units %+d%%, %u samples/s\n", message, unit_us, skew_percent, sample_rate);
+
+    unit_samples = (uint64_t)unit_us * (100 + skew_percent) / 100 * sample_rate / 1000000;
+    for (i = 0; i < unit_samples * TRAILING_UNITS; ++i) {
+        fprintf(out, "%d\n", scene(n++, 0, &response));
+    }
+    while (timeline_next(&cursor, &mask, &units) == 1) {
+        for (i = 0; i < unit_samples * units; ++i) {
+            fprintf(out, "%d\n", scene(n++, mask != 0, &response));
+        }
+    }
+    for (i = 0; i < unit_samples * TRAILING_UNITS; ++i) {
+        fprintf(out, "%d\n", scene(n++, 0, &response));
+    }
+
+    fclose(out);
+    return 0;
+}
+
+/* read a recording into ADC-format words
+ * @return -> the words, malloc'd, or NULL */
+static uint32_t *load(const char *path, size_t *count) {
+
+    char line[64];
+    uint32_t *words = NULL;
+    size_t size = 0;
+    FILE *in;
+
+    in = fopen(path, "r");
+    if (in == NULL) {
+        perror(path);
+        return NULL;
+    }
+    *count = 0;
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (line[0] == '#' || line[0] == '\n') {
+            continue;
+        }
+        if (*count == size) {
+            size = size != 0 ? size * 2 : 65536;
+            words = realloc(words, size * sizeof(*words));
+            if (words == NULL) {
+                fclose(in);
+                return NULL;
+            }
+        }
+        words[*count] = ((uint32_t)*count << 14) | ((uint32_t)(strtoul(line, NULL, 0) & 0xFFF) << 2);
+        ++*count;
+    }
+    fclose(in);
+    return words;
+}
+
+int main(int argc, char **argv) {
+
+    static optical_receiver receiver;
+    const char *message = NULL;
+    uint32_t *words;
+    size_t count, i, block;
+    uint64_t start, elapsed;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "u:r:g:k:a:n:")) != -1) {
+        switch (opt) {
+            case 'u':
+                unit_us = (uint32_t)(strtod(optarg, NULL) * 1000);
+                break;
+            case 'r':
+                sample_rate = (uint32_t)strtoul(optarg, NULL, 0);
+                break;
+            case 'g':
+                message = optarg;
+                break;
+            case 'k':
+                skew_percent = atoi(optarg);
+                break;
+            case 'a':
+                amplitude = strtod(optarg, NULL);
+                break;
+            case 'n':
+                noise = strtod(optarg, NULL);
+                break;
+            default:
+                optind = argc;
+                break;
+        }
+    }
+    if (optind != argc - 1 || unit_us == 0 || sample_rate == 0) {
+        fprintf(stderr, "usage: optical_rx [-u UNIT_MS] [-r RATE] "
+                        "[-g MESSAGE [-k SKEW] [-a AMPLITUDE] [-n NOISE]] FILE\n");
+        return 2;
+    }
+
+    if (message != NULL && synthesise(argv[optind], message) != 0) {
+        return 2;
+    }
+    words = load(argv[optind], &count);
+    if (words == NULL) {
+        return 2;
+    }
+
+    /* in DMA-sized blocks, as on target */
+    optical_init(&receiver, unit_us, sample_rate, emit);
+    start = now_ns();
+    for (i = 0; i < count; i += block) {
+        block = count - i < OPTICAL_BLOCK_LEN ? count - i : OPTICAL_BLOCK_LEN;
+        optical_feed(&receiver, &words[i], block);
+    }
+    elapsed = now_ns() - start;
+
+    /* the recording may stop mid-space */
+    decoder_idle(&receiver.decoder, UINT32_MAX);
+    putchar('\n');
+
+    printf("%zu samples (%.1f s) in %.2f ms, %.2f ns per sample; %u marks, %u characters, "
+           "%u unknown; unit %u levels (%.1f ms)\n",
+           count, (double)count / sample_rate, elapsed / 1e6, (double)elapsed / count,
+           receiver.marks, receiver.decoder.characters, receiver.decoder.unknown,
+           decoder_unit(&receiver.decoder),
+           decoder_unit(&receiver.decoder) * 1000.0 * OPTICAL_DECIMATION / sample_rate);
+    free(words);
+
+    /* a synthesised recording must come back as it went in, give or take
+     * the space that ends it */
+    if (message != NULL) {
+        while (decoded_len != 0 && decoded[decoded_len - 1] == ' ') {
+            decoded[--decoded_len] = '\0';
+        }
+        if (strcmp(decoded, message) != 0) {
+            printf("mismatch: sent '%s', decoded '%s'\n", message, decoded);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+#endif /* MORSE_HOST */
@@ -0,0 +1,622 @@
+/*
+ *  ======== sim.c ========
+ *  HOST SIMULATOR FOR THE FIRMWARE IN gpiointerrupt.c. IT RUNS THE MAIN
+ *  LOOP TICK BY TICK AGAINST THE DRIVER STUBS, REPLAYS RECORDED BUTTON
+ *  EDGES AT THE TICK AND LOOP STAGE THEY WERE CAPTURED IN, AND PRINTS THE
+ *  RESULTING LED TIMELINE.
+ *
+ *    sim [-n TICKS] [-e EVENTS] [-q TICK:PRIORITY:TEXT]... [-a TICK:PRIORITY:TEXT]...
+ *        [-w TICK:UNIT]... [-f TICK:WPM]... [-l ALPHABET] [-u PORT] [-c] [-s STORE]
+ *        [-t] [-x EXPECTED] [-r RECORD]
+ *
+ *    -n  number of ticks to run (default 200)
+ *    -e  button edges to replay, one "tick stage button" per line, in the
+ *        order of replay_log[] as read from the device
+ *    -q  queue TEXT at PRIORITY (0 routine, 1 priority, 2 distress) at the
+ *        start of tick TICK; may be given more than once
+ *    -a  add TEXT to a streamed message (rope.h) at the start of tick TICK,
+ *        first opening one at PRIORITY if none is live; an empty TEXT
+ *        closes it. Likewise
+ *    -w  change the tick to UNIT us part-way through tick TICK, as the
+ *        console's unit command would; may be given more than once
+ *    -f  set the Farnsworth speed to WPM (0 for off) part-way through tick
+ *        TICK, as the console's farnsworth command would; likewise
+ *    -l  key text past ASCII in ALPHABET (see alphabet.h), as the console's
+ *        alphabet command would before the run starts
+ *    -u  also queue whatever arrives on UDP port PORT on the loopback
+ *        interface, in the format of ingest.h, checking at every tick
+ *    -c  attach the command console (command.h) to a new pty, whose name is
+ *        printed, and run in real time at the timer's period, printing each
+ *        LED change to stderr as it happens; e.g. "screen /dev/pts/N"
+ *    -s  open the message store (msgstore.h) in file STORE, creating it if
+ *        need be, for the console's store and play commands
+ *    -t  time the timeline in simulated us rather than in ticks
+ *    -x  compare the timeline with a previous run and fail on any difference
+ *    -r  write the edges the firmware recorded, in the -e format
+ *
+ *  The timeline is one "tick mask" line per LED change, mask as set_leds(),
+ *  or with -t "us mask". Simulated time runs at the timer's period, and a
+ *  period set from outside the timer callback takes effect as if half of
+ *  the tick under way had gone, as it does on the CC32xx, so a retiming
+ *  that stretches a tick shows up in the -t timeline.
+ *  Built with MORSE_SEQUENCER_IN_ISR=1 the timer interrupt does all the work
+ *  and each level goes out one tick after it is worked out, so the same run
+ *  gives the same timeline shifted one tick later. Built with MORSE_LPDS=1
+ *  as well, the long dark gaps are slept through on the stubbed Power
+ *  driver: the ticks slept through are skipped, an edge recorded on one of
+ *  them wakes the device early if it is button 0's and is lost if it is
+ *  button 1's, and messages and speeds given for them are handed over on
+ *  waking. With -t the timeline then shows where each edge after a sleep
+ *  really went out.
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -Ihost -I. -o sim host/sim.c host/stubs.c alphabet.c \
+ *        alphabet_tables.c boot.c command.c console.c dsp.c energy.c \
+ *        gpiointerrupt.c ingest.c jitter.c link.c lpds.c morse.c msgqueue.c \
+ *        msgstore.c profile.c replay.c rope.c slab.c speed.c timeline.c \
+ *        timeline_image.c utf8.c
+ */
+
+#if defined(MORSE_HOST)
+
+#define _XOPEN_SOURCE 600
+#define _DEFAULT_SOURCE
+
+#include <stdint.h>
+#include <stddef.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "ti_drivers_config.h"
+#include "alphabet.h"
+#include "console.h"
+#include "energy.h"
+#include "host.h"
+#include "ingest.h"
+#include "lpds.h"
+#include "msgqueue.h"
+#include "msgstore.h"
+#include "profile.h"
+#include "replay.h"
+#include "rope.h"
+#include "slab.h"
+
+#define MAX_EVENTS 4096
+#define MAX_QUEUED 64
+
+#ifndef MORSE_SEQUENCER_IN_ISR
+#define MORSE_SEQUENCER_IN_ISR 0
+#endif
+
+/* firmware entry points, see mainThread() */
+extern volatile uint32_t tick_count;
+extern void initTimer(void);
+extern void start_leds(void);
+extern void start_peripherals(void);
+extern void sequencer_tick(void);
+extern void update_message(void);
+extern void wait_for_tick(void);
+extern void service_console(void);
+extern int queue_message(const char *text, unsigned char priority, msgqueue_release_fxn release);
+extern int queue_rope(rope *r, unsigned char priority);
+extern int set_unit_us(uint32_t unit_us);
+extern int set_farnsworth(unsigned int wpm);
+#if MORSE_LPDS
+extern unsigned char deep_sleep(void);
+#endif
+
+/* --- a message to queue at a given tick --- */
+typedef struct {
+    uint32_t tick;
+    unsigned char priority;
+    const char *text;
+} sim_message;
+
+static sim_message queued[MAX_QUEUED];
+static size_t num_queued = 0;
+
+/* the same for -a, and the streamed message they go to */
+static sim_message streamed[MAX_QUEUED];
+static size_t num_streamed = 0;
+static rope stream;
+
+/* --- a speed to set at a given tick --- */
+typedef struct {
+    uint32_t tick;
+    unsigned char farnsworth;       /* 1 for -f, 0 for -w */
+    uint32_t value;
+} sim_retime;
+
+static sim_retime retimes[MAX_QUEUED];
+static size_t num_retimes = 0;
+
+static replay_event events[MAX_EVENTS];
+static size_t num_events = 0;
+static size_t next_event = 0;
+
+#if MORSE_LPDS
+/* presses of the button that cannot wake the device, made while it slept */
+static uint32_t lost_presses = 0;
+#endif
+
+static int load_events(const char *path) {
+
+    FILE *in = fopen(path, "r");
+    char line[128];
+    unsigned long tick;
+    unsigned int stage, button;
+
+    if (in == NULL) {
+        perror(path);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), in) != NULL) {
+        if (line[0] == '#' || sscanf(line, "%lu %u %u", &tick, &stage, &button) != 3) {
+            continue;
+        }
+        if (num_events == MAX_EVENTS) {
+            fprintf(stderr, "sim: too many events in %s\n", path);
+            fclose(in);
+            return -1;
+        }
+        events[num_events].tick = (uint32_t)tick;
+        events[num_events].stage = (unsigned char)stage;
+        events[num_events].button = (unsigned char)button;
+        ++num_events;
+    }
+    fclose(in);
+
+    return 0;
+}
+
+/* open a pty in raw mode and hand its master side to the console
+ * @return -> 0, or -1 on failure */
+static int attach_pty(void) {
+
+    struct termios mode;
+    int fd = posix_openpt(O_RDWR | O_NOCTTY);
+    int slave;
+
+    if (fd < 0 || grantpt(fd) != 0 || unlockpt(fd) != 0) {
+        return -1;
+    }
+
+    /* raw, so that replies are not echoed back in as commands */
+    slave = open(ptsname(fd), O_RDWR | O_NOCTTY);
+    if (slave < 0 || tcgetattr(slave, &mode) != 0) {
+        return -1;
+    }
+    cfmakeraw(&mode);
+    tcsetattr(slave, TCSANOW, &mode);
+    close(slave);
+
+    fprintf(stderr, "sim: console on %s\n", ptsname(fd));
+
+    return console_attach(fd);
+}
+
+/* parse a -q or -a argument, TICK:PRIORITY:TEXT */
+static int add_message(char *arg, sim_message *messages, size_t *count, char opt) {
+
+    char *priority = strchr(arg, ':');
+    char *text = priority != NULL ? strchr(priority + 1, ':') : NULL;
+
+    if (text == NULL || *count == MAX_QUEUED) {
+        fprintf(stderr, "sim: bad or too many -%c %s\n", opt, arg);
+        return -1;
+    }
+    messages[*count].tick = (uint32_t)strtoul(arg, NULL, 0);
+    messages[*count].priority = (unsigned char)strtoul(priority + 1, NULL, 0);
+    messages[*count].text = text + 1;
+    ++*count;
+
+    return 0;
+}
+
+/* parse a -w or -f argument, TICK:VALUE */
+static int add_retime(char *arg, unsigned char farnsworth) {
+
+    char *value = strchr(arg, ':');
+
+    if (value == NULL || num_retimes == MAX_QUEUED) {
+        fprintf(stderr, "sim: bad or too many -%c %s\n", farnsworth ? 'f' : 'w', arg);
+        return -1;
+    }
+    retimes[num_retimes].tick = (uint32_t)strtoul(arg, NULL, 0);
+    retimes[num_retimes].farnsworth = farnsworth;
+    retimes[num_retimes].value = (uint32_t)strtoul(value + 1, NULL, 0);
+    ++num_retimes;
+
+    return 0;
+}
+
+/* make every speed change given for this tick */
+static void retime(uint32_t tick) {
+
+    size_t i;
+    int status;
+
+    for (i = 0; i < num_retimes; ++i) {
+        if (retimes[i].tick != tick) {
+            continue;
+        }
+        status = retimes[i].farnsworth ? set_farnsworth(retimes[i].value) : set_unit_us(retimes[i].value);
+        if (status != 0) {
+            fprintf(stderr, "sim: -%c %u refused at tick %u\n", retimes[i].farnsworth ? 'f' : 'w',
+                    retimes[i].value, tick);
+        }
+    }
+}
+
+/* queue every message given for this tick, and stream every part */
+static void inject_messages(uint32_t tick) {
+
+    size_t i, length, taken;
+
+    for (i = 0; i < num_queued; ++i) {
+        if (queued[i].tick == tick && queue_message(queued[i].text, queued[i].priority, NULL) != MSGQUEUE_STATUS_SUCCESS) {
+            fprintf(stderr, "sim: queue full at tick %u, \"%s\" dropped\n", tick, queued[i].text);
+        }
+    }
+
+    for (i = 0; i < num_streamed; ++i) {
+        if (streamed[i].tick != tick) {
+            continue;
+        }
+        length = strlen(streamed[i].text);
+        if (length == 0) {
+            rope_close(&stream);
+            continue;
+        }
+        if (!stream.live) {
+            rope_open(&stream);
+            if (queue_rope(&stream, streamed[i].priority) != MSGQUEUE_STATUS_SUCCESS) {
+                rope_release(&stream);
+                fprintf(stderr, "sim: queue full at tick %u, stream dropped\n", tick);
+                continue;
+            }
+        }
+        taken = rope_append(&stream, streamed[i].text, length);
+        if (taken != length) {
+            fprintf(stderr, "sim: stream full at tick %u, %zu of %zu bytes taken\n", tick, taken, length);
+        }
+    }
+}
+
+/* press every button recorded for this tick and loop stage */
+static void inject(uint32_t tick, unsigned char stage) {
+
+    while (next_event < num_events && events[next_event].tick == tick &&
+           events[next_event].stage == stage) {
+        host_press_button(events[next_event].button ? CONFIG_GPIO_BUTTON_1 : CONFIG_GPIO_BUTTON_0);
+        ++next_event;
+    }
+}
+
+#if MORSE_LPDS
+/* LPDS's wakeup hook: an edge recorded on tick T came in half-way
+ * between T's rollover and the next, as the timer was left before the
+ * sleep; the first of button 0's wakes the device, and button 1's before
+ * it are lost */
+static uint64_t wake_at(uint64_t from_us, uint64_t until_us) {
+
+    uint64_t base = host_timer_time(CONFIG_TIMER_0);
+    uint32_t period = host_timer_period(CONFIG_TIMER_0);
+    uint64_t when;
+
+    while (next_event < num_events) {
+        when = base + (uint64_t)(events[next_event].tick - tick_count) * period + period / 2;
+        if (when > until_us) {
+            break;
+        }
+        if (events[next_event++].button == 0) {
+            return when;
+        }
+        ++lost_presses;
+    }
+    return until_us;
+}
+
+/* give the firmware what was due on the ticks from first up to the tick
+ * count it woke on, and drop any edge left over from them */
+static void after_sleep(uint32_t first, unsigned char real_time) {
+
+    uint32_t s;
+
+    for (s = first; s < tick_count; ++s) {
+        inject_messages(s);
+        retime(s);
+        if (real_time) {
+            usleep(host_timer_period(CONFIG_TIMER_0));
+        }
+    }
+    while (next_event < num_events && events[next_event].tick < tick_count) {
+        ++next_event;
+        ++lost_presses;
+    }
+}
+#endif
+
+static void print_energy(const char *name, const energy_stat *stat) {
+
+    uint64_t nanojoules = energy_nanojoules(stat);
+
+    fprintf(stderr, "  %-16s n=%-4u ticks=%-6u led0=%-8.1f led1=%-8.1f awake=%-9.3f idle=%-9.1f lpds=%-9.1f "
+                    "wakeups=%-6u %.1f uJ, %.1f uJ/msg\n", name, stat->messages, stat->ticks,
+            stat->led_on_us[0] / 1e3, stat->led_on_us[1] / 1e3, stat->active_us / 1e3, stat->idle_us / 1e3,
+            stat->lpds_us / 1e3, stat->wakeups, nanojoules / 1e3, stat->messages == 0 ? 0 : nanojoules / 1e3 / stat->messages);
+}
+
+static void print_stat(const char *name, profile_point point) {
+
+    if (profile_stats[point].count != 0) {
+        fprintf(stderr, "  %-16s n=%-8u min=%-8u mean=%-8u max=%u ns\n", name,
+                profile_stats[point].count, profile_stats[point].min,
+                profile_mean(point), profile_stats[point].max);
+    }
+}
+
+int main(int argc, char **argv) {
+
+    unsigned long ticks = 200;
+    const char *expected_path = NULL;
+    const char *record_path = NULL;
+    char *timeline;
+    size_t timeline_len = 0;
+    size_t timeline_cap = 1 << 16;
+    unsigned char mask, previous_mask = 0xff;
+    replay_event event;
+    uint32_t t;
+    uint16_t port = 0;
+    unsigned char real_time = 0;
+    unsigned char timed = 0;
+    uint64_t when;
+    unsigned int i;
+    int opt;
+    int status = 0;
+
+    while ((opt = getopt(argc, argv, "n:e:q:a:w:f:l:u:cs:tx:r:")) != -1) {
+        switch (opt) {
+            case 'n':
+                ticks = strtoul(optarg, NULL, 0);
+                break;
+            case 'e':
+                if (load_events(optarg) != 0) {
+                    return 2;
+                }
+                break;
+            case 'q':
+                if (add_message(optarg, queued, &num_queued, 'q') != 0) {
+                    return 2;
+                }
+                break;
+            case 'a':
+                if (add_message(optarg, streamed, &num_streamed, 'a') != 0) {
+                    return 2;
+                }
+                break;
+            case 'w':
+            case 'f':
+                if (add_retime(optarg, opt == 'f') != 0) {
+                    return 2;
+                }
+                break;
+            case 'l':
+                for (i = 0; i < ALPHABET_COUNT && strcmp(optarg, alphabet_tables[i].name) != 0; ++i) {
+                }
+                if (alphabet_select((alphabet_id)i) != ALPHABET_STATUS_SUCCESS) {
+                    fprintf(stderr, "sim: no alphabet %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'u':
+                port = (uint16_t)strtoul(optarg, NULL, 0);
+                if (ingest_open(port) != INGEST_STATUS_SUCCESS) {
+                    perror("sim: ingest");
+                    return 2;
+                }
+                break;
+            case 'c':
+                if (attach_pty() != 0) {
+                    perror("sim: pty");
+                    return 2;
+                }
+                real_time = 1;
+                break;
+            case 's':
+                if (msgstore_open(optarg) != MSGSTORE_STATUS_SUCCESS) {
+                    fprintf(stderr, "sim: cannot open store %s\n", optarg);
+                    return 2;
+                }
+                break;
+            case 't':
+                timed = 1;
+                break;
+            case 'x':
+                expected_path = optarg;
+                break;
+            case 'r':
+                record_path = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: sim [-n TICKS] [-e EVENTS] [-q TICK:PRIORITY:TEXT]... "
+                                "[-a TICK:PRIORITY:TEXT]... [-w TICK:UNIT]... [-f TICK:WPM]... [-l ALPHABET] [-u PORT] [-c] "
+                                "[-s STORE] [-t] [-x EXPECTED] [-r RECORD]\n");
+                return 2;
+        }
+    }
+
+    timeline = malloc(timeline_cap);
+    if (timeline == NULL) {
+        return 2;
+    }
+
+    /* same start-up as mainThread(); with MORSE_FAST_START tick 0 is
+     * keyed at the first step as usual, but without the start-up delay */
+    start_leds();
+    start_peripherals();
+    initTimer();
+#if MORSE_LPDS
+    host_set_wake_hook(wake_at);
+#endif
+
+#if MORSE_SEQUENCER_IN_ISR
+    /* tick 0 is worked out before the timer starts */
+    sequencer_tick();
+    update_message();
+#endif
+
+    for (t = 0; t < ticks; ++t) {
+        inject_messages(t);
+        while (port != 0 && ingest_poll(t) > 0) {
+        }
+        inject(t, 0);
+#if MORSE_SEQUENCER_IN_ISR
+        inject(t, 1);
+        host_fire_timer(CONFIG_TIMER_0);
+        retime(t);
+        service_console();
+#else
+        sequencer_tick();
+        update_message();
+        inject(t, 1);
+        retime(t);
+        service_console();
+#endif
+
+        /* the edges of a tick go out at its start, which in the ISR build
+         * is the rollover just fired */
+        mask = host_led_mask();
+        when = timed ? host_timer_time(CONFIG_TIMER_0) : t + MORSE_SEQUENCER_IN_ISR;
+        if (mask != previous_mask) {
+            if (timeline_len + 32 > timeline_cap) {
+                timeline_cap *= 2;
+                timeline = realloc(timeline, timeline_cap);
+                if (timeline == NULL) {
+                    return 2;
+                }
+            }
+            timeline_len += (size_t)sprintf(timeline + timeline_len, "%llu %u\n",
+                                            (unsigned long long)when, mask);
+            previous_mask = mask;
+            if (real_time) {
+                fprintf(stderr, "%llu %u\n", (unsigned long long)when, mask);
+            }
+        }
+
+        if (real_time) {
+            usleep(host_timer_period(CONFIG_TIMER_0));
+        }
+
+#if !MORSE_SEQUENCER_IN_ISR
+        host_fire_timer(CONFIG_TIMER_0);
+        wait_for_tick();
+#elif MORSE_LPDS
+        /* the main loop's idle, which may sleep on to a later tick */
+        if (deep_sleep()) {
+            after_sleep(t + 1, real_time);
+            t = tick_count - 1;
+        }
+#endif
+    }
+
+    fwrite(timeline, 1, timeline_len, stdout);
+
+    if (next_event != num_events) {
+        fprintf(stderr, "sim: %zu event(s) after the last tick were not replayed\n", num_events - next_event);
+    }
+
+    if (record_path != NULL) {
+        FILE *out = fopen(record_path, "w");
+        if (out == NULL) {
+            perror(record_path);
+            return 2;
+        }
+        while (replay_read(&event)) {
+            fprintf(out, "%u %u %u\n", event.tick, event.stage, event.button);
+        }
+        fclose(out);
+    }
+
+    if (expected_path != NULL) {
+        FILE *in = fopen(expected_path, "r");
+        char *expected = malloc(timeline_len + 1);
+        size_t expected_len;
+
+        if (in == NULL || expected == NULL) {
+            perror(expected_path);
+            return 2;
+        }
+        expected_len = fread(expected, 1, timeline_len + 1, in);
+        fclose(in);
+        if (expected_len != timeline_len || memcmp(expected, timeline, timeline_len) != 0) {
+            fprintf(stderr, "sim: timeline differs from %s\n", expected_path);
+            status = 1;
+        }
+        free(expected);
+    }
+
+    fprintf(stderr, "per-call cost on this host:\n");
+    print_stat("timerCallback", PROFILE_TIMER_CALLBACK);
+    print_stat("gpioButtonFxn0", PROFILE_BUTTON_FXN0);
+    print_stat("gpioButtonFxn1", PROFILE_BUTTON_FXN1);
+    print_stat("signal_message", PROFILE_SIGNAL_MESSAGE);
+    print_stat("set_leds", PROFILE_SET_LEDS);
+    print_stat("tick to edge", PROFILE_EDGE_LATENCY);
+
+    if (num_queued != 0 || num_streamed != 0 || port != 0) {
+        static const char *const class_names[MSGQUEUE_NUM_PRIORITIES] = {"routine", "priority", "distress"};
+
+        fprintf(stderr, "queue wait (ticks):\n");
+        for (i = 0; i < MSGQUEUE_NUM_PRIORITIES; ++i) {
+            if (msgqueue_stats[i].started != 0) {
+                fprintf(stderr, "  %-16s n=%-8u mean=%-8u max=%u preempted=%u\n", class_names[i],
+                        msgqueue_stats[i].started, msgqueue_stats[i].total_wait / msgqueue_stats[i].started,
+                        msgqueue_stats[i].max_wait, msgqueue_stats[i].preempted);
+            }
+        }
+    }
+
+    if (num_streamed != 0) {
+        fprintf(stderr, "stream: %u bytes in %u chunks, at most %u of %u held, %u short appends, %u underruns; "
+                        "text pool %u in use, high water %u\n",
+                rope_stats.bytes, rope_stats.chunks, rope_stats.max_chunks, ROPE_WINDOW,
+                rope_stats.short_appends, rope_stats.underruns, slab_text.stats.in_use,
+                slab_text.stats.high_water);
+    }
+
+    /* the message cut off by the end of the run counts too */
+    energy_flush();
+    fprintf(stderr, "energy per message at %u mV, times in ms:\n", energy_supply_mv);
+    for (i = 0; i < ENERGY_MESSAGES; ++i) {
+        if (energy_messages[i].name[0] != '\0') {
+            print_energy(energy_messages[i].name, &energy_messages[i].stat);
+        }
+    }
+    print_energy("total", &energy_total);
+
+#if MORSE_LPDS
+    fprintf(stderr, "lpds: %u sleeps, %.1f ms asleep, %u ticks skipped, %u button wakeups, %u late, "
+                    "wake %u us (max %u), %u presses lost\n",
+            lpds_stats.sleeps, lpds_stats.slept_us / 1e3, lpds_stats.ticks_skipped, lpds_stats.button_wakes,
+            lpds_stats.late, lpds_stats.wake_us, lpds_stats.max_wake_us, lost_presses);
+#endif
+
+    if (port != 0) {
+        fprintf(stderr, "ingest: %u datagrams, %u queued, %u coalesced, dropped %u datagrams %u messages\n",
+                ingest_stats.datagrams, ingest_stats.messages, ingest_stats.coalesced,
+                ingest_stats.dropped_datagrams, ingest_stats.dropped_messages);
+        ingest_close();
+    }
+    msgstore_close();
+
+    free(timeline);
+
+    return status;
+}
+
+#endif /* MORSE_HOST */
@@ -0,0 +1,309 @@
+/*
+ *  ======== slab_bench.c ========
+ *  CHURN TEST OF THE BLOCK POOLS (slab.c) AGAINST malloc(). ONE RANDOM RUN
+ *  OF ALLOCATIONS AND FREES, SHAPED LIKE THE FIRMWARE'S OWN (MESSAGE TEXTS
+ *  OF ANY LENGTH UP TO SLAB_TEXT_LEN), MIXED WITH LARGER FIXED BLOCKS AS A
+ *  SECOND POOL WOULD HAND OUT, IS PLAYED
+ *  THROUGH EACH IN TURN: ONCE FLAT OUT FOR THE MEAN COST OF A CALL, AND
+ *  ONCE TIMING EVERY CALL FOR THE SPREAD, WHICH IS WHAT AN INTERRUPT
+ *  HANDLER HAS TO ALLOW FOR.
+ *
+ *    slab_bench [-n OPERATIONS] [-l LIVE] [-c CHUNKS] [-s SEED]
+ *
+ *    -n  allocations and frees in the run (default 10000000)
+ *    -l  most blocks out at once; the number out wanders between none
+ *        and this (default 256)
+ *    -c  percentage of allocations that are CHUNK_LEN blocks, not texts
+ *        (default 30)
+ *    -s  random seed (default 1)
+ *
+ *  The last byte of each block is stamped when it is allocated and
+ *  checked when it is freed, so that two handed out at once would show.
+ *  The timed pass pays for a clock read per call, the same for both.
+ *
+ *  Build from the repository root with:
+ *    gcc -O2 -DMORSE_HOST -Ihost -I. -o slab_bench host/slab_bench.c \
+ *        console.c slab.c
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "slab.h"
+
+/* the larger blocks mixed in with the texts */
+#define CHUNK_LEN 128
+
+/* --- one step of the run: allocate into live slot, or free it --- */
+typedef struct {
+    uint32_t slot;
+    uint16_t length;                /* bytes asked for, 0 to free */
+    unsigned char chunk;
+} bench_op;
+
+/* --- a block out, in a live slot --- */
+typedef struct {
+    unsigned char *block;
+    uint16_t length;
+    unsigned char chunk;
+} bench_block;
+
+/* --- one allocator under test --- */
+typedef struct {
+    const char *name;
+    void *(*alloc)(size_t length, unsigned char chunk);
+    void (*release)(void *block, unsigned char chunk);
+} bench_allocator;
+
+static unsigned long num_ops = 10000000;
+static unsigned long max_live = 256;
+static unsigned int chunk_percent = 30;
+static unsigned long seed = 1;
+
+static slab_pool text_pool;
+static slab_pool chunk_pool;
+
+static void *slab_bench_alloc(size_t length, unsigned char chunk) {
+
+    return slab_alloc(chunk ? &chunk_pool : &text_pool);
+}
+
+static void slab_bench_release(void *block, unsigned char chunk) {
+
+    slab_free(chunk ? &chunk_pool : &text_pool, block);
+}
+
+static void *malloc_bench_alloc(size_t length, unsigned char chunk) {
+
+    return malloc(length);
+}
+
+static void malloc_bench_release(void *block, unsigned char chunk) {
+
+    free(block);
+}
+
+static const bench_allocator allocators[] = {
+    {"slab", slab_bench_alloc, slab_bench_release},
+    {"malloc", malloc_bench_alloc, malloc_bench_release},
+};
+#define NUM_ALLOCATORS (sizeof(allocators) / sizeof(allocators[0]))
+
+/* @return -> nanoseconds on a monotonic clock */
+static uint64_t now_ns(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* make the run: the number of blocks out drifts up and down across the
+ * whole range, and which one is freed is picked at random among them, so
+ * that frees come in no particular order
+ * @param ops -> num_ops steps to fill */
+static void make_run(bench_op *ops) {
+
+    uint32_t *live = malloc(max_live * sizeof(*live));
+    uint32_t *free_slots = malloc(max_live * sizeof(*free_slots));
+    unsigned long i, count = 0, num_free = max_live;
+    unsigned char growing = 1, grow;
+    uint32_t pick;
+
+    for (i = 0; i < max_live; ++i) {
+        free_slots[i] = (uint32_t)i;
+    }
+    srand((unsigned int)seed);
+
+    for (i = 0; i < num_ops; ++i) {
+        if (count == max_live) {
+            growing = 0;
+        }
+        else if (count == 0) {
+            growing = 1;
+        }
+
+        /* three steps the way it is drifting to every one back */
+        grow = (unsigned int)rand() % 4 != 0;
+        if (count != max_live && (count == 0 || grow == growing)) {
+            ops[i].slot = free_slots[--num_free];
+            ops[i].chunk = (unsigned int)rand() % 100 < chunk_percent;
+            ops[i].length = ops[i].chunk ? CHUNK_LEN : (uint16_t)(2 + (unsigned int)rand() % (SLAB_TEXT_LEN - 1));
+            live[count++] = ops[i].slot;
+        }
+        else {
+            pick = (uint32_t)((unsigned long)rand() % count);
+            ops[i].slot = live[pick];
+            ops[i].length = 0;
+            live[pick] = live[--count];
+            free_slots[num_free++] = ops[i].slot;
+        }
+    }
+
+    free(live);
+    free(free_slots);
+}
+
+/* play the run through an allocator
+ * @param blocks -> max_live slots, all empty, and left so
+ * @param spread -> NULL for the flat-out pass, or num_ops entries for the
+ *                  time of each call
+ * @return -> calls that failed or found their block's stamp overwritten */
+static unsigned long play(const bench_allocator *allocator, const bench_op *ops, bench_block *blocks,
+                          uint32_t *spread) {
+
+    unsigned long i, bad = 0;
+    uint64_t start = 0;
+    bench_block *live;
+
+    for (i = 0; i < num_ops; ++i) {
+        live = &blocks[ops[i].slot];
+
+        /* check the stamp on a block before it goes back */
+        if (ops[i].length == 0 && live->block != NULL &&
+            live->block[live->length - 1] != (unsigned char)ops[i].slot) {
+            ++bad;
+        }
+
+        if (spread != NULL) {
+            start = now_ns();
+        }
+        if (ops[i].length != 0) {
+            live->block = allocator->alloc(ops[i].length, ops[i].chunk);
+        }
+        else if (live->block != NULL) {
+            allocator->release(live->block, live->chunk);
+        }
+        if (spread != NULL) {
+            spread[i] = (uint32_t)(now_ns() - start);
+        }
+
+        /* and stamp a new one at its far end, where the pool keeps nothing */
+        if (ops[i].length == 0) {
+            live->block = NULL;
+        }
+        else if (live->block == NULL) {
+            ++bad;
+        }
+        else {
+            live->length = ops[i].length;
+            live->chunk = ops[i].chunk;
+            live->block[live->length - 1] = (unsigned char)ops[i].slot;
+        }
+    }
+
+    for (i = 0; i < max_live; ++i) {
+        if (blocks[i].block != NULL) {
+            allocator->release(blocks[i].block, blocks[i].chunk);
+            blocks[i].block = NULL;
+        }
+    }
+
+    return bad;
+}
+
+static int compare_u32(const void *a, const void *b) {
+
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return x < y ? -1 : x > y;
+}
+
+static void print_pool(const slab_pool *pool) {
+
+    printf("  %-6s %5u x %3u B, high water %5u (%u of %u B), %u allocs %u frees %u failed\n",
+           pool->name, pool->count, (uint32_t)pool->block_len, pool->stats.high_water,
+           (uint32_t)(pool->stats.high_water * pool->block_len), (uint32_t)(pool->count * pool->block_len),
+           pool->stats.allocs, pool->stats.frees, pool->stats.failures);
+}
+
+int main(int argc, char **argv) {
+
+    bench_op *ops;
+    bench_block *blocks;
+    uint32_t *spread;
+    uint64_t *text_blocks, *chunk_blocks;
+    unsigned long bad, a;
+    uint64_t start, elapsed;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:c:s:")) != -1) {
+        switch (opt) {
+            case 'n':
+                num_ops = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                max_live = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                chunk_percent = (unsigned int)strtoul(optarg, NULL, 0);
+                break;
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: slab_bench [-n OPERATIONS] [-l LIVE] [-c CHUNKS] [-s SEED]\n");
+                return 2;
+        }
+    }
+    if (num_ops == 0 || max_live == 0 || max_live > 65535 || chunk_percent > 100) {
+        fprintf(stderr, "slab_bench: LIVE is 1 to 65535 and CHUNKS 0 to 100\n");
+        return 2;
+    }
+
+    ops = malloc(num_ops * sizeof(*ops));
+    blocks = calloc(max_live, sizeof(*blocks));
+    spread = malloc(num_ops * sizeof(*spread));
+
+    /* pools the size of the run, as the firmware's are the size of its queue */
+    text_blocks = malloc(max_live * SLAB_TEXT_LEN);
+    chunk_blocks = malloc(max_live * CHUNK_LEN);
+    if (ops == NULL || blocks == NULL || spread == NULL ||
+        text_blocks == NULL || chunk_blocks == NULL) {
+        fprintf(stderr, "slab_bench: out of memory\n");
+        return 2;
+    }
+    make_run(ops);
+
+    printf("%lu operations, up to %lu blocks out, %u%% chunks\n", num_ops, max_live, chunk_percent);
+    printf("%-8s %10s %8s %8s %8s %8s %8s\n", "", "mean ns", "p50", "p99", "p99.9", "max", "bad");
+    for (a = 0; a < NUM_ALLOCATORS; ++a) {
+        slab_pool_init(&text_pool, "text", text_blocks, SLAB_TEXT_LEN, (short unsigned int)max_live);
+        slab_pool_init(&chunk_pool, "chunk", chunk_blocks, CHUNK_LEN, (short unsigned int)max_live);
+
+        /* a pass to warm up the caches and the allocator's own free lists */
+        bad = play(&allocators[a], ops, blocks, NULL);
+
+        start = now_ns();
+        bad += play(&allocators[a], ops, blocks, NULL);
+        elapsed = now_ns() - start;
+
+        bad += play(&allocators[a], ops, blocks, spread);
+        qsort(spread, num_ops, sizeof(*spread), compare_u32);
+
+        printf("%-8s %10.1f %8u %8u %8u %8u %8lu\n", allocators[a].name, (double)elapsed / num_ops,
+               spread[num_ops / 2], spread[num_ops * 99 / 100], spread[num_ops * 999 / 1000],
+               spread[num_ops - 1], bad);
+        if (a == 0) {
+            print_pool(&text_pool);
+            print_pool(&chunk_pool);
+        }
+    }
+
+    free(ops);
+    free(blocks);
+    free(spread);
+    free(text_blocks);
+    free(chunk_blocks);
+
+    return 0;
+}
+
+#endif /* MORSE_HOST */
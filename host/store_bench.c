@@ -0,0 +1,188 @@
+/*
+ *  ======== store_bench.c ========
+ *  LOAD TEST FOR THE MESSAGE STORE (msgstore.c) AGAINST A REGULAR FILE.
+ *  BUILDS A STORE OF GENERATED MESSAGES, TIMING THE APPENDS AND, AT EACH
+ *  POWER OF TEN, A RUN OF RANDOM LOOKUPS, TO SHOW THAT NEITHER SLOWS AS THE
+ *  STORE GROWS; THEN REOPENS IT AND READS EVERY ENTRY BACK TO CHECK IT.
+ *
+ *    store_bench [-n ENTRIES] [-l LOOKUPS] [-f FILE]
+ *
+ *    -n  entries to append (default 100000)
+ *    -l  random lookups timed at each power of ten (default 10000)
+ *    -f  the store's file, replaced (default msgstore.bin)
+ *
+ *  The host file system caches writes, so append times are the store's own
+ *  cost; on target each append also pays for one serial-flash block write.
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -Ihost -I. -o store_bench host/store_bench.c \
+ *        alphabet.c alphabet_tables.c console.c morse.c msgstore.c \
+ *        timeline.c utf8.c
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "msgstore.h"
+#include "timeline.h"
+
+/* the unit the firmware keys at, as in tools/mtl.c */
+#define UNIT_US 500000
+
+static const char *const words[] = {
+    "sos", "cq", "de", "qth", "qrz", "k", "ar", "sk", "73", "test",
+    "hello", "world", "beacon", "morse", "paris", "rst", "599", "qsl",
+};
+#define NUM_WORDS (sizeof(words) / sizeof(words[0]))
+
+static unsigned long num_entries = 100000;
+static unsigned long num_lookups = 10000;
+static const char *path = "msgstore.bin";
+
+/* @return -> nanoseconds on a monotonic clock */
+static uint64_t now_ns(void) {
+
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec;
+}
+
+/* message number i: a few words, the same every time for the same i */
+static void make_text(unsigned long i, char *text, size_t size) {
+
+    uint32_t seed = (uint32_t)i * 2654435761u + 1;
+    unsigned int count = 1 + (i % 7);
+    size_t length = 0;
+
+    text[0] = '\0';
+    while (count-- != 0) {
+        seed = seed * 1103515245u + 12345u;
+        length += (size_t)snprintf(&text[length], size - length, "%s%s",
+                                   length != 0 ? " " : "", words[(seed >> 16) % NUM_WORDS]);
+    }
+}
+
+/* time lookups of random entries among the first count appended
+ * @return -> mean nanoseconds per lookup, or 0 if one failed */
+static double time_lookups(const int32_t *ids, unsigned long count) {
+
+    static uint8_t buffer[MSGSTORE_SEGMENT_LEN];
+    msgstore_entry entry;
+    uint64_t start = now_ns();
+    unsigned long i;
+
+    for (i = 0; i < num_lookups; ++i) {
+        if (msgstore_get(ids[(unsigned long)rand() % count], &entry, buffer, sizeof(buffer)) != MSGSTORE_STATUS_SUCCESS) {
+            return 0;
+        }
+    }
+    return (double)(now_ns() - start) / num_lookups;
+}
+
+int main(int argc, char **argv) {
+
+    static uint8_t buffer[MSGSTORE_SEGMENT_LEN];
+    char text[MSGSTORE_TEXT_LEN + 1];
+    msgstore_entry entry;
+    timeline_header header;
+    timeline_cursor cursor;
+    struct stat info;
+    int32_t *ids;
+    uint64_t start, elapsed, slowest = 0, decade_start;
+    unsigned long i, decade_from = 0, next_decade = 1000, bad = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:f:")) != -1) {
+        switch (opt) {
+            case 'n':
+                num_entries = strtoul(optarg, NULL, 0);
+                break;
+            case 'l':
+                num_lookups = strtoul(optarg, NULL, 0);
+                break;
+            case 'f':
+                path = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: store_bench [-n ENTRIES] [-l LOOKUPS] [-f FILE]\n");
+                return 2;
+        }
+    }
+
+    ids = malloc(num_entries * sizeof(*ids));
+    unlink(path);
+    if (ids == NULL || msgstore_open(path) != MSGSTORE_STATUS_SUCCESS) {
+        fprintf(stderr, "store_bench: cannot open %s\n", path);
+        return 2;
+    }
+
+    printf("%10s %14s %14s\n", "entries", "append ns", "lookup ns");
+    decade_start = now_ns();
+    for (i = 0; i < num_entries; ++i) {
+        make_text(i, text, sizeof(text));
+
+        start = now_ns();
+        ids[i] = msgstore_append(text, UNIT_US);
+        elapsed = now_ns() - start;
+
+        if (ids[i] < 0) {
+            fprintf(stderr, "store_bench: append %lu failed (%d)\n", i, (int)ids[i]);
+            return 1;
+        }
+        if (elapsed > slowest) {
+            slowest = elapsed;
+        }
+
+        if (i + 1 == next_decade || i + 1 == num_entries) {
+            elapsed = now_ns() - decade_start;
+            printf("%10lu %14.0f %14.0f\n", i + 1, (double)elapsed / (i + 1 - decade_from),
+                   time_lookups(ids, i + 1));
+            decade_from = i + 1;
+            next_decade *= 10;
+            decade_start = now_ns();
+        }
+    }
+    printf("slowest append %llu ns\n", (unsigned long long)slowest);
+    fflush(stdout);
+    msgstore_report();
+    msgstore_close();
+
+    /* everything must come back the same after a reopen */
+    start = now_ns();
+    if (msgstore_open(path) != MSGSTORE_STATUS_SUCCESS) {
+        fprintf(stderr, "store_bench: cannot reopen %s\n", path);
+        return 1;
+    }
+    elapsed = now_ns() - start;
+
+    for (i = 0; i < num_entries; ++i) {
+        make_text(i, text, sizeof(text));
+        if (msgstore_get(ids[i], &entry, buffer, sizeof(buffer)) != MSGSTORE_STATUS_SUCCESS ||
+            strcmp(entry.text, text) != 0 ||
+            timeline_open(entry.image, entry.image_len, &header, &cursor) != TIMELINE_STATUS_SUCCESS ||
+            header.unit_us != UNIT_US) {
+            ++bad;
+        }
+    }
+    stat(path, &info);
+    printf("reopened in %llu ns; %lu of %lu entries read back wrong\n",
+           (unsigned long long)elapsed, bad, num_entries);
+    printf("file %lld bytes, %.1f per entry; %u entries, last ID %d\n",
+           (long long)info.st_size, (double)info.st_size / num_entries,
+           msgstore_stats.entries, (int)ids[num_entries - 1]);
+    msgstore_close();
+    free(ids);
+
+    return bad != 0;
+}
+
+#endif /* MORSE_HOST */
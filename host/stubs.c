@@ -0,0 +1,287 @@
+/*
+ *  ======== stubs.c ========
+ *  HOST IMPLEMENTATIONS OF THE TI-DRIVERS CALLS USED BY THE FIRMWARE.
+ *  PIN WRITES ARE REMEMBERED, AND CALLBACKS ARE INVOKED ONLY WHEN A
+ *  SIMULATOR ASKS FOR THEM THROUGH host.h.
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <ti/drivers/GPIO.h>
+#include <ti/drivers/Power.h>
+#include <ti/drivers/Timer.h>
+#include <ti/drivers/power/PowerCC32XX.h>
+#include <ti/devices/cc32xx/driverlib/prcm.h>
+
+#include "host.h"
+
+unsigned int host_gpio_level[CONFIG_TI_DRIVERS_GPIO_COUNT];
+
+static GPIO_CallbackFxn gpio_callbacks[CONFIG_TI_DRIVERS_GPIO_COUNT];
+static unsigned char gpio_int_enabled[CONFIG_TI_DRIVERS_GPIO_COUNT];
+
+/* one parameter block per timer; the handle is a pointer to it */
+static Timer_Params timers[CONFIG_TI_DRIVERS_TIMER_COUNT];
+static unsigned char timer_running[CONFIG_TI_DRIVERS_TIMER_COUNT];
+
+/* simulated time, in the units the firmware gave: of each timer's last
+ * rollover, and from there to the next; and whether its callback is running */
+static uint64_t timer_time[CONFIG_TI_DRIVERS_TIMER_COUNT];
+static uint32_t timer_due[CONFIG_TI_DRIVERS_TIMER_COUNT];
+static unsigned char timer_in_callback[CONFIG_TI_DRIVERS_TIMER_COUNT];
+
+/* simulated time now, in us: the latest rollover, or the end of a sleep */
+static uint64_t now_us = 0;
+
+/* the Power driver's constraints, LPDS wakeup and timer interval */
+static unsigned int constraints[2];
+static PowerCC32XX_Wakeup wakeup;
+static unsigned long lpds_interval = 0;
+static unsigned long lpds_sources = 0;
+static uint64_t (*wake_hook)(uint64_t from_us, uint64_t until_us) = NULL;
+
+uint32_t host_lpds_latency_us = HOST_LPDS_LATENCY_US;
+
+/* --- GPIO --- */
+void GPIO_init(void) {}
+
+int_fast16_t GPIO_setConfig(uint_least8_t index, GPIO_PinConfig pinConfig) {
+
+    if (pinConfig & GPIO_CFG_OUT_HIGH) {
+        host_gpio_level[index] = 1;
+    }
+    else if (pinConfig & GPIO_CFG_OUT_LOW) {
+        host_gpio_level[index] = 0;
+    }
+    return 0;
+}
+
+void GPIO_setCallback(uint_least8_t index, GPIO_CallbackFxn callback) {
+
+    gpio_callbacks[index] = callback;
+}
+
+void GPIO_enableInt(uint_least8_t index) {
+
+    gpio_int_enabled[index] = 1;
+}
+
+void GPIO_disableInt(uint_least8_t index) {
+
+    gpio_int_enabled[index] = 0;
+}
+
+uint_fast8_t GPIO_read(uint_least8_t index) {
+
+    return (uint_fast8_t)host_gpio_level[index];
+}
+
+void GPIO_write(uint_least8_t index, unsigned int value) {
+
+    host_gpio_level[index] = value ? 1 : 0;
+}
+
+void GPIO_toggle(uint_least8_t index) {
+
+    host_gpio_level[index] ^= 1;
+}
+
+/* --- Timer --- */
+void Timer_init(void) {}
+
+void Timer_Params_init(Timer_Params *params) {
+
+    params->timerMode = Timer_ONESHOT_BLOCKING;
+    params->periodUnits = Timer_PERIOD_COUNTS;
+    params->timerCallback = NULL;
+    params->period = (uint32_t)~0;
+}
+
+Timer_Handle Timer_open(uint_least8_t index, Timer_Params *params) {
+
+    if (index >= CONFIG_TI_DRIVERS_TIMER_COUNT) {
+        return NULL;
+    }
+    timers[index] = *params;
+    return (Timer_Handle)&timers[index];
+}
+
+int32_t Timer_start(Timer_Handle handle) {
+
+    timer_running[(Timer_Params *)handle - timers] = 1;
+    timer_time[(Timer_Params *)handle - timers] = now_us;
+    timer_due[(Timer_Params *)handle - timers] = ((Timer_Params *)handle)->period;
+    return Timer_STATUS_SUCCESS;
+}
+
+void Timer_stop(Timer_Handle handle) {
+
+    timer_running[(Timer_Params *)handle - timers] = 0;
+}
+
+void Timer_close(Timer_Handle handle) {
+
+    Timer_stop(handle);
+}
+
+/* the simulator has no time pass within a tick, so it is always at its start */
+uint32_t Timer_getCount(Timer_Handle handle) {
+
+    return 0;
+}
+
+/* as on the CC32xx, the count restarts from the new period straight
+ * away: at the rollover from the callback, or otherwise, as the simulator
+ * has it, half-way through the period under way, which then runs long */
+int32_t Timer_setPeriod(Timer_Handle handle, Timer_PeriodUnits periodUnits, uint32_t period) {
+
+    size_t index = (size_t)((Timer_Params *)handle - timers);
+
+    timer_due[index] = timer_in_callback[index] ? period : timers[index].period / 2 + period;
+    ((Timer_Params *)handle)->periodUnits = periodUnits;
+    ((Timer_Params *)handle)->period = period;
+    return Timer_STATUS_SUCCESS;
+}
+
+/* --- Power --- */
+int_fast16_t Power_setConstraint(uint_fast16_t constraintId) {
+
+    ++constraints[constraintId];
+    return Power_SOK;
+}
+
+int_fast16_t Power_releaseConstraint(uint_fast16_t constraintId) {
+
+    --constraints[constraintId];
+    return Power_SOK;
+}
+
+uint_fast32_t Power_getConstraintMask(void) {
+
+    return (constraints[PowerCC32XX_DISALLOW_LPDS] != 0 ? 1 << PowerCC32XX_DISALLOW_LPDS : 0) |
+           (constraints[PowerCC32XX_DISALLOW_SHUTDOWN] != 0 ? 1 << PowerCC32XX_DISALLOW_SHUTDOWN : 0);
+}
+
+void PowerCC32XX_getWakeup(PowerCC32XX_Wakeup *config) {
+
+    *config = wakeup;
+}
+
+void PowerCC32XX_configureWakeup(PowerCC32XX_Wakeup *config) {
+
+    wakeup = *config;
+}
+
+/* LPDS passes the simulated clock on to the end of the LPDS timer's
+ * interval and host_lpds_latency_us more, or to the press of a wakeup
+ * button that the simulator's hook says comes first, whose function the
+ * driver then calls as it resumes */
+int_fast16_t Power_sleep(uint_fast16_t sleepState) {
+
+    uint64_t until = (uint64_t)-1;
+    uint64_t pressed;
+
+    if (sleepState != PowerCC32XX_LPDS) {
+        return Power_EFAIL;
+    }
+    if (lpds_sources & PRCM_LPDS_TIMER) {
+        until = now_us + (uint64_t)lpds_interval * 1000000 / 32768 + host_lpds_latency_us;
+    }
+    pressed = wakeup.enableGPIOWakeupLPDS && wake_hook != NULL ? wake_hook(now_us, until) : until;
+    if (pressed == (uint64_t)-1) {
+        /* nothing would ever wake it */
+        return Power_EFAIL;
+    }
+
+    if (pressed < until) {
+        now_us = pressed + host_lpds_latency_us;
+        if (wakeup.wakeupGPIOFxnLPDS != NULL) {
+            wakeup.wakeupGPIOFxnLPDS(wakeup.wakeupGPIOFxnLPDSArg);
+        }
+    }
+    else {
+        now_us = until;
+    }
+    return Power_SOK;
+}
+
+/* --- driverlib PRCM --- */
+void PRCMLPDSIntervalSet(unsigned long ulTicks) {
+
+    lpds_interval = ulTicks;
+}
+
+void PRCMLPDSWakeupSourceEnable(unsigned long ulLpdsWakeupSrc) {
+
+    lpds_sources |= ulLpdsWakeupSrc;
+}
+
+void PRCMLPDSWakeupSourceDisable(unsigned long ulLpdsWakeupSrc) {
+
+    lpds_sources &= ~ulLpdsWakeupSrc;
+}
+
+/* the 32.768 kHz slow clock, on the simulated clock */
+unsigned long long PRCMSlowClkCtrGet(void) {
+
+    return now_us * 32768 / 1000000;
+}
+
+/* --- simulator hooks --- */
+
+/* @return -> the LEDs as set_leds() encodes them: bit 0 red, bit 1 green */
+unsigned char host_led_mask(void) {
+
+    return (unsigned char)((host_gpio_level[CONFIG_GPIO_LED_0] == CONFIG_GPIO_LED_ON) |
+                           ((host_gpio_level[CONFIG_GPIO_LED_1] == CONFIG_GPIO_LED_ON) << 1));
+}
+
+/* deliver one period's interrupt if the timer is running */
+void host_fire_timer(uint_least8_t index) {
+
+    if (timer_running[index] && timers[index].timerCallback != NULL) {
+        timer_time[index] += timer_due[index];
+        timer_due[index] = timers[index].period;
+        if (timer_time[index] > now_us) {
+            now_us = timer_time[index];
+        }
+        timer_in_callback[index] = 1;
+        timers[index].timerCallback((Timer_Handle)&timers[index], 0);
+        timer_in_callback[index] = 0;
+    }
+}
+
+/* @return -> the timer's current period, in the units the firmware gave */
+uint32_t host_timer_period(uint_least8_t index) {
+
+    return timers[index].period;
+}
+
+/* @return -> the simulated time of the timer's last rollover, in the
+ *            units the firmware gave, from 0 when it was started */
+uint64_t host_timer_time(uint_least8_t index) {
+
+    return timer_time[index];
+}
+
+/* have LPDS ask, on each sleep, for the first press of the wakeup button
+ * after from_us, given in simulated us; the hook returns until_us if
+ * there is none by then
+ * @param hook -> the hook, or NULL for no presses */
+void host_set_wake_hook(uint64_t (*hook)(uint64_t from_us, uint64_t until_us)) {
+
+    wake_hook = hook;
+}
+
+/* deliver a falling edge on a button if its interrupt is enabled */
+void host_press_button(uint_least8_t index) {
+
+    if (gpio_int_enabled[index] && gpio_callbacks[index] != NULL) {
+        gpio_callbacks[index](index);
+    }
+}
+
+#endif /* MORSE_HOST */
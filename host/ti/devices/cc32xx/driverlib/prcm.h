@@ -0,0 +1,34 @@
+/*
+ *  ======== prcm.h ========
+ *  HOST STAND-IN FOR THE CC32XX DRIVERLIB'S LPDS WAKEUP AND SLOW CLOCK
+ *  CALLS. IMPLEMENTED IN host/stubs.c, ON THE SIMULATED CLOCK.
+ */
+
+#ifndef HOST_PRCM_H
+#define HOST_PRCM_H
+
+/* LPDS wakeup sources */
+#define PRCM_LPDS_HOST_IRQ      0x00000080
+#define PRCM_LPDS_GPIO          0x00000010
+#define PRCM_LPDS_TIMER         0x00000001
+
+/* LPDS wakeup pins and edges */
+#define PRCM_LPDS_GPIO2         0x00000000
+#define PRCM_LPDS_GPIO4         0x00000001
+#define PRCM_LPDS_GPIO13        0x00000002
+#define PRCM_LPDS_GPIO17        0x00000003
+#define PRCM_LPDS_GPIO11        0x00000004
+#define PRCM_LPDS_GPIO24        0x00000005
+#define PRCM_LPDS_GPIO26        0x00000006
+
+#define PRCM_LPDS_LOW_LEVEL     0x00000002
+#define PRCM_LPDS_HIGH_LEVEL    0x00000000
+#define PRCM_LPDS_FALL_EDGE     0x00000001
+#define PRCM_LPDS_RISE_EDGE     0x00000003
+
+void PRCMLPDSIntervalSet(unsigned long ulTicks);
+void PRCMLPDSWakeupSourceEnable(unsigned long ulLpdsWakeupSrc);
+void PRCMLPDSWakeupSourceDisable(unsigned long ulLpdsWakeupSrc);
+unsigned long long PRCMSlowClkCtrGet(void);
+
+#endif /* HOST_PRCM_H */
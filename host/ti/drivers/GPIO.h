@@ -0,0 +1,32 @@
+/*
+ *  ======== GPIO.h ========
+ *  HOST STAND-IN FOR THE TI-DRIVERS GPIO API, COVERING ONLY WHAT THE
+ *  FIRMWARE USES. IMPLEMENTED IN host/stubs.c.
+ */
+
+#ifndef HOST_GPIO_H
+#define HOST_GPIO_H
+
+#include <stdint.h>
+
+typedef uint32_t GPIO_PinConfig;
+typedef void (*GPIO_CallbackFxn)(uint_least8_t index);
+
+#define GPIO_CFG_OUT_STD            (1u << 0)
+#define GPIO_CFG_OUT_LOW            (1u << 1)
+#define GPIO_CFG_OUT_HIGH           (1u << 2)
+#define GPIO_CFG_IN_PU              (1u << 3)
+#define GPIO_CFG_IN_NOPULL          (1u << 4)
+#define GPIO_CFG_IN_INT_FALLING     (1u << 5)
+#define GPIO_CFG_IN_INT_BOTH_EDGES  (1u << 6)
+
+void GPIO_init(void);
+int_fast16_t GPIO_setConfig(uint_least8_t index, GPIO_PinConfig pinConfig);
+void GPIO_setCallback(uint_least8_t index, GPIO_CallbackFxn callback);
+void GPIO_enableInt(uint_least8_t index);
+void GPIO_disableInt(uint_least8_t index);
+uint_fast8_t GPIO_read(uint_least8_t index);
+void GPIO_write(uint_least8_t index, unsigned int value);
+void GPIO_toggle(uint_least8_t index);
+
+#endif /* HOST_GPIO_H */
@@ -0,0 +1,20 @@
+/*
+ *  ======== Power.h ========
+ *  HOST STAND-IN FOR THE TI-DRIVERS POWER MANAGER API, COVERING ONLY WHAT
+ *  THE FIRMWARE USES. IMPLEMENTED IN host/stubs.c.
+ */
+
+#ifndef HOST_POWER_H
+#define HOST_POWER_H
+
+#include <stdint.h>
+
+#define Power_SOK       (0)
+#define Power_EFAIL     (-1)
+
+int_fast16_t Power_sleep(uint_fast16_t sleepState);
+uint_fast32_t Power_getConstraintMask(void);
+int_fast16_t Power_setConstraint(uint_fast16_t constraintId);
+int_fast16_t Power_releaseConstraint(uint_fast16_t constraintId);
+
+#endif /* HOST_POWER_H */
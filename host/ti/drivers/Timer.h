@@ -0,0 +1,47 @@
+/*
+ *  ======== Timer.h ========
+ *  HOST STAND-IN FOR THE TI-DRIVERS TIMER API, COVERING ONLY WHAT THE
+ *  FIRMWARE USES. IMPLEMENTED IN host/stubs.c.
+ */
+
+#ifndef HOST_TIMER_H
+#define HOST_TIMER_H
+
+#include <stdint.h>
+
+typedef struct Timer_Config_ *Timer_Handle;
+typedef void (*Timer_CallBackFxn)(Timer_Handle handle, int_fast16_t status);
+
+typedef enum {
+    Timer_ONESHOT_CALLBACK,
+    Timer_ONESHOT_BLOCKING,
+    Timer_CONTINUOUS_CALLBACK,
+    Timer_FREE_RUNNING
+} Timer_Mode;
+
+typedef enum {
+    Timer_PERIOD_US,
+    Timer_PERIOD_HZ,
+    Timer_PERIOD_COUNTS
+} Timer_PeriodUnits;
+
+typedef struct {
+    Timer_Mode timerMode;
+    Timer_PeriodUnits periodUnits;
+    Timer_CallBackFxn timerCallback;
+    uint32_t period;
+} Timer_Params;
+
+#define Timer_STATUS_SUCCESS    (0)
+#define Timer_STATUS_ERROR      (-1)
+
+void Timer_init(void);
+void Timer_Params_init(Timer_Params *params);
+Timer_Handle Timer_open(uint_least8_t index, Timer_Params *params);
+int32_t Timer_start(Timer_Handle handle);
+void Timer_stop(Timer_Handle handle);
+void Timer_close(Timer_Handle handle);
+int32_t Timer_setPeriod(Timer_Handle handle, Timer_PeriodUnits periodUnits, uint32_t period);
+uint32_t Timer_getCount(Timer_Handle handle);
+
+#endif /* HOST_TIMER_H */
@@ -0,0 +1,15 @@
+/*
+ *  ======== HwiP.h ========
+ *  HOST STAND-IN FOR THE TI DRIVER PORTING LAYER'S INTERRUPT CONTROL. THE
+ *  SIMULATORS ARE SINGLE-THREADED, SO A CRITICAL SECTION NEEDS NO LOCK.
+ */
+
+#ifndef HOST_HWIP_H
+#define HOST_HWIP_H
+
+#include <stdint.h>
+
+static inline uintptr_t HwiP_disable(void) { return 0; }
+static inline void HwiP_restore(uintptr_t key) { (void)key; }
+
+#endif /* HOST_HWIP_H */
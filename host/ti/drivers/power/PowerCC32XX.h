@@ -0,0 +1,35 @@
+/*
+ *  ======== PowerCC32XX.h ========
+ *  HOST STAND-IN FOR THE CC32XX POWER MANAGER'S SLEEP STATES, CONSTRAINTS
+ *  AND WAKEUP CONFIGURATION. IMPLEMENTED IN host/stubs.c.
+ */
+
+#ifndef HOST_POWERCC32XX_H
+#define HOST_POWERCC32XX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* sleep states */
+#define PowerCC32XX_LPDS                0x2
+
+/* constraints */
+#define PowerCC32XX_DISALLOW_LPDS       0
+#define PowerCC32XX_DISALLOW_SHUTDOWN   1
+
+typedef struct {
+    bool enableGPIOWakeupLPDS;
+    bool enableGPIOWakeupShutdown;
+    bool enableNetworkWakeupLPDS;
+    uint_fast32_t wakeupGPIOSourceLPDS;
+    uint_fast32_t wakeupGPIOTypeLPDS;
+    void (*wakeupGPIOFxnLPDS)(uint_least32_t arg);
+    uint_least32_t wakeupGPIOFxnLPDSArg;
+    uint_fast32_t wakeupGPIOSourceShutdown;
+    uint_fast32_t wakeupGPIOTypeShutdown;
+} PowerCC32XX_Wakeup;
+
+void PowerCC32XX_getWakeup(PowerCC32XX_Wakeup *wakeup);
+void PowerCC32XX_configureWakeup(PowerCC32XX_Wakeup *wakeup);
+
+#endif /* HOST_POWERCC32XX_H */
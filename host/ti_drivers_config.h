@@ -0,0 +1,28 @@
+/*
+ *  ======== ti_drivers_config.h ========
+ *  HOST STAND-IN FOR THE SYSCONFIG-GENERATED BOARD CONFIGURATION, WITH THE
+ *  SAME NAMES AND INDICES AS Debug/syscfg/ti_drivers_config.h.
+ */
+
+#ifndef ti_drivers_config_h
+#define ti_drivers_config_h
+
+#define CONFIG_GPIO_BUTTON_0            0
+#define CONFIG_GPIO_BUTTON_1            1
+#define CONFIG_GPIO_LED_0               2
+#define CONFIG_GPIO_LED_1               3
+/* red LED output wired back for the jitter self-test */
+#define CONFIG_GPIO_LOOPBACK            4
+#define CONFIG_TI_DRIVERS_GPIO_COUNT    5
+
+#define CONFIG_GPIO_LED_ON  (1)
+#define CONFIG_GPIO_LED_OFF (0)
+
+#define CONFIG_TIMER_0                      0
+#define CONFIG_TIMER_1                      1
+#define CONFIG_TI_DRIVERS_TIMER_COUNT       2
+
+#define CONFIG_UART_0                       0
+#define CONFIG_TI_DRIVERS_UART_COUNT        1
+
+#endif /* include guard */
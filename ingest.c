@@ -0,0 +1,316 @@
+/*
+ *  ======== ingest.c ========
+ *  UDP MESSAGE INGEST INTO THE TRANSMIT QUEUE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "console.h"
+#include "ingest.h"
+#include "msgqueue.h"
+#include "profile.h"
+
+#if MORSE_INGEST || defined(MORSE_HOST)
+
+#if defined(MORSE_HOST)
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#else
+#include <unistd.h>
+#include <ti/drivers/net/wifi/simplelink.h>
+#endif
+
+volatile ingest_stat ingest_stats;
+
+/* receive buffers, with the number of queued messages still pointing into
+ * each; a buffer is free when its count is zero */
+static char buffers[INGEST_BUFFERS][INGEST_BUFFER_LEN];
+static volatile unsigned char buffer_refs[INGEST_BUFFERS];
+
+/* where datagrams go when there is no free buffer */
+static char scratch[INGEST_BUFFER_LEN];
+
+static int sd = -1;
+
+#if !defined(MORSE_HOST)
+/* set by the SimpleLink event handlers while the station has an address */
+static volatile unsigned char ip_acquired = 0;
+#endif
+
+/* @return -> the pool index of a free buffer, claimed for the caller, or -1 */
+static int claim_buffer(void) {
+
+    short unsigned int i;
+    uintptr_t key;
+
+    for (i = 0; i < INGEST_BUFFERS; ++i) {
+        key = HwiP_disable();
+        if (buffer_refs[i] == 0) {
+            buffer_refs[i] = 1;
+            HwiP_restore(key);
+            return i;
+        }
+        HwiP_restore(key);
+    }
+    return -1;
+}
+
+/* drop one reference to a buffer */
+static void put_buffer(short unsigned int i) {
+
+    uintptr_t key = HwiP_disable();
+
+    --buffer_refs[i];
+    HwiP_restore(key);
+}
+
+/* split a received datagram into lines and queue each one in place
+ * @param text -> the datagram, with room for a terminating NUL
+ * @param length -> its length in bytes
+ * @param buffer -> its pool index, whose count is raised per queued message
+ * @param now -> the current tick, for the queue's wait statistics */
+static void queue_batch(char *text, int length, short unsigned int buffer, uint32_t now) {
+
+    char *end = text + length;
+    char *line;
+    unsigned char priority;
+    uintptr_t key;
+
+    *end = '\0';
+    while (text < end) {
+        line = text;
+        while (text < end && *text != '\n') {
+            ++text;
+        }
+        *text++ = '\0';
+
+        priority = MSGQUEUE_ROUTINE;
+        if (line[0] >= '0' && line[0] <= '9' && line[1] == ':') {
+            priority = (unsigned char)(line[0] - '0');
+            line += 2;
+        }
+        if (*line == '\0') {
+            continue;
+        }
+
+        if (priority >= MSGQUEUE_NUM_PRIORITIES) {
+            ++ingest_stats.dropped_messages;
+        }
+        else if (msgqueue_find(line, priority)) {
+            ++ingest_stats.coalesced;
+        }
+        else {
+            /* count the reference first: the message can be keyed and
+             * released the moment it is queued */
+            key = HwiP_disable();
+            ++buffer_refs[buffer];
+            HwiP_restore(key);
+
+            if (msgqueue_push(line, priority, now, ingest_release) == MSGQUEUE_STATUS_SUCCESS) {
+                ++ingest_stats.messages;
+            }
+            else {
+                put_buffer(buffer);
+                ++ingest_stats.dropped_messages;
+            }
+        }
+    }
+}
+
+#if !defined(MORSE_HOST)
+/* start the network processor, unless the message store already has,
+ * and wait until it has an address; the connection comes from a profile
+ * already stored on the device */
+static int start_network(void) {
+
+    int16_t role = sl_Start(NULL, NULL, NULL);
+
+    if (role != ROLE_STA && role != SL_RET_CODE_DEV_ALREADY_STARTED) {
+        return INGEST_STATUS_ERROR;
+    }
+    sl_WlanPolicySet(SL_WLAN_POLICY_CONNECTION, SL_WLAN_CONNECTION_POLICY(1, 0, 0, 0), NULL, 0);
+
+    while (!ip_acquired) {
+        usleep(100000);
+    }
+
+    return INGEST_STATUS_SUCCESS;
+}
+#endif
+
+/* open the socket that messages arrive on; on target this starts the
+ * network processor, so sl_Task() must already be running. The socket
+ * blocks on target, where ingest_poll() has a thread of its own, and does
+ * not on the host, where it is polled
+ * @param port -> the UDP port to listen on
+ * @return -> INGEST_STATUS_SUCCESS or INGEST_STATUS_ERROR */
+int ingest_open(uint16_t port) {
+
+    short unsigned int i;
+
+    for (i = 0; i < INGEST_BUFFERS; ++i) {
+        buffer_refs[i] = 0;
+    }
+    ingest_stats.datagrams = 0;
+    ingest_stats.bytes = 0;
+    ingest_stats.messages = 0;
+    ingest_stats.coalesced = 0;
+    ingest_stats.dropped_datagrams = 0;
+    ingest_stats.dropped_messages = 0;
+
+#if defined(MORSE_HOST)
+    struct sockaddr_in address = {0};
+
+    sd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sd < 0) {
+        return INGEST_STATUS_ERROR;
+    }
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(sd, (struct sockaddr *)&address, sizeof(address)) != 0 ||
+        fcntl(sd, F_SETFL, O_NONBLOCK) != 0) {
+        ingest_close();
+        return INGEST_STATUS_ERROR;
+    }
+#else
+    SlSockAddrIn_t address;
+
+    if (start_network() != INGEST_STATUS_SUCCESS) {
+        return INGEST_STATUS_ERROR;
+    }
+
+    sd = sl_Socket(SL_AF_INET, SL_SOCK_DGRAM, 0);
+    if (sd < 0) {
+        return INGEST_STATUS_ERROR;
+    }
+    address.sin_family = SL_AF_INET;
+    address.sin_port = sl_Htons(port);
+    address.sin_addr.s_addr = SL_INADDR_ANY;
+    if (sl_Bind(sd, (SlSockAddr_t *)&address, sizeof(address)) != 0) {
+        sl_Close(sd);
+        sd = -1;
+        return INGEST_STATUS_ERROR;
+    }
+#endif
+
+    return INGEST_STATUS_SUCCESS;
+}
+
+/* receive and queue one datagram; blocks on target until one arrives
+ * @param now -> the current tick, for the queue's wait statistics
+ * @return -> 1 if a datagram was handled, 0 if none was waiting,
+ *            or INGEST_STATUS_ERROR if the socket failed */
+int ingest_poll(uint32_t now) {
+
+    int buffer = claim_buffer();
+    char *into = buffer >= 0 ? buffers[buffer] : scratch;
+    int length;
+
+#if defined(MORSE_HOST)
+    length = (int)recv(sd, into, INGEST_BUFFER_LEN - 1, 0);
+    if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        length = 0;
+    }
+#else
+    length = sl_Recv(sd, into, INGEST_BUFFER_LEN - 1, 0);
+#endif
+
+    if (length <= 0) {
+        if (buffer >= 0) {
+            put_buffer((short unsigned int)buffer);
+        }
+        return length == 0 ? 0 : INGEST_STATUS_ERROR;
+    }
+
+    PROFILE_BEGIN(busy);
+
+    ++ingest_stats.datagrams;
+    ingest_stats.bytes += (uint32_t)length;
+
+    if (buffer < 0) {
+        ++ingest_stats.dropped_datagrams;
+    }
+    else {
+        queue_batch(into, length, (short unsigned int)buffer, now);
+        put_buffer((short unsigned int)buffer);
+    }
+
+    PROFILE_TASK_END(PROFILE_TASK_INGEST, busy);
+
+    return 1;
+}
+
+/* hand back a message's share of its buffer once it has been keyed or
+ * dropped; queued as the message's msgqueue_release_fxn
+ * @param text -> the message text as it was queued */
+void ingest_release(const char *text) {
+
+    put_buffer((short unsigned int)((text - buffers[0]) / INGEST_BUFFER_LEN));
+}
+
+/* print the totals over the console */
+void ingest_report(void) {
+
+    console_printf("ingest: %u datagrams %u bytes, %u queued %u coalesced, dropped %u datagrams %u messages\r\n",
+                   ingest_stats.datagrams, ingest_stats.bytes, ingest_stats.messages,
+                   ingest_stats.coalesced, ingest_stats.dropped_datagrams,
+                   ingest_stats.dropped_messages);
+}
+
+#if defined(MORSE_HOST)
+/* close the socket */
+void ingest_close(void) {
+
+    if (sd >= 0) {
+        close(sd);
+        sd = -1;
+    }
+}
+#else
+/* --- SimpleLink event handlers, which the host driver requires the
+ * application to provide; only the connection state is of interest --- */
+void SimpleLinkWlanEventHandler(SlWlanEvent_t *pWlanEvent) {
+
+    if (pWlanEvent->Id == SL_WLAN_EVENT_DISCONNECT) {
+        ip_acquired = 0;
+    }
+}
+
+void SimpleLinkNetAppEventHandler(SlNetAppEvent_t *pNetAppEvent) {
+
+    if (pNetAppEvent->Id == SL_NETAPP_EVENT_IPV4_ACQUIRED) {
+        ip_acquired = 1;
+    }
+}
+
+void SimpleLinkHttpServerEventHandler(SlNetAppHttpServerEvent_t *pHttpEvent,
+                                      SlNetAppHttpServerResponse_t *pHttpResponse) {
+}
+
+void SimpleLinkGeneralEventHandler(SlDeviceEvent_t *pDevEvent) {
+}
+
+void SimpleLinkSockEventHandler(SlSockEvent_t *pSock) {
+}
+
+void SimpleLinkFatalErrorEventHandler(SlDeviceFatal_t *slFatalErrorEvent) {
+
+    ip_acquired = 0;
+}
+
+void SimpleLinkNetAppRequestEventHandler(SlNetAppRequest_t *pNetAppRequest,
+                                         SlNetAppResponse_t *pNetAppResponse) {
+}
+
+void SimpleLinkNetAppRequestMemFreeEventHandler(uint8_t *buffer) {
+}
+#endif
+
+#endif /* MORSE_INGEST || MORSE_HOST */
@@ -0,0 +1,72 @@
+/*
+ *  ======== ingest.h ========
+ *  UDP MESSAGE INGEST. DATAGRAMS ARE RECEIVED STRAIGHT INTO A SMALL POOL OF
+ *  BUFFERS AND THE MESSAGES IN THEM ARE QUEUED WHERE THEY LIE, SO THE TEXT
+ *  IS NEVER COPIED AGAIN; A BUFFER IS REUSED ONCE EVERY MESSAGE IN IT HAS
+ *  BEEN KEYED. ON TARGET THE SOCKET IS THE CC3220S NETWORK PROCESSOR'S; ON
+ *  THE HOST (MORSE_HOST DEFINED) IT IS A LOOPBACK UDP SOCKET.
+ *
+ *  A datagram is a batch of messages, one per line:
+ *
+ *    [P:]text\n
+ *
+ *  where the optional digit P is the priority (0 routine, 1 priority,
+ *  2 distress; routine if left out). The last newline may be left off.
+ *
+ *  Nothing here ever waits on the sequencer. Should every buffer still be
+ *  held by waiting messages, a datagram is read into a scratch buffer and
+ *  dropped; when the queue is full, the least urgent message is dropped,
+ *  whether it is the new one or one already waiting (msgqueue_push()
+ *  releases the latter through ingest_release()); and a message
+ *  already waiting at the same or a higher priority is coalesced into that
+ *  one. All three are counted in ingest_stats.
+ */
+
+#ifndef INGEST_H
+#define INGEST_H
+
+#include <stdint.h>
+
+#include "msgqueue.h"
+
+/* set MORSE_INGEST to 1, in an RTOS build linked with the SimpleLink host
+ * driver, to take messages from the network */
+#ifndef MORSE_INGEST
+#define MORSE_INGEST 0
+#endif
+
+#define INGEST_PORT         5001
+#define INGEST_BUFFER_LEN   256
+
+/* every queued message and the one being keyed can each pin a buffer,
+ * so with one more than that a datagram always has somewhere to go */
+#define INGEST_BUFFERS      (MSGQUEUE_LEN + 2)
+
+/* --- status codes --- */
+#define INGEST_STATUS_SUCCESS   (0)
+#define INGEST_STATUS_ERROR     (-1)
+
+/* --- running totals since ingest_open() --- */
+typedef struct {
+    uint32_t datagrams;
+    uint32_t bytes;
+    uint32_t messages;              /* queued */
+    uint32_t coalesced;
+    uint32_t dropped_datagrams;     /* no free buffer */
+    uint32_t dropped_messages;      /* queue full, or bad priority */
+} ingest_stat;
+
+extern volatile ingest_stat ingest_stats;
+
+/* function prototypes */
+int ingest_open(uint16_t port);
+int ingest_poll(uint32_t now);
+void ingest_report(void);
+
+void ingest_release(const char *text);
+
+#if defined(MORSE_HOST)
+void ingest_close(void);
+#endif
+
+#endif /* INGEST_H */
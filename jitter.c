@@ -0,0 +1,191 @@
+/*
+ *  ======== jitter.c ========
+ *  EDGE-TIMING SELF-TEST AGAINST THE IDEAL TIMELINE.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Driver Header files */
+#include <ti/drivers/GPIO.h>
+
+/* Driver configuration */
+#include "ti_drivers_config.h"
+
+#include "console.h"
+#include "jitter.h"
+#include "profile.h"
+#include "timeline.h"
+
+volatile jitter_stats jitter_results;
+
+/* ideal intervals between successive red edges of the current message,
+ * in cycles, starting from its first rising edge */
+static uint32_t expected[JITTER_MAX_EDGES];
+static volatile short unsigned int num_expected = 0;
+
+/* progress through the current message, owned by the loopback ISR */
+static volatile short unsigned int edge_index = 0;
+static volatile unsigned char seen_first_edge = 0;
+static uint32_t first_edge_time;
+static uint32_t last_edge_time;
+static uint32_t expected_since_first;
+
+/* scratch space for encoding the ideal timeline */
+static uint8_t image[512];
+
+/* function prototypes */
+void gpioLoopbackFxn(uint_least8_t index);
+
+/* clear the results and start timestamping the loopback pin */
+void jitter_init(void) {
+
+    short unsigned int i;
+
+    jitter_results.messages = 0;
+    jitter_results.edges = 0;
+    jitter_results.unexpected_edges = 0;
+    jitter_results.min_jitter = INT32_MAX;
+    jitter_results.max_jitter = INT32_MIN;
+    jitter_results.min_drift = INT32_MAX;
+    jitter_results.max_drift = INT32_MIN;
+    for (i = 0; i < JITTER_BINS; ++i) {
+        jitter_results.jitter_histogram[i] = 0;
+        jitter_results.drift_histogram[i] = 0;
+    }
+
+    GPIO_setConfig(CONFIG_GPIO_LOOPBACK, GPIO_CFG_IN_NOPULL | GPIO_CFG_IN_INT_BOTH_EDGES);
+    GPIO_setCallback(CONFIG_GPIO_LOOPBACK, gpioLoopbackFxn);
+    GPIO_enableInt(CONFIG_GPIO_LOOPBACK);
+}
+
+/* work out the ideal red edge intervals of a message that is about to
+ * start; must be called before its first LED write
+ * @param message -> the message text
+ * @param unit_us -> the tick period in microseconds */
+void jitter_begin_message(const char *message, uint32_t unit_us) {
+
+    timeline_writer writer;
+    timeline_cursor cursor;
+    unsigned char level_mask;
+    unsigned char red = 0;
+    unsigned char started = 0;
+    uint32_t units;
+    uint32_t run = 0;
+    short unsigned int count = 0;
+
+    /* stop the ISR matching edges while the table is rebuilt */
+    num_expected = 0;
+    edge_index = 0;
+    seen_first_edge = 0;
+    expected_since_first = 0;
+
+    timeline_writer_init(&writer, image, sizeof(image), 2);
+    if (timeline_encode_message(&writer, message) != TIMELINE_STATUS_SUCCESS ||
+        timeline_writer_finish(&writer, unit_us) < 0) {
+        return;
+    }
+    timeline_open(image, sizeof(image), NULL, &cursor);
+
+    /* fold the runs down to the red channel and note where it changes */
+    while (timeline_next(&cursor, &level_mask, &units) == 1 && count < JITTER_MAX_EDGES) {
+        if ((level_mask & 0b01) != red) {
+            if (started) {
+                expected[count++] = run * unit_us * JITTER_CYCLES_PER_US;
+            }
+            started = 1;
+            red = level_mask & 0b01;
+            run = 0;
+        }
+        run += units;
+    }
+
+    ++jitter_results.messages;
+    num_expected = count;
+}
+
+/* histogram bin for an error in cycles */
+static short unsigned int bin_of(int32_t error) {
+
+    int32_t bin = (error + (error >= 0 ? JITTER_BIN_CYCLES / 2 : -(JITTER_BIN_CYCLES / 2))) / JITTER_BIN_CYCLES
+                  + JITTER_BINS / 2;
+
+    if (bin < 0) {
+        return 0;
+    }
+    if (bin >= JITTER_BINS) {
+        return JITTER_BINS - 1;
+    }
+    return (short unsigned int)bin;
+}
+
+/*
+ *  ======== gpioLoopbackFxn ========
+ *  Callback function for the GPIO interrupt on CONFIG_GPIO_LOOPBACK,
+ *  taken on both edges of the looped-back red LED.
+ */
+void gpioLoopbackFxn(uint_least8_t index)
+{
+    uint32_t now = profile_now();
+    int32_t jitter;
+    int32_t drift;
+
+    if (!seen_first_edge) {
+        first_edge_time = last_edge_time = now;
+        seen_first_edge = 1;
+        return;
+    }
+
+    if (edge_index >= num_expected) {
+        ++jitter_results.unexpected_edges;
+        last_edge_time = now;
+        return;
+    }
+
+    expected_since_first += expected[edge_index];
+    jitter = (int32_t)(now - last_edge_time - expected[edge_index]);
+    drift = (int32_t)(now - first_edge_time - expected_since_first);
+    last_edge_time = now;
+    ++edge_index;
+
+    ++jitter_results.edges;
+    ++jitter_results.jitter_histogram[bin_of(jitter)];
+    ++jitter_results.drift_histogram[bin_of(drift)];
+    if (jitter < jitter_results.min_jitter) {
+        jitter_results.min_jitter = jitter;
+    }
+    if (jitter > jitter_results.max_jitter) {
+        jitter_results.max_jitter = jitter;
+    }
+    if (drift < jitter_results.min_drift) {
+        jitter_results.min_drift = drift;
+    }
+    if (drift > jitter_results.max_drift) {
+        jitter_results.max_drift = drift;
+    }
+}
+
+/* print the results so far; the formatting takes a while, so call it
+ * straight after an LED write rather than before one */
+void jitter_report(void) {
+
+    short unsigned int i;
+
+    if (jitter_results.edges == 0) {
+        return;
+    }
+
+    console_printf("jitter: %u messages, %u edges, %u unexpected\r\n",
+                   jitter_results.messages, jitter_results.edges, jitter_results.unexpected_edges);
+    console_printf("  interval error %d..%d cycles, drift %d..%d cycles\r\n",
+                   jitter_results.min_jitter, jitter_results.max_jitter,
+                   jitter_results.min_drift, jitter_results.max_drift);
+    console_printf("  error(us)  jitter     drift\r\n");
+    for (i = 0; i < JITTER_BINS; ++i) {
+        if (jitter_results.jitter_histogram[i] != 0 || jitter_results.drift_histogram[i] != 0) {
+            console_printf("  %+9d  %-9u  %u\r\n",
+                           ((int)i - JITTER_BINS / 2) * JITTER_BIN_CYCLES / JITTER_CYCLES_PER_US,
+                           jitter_results.jitter_histogram[i], jitter_results.drift_histogram[i]);
+        }
+    }
+}
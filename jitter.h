@@ -0,0 +1,49 @@
+/*
+ *  ======== jitter.h ========
+ *  EDGE-TIMING SELF-TEST. THE RED LED OUTPUT IS WIRED BACK TO A SECOND
+ *  PIN (CONFIG_GPIO_LOOPBACK), EVERY EDGE ON IT IS TIMESTAMPED WITH THE
+ *  CYCLE COUNTER, AND EACH EDGE-TO-EDGE INTERVAL IS COMPARED WITH THE IDEAL
+ *  TIMELINE THAT timeline_encode_message() DERIVES FROM dot_len/dash_len.
+ *
+ *  Jitter is the error of each interval; drift is the error of each edge
+ *  relative to the first edge of the message. Both are histogrammed into
+ *  jitter_results, which the debugger can read and jitter_report() prints.
+ */
+
+#ifndef JITTER_H
+#define JITTER_H
+
+#include <stdint.h>
+
+/* core clock, for converting timeline units to cycles */
+#define JITTER_CYCLES_PER_US    80
+
+/* histogram shape: JITTER_BINS bins of JITTER_BIN_CYCLES each, centred on
+ * zero error; errors beyond either end land in the outermost bins */
+#define JITTER_BINS             33
+#define JITTER_BIN_CYCLES       80
+
+/* most red edges held in one message's ideal timeline */
+#define JITTER_MAX_EDGES        128
+
+/* --- results, accumulated over every message since jitter_init() --- */
+typedef struct {
+    uint32_t messages;
+    uint32_t edges;
+    uint32_t unexpected_edges;      /* edges beyond the ideal timeline */
+    int32_t min_jitter;             /* cycles */
+    int32_t max_jitter;
+    int32_t min_drift;
+    int32_t max_drift;
+    uint32_t jitter_histogram[JITTER_BINS];
+    uint32_t drift_histogram[JITTER_BINS];
+} jitter_stats;
+
+extern volatile jitter_stats jitter_results;
+
+/* function prototypes */
+void jitter_init(void);
+void jitter_begin_message(const char *message, uint32_t unit_us);
+void jitter_report(void);
+
+#endif /* JITTER_H */
@@ -0,0 +1,377 @@
+/*
+ *  ======== link.c ========
+ *  OOK DATA LINK: MANCHESTER-CODED FRAMES OUT ON THE LEDS AND BACK IN.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Driver Header files */
+#include <ti/drivers/GPIO.h>
+
+/* Driver configuration */
+#include "ti_drivers_config.h"
+
+#include "console.h"
+#include "link.h"
+#include "profile.h"
+
+/* half-bits in a frame, with the lit one after the CRC */
+#define FRAME_HALF_BITS(length)     ((uint32_t)(LINK_OVERHEAD + (length)) * 16 + 1)
+
+/* the receiver follows the sender's speed over 2^TRACK_SHIFT runs */
+#define TRACK_SHIFT     3
+
+volatile link_stat link_tx_stats;
+
+/* @return -> the CRC-16/CCITT-FALSE of the data */
+uint16_t link_crc16(const uint8_t *data, size_t length) {
+
+    uint16_t crc = 0xFFFF;
+    unsigned char bit;
+
+    while (length-- != 0) {
+        crc ^= (uint16_t)(*data++ << 8);
+        for (bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* build a frame around a payload, ready to be keyed by link_tx_next()
+ * @param payload -> the bytes to send, copied into the frame
+ * @param length -> 0 to LINK_MAX_PAYLOAD
+ * @return -> LINK_STATUS_SUCCESS or LINK_STATUS_TOO_LONG */
+int link_tx_start(link_transmitter *tx, const uint8_t *payload, size_t length) {
+
+    uint8_t *frame = tx->frame;
+    uint16_t crc;
+    size_t i;
+
+    if (length > LINK_MAX_PAYLOAD) {
+        return LINK_STATUS_TOO_LONG;
+    }
+
+    for (i = 0; i < LINK_PREAMBLE_LEN; ++i) {
+        *frame++ = 0x55;
+    }
+    *frame++ = (uint8_t)(LINK_SYNC >> 8);
+    *frame++ = (uint8_t)LINK_SYNC;
+    *frame++ = (uint8_t)length;
+    for (i = 0; i < length; ++i) {
+        *frame++ = payload[i];
+    }
+    crc = link_crc16(&tx->frame[LINK_PREAMBLE_LEN + 2], 1 + length);
+    *frame++ = (uint8_t)(crc >> 8);
+    *frame++ = (uint8_t)crc;
+
+    tx->length = (uint16_t)(frame - tx->frame);
+    tx->half_bit = 0;
+
+    ++link_tx_stats.frames;
+    link_tx_stats.payload_bytes += length;
+    link_tx_stats.ticks += FRAME_HALF_BITS(length) + LINK_GAP_TICKS;
+
+    return LINK_STATUS_SUCCESS;
+}
+
+/* @return -> the level of the frame's next half-bit, 1 for lit, or -1
+ *            once the whole frame has been sent */
+int link_tx_next(link_transmitter *tx) {
+
+    uint16_t half_bit = tx->half_bit;
+    int bit;
+
+    if (half_bit >= (uint16_t)(tx->length * 16)) {
+        if (half_bit > (uint16_t)(tx->length * 16)) {
+            return -1;
+        }
+        /* the lit half-bit that closes the frame */
+        tx->half_bit = half_bit + 1;
+        return 1;
+    }
+    bit = (tx->frame[half_bit >> 4] >> (7 - ((half_bit >> 1) & 7))) & 1;
+    tx->half_bit = half_bit + 1;
+
+    /* 0 is on then off, 1 off then on */
+    return (half_bit & 1) ? bit : !bit;
+}
+
+/* go back to hunting for a sync word */
+static void hunt(link_receiver *rx) {
+
+    rx->hunt[0] = rx->hunt[1] = 0;
+    rx->valid[0] = rx->valid[1] = 0;
+    rx->locked = 0;
+}
+
+/* give up on the frame in progress, if there is one */
+static void lose_frame(link_receiver *rx) {
+
+    if (rx->locked) {
+        ++rx->bad_frames;
+    }
+    hunt(rx);
+}
+
+/* add one bit to the frame being received, and hand it on if complete */
+static void take_bit(link_receiver *rx, unsigned char bit) {
+
+    uint8_t *byte = &rx->frame[rx->bits >> 3];
+    uint16_t length;
+
+    *byte = (uint8_t)((*byte << 1) | bit);
+    ++rx->bits;
+
+    if (rx->bits == 8) {
+        if (rx->frame[0] > LINK_MAX_PAYLOAD) {
+            lose_frame(rx);
+            return;
+        }
+        rx->expected = (uint16_t)((1 + rx->frame[0] + 2) * 8);
+    }
+    if (rx->bits < rx->expected) {
+        return;
+    }
+
+    length = rx->frame[0];
+    if (link_crc16(rx->frame, 1 + length) == ((rx->frame[1 + length] << 8) | rx->frame[2 + length])) {
+        ++rx->frames;
+        rx->payload_bytes += length;
+        if (rx->emit != NULL) {
+            rx->emit(&rx->frame[1], length);
+        }
+        hunt(rx);
+    }
+    else {
+        lose_frame(rx);
+    }
+}
+
+/* take in one half-bit: pair it with the one before, and look for the
+ * sync word in both phases until it turns up in one */
+static void take_half(link_receiver *rx, unsigned char level) {
+
+    unsigned char phase = rx->phase ^= 1;
+    unsigned char valid = rx->previous != level;
+
+    if (rx->previous > 1) {
+        rx->previous = level;
+        return;
+    }
+    rx->previous = level;
+
+    if (rx->locked) {
+        if (phase != rx->locked - 1) {
+            return;
+        }
+        if (!valid) {
+            lose_frame(rx);
+            return;
+        }
+        take_bit(rx, level);
+        return;
+    }
+
+    if (!valid) {
+        rx->valid[phase] = 0;
+        return;
+    }
+    rx->hunt[phase] = (uint16_t)((rx->hunt[phase] << 1) | level);
+    if (rx->valid[phase] < 16) {
+        ++rx->valid[phase];
+    }
+    if (rx->valid[phase] == 16 && rx->hunt[phase] == LINK_SYNC) {
+        rx->locked = (uint8_t)(phase + 1);
+        rx->bits = 0;
+        rx->expected = 8;
+    }
+}
+
+/* start a receiver
+ * @param half_bit -> the half-bit to expect, in the units runs will be given in
+ * @param emit -> handed each good frame's payload */
+void link_rx_init(link_receiver *rx, uint32_t half_bit, link_frame_fxn emit) {
+
+    rx->half = half_bit << 4;
+    rx->previous = 2;
+    rx->phase = 0;
+    rx->emit = emit;
+    rx->frames = 0;
+    rx->bad_frames = 0;
+    rx->payload_bytes = 0;
+    hunt(rx);
+}
+
+/* take in a run of the line at one level
+ * @param level -> 1 for lit
+ * @param duration -> how long it lasted, in the units of link_rx_init() */
+void link_rx_run(link_receiver *rx, unsigned char level, uint32_t duration) {
+
+    uint32_t half = rx->half >> 4;
+    unsigned char count;
+
+    if (duration < half / 2) {
+        /* too short for a half-bit: whatever it was, the bits are lost */
+        lose_frame(rx);
+        rx->previous = 2;
+        return;
+    }
+    if (duration >= half * 2 + half / 2) {
+        link_rx_idle(rx, level);
+        return;
+    }
+    count = duration < half + half / 2 ? 1 : 2;
+
+    rx->half += (int32_t)((duration << 4) / count - rx->half) >> TRACK_SHIFT;
+
+    take_half(rx, level);
+    if (count == 2) {
+        take_half(rx, level);
+    }
+}
+
+/* the line has stayed at one level for longer than any run in a frame;
+ * its start may still finish the last bit of one
+ * @param level -> 1 for lit */
+void link_rx_idle(link_receiver *rx, unsigned char level) {
+
+    take_half(rx, level);
+    lose_frame(rx);
+    rx->previous = 2;
+}
+
+#if MORSE_LINK_RX && !defined(MORSE_HOST)
+/* the receiver on CONFIG_GPIO_LOOPBACK, and the payloads it has passed but
+ * not yet printed; the ISR writes text_head, link_service() text_tail */
+static link_receiver receiver;
+static char text[128];
+static volatile unsigned char text_head = 0;
+static volatile unsigned char text_tail = 0;
+static volatile uint32_t text_dropped = 0;
+static void (*text_notify)(void) = NULL;
+static uint32_t last_edge_time;
+static unsigned char seen_edge = 0;
+
+/* function prototypes */
+void gpioLinkFxn(uint_least8_t index);
+
+/* hold on to a payload for link_service(), one line each, anything
+ * unprintable as '.' */
+static void keep_payload(const uint8_t *payload, size_t length) {
+
+    unsigned char head = text_head;
+    unsigned char next;
+    size_t i;
+    char c;
+
+    for (i = 0; i < length + 2; ++i) {
+        c = i < length ? ((payload[i] >= ' ' && payload[i] < 0x7F) ? (char)payload[i] : '.') :
+            i == length ? '\r' : '\n';
+        next = (unsigned char)((head + 1) % sizeof(text));
+        if (next == text_tail) {
+            ++text_dropped;
+            return;
+        }
+        text[head] = c;
+        head = next;
+    }
+    text_head = head;
+    if (text_notify != NULL) {
+        text_notify();
+    }
+}
+
+/*
+ *  ======== gpioLinkFxn ========
+ *  Callback function for the GPIO interrupt on CONFIG_GPIO_LOOPBACK,
+ *  taken on both edges of the light coming back.
+ */
+void gpioLinkFxn(uint_least8_t index)
+{
+    uint32_t now = profile_now();
+    unsigned char level = GPIO_read(CONFIG_GPIO_LOOPBACK) ? 1 : 0;
+
+    /* the run that has just ended was at the other level */
+    if (seen_edge) {
+        link_rx_run(&receiver, !level, now - last_edge_time);
+    }
+    seen_edge = 1;
+    last_edge_time = now;
+}
+
+/* start timestamping the loopback pin
+ * @param half_bit_us -> the half-bit to expect, normally the tick
+ * @return -> 0 */
+int link_rx_start(uint32_t half_bit_us) {
+
+    link_rx_init(&receiver, half_bit_us * PROFILE_COUNTS_PER_US, keep_payload);
+
+    GPIO_setConfig(CONFIG_GPIO_LOOPBACK, GPIO_CFG_IN_NOPULL | GPIO_CFG_IN_INT_BOTH_EDGES);
+    GPIO_setCallback(CONFIG_GPIO_LOOPBACK, gpioLinkFxn);
+    GPIO_enableInt(CONFIG_GPIO_LOOPBACK);
+
+    return 0;
+}
+
+/* expect a new half-bit from here on, when the tick is changed
+ * @param half_bit_us -> the new tick */
+void link_rx_expect(uint32_t half_bit_us) {
+
+    receiver.half = half_bit_us * PROFILE_COUNTS_PER_US << 4;
+}
+
+/* have a function called, from the GPIO interrupt, whenever a payload
+ * is waiting for link_service()
+ * @param notify -> the function, or NULL for none */
+void link_rx_notify(void (*notify)(void)) {
+
+    text_notify = notify;
+}
+
+/* print the payloads received since the last call */
+void link_service(void) {
+
+    unsigned char head = text_head;
+
+    if (text_tail > head) {
+        console_write(&text[text_tail], sizeof(text) - text_tail);
+        text_tail = 0;
+    }
+    if (text_tail < head) {
+        console_write(&text[text_tail], head - text_tail);
+        text_tail = head;
+    }
+}
+#endif
+
+/* print what has been sent, and received with MORSE_LINK_RX, over the console
+ * @param unit_us -> the tick, which is the half-bit */
+void link_report(uint32_t unit_us) {
+
+    uint32_t bits = link_tx_stats.payload_bytes * 8;
+    uint64_t airtime_us = (uint64_t)link_tx_stats.ticks * unit_us;
+
+    console_printf("link: %u bit/s on the line; sent %u frames, %u payload bytes, %u bit/s effective\r\n",
+                   500000 / unit_us, link_tx_stats.frames, link_tx_stats.payload_bytes,
+                   airtime_us == 0 ? 0 : (uint32_t)((uint64_t)bits * 1000000 / airtime_us));
+
+#if MORSE_LINK_RX && !defined(MORSE_HOST)
+    {
+        uint32_t frames = receiver.frames;
+        uint32_t bad = receiver.bad_frames;
+        uint32_t sent = link_tx_stats.frames;
+
+        /* out of the frames sent, with the LED looped back, or else out
+         * of those the receiver synced on */
+        uint32_t total = sent != 0 ? sent : frames + bad;
+        uint32_t errors = sent != 0 ? (sent > frames ? sent - frames : 0) : bad;
+        uint32_t hundredths = total == 0 ? 0 : (uint32_t)((uint64_t)errors * 10000 / total);
+
+        console_printf("link: received %u frames, %u payload bytes, %u bad, %u bytes dropped; "
+                       "frame error rate %u.%02u%%\r\n",
+                       frames, receiver.payload_bytes, bad, text_dropped, hundredths / 100, hundredths % 100);
+    }
+#endif
+}
@@ -0,0 +1,123 @@
+/*
+ *  ======== link.h ========
+ *  OOK DATA LINK. FRAMES OF BINARY DATA ARE MANCHESTER CODED ONTO THE SAME
+ *  LEDS THAT KEY MORSE, ONE HALF-BIT PER TIMER TICK, SO THAT THE SYMBOL
+ *  RATE IS SET BY THE TICK (unit 500 IS 2 KBAUD, 1 KBIT/S). A RECEIVER
+ *  TAKES THE LIGHT BACK AS RUNS OF ON AND OFF, FROM EDGE TIMESTAMPS ON
+ *  CONFIG_GPIO_LOOPBACK ON TARGET OR FROM A SLICED SAMPLE FILE ON THE HOST
+ *  (SEE host/link_rx.c), AND HANDS BACK THE FRAMES THAT PASS THEIR CRC.
+ *
+ *  A frame, sent most significant bit first:
+ *
+ *    preamble    LINK_PREAMBLE_LEN bytes of 0x55, for the far end's slicer
+ *                to settle on
+ *    sync        0x2D 0xD4
+ *    length      payload bytes, 0 to LINK_MAX_PAYLOAD
+ *    payload
+ *    crc         CRC-16/CCITT-FALSE (0x1021, from 0xFFFF) of length and
+ *                payload, high byte first
+ *
+ *  Each bit is two half-bits, as IEEE 802.3 has it: a 0 is on then off, a
+ *  1 off then on, so there is an edge in the middle of every bit and the
+ *  LED is lit half the time whatever the data. After the CRC comes one
+ *  lit half-bit, so that the last bit ends on an edge rather than fading
+ *  into the dark between frames. The receiver is told the half-bit it
+ *  should expect and follows the sender from there; it reads a run as
+ *  one half-bit or two to the nearest, and anything past two and a half
+ *  as the line falling idle. It finds the bit boundaries by waiting for
+ *  16 valid bits that read as the sync word, which the preamble cannot
+ *  do in either phase.
+ *
+ *  With MORSE_LINK_RX the receiver timestamps both edges of
+ *  CONFIG_GPIO_LOOPBACK with the cycle counter: loop an LED back to it to
+ *  check the transmitter, or give it a photodiode through a comparator.
+ *  The pin is the jitter test's, so the two cannot be built together.
+ */
+
+#ifndef LINK_H
+#define LINK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* set MORSE_LINK_RX to 1 to decode frames seen on CONFIG_GPIO_LOOPBACK
+ * and print their payloads on the console */
+#ifndef MORSE_LINK_RX
+#define MORSE_LINK_RX 0
+#endif
+
+/* set MORSE_LINK_TX to 1 to start up keying messages as frames rather
+ * than as Morse; "mode link" and "mode morse" switch at run time, except
+ * that a MORSE_PLAY_TIMELINE build always plays its precompiled Morse */
+#ifndef MORSE_LINK_TX
+#define MORSE_LINK_TX 0
+#endif
+
+#define LINK_PREAMBLE_LEN   4
+#define LINK_SYNC           0x2DD4
+#define LINK_MAX_PAYLOAD    64
+
+/* bytes in a frame around the payload */
+#define LINK_OVERHEAD       (LINK_PREAMBLE_LEN + 2 + 1 + 2)
+#define LINK_MAX_FRAME      (LINK_OVERHEAD + LINK_MAX_PAYLOAD)
+
+/* dark ticks left after a frame, comfortably more than the receiver
+ * takes for the line falling idle */
+#define LINK_GAP_TICKS      8
+
+#define LINK_STATUS_SUCCESS     0
+#define LINK_STATUS_TOO_LONG    (-1)
+
+/* handed each good frame's payload */
+typedef void (*link_frame_fxn)(const uint8_t *payload, size_t length);
+
+/* --- transmitter: a frame, and how far through it the LEDs are --- */
+typedef struct {
+    uint8_t frame[LINK_MAX_FRAME];
+    uint16_t length;                /* bytes */
+    uint16_t half_bit;              /* the next to send */
+} link_transmitter;
+
+/* --- what has been sent, for the effective bit rate --- */
+typedef struct {
+    uint32_t frames;
+    uint32_t payload_bytes;
+    uint32_t ticks;                 /* keyed for them, gaps included */
+} link_stat;
+
+extern volatile link_stat link_tx_stats;
+
+/* --- receiver --- */
+typedef struct {
+    uint32_t half;                  /* expected half-bit, in input counts, Q4 */
+    uint8_t previous;               /* last half-bit level, or 2 after idle */
+    uint8_t phase;                  /* of the half-bit just taken */
+    uint16_t hunt[2];               /* last 16 bits read in each phase */
+    uint8_t valid[2];               /* how many of them were valid pairs */
+    uint8_t locked;                 /* 1 + the phase of a frame's bits, or 0 */
+    uint8_t frame[1 + LINK_MAX_PAYLOAD + 2];
+    uint16_t bits;                  /* of the frame so far, after the sync */
+    uint16_t expected;              /* bits the frame will have, once known */
+    link_frame_fxn emit;
+    uint32_t frames;                /* running totals */
+    uint32_t bad_frames;            /* synced on but lost or failed the CRC */
+    uint32_t payload_bytes;
+} link_receiver;
+
+/* function prototypes */
+uint16_t link_crc16(const uint8_t *data, size_t length);
+
+int link_tx_start(link_transmitter *tx, const uint8_t *payload, size_t length);
+int link_tx_next(link_transmitter *tx);
+
+void link_rx_init(link_receiver *rx, uint32_t half_bit, link_frame_fxn emit);
+void link_rx_run(link_receiver *rx, unsigned char level, uint32_t duration);
+void link_rx_idle(link_receiver *rx, unsigned char level);
+
+int link_rx_start(uint32_t half_bit_us);
+void link_rx_expect(uint32_t half_bit_us);
+void link_rx_notify(void (*notify)(void));
+void link_service(void);
+void link_report(uint32_t unit_us);
+
+#endif /* LINK_H */
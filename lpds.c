@@ -0,0 +1,130 @@
+/*
+ *  ======== lpds.c ========
+ *  LOW-POWER DEEP SLEEP THROUGH LONG DARK GAPS.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "lpds.h"
+
+#if MORSE_LPDS
+
+#include <stdbool.h>
+
+/* Driver Header files */
+#include <ti/drivers/Power.h>
+#include <ti/drivers/power/PowerCC32XX.h>
+#if !defined(MORSE_HOST)
+#include <ti/devices/cc32xx/inc/hw_types.h>
+#endif
+#include <ti/devices/cc32xx/driverlib/prcm.h>
+
+#include "console.h"
+
+volatile lpds_stat lpds_stats;
+volatile uint32_t lpds_min_gap_us = LPDS_MIN_GAP_US;
+
+/* estimate of the time lost getting into LPDS and back out */
+static uint32_t wake_us = LPDS_WAKE_US;
+
+/* set by the Power driver, on the way out of LPDS, if a button woke it */
+static volatile unsigned char button_woke = 0;
+
+/* called by the Power driver on resuming from a GPIO wakeup */
+static void wake_fxn(uint_least32_t arg) {
+
+    button_woke = 1;
+}
+
+/* make SW2 (GPIO13, CONFIG_GPIO_BUTTON_0) a wakeup source, on the same
+ * falling edge as its interrupt; the LPDS timer is set for each sleep */
+void lpds_init(void) {
+
+    PowerCC32XX_Wakeup wakeup;
+
+    PowerCC32XX_getWakeup(&wakeup);
+    wakeup.enableGPIOWakeupLPDS = true;
+    wakeup.wakeupGPIOSourceLPDS = PRCM_LPDS_GPIO13;
+    wakeup.wakeupGPIOTypeLPDS = PRCM_LPDS_FALL_EDGE;
+    wakeup.wakeupGPIOFxnLPDS = wake_fxn;
+    wakeup.wakeupGPIOFxnLPDSArg = 0;
+    PowerCC32XX_configureWakeup(&wakeup);
+}
+
+/* sleep in LPDS, waking early enough to be running again LPDS_GUARD_US
+ * before the time given; call with interrupts disabled, and with nothing
+ * that has to run in the meantime
+ * @param gap_us -> time from now until the CPU is needed
+ * @param slept_us -> set to the time actually spent, by the slow clock
+ * @param button -> set to 1 if a button woke the device, 0 if the timer did
+ * @return -> LPDS_STATUS_SUCCESS, or LPDS_STATUS_REFUSED if a driver holds
+ *            the LPDS constraint, or LPDS_STATUS_TOO_SHORT; neither sleeps */
+int lpds_sleep(uint32_t gap_us, uint32_t *slept_us, unsigned char *button) {
+
+    uint64_t enter, leave;
+    uint32_t ticks, asked_us, latency;
+
+    *slept_us = 0;
+    *button = 0;
+
+    if (gap_us < wake_us + LPDS_GUARD_US) {
+        return LPDS_STATUS_TOO_SHORT;
+    }
+    if (Power_getConstraintMask() & (1 << PowerCC32XX_DISALLOW_LPDS)) {
+        ++lpds_stats.refused;
+        return LPDS_STATUS_REFUSED;
+    }
+
+    ticks = (uint32_t)((uint64_t)(gap_us - wake_us - LPDS_GUARD_US) * LPDS_SLOW_CLOCK_HZ / 1000000);
+    asked_us = (uint32_t)((uint64_t)ticks * 1000000 / LPDS_SLOW_CLOCK_HZ);
+
+    PRCMLPDSIntervalSet(ticks);
+    PRCMLPDSWakeupSourceEnable(PRCM_LPDS_TIMER);
+    button_woke = 0;
+
+    enter = PRCMSlowClkCtrGet();
+    Power_sleep(PowerCC32XX_LPDS);
+    leave = PRCMSlowClkCtrGet();
+
+    PRCMLPDSWakeupSourceDisable(PRCM_LPDS_TIMER);
+
+    *slept_us = (uint32_t)((leave - enter) * 1000000 / LPDS_SLOW_CLOCK_HZ);
+    *button = button_woke;
+
+    /* a timer wakeup overshoots by the entry and exit: follow the worst of
+     * them straight away, and ease back only slowly once they shorten */
+    if (!button_woke && *slept_us > asked_us) {
+        latency = *slept_us - asked_us;
+        wake_us = latency > wake_us ? latency : wake_us - (wake_us - latency) / 8;
+        lpds_stats.wake_us = latency;
+        if (latency > lpds_stats.max_wake_us) {
+            lpds_stats.max_wake_us = latency;
+        }
+    }
+
+    ++lpds_stats.sleeps;
+    lpds_stats.slept_us += *slept_us;
+    if (button_woke) {
+        ++lpds_stats.button_wakes;
+    }
+    return LPDS_STATUS_SUCCESS;
+}
+
+/* print the sleep statistics over the console */
+void lpds_report(void) {
+
+    if (lpds_min_gap_us == 0) {
+        console_printf("lpds: off\r\n");
+    }
+    else {
+        console_printf("lpds: gaps of %u us or more\r\n", lpds_min_gap_us);
+    }
+    console_printf("lpds: %u sleeps, %u ms asleep, %u ticks skipped, %u button wakeups, %u refused, %u late; "
+                   "wake %u us (max %u, allowing %u)\r\n",
+                   lpds_stats.sleeps, (uint32_t)(lpds_stats.slept_us / 1000), lpds_stats.ticks_skipped,
+                   lpds_stats.button_wakes, lpds_stats.refused, lpds_stats.late,
+                   lpds_stats.wake_us, lpds_stats.max_wake_us, wake_us);
+}
+
+#endif /* MORSE_LPDS */
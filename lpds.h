@@ -0,0 +1,87 @@
+/*
+ *  ======== lpds.h ========
+ *  LOW-POWER DEEP SLEEP (LPDS) THROUGH THE LONG DARK GAPS BETWEEN WORDS
+ *  AND MESSAGES. WHEN THE SEQUENCER IS HOLDING THE LEDS DARK FOR LONGER
+ *  THAN A THRESHOLD, THE TIMER IS STOPPED AND THE CC3220 SLEEPS IN LPDS
+ *  UNTIL JUST BEFORE THE TICK THAT HAS WORK TO DO, WOKEN BY THE LPDS TIMER
+ *  ON THE 32.768 KHZ SLOW CLOCK; THE TIMER IS THEN RESTARTED IN PHASE, SO
+ *  THE NEXT EDGE GOES OUT WHEN IT WOULD HAVE WITHOUT THE SLEEP.
+ *
+ *  It needs MORSE_SEQUENCER_IN_ISR, the one build whose main loop has
+ *  nothing to do between ticks, and works from the protothread's hold
+ *  count, so a MORSE_PLAY_TIMELINE build never sleeps. Getting into LPDS
+ *  and back out costs some milliseconds, which the sleep makes up for by
+ *  waking that much early: lpds_sleep() measures it on every timer wakeup
+ *  and keeps its estimate up to the worst it has seen lately, and a
+ *  further LPDS_GUARD_US is spent awake waiting for the timer. The slow
+ *  clock's 30.5 us resolution is the most an edge after a sleep can move.
+ *
+ *  The timer's own constraint goes when it is closed for the sleep; any
+ *  other driver still holding PowerCC32XX_DISALLOW_LPDS keeps the device
+ *  awake. The console stops receiving for the sleep, so that its UART
+ *  lets go, and input that arrives meanwhile is lost.
+ *
+ *  Only some pins can wake the CC3220 from LPDS. Of the LaunchPad's
+ *  buttons that is SW2 on GPIO13, CONFIG_GPIO_BUTTON_0, whose press wakes
+ *  the device and is then handled as usual; a press of SW3 while asleep
+ *  is lost. On the host the Power driver and slow clock are stubbed (see
+ *  host/stubs.c), so that a simulator can drive the same scheduling.
+ */
+
+#ifndef LPDS_H
+#define LPDS_H
+
+#include <stdint.h>
+
+/* set MORSE_LPDS to 1, with MORSE_SEQUENCER_IN_ISR, to sleep through long dark gaps */
+#ifndef MORSE_LPDS
+#define MORSE_LPDS 0
+#endif
+
+/* shortest dark gap worth sleeping through, the Power driver's own
+ * reckoning of LPDS entry and exit (PowerCC32XX_TOTALTIMELPDS) */
+#define LPDS_MIN_GAP_US     20000
+
+/* first guess at the time from asking for LPDS to running again after
+ * the wakeup, before any has been measured (PowerCC32XX_RESUMETIMELPDS) */
+#define LPDS_WAKE_US        2500
+
+/* time to be awake before the tick that has work, over the wake estimate */
+#define LPDS_GUARD_US       1000
+
+/* first period of a timer restarted after waking past an edge, which then
+ * goes out that late, and every tick after it with it */
+#define LPDS_LATE_RESTART_US 50
+
+#define LPDS_SLOW_CLOCK_HZ  32768
+
+/* the general-purpose timers count at the 80 MHz system clock */
+#define LPDS_TIMER_COUNTS_PER_US 80
+
+#define LPDS_STATUS_SUCCESS     (0)
+#define LPDS_STATUS_REFUSED     (-1)
+#define LPDS_STATUS_TOO_SHORT   (-2)
+
+/* --- running totals --- */
+typedef struct {
+    uint32_t sleeps;
+    uint32_t refused;               /* a driver held the LPDS constraint */
+    uint32_t button_wakes;
+    uint32_t late;                  /* woke after an edge was due */
+    uint32_t ticks_skipped;
+    uint64_t slept_us;
+    uint32_t wake_us;               /* last measured entry and exit */
+    uint32_t max_wake_us;
+} lpds_stat;
+
+extern volatile lpds_stat lpds_stats;
+
+/* dark gaps shorter than this are idled through awake; 0 for never sleep */
+extern volatile uint32_t lpds_min_gap_us;
+
+/* function prototypes */
+void lpds_init(void);
+int lpds_sleep(uint32_t gap_us, uint32_t *slept_us, unsigned char *button);
+void lpds_report(void);
+
+#endif /* LPDS_H */
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2016-2020, Texas Instruments Incorporated
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ *
+ * *  Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ *
+ * *  Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * *  Neither the name of Texas Instruments Incorporated nor the names of
+ *    its contributors may be used to endorse or promote products derived
+ *    from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO,
+ * THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+ * PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+ * CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+ * EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR
+ * OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ *  ======== main_freertos.c ========
+ *  Entry point for an RTOS build: import the SDK's FreeRTOS gpiointerrupt
+ *  example, add these sources, set RTOS.name to "FreeRTOS" in the .syscfg
+ *  and define MORSE_RTOS=1. Only POSIX and TI DPL calls are used outside
+ *  this file, so a TI-RTOS build works the same way with BIOS_start().
+ */
+#if MORSE_RTOS
+
+#include <stdint.h>
+
+/* POSIX Header files */
+#include <pthread.h>
+
+/* RTOS header files */
+#include <FreeRTOS.h>
+#include <task.h>
+
+#include <ti/drivers/Board.h>
+
+#include "boot.h"
+
+extern void *mainThread(void *arg0);
+
+/* Stack size in bytes */
+#define THREADSTACKSIZE    1024
+
+/*
+ *  ======== main ========
+ */
+int main(void)
+{
+    pthread_t           thread;
+    pthread_attr_t      attrs;
+    struct sched_param  priParam;
+    int                 retc;
+
+    boot_mark(BOOT_MAIN);
+
+    Board_init();
+    boot_mark(BOOT_BOARD_INIT);
+
+    /* Initialize the attributes structure with default values */
+    pthread_attr_init(&attrs);
+
+    /* Set priority, detach state, and stack size attributes; mainThread
+     * only reports, so it runs below all of the threads it starts */
+    priParam.sched_priority = 1;
+    retc = pthread_attr_setschedparam(&attrs, &priParam);
+    retc |= pthread_attr_setdetachstate(&attrs, PTHREAD_CREATE_DETACHED);
+    retc |= pthread_attr_setstacksize(&attrs, THREADSTACKSIZE);
+    if (retc != 0) {
+        /* failed to set attributes */
+        while (1) {}
+    }
+
+    retc = pthread_create(&thread, &attrs, mainThread, NULL);
+    if (retc != 0) {
+        /* pthread_create() failed */
+        while (1) {}
+    }
+
+    /* Start the FreeRTOS scheduler */
+    vTaskStartScheduler();
+
+    return (0);
+}
+
+/*
+ *  ======== vApplicationMallocFailedHook ========
+ *  Called if a call to pvPortMalloc() fails because there is insufficient
+ *  free memory available in the FreeRTOS heap.
+ */
+void vApplicationMallocFailedHook()
+{
+    /* Handle Memory Allocation Errors */
+    while (1) {}
+}
+
+/*
+ *  ======== vApplicationStackOverflowHook ========
+ *  When stack overflow checking is enabled the application must provide a
+ *  stack overflow hook function. This default hook function is declared as
+ *  weak, and will be used by default, unless the application specifically
+ *  provides its own hook function.
+ */
+void vApplicationStackOverflowHook(TaskHandle_t pxTask, char *pcTaskName)
+{
+    /* Handle FreeRTOS Stack Overflow */
+    while (1) {}
+}
+
+#endif /* MORSE_RTOS */
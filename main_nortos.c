@@ -33,7 +33,10 @@
 
 /*
  *  ======== main_nortos.c ========
+ *  Not built when MORSE_RTOS is set; main_freertos.c is used instead.
  */
+#if !MORSE_RTOS
+
 #include <stdint.h>
 #include <stddef.h>
 
@@ -41,6 +44,8 @@
 
 #include <ti/drivers/Board.h>
 
+#include "boot.h"
+
 extern void *mainThread(void *arg0);
 
 /*
@@ -48,7 +53,10 @@ extern void *mainThread(void *arg0);
  */
 int main(void)
 {
+    boot_mark(BOOT_MAIN);
+
     Board_init();
+    boot_mark(BOOT_BOARD_INIT);
 
     /* Start NoRTOS */
     NoRTOS_start();
@@ -58,3 +66,5 @@ int main(void)
 
     while (1) {}
 }
+
+#endif /* !MORSE_RTOS */
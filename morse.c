@@ -0,0 +1,174 @@
+/*
+ *  ======== morse.c ========
+ *  MORSE CODE ALPHABET AND SYMBOL LENGTHS SHARED BY THE FIRMWARE AND THE
+ *  HOST TOOLS.
+ */
+
+#include "morse.h"
+
+/* lengths of Morse code symbols */
+const int dot_len = 2;
+const int dash_len = 4;
+const int character_pause_len = 2;
+const int word_pause_len = 4;
+
+/* gaps in the two-LED code */
+const int parallel_symbol_pause_len = 1;
+const int parallel_character_pause_len = 2;
+
+/* every character get_morse() has a code for but the space, in the
+ * order get_character() tries them */
+static const char coded[] = "abcdefghijklmnopqrstuvwxyz0123456789.,?'!/()&:;=+-_\"@";
+
+/* This function converts a character to its Morse code equivalent
+ *   n.b. each 'symbol' (dot/dash) postpends a dot-length pause, and
+ *   each character postpends a dash-length pause; each is then
+ *   subtracted from the character- or word-pause when it occurs
+ * Capitals are keyed as the small letters; beyond the letters there are
+ * the digits and the ITU punctuation, and '!'. Anything past ASCII is
+ * for alphabet_code() (see alphabet.h).
+ * @param character -> the character to be converted to Morse code
+ * @return -> a string containting the Morse code for the character
+ * */
+const char* get_morse(char character)
+{
+
+  if (character >= 'A' && character <= 'Z') {
+    character = (char)(character - 'A' + 'a');
+  }
+
+  switch (character) {
+    case 'a':
+      return ".-";
+    case 'b':
+      return "-...";
+    case 'c':
+      return "-.-.";
+    case 'd':
+      return "-..";
+    case 'e':
+      return ".";
+    case 'f':
+      return "..-.";
+    case 'g':
+      return "--.";
+    case 'h':
+      return "....";
+    case 'i':
+      return "..";
+    case 'j':
+      return ".---";
+    case 'k':
+      return "-.-";
+    case 'l':
+      return ".-..";
+    case 'm':
+      return "--";
+    case 'n':
+      return "-.";
+    case 'o':
+      return "---";
+    case 'p':
+      return ".--.";
+    case 'q':
+      return "--.-";
+    case 'r':
+      return ".-.";
+    case 's':
+      return "...";
+    case 't':
+      return "-";
+    case 'u':
+      return "..-";
+    case 'v':
+      return "...-";
+    case 'w':
+      return ".--";
+    case 'x':
+      return "-..-";
+    case 'y':
+      return "-.--";
+    case 'z':
+      return "--..";
+    case '0':
+      return "-----";
+    case '1':
+      return ".----";
+    case '2':
+      return "..---";
+    case '3':
+      return "...--";
+    case '4':
+      return "....-";
+    case '5':
+      return ".....";
+    case '6':
+      return "-....";
+    case '7':
+      return "--...";
+    case '8':
+      return "---..";
+    case '9':
+      return "----.";
+    case '.':
+      return ".-.-.-";
+    case ',':
+      return "--..--";
+    case '?':
+      return "..--..";
+    case '\'':
+      return ".----.";
+    case '!':
+      return "-.-.--";
+    case '/':
+      return "-..-.";
+    case '(':
+      return "-.--.";
+    case ')':
+      return "-.--.-";
+    case '&':
+      return ".-...";
+    case ':':
+      return "---...";
+    case ';':
+      return "-.-.-.";
+    case '=':
+      return "-...-";
+    case '+':
+      return ".-.-.";
+    case '-':
+      return "-....-";
+    case '_':
+      return "..--.-";
+    case '"':
+      return ".-..-.";
+    case '@':
+      return ".--.-.";
+    default:
+      return " ";
+  }
+}
+
+/* The inverse of get_morse(): finds the character a code stands for
+ * @param morse -> a string of '.' and '-', or " " for the space
+ * @return -> the character, or '\0' if no character has that code
+ * */
+char get_character(const char *morse)
+{
+  const char *character;
+  const char *code;
+  const char *symbol;
+
+  if (morse[0] == ' ' && morse[1] == '\0') {
+    return ' ';
+  }
+  for (character = coded; *character != '\0'; ++character) {
+    code = get_morse(*character);
+    for (symbol = morse; *symbol != '\0' && *symbol == *code; ++symbol, ++code) {
+    }
+    if (*symbol == '\0' && *code == '\0') {
+      return *character;
+    }
+  }
+  return '\0';
+}
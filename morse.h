@@ -0,0 +1,36 @@
+/*
+ *  ======== morse.h ========
+ *  MORSE CODE ALPHABET AND SYMBOL LENGTHS SHARED BY THE FIRMWARE AND THE
+ *  HOST TOOLS. NOTHING IN HERE DEPENDS ON THE TI DRIVERS.
+ */
+
+#ifndef MORSE_H
+#define MORSE_H
+
+/* lengths of Morse code symbols, in timer ticks */
+extern const int dot_len;
+extern const int dash_len;
+extern const int character_pause_len;
+extern const int word_pause_len;
+
+/* set MORSE_PARALLEL to 1 to key the two-LED code instead: every symbol
+ * is a single tick, red for a dot, green for a dash and both for a space,
+ * so that the colour rather than the length tells them apart; a dark tick
+ * separates the symbols of a character and two separate characters, and
+ * a message ends dark for word_pause_len + 2 ticks as before. Ordinary
+ * text goes at well over twice the characters per second. The images
+ * MORSE_PLAY_TIMELINE plays are whichever code tools/mtl.c was built for,
+ * so regenerate timeline_image.c with it built with the same setting. */
+#ifndef MORSE_PARALLEL
+#define MORSE_PARALLEL 0
+#endif
+
+/* gaps in the two-LED code, in dark ticks */
+extern const int parallel_symbol_pause_len;
+extern const int parallel_character_pause_len;
+
+/* function prototypes */
+const char* get_morse(char character);
+char get_character(const char *morse);
+
+#endif /* MORSE_H */
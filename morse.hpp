@@ -0,0 +1,656 @@
+/*
+ *  ======== morse.hpp ========
+ *  HEADER-ONLY C++ MORSE ENCODER AND DECODER: THE ALPHABET OF get_morse()
+ *  AND THE KEYING OF run_sequencer(), BEHIND ITERATOR AND RANGE INTERFACES
+ *  THAT WRITE INTO SPANS THE CALLER PROVIDES. IT NEEDS C++14 AND NOTHING
+ *  ELSE: NO HEAP, NO STATE OUTSIDE THE OBJECTS THE CALLER HOLDS, NO
+ *  EXCEPTIONS AND NO STANDARD LIBRARY BEYOND <cstddef> AND <cstdint>, SO
+ *  IT BUILDS FOR THE CC3220 AS READILY AS FOR THE HOST. EVERYTHING IS
+ *  constexpr, SO A MESSAGE CAN BE ENCODED AT COMPILE TIME.
+ *
+ *  The runs are the ones timeline_encode_message() writes (see
+ *  timeline.h): a level mask, bit 0 red and bit 1 green as set_leds()
+ *  takes it, held for a number of ticks, with neighbouring holds at the
+ *  same level merged. encode_timeline() writes the same image, byte for
+ *  byte, and host/codec_bench.cpp checks that it does and times the two.
+ *  The encode functions walk the whole message in one go; runs() hands
+ *  the runs out one at a time, for a caller that only wants a few or has
+ *  nowhere to put them, keying a character at a time from a table of
+ *  packed codes built at compile time, and is as quick.
+ *
+ *    for (morse::run r : morse::runs(morse::text("sos"))) ...
+ *
+ *    morse::run out[64];
+ *    morse::result written = morse::encode(morse::text("sos"), out);
+ *
+ *  The firmware itself stays in C; the alphabet and the timings here
+ *  default to those in morse.c and must be kept in step with them. Text is
+ *  taken a byte at a time, as ASCII: the alphabets past it (alphabet.h)
+ *  are the C's alone.
+ */
+
+#ifndef MORSE_HPP
+#define MORSE_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace morse {
+
+/* --- symbol lengths and gaps, in ticks, as in morse.c --- */
+struct timing {
+    int dot_len = 2;
+    int dash_len = 4;
+    int character_pause_len = 2;
+    int word_pause_len = 4;
+    int parallel_symbol_pause_len = 1;
+    int parallel_character_pause_len = 2;
+};
+
+/* --- the code keyed: Morse on lengths, or the two-LED code of morse.h --- */
+enum class keying { serial, parallel };
+
+/* --- a view of caller-owned memory; the library never holds more --- */
+template <typename T>
+class span {
+public:
+    constexpr span() : data_(nullptr), size_(0) {}
+    constexpr span(T *data, std::size_t size) : data_(data), size_(size) {}
+    template <std::size_t N>
+    constexpr span(T (&array)[N]) : data_(array), size_(N) {}
+
+    constexpr T *begin() const { return data_; }
+    constexpr T *end() const { return data_ + size_; }
+    constexpr T *data() const { return data_; }
+    constexpr std::size_t size() const { return size_; }
+    constexpr T &operator[](std::size_t i) const { return data_[i]; }
+
+private:
+    T *data_;
+    std::size_t size_;
+};
+
+/* @return -> the text of a NUL-terminated string, without the NUL */
+constexpr span<const char> text(const char *string) {
+
+    std::size_t length = 0;
+
+    while (string[length] != '\0') {
+        ++length;
+    }
+    return span<const char>(string, length);
+}
+
+/* --- one level held for a number of ticks --- */
+struct run {
+    unsigned char level_mask;
+    std::uint32_t units;
+};
+
+constexpr bool operator==(const run &a, const run &b) {
+
+    return a.level_mask == b.level_mask && a.units == b.units;
+}
+
+constexpr bool operator!=(const run &a, const run &b) {
+
+    return !(a == b);
+}
+
+/* --- what a write into a span came to --- */
+struct result {
+    std::size_t written;            /* elements written */
+    bool complete;                  /* false if the span ran out first */
+};
+
+/* @return -> the code for a character, as get_morse(): '.' and '-', or
+ *            " " for a space or anything with no code; capitals are
+ *            keyed as small letters */
+constexpr const char *code(char character) {
+
+    switch (character >= 'A' && character <= 'Z' ? static_cast<char>(character - 'A' + 'a') : character) {
+        case 'a': return ".-";
+        case 'b': return "-...";
+        case 'c': return "-.-.";
+        case 'd': return "-..";
+        case 'e': return ".";
+        case 'f': return "..-.";
+        case 'g': return "--.";
+        case 'h': return "....";
+        case 'i': return "..";
+        case 'j': return ".---";
+        case 'k': return "-.-";
+        case 'l': return ".-..";
+        case 'm': return "--";
+        case 'n': return "-.";
+        case 'o': return "---";
+        case 'p': return ".--.";
+        case 'q': return "--.-";
+        case 'r': return ".-.";
+        case 's': return "...";
+        case 't': return "-";
+        case 'u': return "..-";
+        case 'v': return "...-";
+        case 'w': return ".--";
+        case 'x': return "-..-";
+        case 'y': return "-.--";
+        case 'z': return "--..";
+        case '0': return "-----";
+        case '1': return ".----";
+        case '2': return "..---";
+        case '3': return "...--";
+        case '4': return "....-";
+        case '5': return ".....";
+        case '6': return "-....";
+        case '7': return "--...";
+        case '8': return "---..";
+        case '9': return "----.";
+        case '.': return ".-.-.-";
+        case ',': return "--..--";
+        case '?': return "..--..";
+        case '\'': return ".----.";
+        case '!': return "-.-.--";
+        case '/': return "-..-.";
+        case '(': return "-.--.";
+        case ')': return "-.--.-";
+        case '&': return ".-...";
+        case ':': return "---...";
+        case ';': return "-.-.-.";
+        case '=': return "-...-";
+        case '+': return ".-.-.";
+        case '-': return "-....-";
+        case '_': return "..--.-";
+        case '"': return ".-..-.";
+        case '@': return ".--.-.";
+        default: return " ";
+    }
+}
+
+/* @return -> the character a code stands for, as get_character(), or
+ *            '\0' if none has it */
+constexpr char character(span<const char> symbols) {
+
+    const char *coded = "abcdefghijklmnopqrstuvwxyz0123456789.,?'!/()&:;=+-_\"@";
+    const char *candidate = nullptr;
+    std::size_t i = 0;
+
+    if (symbols.size() == 1 && symbols[0] == ' ') {
+        return ' ';
+    }
+    for (; *coded != '\0'; ++coded) {
+        candidate = code(*coded);
+        for (i = 0; i < symbols.size() && candidate[i] == symbols[i]; ++i) {
+        }
+        if (i == symbols.size() && candidate[i] == '\0') {
+            return *coded;
+        }
+    }
+    return '\0';
+}
+
+namespace detail {
+
+/* --- a character's code packed: its symbols, and a bit for each, set
+ * for a dash; a length of 0 is a space, which is also what a character
+ * with no code is keyed as --- */
+struct packed_code {
+    unsigned char length;
+    unsigned char dashes;
+};
+
+struct packed_codes {
+    packed_code code[256];
+
+    constexpr const packed_code &operator[](std::size_t i) const { return code[i]; }
+};
+
+constexpr packed_codes pack_codes() {
+
+    packed_codes table{};
+    const char *symbol = nullptr;
+    unsigned char length = 0;
+
+    for (int c = 0; c < 256; ++c) {
+        symbol = code(static_cast<char>(c));
+        length = 0;
+        if (symbol[0] != ' ') {
+            for (; symbol[length] != '\0'; ++length) {
+                if (symbol[length] == '-') {
+                    table.code[c].dashes = static_cast<unsigned char>(table.code[c].dashes | (1u << length));
+                }
+            }
+        }
+        table.code[c].length = length;
+    }
+    return table;
+}
+
+/* every character's packed code, worked out at compile time; a template
+ * so that the header can define it */
+template <typename T = void>
+struct code_table {
+    static constexpr packed_codes codes = pack_codes();
+};
+
+template <typename T>
+constexpr packed_codes code_table<T>::codes;
+
+/* the holds of one character the way the sequencer keys it, without
+ * merging them, each handed to a sink; see timeline_encode_message() and
+ * timeline_encode_parallel(). The sink merges them as it likes, and stops
+ * the walk by returning false
+ * @return -> false if the sink stopped it */
+template <keying K, typename Sink>
+constexpr bool walk_character(char character, const timing &t, Sink &sink) {
+
+    const char *symbol = code(character);
+
+    for (; *symbol != '\0'; ++symbol) {
+        if (K == keying::parallel) {
+            if (!sink.add(static_cast<unsigned char>(*symbol == '.' ? 0b01 : *symbol == '-' ? 0b10 : 0b11), 1) ||
+                !sink.add(0, static_cast<std::uint32_t>(t.parallel_symbol_pause_len))) {
+                return false;
+            }
+        }
+        else if (*symbol == '.' || *symbol == '-') {
+            if (!sink.add(*symbol == '.' ? 0b01 : 0b10,
+                          static_cast<std::uint32_t>(*symbol == '.' ? t.dot_len - 1 : t.dash_len - 1)) ||
+                !sink.add(0, 2)) {
+                return false;
+            }
+        }
+        else if (!sink.add(0, static_cast<std::uint32_t>(t.word_pause_len + 1))) {
+            /* a space has no gap of its own after it */
+            return false;
+        }
+    }
+
+    return sink.add(0, static_cast<std::uint32_t>(K == keying::parallel ?
+                           t.parallel_character_pause_len - t.parallel_symbol_pause_len :
+                           t.character_pause_len + 2));
+}
+
+/* the gap at the end of a message */
+template <typename Sink>
+constexpr bool walk_end(const timing &t, Sink &sink) {
+
+    return sink.add(0, static_cast<std::uint32_t>(t.word_pause_len + 2));
+}
+
+/* @return -> false if the sink stopped the walk */
+template <keying K, typename Sink>
+constexpr bool walk(span<const char> message, const timing &t, Sink &sink) {
+
+    for (std::size_t i = 0; i < message.size(); ++i) {
+        if (!walk_character<K>(message[i], t, sink)) {
+            return false;
+        }
+    }
+
+    return walk_end(t, sink);
+}
+
+/* runs into a span, each hold merged into the last run while the level
+ * holds */
+struct run_sink {
+    span<run> out;
+    std::size_t written;
+
+    constexpr bool add(unsigned char level_mask, std::uint32_t units) {
+
+        if (units == 0) {
+            return true;
+        }
+        if (written != 0 && out[written - 1].level_mask == level_mask) {
+            out[written - 1].units += units;
+            return true;
+        }
+        if (written == out.size()) {
+            return false;
+        }
+        out[written++] = run{level_mask, units};
+        return true;
+    }
+};
+
+/* a mask for every tick */
+struct tick_sink {
+    span<unsigned char> out;
+    std::size_t written;
+
+    constexpr bool add(unsigned char level_mask, std::uint32_t units) {
+
+        for (; units != 0; --units) {
+            if (written == out.size()) {
+                return false;
+            }
+            out[written++] = level_mask;
+        }
+        return true;
+    }
+};
+
+/* timeline runs, as timeline_writer_add() writes them: each run is
+ * written once the level changes, as a varint of units and mask */
+struct timeline_sink {
+    span<std::uint8_t> image;
+    std::size_t length;
+    std::uint32_t run_count;
+    unsigned char pending_mask;
+    std::uint32_t pending_units;
+
+    constexpr bool add(unsigned char level_mask, std::uint32_t units) {
+
+        if (units == 0) {
+            return true;
+        }
+        if (pending_units != 0 && level_mask != pending_mask && !flush()) {
+            return false;
+        }
+        pending_mask = level_mask;
+        pending_units += units;
+        return true;
+    }
+
+    constexpr bool flush() {
+
+        std::uint32_t value = (pending_units << 2) | pending_mask;
+
+        if (pending_units == 0) {
+            return true;
+        }
+        do {
+            if (length >= image.size()) {
+                return false;
+            }
+            image[length++] = static_cast<std::uint8_t>((value & 0x7f) | (value > 0x7f ? 0x80 : 0));
+            value >>= 7;
+        } while (value != 0);
+        ++run_count;
+        pending_units = 0;
+        return true;
+    }
+};
+
+} /* namespace detail */
+
+/* --- input iterator over the runs of a message; a default-constructed
+ * one is the end. It keys a character at a time into a few runs of its
+ * own, from its packed code and lengths worked out once, so each step is
+ * an increment and a compare; the last run is held back until the next
+ * character shows whether it grows --- */
+template <keying K = keying::serial>
+class run_iterator {
+public:
+    using value_type = run;
+    using difference_type = std::ptrdiff_t;
+    using pointer = const run *;
+    using reference = const run &;
+
+    constexpr run_iterator()
+        : next_(nullptr), last_(nullptr), buffer_{}, count_(0), at_(0), mark_{}, gap_(0), character_gap_(0),
+          space_(0), end_(0) {}
+    constexpr run_iterator(span<const char> message, timing t)
+        : next_(message.begin()), last_(message.end()), buffer_{}, count_(0), at_(0), mark_{}, gap_(0),
+          character_gap_(0), space_(0), end_(static_cast<std::uint32_t>(t.word_pause_len + 2)) {
+
+        if (K == keying::parallel) {
+            mark_[0] = 1;
+            mark_[1] = 1;
+            gap_ = static_cast<std::uint32_t>(t.parallel_symbol_pause_len);
+            character_gap_ = static_cast<std::uint32_t>(t.parallel_character_pause_len - t.parallel_symbol_pause_len);
+        }
+        else {
+            mark_[0] = static_cast<std::uint32_t>(t.dot_len - 1);
+            mark_[1] = static_cast<std::uint32_t>(t.dash_len - 1);
+            gap_ = 2;
+            character_gap_ = static_cast<std::uint32_t>(t.character_pause_len + 2);
+            space_ = static_cast<std::uint32_t>(t.word_pause_len + 1);
+        }
+        refill();
+    }
+
+    constexpr const run &operator*() const { return buffer_[at_]; }
+    constexpr const run *operator->() const { return &buffer_[at_]; }
+
+    constexpr run_iterator &operator++() {
+
+        if (++at_ + 1 >= count_) {
+            refill();
+        }
+        return *this;
+    }
+
+    constexpr run_iterator operator++(int) {
+
+        run_iterator before = *this;
+        ++*this;
+        return before;
+    }
+
+    /* the end has no text left; until then, iterators over the same text
+     * differ in where they have got to */
+    constexpr bool operator==(const run_iterator &other) const {
+
+        return last_ == other.last_ && next_ == other.next_ && at_ == other.at_ && count_ == other.count_;
+    }
+
+    constexpr bool operator!=(const run_iterator &other) const { return !(*this == other); }
+
+private:
+    /* the most runs one character can add, a mark and a gap for each of
+     * up to six symbols, and the run carried over */
+    static constexpr std::size_t buffer_len = 13;
+
+    /* a hold after the last run, merged into it while the level holds */
+    constexpr void add(unsigned char level_mask, std::uint32_t units) {
+
+        if (units == 0) {
+            return;
+        }
+        if (count_ != 0 && buffer_[count_ - 1].level_mask == level_mask) {
+            buffer_[count_ - 1].units += units;
+        }
+        else {
+            buffer_[count_++] = run{level_mask, units};
+        }
+    }
+
+    /* called when at_ is on the last run, or past it: carry that run over
+     * and key characters until it is whole or the message has ended */
+    constexpr void refill() {
+
+        if (next_ == nullptr) {
+            /* the gap at the end has been keyed: run out, then be the end */
+            if (at_ >= count_) {
+                last_ = nullptr;
+                at_ = 0;
+                count_ = 0;
+            }
+            return;
+        }
+
+        if (at_ < count_) {
+            buffer_[0] = buffer_[at_];
+            count_ = 1;
+        }
+        else {
+            count_ = 0;
+        }
+        at_ = 0;
+        while (count_ < 2) {
+            if (next_ == last_) {
+                add(0, end_);
+                next_ = nullptr;
+                return;
+            }
+            key(detail::code_table<>::codes[static_cast<unsigned char>(*next_++)]);
+        }
+    }
+
+    /* the holds of one character, as walk_character() has them */
+    constexpr void key(detail::packed_code code) {
+
+        unsigned char i = 0;
+
+        if (code.length == 0) {
+            /* a space, or a character with no code */
+            if (K == keying::parallel) {
+                add(0b11, 1);
+                add(0, gap_);
+            }
+            else {
+                add(0, space_);
+            }
+        }
+        for (; i < code.length; ++i) {
+            add(static_cast<unsigned char>(1u << ((code.dashes >> i) & 1u)), mark_[(code.dashes >> i) & 1u]);
+            add(0, gap_);
+        }
+        add(0, character_gap_);
+    }
+
+    const char *next_;              /* the next character, NULL once the end is keyed */
+    const char *last_;              /* the end of the text, NULL at the end */
+    run buffer_[buffer_len];
+    std::size_t count_;
+    std::size_t at_;                /* the run *this is at */
+    std::uint32_t mark_[2];         /* a dot and a dash */
+    std::uint32_t gap_;             /* after each symbol */
+    std::uint32_t character_gap_;   /* after the last symbol's */
+    std::uint32_t space_;           /* a space's, keying Morse */
+    std::uint32_t end_;             /* at the end of the message */
+};
+
+/* --- the runs of a message, for a range-based for --- */
+template <keying K = keying::serial>
+class run_range {
+public:
+    constexpr run_range(span<const char> message, timing t) : message_(message), timing_(t) {}
+
+    constexpr run_iterator<K> begin() const { return run_iterator<K>(message_, timing_); }
+    constexpr run_iterator<K> end() const { return run_iterator<K>(); }
+
+private:
+    span<const char> message_;
+    timing timing_;
+};
+
+template <keying K = keying::serial>
+constexpr run_range<K> runs(span<const char> message, timing t = timing()) {
+
+    return run_range<K>(message, t);
+}
+
+/* write the runs of a message; the same runs as runs() gives, written
+ * as the message is walked rather than asked for one at a time
+ * @return -> the runs written, and whether that was all of them */
+template <keying K = keying::serial>
+constexpr result encode(span<const char> message, span<run> out, timing t = timing()) {
+
+    detail::run_sink sink{out, 0};
+    bool complete = detail::walk<K>(message, t, sink);
+
+    return result{sink.written, complete};
+}
+
+/* write the level of every tick of a message, one mask per tick, as the
+ * sequencer would set the LEDs
+ * @return -> the ticks written, and whether that was all of them */
+template <keying K = keying::serial>
+constexpr result encode_ticks(span<const char> message, span<unsigned char> out, timing t = timing()) {
+
+    detail::tick_sink sink{out, 0};
+    bool complete = detail::walk<K>(message, t, sink);
+
+    return result{sink.written, complete};
+}
+
+/* write a message as a two-channel timeline image, as
+ * timeline_encode_message() and timeline_writer_finish() do
+ * @param unit_us -> the tick, for the header
+ * @return -> the bytes written, and whether the image fitted; the header
+ *            is only written if it did */
+template <keying K = keying::serial>
+constexpr result encode_timeline(span<const char> message, span<std::uint8_t> image, std::uint32_t unit_us,
+                                 timing t = timing()) {
+
+    constexpr std::size_t header_len = 16;
+    detail::timeline_sink sink{image, header_len, 0, 0, 0};
+
+    if (image.size() < header_len) {
+        return result{0, false};
+    }
+    if (!detail::walk<K>(message, t, sink) || !sink.flush()) {
+        return result{sink.length, false};
+    }
+
+    image[0] = 'M';
+    image[1] = 'T';
+    image[2] = 'L';
+    image[3] = 1;
+    for (int i = 0; i < 4; ++i) {
+        image[4 + i] = static_cast<std::uint8_t>(unit_us >> (8 * i));
+        image[12 + i] = static_cast<std::uint8_t>(sink.run_count >> (8 * i));
+    }
+    image[8] = 2;
+    image[9] = 0;
+    image[10] = 0;
+    image[11] = 0;
+
+    return result{sink.length, true};
+}
+
+/* recover the text from runs keyed exactly as encode() writes them; a
+ * character with no code comes back as a space, as it was keyed
+ * @return -> the characters written, and whether that was all of them */
+template <keying K = keying::serial>
+constexpr result decode(span<const run> in, span<char> out, timing t = timing()) {
+
+    /* dark after a character; and, keying Morse, the dark a space adds */
+    const std::uint32_t character_gap = static_cast<std::uint32_t>(K == keying::parallel ?
+                                            t.parallel_character_pause_len : t.character_pause_len + 4);
+    const std::uint32_t space_gap = static_cast<std::uint32_t>(t.word_pause_len + t.character_pause_len + 3);
+    char symbols[8] = {};
+    std::size_t count = 0, written = 0;
+    std::uint32_t dark = 0;
+
+    for (std::size_t i = 0; i <= in.size(); ++i) {
+        /* the end counts as dark, to finish the last character */
+        if (i < in.size() && in[i].level_mask != 0) {
+            if (count < sizeof(symbols)) {
+                symbols[count] = in[i].level_mask == 0b01 ? '.' : in[i].level_mask == 0b10 ? '-' : ' ';
+            }
+            ++count;
+            continue;
+        }
+        dark = i < in.size() ? in[i].units : character_gap;
+        if (dark < character_gap) {
+            continue;
+        }
+
+        if (count != 0) {
+            if (written == out.size()) {
+                return result{written, false};
+            }
+            out[written] = count <= sizeof(symbols) ? character(span<const char>(symbols, count)) : '\0';
+            if (out[written] == '\0') {
+                out[written] = ' ';
+            }
+            ++written;
+            count = 0;
+            dark -= character_gap;
+        }
+        for (; K == keying::serial && dark >= space_gap; dark -= space_gap) {
+            if (written == out.size()) {
+                return result{written, false};
+            }
+            out[written++] = ' ';
+        }
+    }
+    return result{written, true};
+}
+
+} /* namespace morse */
+
+#endif /* MORSE_HPP */
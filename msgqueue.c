@@ -0,0 +1,350 @@
+/*
+ *  ======== msgqueue.c ========
+ *  PRIORITY QUEUE OF MESSAGES WAITING TO BE KEYED.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "console.h"
+#include "msgqueue.h"
+
+volatile msgqueue_stat msgqueue_stats[MSGQUEUE_NUM_PRIORITIES];
+
+/* pool of entries, the heap of pool indices ordered by urgency, and a
+ * stack of the pool indices not in use */
+static msgqueue_entry pool[MSGQUEUE_LEN];
+static unsigned char heap[MSGQUEUE_LEN];
+static unsigned char free_slots[MSGQUEUE_LEN];
+static short unsigned int heap_len = 0;
+static short unsigned int free_len = 0;
+static uint32_t next_sequence = 0;
+
+/* @return -> nonzero if pool entry a should be keyed before pool entry b */
+static int before(unsigned char a, unsigned char b) {
+
+    if (pool[a].priority != pool[b].priority) {
+        return pool[a].priority > pool[b].priority;
+    }
+    return (int32_t)(pool[a].sequence - pool[b].sequence) < 0;
+}
+
+/* move the heap entry at position i up until its parent comes first */
+static void sift_up(short unsigned int i) {
+
+    unsigned char slot = heap[i];
+    short unsigned int parent;
+
+    while (i > 0) {
+        parent = (i - 1) / 2;
+        if (!before(slot, heap[parent])) {
+            break;
+        }
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = slot;
+}
+
+/* move the heap entry at position i down until it comes before its children */
+static void sift_down(short unsigned int i) {
+
+    unsigned char slot = heap[i];
+    short unsigned int child;
+
+    while ((child = 2 * i + 1) < heap_len) {
+        if (child + 1 < heap_len && before(heap[child + 1], heap[child])) {
+            ++child;
+        }
+        if (!before(heap[child], slot)) {
+            break;
+        }
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = slot;
+}
+
+/* when the queue is full, make room by dropping its least urgent entry,
+ * provided the new one is more urgent; interrupts already disabled
+ * @param evicted -> receives the dropped entry
+ * @return -> 1 if room was made, 0 if the new entry is to be dropped */
+static int evict(const msgqueue_entry *entry, msgqueue_entry *evicted) {
+
+    short unsigned int i, least = heap_len / 2;
+    unsigned char slot;
+
+    /* the least urgent entry is always a leaf */
+    for (i = least + 1; i < heap_len; ++i) {
+        if (before(heap[least], heap[i])) {
+            least = i;
+        }
+    }
+    slot = heap[least];
+    if (pool[slot].priority >= entry->priority) {
+        return 0;
+    }
+
+    ++msgqueue_stats[pool[slot].priority].dropped;
+    *evicted = pool[slot];
+
+    /* fill the hole with the last entry; as it replaces a leaf it can
+     * only need to move up */
+    heap[least] = heap[--heap_len];
+    if (least < heap_len) {
+        sift_up(least);
+    }
+    free_slots[free_len++] = slot;
+
+    return 1;
+}
+
+/* add an entry, with interrupts already disabled
+ * @param evicted -> receives any entry dropped to make room; its text is
+ *                   NULL if there was none */
+static int insert(const msgqueue_entry *entry, msgqueue_entry *evicted) {
+
+    unsigned char slot;
+
+    evicted->text = NULL;
+    evicted->rope = NULL;
+    if (free_len == 0 && !evict(entry, evicted)) {
+        ++msgqueue_stats[entry->priority].dropped;
+        return MSGQUEUE_STATUS_FULL;
+    }
+
+    slot = free_slots[--free_len];
+    pool[slot] = *entry;
+    heap[heap_len] = slot;
+    sift_up(heap_len++);
+
+    return MSGQUEUE_STATUS_SUCCESS;
+}
+
+/* empty the queue and clear the statistics */
+void msgqueue_init(void) {
+
+    uintptr_t key = HwiP_disable();
+    short unsigned int i;
+
+    heap_len = 0;
+    free_len = MSGQUEUE_LEN;
+    for (i = 0; i < MSGQUEUE_LEN; ++i) {
+        free_slots[i] = (unsigned char)(MSGQUEUE_LEN - 1 - i);
+    }
+    for (i = 0; i < MSGQUEUE_NUM_PRIORITIES; ++i) {
+        msgqueue_stats[i].enqueued = 0;
+        msgqueue_stats[i].dropped = 0;
+        msgqueue_stats[i].started = 0;
+        msgqueue_stats[i].preempted = 0;
+        msgqueue_stats[i].total_wait = 0;
+        msgqueue_stats[i].max_wait = 0;
+    }
+
+    HwiP_restore(key);
+}
+
+/* hand a message's text back to its owner, once it has been keyed or
+ * dropped: a streamed message's rope is released, and any other text is
+ * handed to its release function
+ * @param entry -> as pushed or popped; an evicted entry's text may be NULL */
+void msgqueue_release(const msgqueue_entry *entry) {
+
+    if (entry->rope != NULL) {
+        rope_release(entry->rope);
+    }
+    else if (entry->text != NULL && entry->release != NULL) {
+        entry->release(entry->text);
+    }
+}
+
+/* add a new entry, dropping and releasing whatever it displaces */
+static int push(msgqueue_entry *entry) {
+
+    msgqueue_entry evicted;
+    uintptr_t key;
+    int status;
+
+    key = HwiP_disable();
+    entry->sequence = next_sequence++;
+    status = insert(entry, &evicted);
+    if (status == MSGQUEUE_STATUS_SUCCESS) {
+        ++msgqueue_stats[entry->priority].enqueued;
+    }
+    HwiP_restore(key);
+
+    msgqueue_release(&evicted);
+
+    return status;
+}
+
+/* queue a new message; when the queue is full, a less urgent message is
+ * dropped (and released) to make room, or failing that this one is
+ * @param text -> the message, which must outlive its time in the queue
+ * @param priority -> one of MSGQUEUE_ROUTINE, MSGQUEUE_PRIORITY, MSGQUEUE_DISTRESS
+ * @param now -> the current tick, for the wait statistics
+ * @param release -> called with the text once it is finished with (may be NULL)
+ * @return -> MSGQUEUE_STATUS_SUCCESS, or MSGQUEUE_STATUS_FULL if it was
+ *            dropped, in which case the text is still the caller's */
+int msgqueue_push(const char *text, unsigned char priority, uint32_t now, msgqueue_release_fxn release_fxn) {
+
+    msgqueue_entry entry;
+
+    if (text == NULL || priority >= MSGQUEUE_NUM_PRIORITIES) {
+        return MSGQUEUE_STATUS_ERROR;
+    }
+
+    entry.text = text;
+    entry.rope = NULL;
+    entry.priority = priority;
+    entry.resume_index = 0;
+    entry.enqueue_tick = now;
+    entry.release = release_fxn;
+
+    return push(&entry);
+}
+
+/* queue a streamed message, as msgqueue_push(); it is released with
+ * rope_release() once it has been keyed or dropped
+ * @param r -> the rope, opened and perhaps already appended to
+ * @return -> MSGQUEUE_STATUS_SUCCESS, or MSGQUEUE_STATUS_FULL if it was
+ *            dropped, in which case the rope is still the caller's */
+int msgqueue_push_rope(rope *r, unsigned char priority, uint32_t now) {
+
+    msgqueue_entry entry;
+
+    if (r == NULL || priority >= MSGQUEUE_NUM_PRIORITIES) {
+        return MSGQUEUE_STATUS_ERROR;
+    }
+
+    entry.text = ROPE_NAME;
+    entry.rope = r;
+    entry.priority = priority;
+    entry.resume_index = 0;
+    entry.enqueue_tick = now;
+    entry.release = NULL;
+
+    return push(&entry);
+}
+
+/* put a preempted message back, keeping its place among its equals
+ * @param entry -> as popped, with resume_index moved on
+ * @return -> MSGQUEUE_STATUS_SUCCESS, or MSGQUEUE_STATUS_FULL if it was
+ *            dropped, in which case the text is still the caller's */
+int msgqueue_requeue(const msgqueue_entry *entry) {
+
+    msgqueue_entry evicted;
+    uintptr_t key = HwiP_disable();
+    int status = insert(entry, &evicted);
+
+    if (status == MSGQUEUE_STATUS_SUCCESS) {
+        ++msgqueue_stats[entry->priority].preempted;
+    }
+    HwiP_restore(key);
+
+    msgqueue_release(&evicted);
+
+    return status;
+}
+
+/* take the most urgent message off the queue
+ * @param entry -> receives the message
+ * @param now -> the current tick; a message's wait ends when first popped
+ * @return -> 1 if a message was popped, 0 if the queue is empty */
+int msgqueue_pop(msgqueue_entry *entry, uint32_t now) {
+
+    uintptr_t key = HwiP_disable();
+    volatile msgqueue_stat *stat;
+    uint32_t wait;
+
+    if (heap_len == 0) {
+        HwiP_restore(key);
+        return 0;
+    }
+
+    *entry = pool[heap[0]];
+    free_slots[free_len++] = heap[0];
+    if (--heap_len > 0) {
+        heap[0] = heap[heap_len];
+        sift_down(0);
+    }
+
+    if (entry->resume_index == 0) {
+        stat = &msgqueue_stats[entry->priority];
+        wait = now - entry->enqueue_tick;
+        ++stat->started;
+        stat->total_wait += wait;
+        if (wait > stat->max_wait) {
+            stat->max_wait = wait;
+        }
+    }
+    HwiP_restore(key);
+
+    return 1;
+}
+
+/* @return -> the priority of the most urgent waiting message, or -1 if none */
+int msgqueue_top_priority(void) {
+
+    uintptr_t key = HwiP_disable();
+    int priority = heap_len == 0 ? -1 : pool[heap[0]].priority;
+
+    HwiP_restore(key);
+
+    return priority;
+}
+
+/* look for a waiting message with the same text, streamed ones aside; the
+ * queue is only locked while each entry is fetched, so the texts compared
+ * must not change underneath the caller
+ * @param text -> the message to look for
+ * @param priority -> the lowest priority that counts as a match
+ * @return -> 1 if such a message is waiting, 0 if not */
+int msgqueue_find(const char *text, unsigned char priority) {
+
+    const char *waiting;
+    unsigned char waiting_priority, streamed;
+    short unsigned int i;
+    uintptr_t key;
+
+    for (i = 0; ; ++i) {
+        key = HwiP_disable();
+        if (i >= heap_len) {
+            HwiP_restore(key);
+            return 0;
+        }
+        waiting = pool[heap[i]].text;
+        waiting_priority = pool[heap[i]].priority;
+        streamed = pool[heap[i]].rope != NULL;
+        HwiP_restore(key);
+
+        if (!streamed && waiting_priority >= priority && strcmp(waiting, text) == 0) {
+            return 1;
+        }
+    }
+}
+
+/* @return -> the number of messages waiting */
+short unsigned int msgqueue_count(void) {
+
+    return heap_len;
+}
+
+/* print the wait statistics over the console */
+void msgqueue_report(void) {
+
+    static const char *const class_names[MSGQUEUE_NUM_PRIORITIES] = {"routine", "priority", "distress"};
+    short unsigned int i;
+
+    console_printf("queue: %u waiting\r\n", msgqueue_count());
+    for (i = 0; i < MSGQUEUE_NUM_PRIORITIES; ++i) {
+        console_printf("  %-9s in=%-6u dropped=%-4u preempted=%-4u wait mean=%u max=%u ticks\r\n",
+                       class_names[i], msgqueue_stats[i].enqueued, msgqueue_stats[i].dropped,
+                       msgqueue_stats[i].preempted,
+                       msgqueue_stats[i].started ? msgqueue_stats[i].total_wait / msgqueue_stats[i].started : 0,
+                       msgqueue_stats[i].max_wait);
+    }
+}
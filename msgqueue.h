@@ -0,0 +1,70 @@
+/*
+ *  ======== msgqueue.h ========
+ *  PRIORITY QUEUE OF MESSAGES WAITING TO BE KEYED. A BINARY HEAP OVER A
+ *  STATICALLY ALLOCATED POOL GIVES O(log n) PUSH AND POP; MESSAGES OF EQUAL
+ *  PRIORITY COME OUT IN THE ORDER THEY WENT IN. ALL CALLS ARE SAFE FROM
+ *  INTERRUPT CONTEXT.
+ */
+
+#ifndef MSGQUEUE_H
+#define MSGQUEUE_H
+
+#include <stdint.h>
+
+#include "rope.h"
+
+/* number of messages that can wait at once */
+#define MSGQUEUE_LEN 16
+
+/* --- priority classes, most urgent last --- */
+#define MSGQUEUE_ROUTINE        0
+#define MSGQUEUE_PRIORITY       1
+#define MSGQUEUE_DISTRESS       2
+#define MSGQUEUE_NUM_PRIORITIES 3
+
+/* --- status codes --- */
+#define MSGQUEUE_STATUS_SUCCESS (0)
+#define MSGQUEUE_STATUS_ERROR   (-1)
+#define MSGQUEUE_STATUS_FULL    (-2)
+
+/* --- hands a message's text back to wherever it came from --- */
+typedef void (*msgqueue_release_fxn)(const char *text);
+
+/* --- one waiting message; the text is not copied and must stay put
+ * until release is called with it. A streamed message has its text in a
+ * rope instead, and the text is only its name --- */
+typedef struct {
+    const char *text;
+    msgqueue_release_fxn release;       /* NULL for static text */
+    rope *rope;                         /* NULL unless streamed */
+    unsigned char priority;
+    uint32_t resume_index;              /* character to carry on from */
+    uint32_t sequence;                  /* arrival order, for ties */
+    uint32_t enqueue_tick;
+} msgqueue_entry;
+
+/* --- wait from enqueue to first keyed tick, per priority class --- */
+typedef struct {
+    uint32_t enqueued;
+    uint32_t dropped;
+    uint32_t started;
+    uint32_t preempted;
+    uint32_t total_wait;                /* ticks */
+    uint32_t max_wait;
+} msgqueue_stat;
+
+extern volatile msgqueue_stat msgqueue_stats[MSGQUEUE_NUM_PRIORITIES];
+
+/* function prototypes */
+void msgqueue_init(void);
+int msgqueue_push(const char *text, unsigned char priority, uint32_t now, msgqueue_release_fxn release);
+int msgqueue_push_rope(rope *r, unsigned char priority, uint32_t now);
+void msgqueue_release(const msgqueue_entry *entry);
+int msgqueue_requeue(const msgqueue_entry *entry);
+int msgqueue_pop(msgqueue_entry *entry, uint32_t now);
+int msgqueue_top_priority(void);
+int msgqueue_find(const char *text, unsigned char priority);
+short unsigned int msgqueue_count(void);
+void msgqueue_report(void);
+
+#endif /* MSGQUEUE_H */
@@ -0,0 +1,528 @@
+/*
+ *  ======== msgstore.c ========
+ *  PERSISTENT INDEXED MESSAGE STORE IN SERIAL FLASH.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "console.h"
+#include "msgstore.h"
+#include "timeline.h"
+
+#if MORSE_STORE || defined(MORSE_HOST)
+
+#if defined(MORSE_HOST)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <ti/drivers/net/wifi/simplelink.h>
+#endif
+
+#define INDEX_LEN   (MSGSTORE_SEGMENT_ENTRIES * 4)
+
+msgstore_stat msgstore_stats;
+
+/* the last segment, which is the only one appended to; it is also where
+ * lookups of its entries are served from */
+static uint8_t tail[MSGSTORE_SEGMENT_LEN];
+static uint32_t tail_segment = 0;
+
+/* where the store lives: a file on the host, a directory on target */
+static char store_path[48];
+static unsigned char store_open = 0;
+
+#if defined(MORSE_HOST)
+static int fd = -1;
+#else
+/* the segment last read from, kept open since lookups tend to come in runs */
+static int32_t read_fd = -1;
+static uint32_t read_fd_segment = 0;
+#endif
+
+static uint16_t read_u16(const uint8_t *from) {
+
+    return (uint16_t)(from[0] | (from[1] << 8));
+}
+
+static uint32_t read_u32(const uint8_t *from) {
+
+    return (uint32_t)from[0] | ((uint32_t)from[1] << 8) |
+           ((uint32_t)from[2] << 16) | ((uint32_t)from[3] << 24);
+}
+
+static void write_u16(uint8_t *to, uint16_t value) {
+
+    to[0] = (uint8_t)value;
+    to[1] = (uint8_t)(value >> 8);
+}
+
+static void write_u32(uint8_t *to, uint32_t value) {
+
+    to[0] = (uint8_t)value;
+    to[1] = (uint8_t)(value >> 8);
+    to[2] = (uint8_t)(value >> 16);
+    to[3] = (uint8_t)(value >> 24);
+}
+
+/* --- the file system underneath: whole segments are written, and any
+ * part of one can be read --- */
+
+#if !defined(MORSE_HOST)
+static void segment_name(char *name, size_t size, uint32_t segment) {
+
+    snprintf(name, size, "%s/%lu", store_path, (unsigned long)segment);
+}
+
+static void close_read_fd(void) {
+
+    if (read_fd >= 0) {
+        sl_FsClose(read_fd, NULL, NULL, 0);
+        read_fd = -1;
+    }
+}
+#endif
+
+/* @return -> MSGSTORE_STATUS_SUCCESS, or MSGSTORE_STATUS_ERROR if the
+ *            bytes could not all be read */
+static int read_segment(uint32_t segment, uint32_t offset, void *into, size_t length) {
+
+#if defined(MORSE_HOST)
+    off_t at = (off_t)segment * MSGSTORE_SEGMENT_LEN + offset;
+
+    if (pread(fd, into, length, at) != (ssize_t)length) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+#else
+    char name[sizeof(store_path) + 12];
+    uint32_t token = 0;
+
+    if (read_fd < 0 || read_fd_segment != segment) {
+        close_read_fd();
+        segment_name(name, sizeof(name), segment);
+        read_fd = sl_FsOpen((const uint8_t *)name, SL_FS_READ, &token);
+        if (read_fd < 0) {
+            return MSGSTORE_STATUS_ERROR;
+        }
+        read_fd_segment = segment;
+    }
+    if (sl_FsRead(read_fd, offset, (uint8_t *)into, length) != (int32_t)length) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+#endif
+
+    return MSGSTORE_STATUS_SUCCESS;
+}
+
+/* replace a segment with the first length bytes of from */
+static int write_segment(uint32_t segment, const uint8_t *from, size_t length) {
+
+#if defined(MORSE_HOST)
+    off_t at = (off_t)segment * MSGSTORE_SEGMENT_LEN;
+
+    if (pwrite(fd, from, length, at) != (ssize_t)length) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+#else
+    char name[sizeof(store_path) + 12];
+    uint32_t token = 0;
+    int32_t write_fd;
+    int32_t written;
+
+    if (read_fd_segment == segment) {
+        close_read_fd();
+    }
+    segment_name(name, sizeof(name), segment);
+    write_fd = sl_FsOpen((const uint8_t *)name,
+                         SL_FS_CREATE | SL_FS_OVERWRITE | SL_FS_CREATE_MAX_SIZE(MSGSTORE_SEGMENT_LEN),
+                         &token);
+    if (write_fd < 0) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+    written = sl_FsWrite(write_fd, 0, (uint8_t *)from, length);
+    if (sl_FsClose(write_fd, NULL, NULL, 0) != 0 || written != (int32_t)length) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+#endif
+
+    ++msgstore_stats.segment_writes;
+    msgstore_stats.bytes_written += length;
+
+    return MSGSTORE_STATUS_SUCCESS;
+}
+
+/* @return -> MSGSTORE_STATUS_SUCCESS if the header is one of ours for this segment */
+static int check_header(const uint8_t *header) {
+
+    if (header[0] != 'M' || header[1] != 'S' || header[2] != 'G' || header[3] != MSGSTORE_VERSION ||
+        read_u16(&header[4]) > MSGSTORE_SEGMENT_ENTRIES ||
+        read_u32(&header[8]) < MSGSTORE_HEADER_LEN + INDEX_LEN ||
+        read_u32(&header[8]) > MSGSTORE_SEGMENT_LEN) {
+        return MSGSTORE_STATUS_CORRUPT;
+    }
+    return MSGSTORE_STATUS_SUCCESS;
+}
+
+/* @return -> how many segments the store has */
+static uint32_t count_segments(void) {
+
+#if defined(MORSE_HOST)
+    struct stat info;
+
+    if (fstat(fd, &info) != 0) {
+        return 0;
+    }
+    return (uint32_t)((info.st_size + MSGSTORE_SEGMENT_LEN - 1) / MSGSTORE_SEGMENT_LEN);
+#else
+    char name[sizeof(store_path) + 8];
+    uint8_t header[MSGSTORE_HEADER_LEN];
+    uint8_t count[4];
+    uint32_t segments = 0;
+    uint32_t token = 0;
+    int32_t meta_fd;
+
+    snprintf(name, sizeof(name), "%s/meta", store_path);
+    meta_fd = sl_FsOpen((const uint8_t *)name, SL_FS_READ, &token);
+    if (meta_fd >= 0) {
+        if (sl_FsRead(meta_fd, 0, count, sizeof(count)) == sizeof(count)) {
+            segments = read_u32(count);
+        }
+        sl_FsClose(meta_fd, NULL, NULL, 0);
+    }
+
+    /* a segment may have been started without the count catching up */
+    if (read_segment(segments, 0, header, sizeof(header)) == MSGSTORE_STATUS_SUCCESS &&
+        check_header(header) == MSGSTORE_STATUS_SUCCESS) {
+        ++segments;
+    }
+    return segments;
+#endif
+}
+
+/* record how many segments there are, after a new one has been written */
+static int write_count(uint32_t segments) {
+
+#if defined(MORSE_HOST)
+    /* the file's length says as much */
+    (void)segments;
+    return MSGSTORE_STATUS_SUCCESS;
+#else
+    char name[sizeof(store_path) + 8];
+    uint8_t count[4];
+    uint32_t token = 0;
+    int32_t meta_fd;
+    int32_t written;
+
+    snprintf(name, sizeof(name), "%s/meta", store_path);
+    meta_fd = sl_FsOpen((const uint8_t *)name,
+                        SL_FS_CREATE | SL_FS_OVERWRITE | SL_FS_CREATE_MAX_SIZE(sizeof(count)),
+                        &token);
+    if (meta_fd < 0) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+    write_u32(count, segments);
+    written = sl_FsWrite(meta_fd, 0, count, sizeof(count));
+    if (sl_FsClose(meta_fd, NULL, NULL, 0) != 0 || written != sizeof(count)) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+    return MSGSTORE_STATUS_SUCCESS;
+#endif
+}
+
+/* --- the store itself --- */
+
+/* make tail an empty segment following on from entries earlier ones */
+static void start_segment(uint32_t segment, uint32_t base) {
+
+    memset(tail, 0, MSGSTORE_HEADER_LEN + INDEX_LEN);
+    tail[0] = 'M';
+    tail[1] = 'S';
+    tail[2] = 'G';
+    tail[3] = MSGSTORE_VERSION;
+    write_u32(&tail[8], MSGSTORE_HEADER_LEN + INDEX_LEN);
+    write_u32(&tail[12], base);
+    tail_segment = segment;
+}
+
+/* open the store, creating it if there is none; on target this starts the
+ * network processor, so sl_Task() must already be running
+ * @param path -> the file on the host, or the directory on target
+ * @return -> MSGSTORE_STATUS_SUCCESS, or a negative status */
+int msgstore_open(const char *path) {
+
+    uint32_t segments;
+    uint32_t used;
+
+    memset(&msgstore_stats, 0, sizeof(msgstore_stats));
+    snprintf(store_path, sizeof(store_path), "%s", path);
+
+#if defined(MORSE_HOST)
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+#else
+    int16_t role = sl_Start(NULL, NULL, NULL);
+
+    if (role < 0 && role != SL_RET_CODE_DEV_ALREADY_STARTED) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+#endif
+    store_open = 1;
+
+    segments = count_segments();
+    if (segments == 0) {
+        start_segment(0, 0);
+    }
+    else {
+        /* bring the last segment into RAM, header first to learn its length */
+        tail_segment = segments - 1;
+        if (read_segment(tail_segment, 0, tail, MSGSTORE_HEADER_LEN) != MSGSTORE_STATUS_SUCCESS ||
+            check_header(tail) != MSGSTORE_STATUS_SUCCESS) {
+            msgstore_close();
+            return MSGSTORE_STATUS_CORRUPT;
+        }
+        used = read_u32(&tail[8]);
+        if (read_segment(tail_segment, MSGSTORE_HEADER_LEN, &tail[MSGSTORE_HEADER_LEN],
+                         used - MSGSTORE_HEADER_LEN) != MSGSTORE_STATUS_SUCCESS) {
+            msgstore_close();
+            return MSGSTORE_STATUS_CORRUPT;
+        }
+    }
+
+    msgstore_stats.segments = segments;
+    msgstore_stats.entries = read_u32(&tail[12]) + read_u16(&tail[4]);
+
+    return MSGSTORE_STATUS_SUCCESS;
+}
+
+/* write a record for text, and its timeline, into the rest of the tail
+ * @return -> the record's length, or MSGSTORE_STATUS_NO_SPACE */
+static int build_record(const char *text, size_t text_len, uint32_t unit_us) {
+
+    uint32_t used = read_u32(&tail[8]);
+    uint8_t *record = &tail[used];
+    size_t image_at = MSGSTORE_RECORD_HEADER_LEN + text_len + 1;
+    timeline_writer writer;
+    int image_len;
+
+    if (read_u16(&tail[4]) == MSGSTORE_SEGMENT_ENTRIES || used + image_at > MSGSTORE_SEGMENT_LEN) {
+        return MSGSTORE_STATUS_NO_SPACE;
+    }
+
+    /* the timeline is encoded straight into its place in the record */
+    timeline_writer_init(&writer, &record[image_at], MSGSTORE_SEGMENT_LEN - used - image_at, 2);
+    if (timeline_encode_message(&writer, text) != TIMELINE_STATUS_SUCCESS) {
+        return MSGSTORE_STATUS_NO_SPACE;
+    }
+    image_len = timeline_writer_finish(&writer, unit_us);
+    if (image_len < 0) {
+        return MSGSTORE_STATUS_NO_SPACE;
+    }
+
+    write_u16(&record[0], (uint16_t)text_len);
+    write_u16(&record[2], (uint16_t)image_len);
+    memcpy(&record[MSGSTORE_RECORD_HEADER_LEN], text, text_len + 1);
+
+    return (int)(image_at + (size_t)image_len);
+}
+
+/* add a message, with its timeline precompiled at unit_us per unit, and
+ * write it through to flash before returning
+ * @return -> the new entry's ID, or a negative status */
+int32_t msgstore_append(const char *text, uint32_t unit_us) {
+
+    size_t text_len = strlen(text);
+    uint16_t entries;
+    uint32_t used;
+    int record_len;
+
+    if (!store_open) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+    if (text_len > MSGSTORE_TEXT_LEN) {
+        return MSGSTORE_STATUS_NO_SPACE;
+    }
+
+    record_len = build_record(text, text_len, unit_us);
+    if (record_len == MSGSTORE_STATUS_NO_SPACE && read_u16(&tail[4]) != 0) {
+        /* the tail is full and already on flash: move on to a new one */
+        start_segment(tail_segment + 1, read_u32(&tail[12]) + read_u16(&tail[4]));
+        record_len = build_record(text, text_len, unit_us);
+    }
+    if (record_len < 0) {
+        return record_len;
+    }
+
+    entries = read_u16(&tail[4]);
+    used = read_u32(&tail[8]);
+    write_u32(&tail[MSGSTORE_HEADER_LEN + entries * 4], used);
+    write_u16(&tail[4], (uint16_t)(entries + 1));
+    write_u32(&tail[8], used + (uint32_t)record_len);
+
+    if (write_segment(tail_segment, tail, used + (uint32_t)record_len) != MSGSTORE_STATUS_SUCCESS) {
+        /* forget the entry, leaving the tail as it is on flash */
+        write_u32(&tail[MSGSTORE_HEADER_LEN + entries * 4], 0);
+        write_u16(&tail[4], entries);
+        write_u32(&tail[8], used);
+        return MSGSTORE_STATUS_ERROR;
+    }
+
+    /* the first entry of a segment makes it count */
+    if (entries == 0) {
+        msgstore_stats.segments = tail_segment + 1;
+        if (write_count(msgstore_stats.segments) != MSGSTORE_STATUS_SUCCESS) {
+            return MSGSTORE_STATUS_ERROR;
+        }
+    }
+
+    ++msgstore_stats.entries;
+    ++msgstore_stats.appends;
+
+    return (int32_t)(tail_segment * MSGSTORE_SEGMENT_ENTRIES + entries);
+}
+
+/* --- where a record is, and how long its parts are --- */
+typedef struct {
+    uint32_t segment;
+    uint32_t offset;
+    size_t text_len;
+    size_t image_len;
+} record_place;
+
+/* find an entry's record by ID, reading only its index word and the
+ * record's own header
+ * @param record -> filled in with the record's segment, offset and lengths
+ * @return -> MSGSTORE_STATUS_SUCCESS, or a negative status */
+static int find_record(int32_t id, record_place *record) {
+
+    uint32_t slot;
+    uint8_t word[MSGSTORE_RECORD_HEADER_LEN];
+    const uint8_t *header;
+
+    if (!store_open || id < 0) {
+        return MSGSTORE_STATUS_NOT_FOUND;
+    }
+    record->segment = (uint32_t)id / MSGSTORE_SEGMENT_ENTRIES;
+    slot = (uint32_t)id % MSGSTORE_SEGMENT_ENTRIES;
+    if (record->segment > tail_segment) {
+        return MSGSTORE_STATUS_NOT_FOUND;
+    }
+    ++msgstore_stats.lookups;
+
+    if (record->segment == tail_segment) {
+        if (slot >= read_u16(&tail[4])) {
+            return MSGSTORE_STATUS_NOT_FOUND;
+        }
+        record->offset = read_u32(&tail[MSGSTORE_HEADER_LEN + slot * 4]);
+        header = &tail[record->offset];
+    }
+    else {
+        if (read_segment(record->segment, MSGSTORE_HEADER_LEN + slot * 4, word, 4) != MSGSTORE_STATUS_SUCCESS) {
+            return MSGSTORE_STATUS_ERROR;
+        }
+        record->offset = read_u32(word);
+        if (record->offset == 0) {
+            return MSGSTORE_STATUS_NOT_FOUND;
+        }
+        if (record->offset > MSGSTORE_SEGMENT_LEN - MSGSTORE_RECORD_HEADER_LEN ||
+            read_segment(record->segment, record->offset, word, MSGSTORE_RECORD_HEADER_LEN) != MSGSTORE_STATUS_SUCCESS) {
+            return MSGSTORE_STATUS_CORRUPT;
+        }
+        header = word;
+    }
+
+    record->text_len = read_u16(&header[0]);
+    record->image_len = read_u16(&header[2]);
+    if (record->offset + MSGSTORE_RECORD_HEADER_LEN + record->text_len + 1 + record->image_len > MSGSTORE_SEGMENT_LEN) {
+        return MSGSTORE_STATUS_CORRUPT;
+    }
+    return MSGSTORE_STATUS_SUCCESS;
+}
+
+/* copy the first length bytes past a record's header, at least the
+ * text and its NUL, into buffer */
+static int read_record(const record_place *record, uint8_t *buffer, size_t length) {
+
+    uint32_t at = record->offset + MSGSTORE_RECORD_HEADER_LEN;
+
+    if (record->segment == tail_segment) {
+        memcpy(buffer, &tail[at], length);
+    }
+    else if (read_segment(record->segment, at, buffer, length) != MSGSTORE_STATUS_SUCCESS) {
+        return MSGSTORE_STATUS_ERROR;
+    }
+    return buffer[record->text_len] == '\0' ? MSGSTORE_STATUS_SUCCESS : MSGSTORE_STATUS_CORRUPT;
+}
+
+/* look an entry up by ID
+ * @param entry -> filled in with pointers into buffer
+ * @param buffer -> where the text and timeline are read to
+ * @param capacity -> size of buffer; MSGSTORE_SEGMENT_LEN always suffices
+ * @return -> MSGSTORE_STATUS_SUCCESS, or a negative status */
+int msgstore_get(int32_t id, msgstore_entry *entry, uint8_t *buffer, size_t capacity) {
+
+    record_place record;
+    int status = find_record(id, &record);
+
+    if (status != MSGSTORE_STATUS_SUCCESS) {
+        return status;
+    }
+    if (record.text_len + 1 + record.image_len > capacity) {
+        return MSGSTORE_STATUS_NO_SPACE;
+    }
+    status = read_record(&record, buffer, record.text_len + 1 + record.image_len);
+    if (status != MSGSTORE_STATUS_SUCCESS) {
+        return status;
+    }
+
+    entry->text = (const char *)buffer;
+    entry->image = &buffer[record.text_len + 1];
+    entry->image_len = record.image_len;
+
+    return MSGSTORE_STATUS_SUCCESS;
+}
+
+/* look up just the text of an entry, leaving its timeline behind
+ * @param capacity -> size of text; MSGSTORE_TEXT_LEN + 1 always suffices
+ * @return -> MSGSTORE_STATUS_SUCCESS, or a negative status */
+int msgstore_get_text(int32_t id, char *text, size_t capacity) {
+
+    record_place record;
+    int status = find_record(id, &record);
+
+    if (status != MSGSTORE_STATUS_SUCCESS) {
+        return status;
+    }
+    if (record.text_len + 1 > capacity) {
+        return MSGSTORE_STATUS_NO_SPACE;
+    }
+    return read_record(&record, (uint8_t *)text, record.text_len + 1);
+}
+
+/* print the totals over the console */
+void msgstore_report(void) {
+
+    console_printf("store: %u entries in %u segments, %u appends, %u lookups, %u segment writes (%u bytes)\r\n",
+                   msgstore_stats.entries, msgstore_stats.segments, msgstore_stats.appends,
+                   msgstore_stats.lookups, msgstore_stats.segment_writes, msgstore_stats.bytes_written);
+}
+
+/* close the store; everything appended is already on flash */
+void msgstore_close(void) {
+
+#if defined(MORSE_HOST)
+    if (fd >= 0) {
+        close(fd);
+        fd = -1;
+    }
+#else
+    close_read_fd();
+#endif
+    store_open = 0;
+}
+
+#endif /* MORSE_STORE || MORSE_HOST */
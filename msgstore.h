@@ -0,0 +1,102 @@
+/*
+ *  ======== msgstore.h ========
+ *  PERSISTENT STORE OF MESSAGES AND THEIR PRECOMPILED TIMELINES (SEE
+ *  timeline.h), KEPT IN THE CC3220S SERIAL-FLASH FILE SYSTEM. ON THE HOST
+ *  (MORSE_HOST DEFINED) ONE REGULAR FILE STANDS IN FOR THE LOT.
+ *
+ *  The store is a run of segments, each MSGSTORE_SEGMENT_LEN bytes at most
+ *  and holding up to MSGSTORE_SEGMENT_ENTRIES entries. On target each is a
+ *  file of its own, /msgstore/N, with /msgstore/meta holding the number of
+ *  segments; on the host segment N sits at N * MSGSTORE_SEGMENT_LEN in the
+ *  file. A segment is laid out as (little-endian throughout):
+ *
+ *    offset  size  field
+ *    0       3     magic, the bytes 'M' 'S' 'G'
+ *    3       1     version, MSGSTORE_VERSION
+ *    4       2     entries in this segment
+ *    6       2     reserved, zero
+ *    8       4     used, bytes of the segment in use, this header included
+ *    12      4     base, entries in all the segments before this one
+ *    16      4*E   index: offset of each entry's record, 0 for none
+ *    ...           records
+ *
+ *  and each record is
+ *
+ *    0       2     text length, not counting the NUL
+ *    2       2     timeline image length
+ *    4       ...   the text, NUL-terminated, then the image
+ *
+ *  An entry's ID is its segment number times MSGSTORE_SEGMENT_ENTRIES plus
+ *  its slot, so a lookup goes straight to one index word and one record
+ *  without scanning. When a record will not fit in the rest of a segment
+ *  the next one is started, and the slots left in the old one are never
+ *  used: IDs are unique and increasing, but need not be consecutive.
+ *
+ *  A serial-flash file cannot be appended to in place: opening one to
+ *  write starts it afresh. So the last segment, the only one that changes,
+ *  is kept in RAM and written out whole on every append, which costs the
+ *  same however large the store grows; full segments are never written
+ *  again. The store is not thread-safe: open and use it from one thread.
+ */
+
+#ifndef MSGSTORE_H
+#define MSGSTORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* set MORSE_STORE to 1, in an RTOS build linked with the SimpleLink host
+ * driver, to keep messages in the store (see the console's store command) */
+#ifndef MORSE_STORE
+#define MORSE_STORE 0
+#endif
+
+/* where the store lives on target: a directory in the file system */
+#define MSGSTORE_PATH               "/msgstore"
+
+#define MSGSTORE_VERSION            1
+#define MSGSTORE_HEADER_LEN         16
+#define MSGSTORE_RECORD_HEADER_LEN  4
+
+/* one serial-flash block per segment */
+#define MSGSTORE_SEGMENT_LEN        4096
+#define MSGSTORE_SEGMENT_ENTRIES    32
+
+/* longest text that can be stored, not counting the NUL */
+#define MSGSTORE_TEXT_LEN           127
+
+/* --- status codes --- */
+#define MSGSTORE_STATUS_SUCCESS     (0)
+#define MSGSTORE_STATUS_ERROR       (-1)
+#define MSGSTORE_STATUS_NOT_FOUND   (-2)
+#define MSGSTORE_STATUS_NO_SPACE    (-3)
+#define MSGSTORE_STATUS_CORRUPT     (-4)
+
+/* --- one entry, as read back by msgstore_get() --- */
+typedef struct {
+    const char *text;
+    const uint8_t *image;
+    size_t image_len;
+} msgstore_entry;
+
+/* --- running totals since msgstore_open() --- */
+typedef struct {
+    uint32_t entries;               /* in the store */
+    uint32_t segments;              /* in the store */
+    uint32_t appends;
+    uint32_t lookups;
+    uint32_t segment_writes;
+    uint32_t bytes_written;
+} msgstore_stat;
+
+extern msgstore_stat msgstore_stats;
+
+/* function prototypes */
+int msgstore_open(const char *path);
+int32_t msgstore_append(const char *text, uint32_t unit_us);
+int msgstore_get(int32_t id, msgstore_entry *entry, uint8_t *buffer, size_t capacity);
+int msgstore_get_text(int32_t id, char *text, size_t capacity);
+void msgstore_report(void);
+void msgstore_close(void);
+
+#endif /* MSGSTORE_H */
@@ -0,0 +1,308 @@
+/*
+ *  ======== optical.c ========
+ *  OPTICAL RECEIVER: PHOTODIODE SAMPLES TO MARKS AND SPACES TO TEXT.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "console.h"
+#include "decoder.h"
+#include "optical.h"
+#include "profile.h"
+
+#if MORSE_OPTICAL_RX || defined(MORSE_HOST)
+
+#if !defined(MORSE_HOST)
+#include <ti/drivers/ADCBuf.h>
+
+#include "ti_drivers_config.h"
+#endif
+
+/* the envelope jumps half way to a new extreme at once */
+#define ATTACK_SHIFT    1
+
+/* follows daylight, or the LED's swing above it, over 2^TRACK_SHIFT
+ * levels, ~130 ms, quick beside daylight changing */
+#define TRACK_SHIFT     7
+
+/* and lets the swing fade over this many units while dark */
+#define DECAY_UNITS     32
+
+/* a change of level has to last this fraction of a unit to count, which
+ * keeps mains flicker (5 ms a half cycle) out of the gaps */
+#define DEBOUNCE_SHIFT  2
+
+/* the receiver the ADC feeds, and the text it has decoded but not yet
+ * printed; the callback writes text_head, optical_service() text_tail */
+static optical_receiver receiver;
+static char text[64];
+static volatile unsigned char text_head = 0;
+static volatile unsigned char text_tail = 0;
+static volatile uint32_t text_dropped = 0;
+static void (*text_notify)(void) = NULL;
+
+/* start a receiver
+ * @param unit_us -> the sender's expected tick; the decoder follows it from there
+ * @param sample_rate -> samples per second
+ * @param emit -> handed each character decoded */
+void optical_init(optical_receiver *receiver, uint32_t unit_us, uint32_t sample_rate,
+                  decoder_emit_fxn emit) {
+
+    uint32_t unit = (uint32_t)((uint64_t)unit_us * sample_rate / OPTICAL_DECIMATION / 1000000);
+
+    receiver->sum = 0;
+    receiver->summed = 0;
+    receiver->newest = 0;
+    receiver->dark = 0;
+    receiver->swing = 0;
+    receiver->lit = 0;
+    receiver->started = 0;
+    receiver->run = 0;
+    receiver->changed = 0;
+    receiver->debounce = unit >> DEBOUNCE_SHIFT;
+    if (receiver->debounce == 0) {
+        receiver->debounce = 1;
+    }
+    receiver->samples = 0;
+    receiver->marks = 0;
+
+    receiver->decay_shift = TRACK_SHIFT;
+    while (receiver->decay_shift < 24 && (1UL << receiver->decay_shift) < unit * DECAY_UNITS) {
+        ++receiver->decay_shift;
+    }
+
+    decoder_init(&receiver->decoder, unit, emit);
+}
+
+/* slice one light level, passing each edge on to the decoder
+ * @param sum -> OPTICAL_DECIMATION samples summed */
+static void slice(optical_receiver *receiver, int32_t sum) {
+
+    int32_t level, above, middle, hysteresis;
+    unsigned char lit, i;
+
+    /* start the moving sum as though the first level had lasted */
+    if (!receiver->started) {
+        for (i = 0; i < OPTICAL_SMOOTHING; ++i) {
+            receiver->levels[i] = sum;
+        }
+        receiver->smoothed = sum * OPTICAL_SMOOTHING;
+        receiver->dark = receiver->smoothed;
+        receiver->started = 1;
+    }
+
+    if (++receiver->newest == OPTICAL_SMOOTHING) {
+        receiver->newest = 0;
+    }
+    receiver->smoothed += sum - receiver->levels[receiver->newest];
+    receiver->levels[receiver->newest] = sum;
+    level = receiver->smoothed;
+
+    middle = receiver->dark + (receiver->swing >> 1);
+    hysteresis = receiver->swing >> 3;
+
+    if (receiver->swing < OPTICAL_MIN_CONTRAST) {
+        lit = 0;
+    }
+    else if (receiver->lit) {
+        lit = level > middle - hysteresis;
+    }
+    else {
+        lit = level > middle + hysteresis;
+    }
+
+    /* the light is daylight, followed while the level reads dark, plus
+     * the LED's swing above it, followed while it reads lit; each jumps to
+     * a new extreme, and the swing fades over the longest gaps */
+    if (level < receiver->dark) {
+        receiver->dark -= (receiver->dark - level) >> ATTACK_SHIFT;
+    }
+    else if (!lit) {
+        receiver->dark += (level - receiver->dark) >> TRACK_SHIFT;
+    }
+    above = level - receiver->dark;
+    if (above > receiver->swing) {
+        receiver->swing += (above - receiver->swing) >> ATTACK_SHIFT;
+    }
+    else if (lit) {
+        receiver->swing -= (receiver->swing - above) >> TRACK_SHIFT;
+    }
+    else {
+        receiver->swing -= receiver->swing >> receiver->decay_shift;
+    }
+
+    /* count levels that disagree with the state up, and those that agree
+     * down, so that flicker riding on the edge cannot hold it off; the
+     * levels since the change began belong to the new state, so both
+     * edges are delayed alike and lengths are left as they were */
+    ++receiver->run;
+    if (lit == receiver->lit) {
+        if (receiver->changed != 0) {
+            --receiver->changed;
+        }
+        if (!lit) {
+            decoder_idle(&receiver->decoder, receiver->run);
+        }
+    }
+    else if (++receiver->changed >= receiver->debounce) {
+        if (lit) {
+            decoder_space(&receiver->decoder, receiver->run - receiver->changed);
+        }
+        else {
+            decoder_mark(&receiver->decoder, receiver->run - receiver->changed);
+            ++receiver->marks;
+        }
+        receiver->lit = lit;
+        receiver->run = receiver->changed;
+        receiver->changed = 0;
+    }
+}
+
+/* work through a run of ADC samples
+ * @param samples -> sample words, as the ADC writes them
+ * @param count -> how many */
+void optical_feed(optical_receiver *receiver, const uint32_t *samples, size_t count) {
+
+    uint32_t sum = receiver->sum;
+    uint32_t summed = receiver->summed;
+    const uint32_t *end = samples + count;
+    const uint32_t *stop;
+
+    receiver->samples += (uint32_t)count;
+    while (samples != end) {
+        stop = samples + (OPTICAL_DECIMATION - summed);
+        if (stop > end) {
+            stop = end;
+        }
+        summed += (uint32_t)(stop - samples);
+
+        /* the only per-sample work */
+        while (samples != stop) {
+            sum += OPTICAL_SAMPLE(*samples++);
+        }
+
+        if (summed == OPTICAL_DECIMATION) {
+            slice(receiver, (int32_t)sum);
+            sum = 0;
+            summed = 0;
+        }
+    }
+    receiver->sum = sum;
+    receiver->summed = summed;
+}
+
+/* decoder output: hold on to it for optical_service() */
+static void keep_text(char character) {
+
+    unsigned char next = (unsigned char)((text_head + 1) % sizeof(text));
+
+    if (next == text_tail) {
+        ++text_dropped;
+        return;
+    }
+    text[text_head] = character;
+    text_head = next;
+}
+
+#if !defined(MORSE_HOST)
+static ADCBuf_Handle adc;
+static ADCBuf_Conversion conversion;
+static uint32_t buffers[2][OPTICAL_BLOCK_LEN];
+
+/* a DMA buffer has been filled; the other is filling meanwhile */
+static void adc_callback(ADCBuf_Handle handle, ADCBuf_Conversion *done,
+                         void *completedADCBuffer, uint32_t completedChannel,
+                         int_fast16_t status) {
+
+    unsigned char head = text_head;
+
+    PROFILE_BEGIN(start);
+
+    optical_feed(&receiver, (const uint32_t *)completedADCBuffer, OPTICAL_BLOCK_LEN);
+
+    /* once a block, not once a character */
+    if (text_head != head && text_notify != NULL) {
+        text_notify();
+    }
+
+    PROFILE_END(PROFILE_OPTICAL_BLOCK, start);
+}
+
+/* start sampling the photodiode
+ * @param unit_us -> the sender's expected tick
+ * @return -> 0 on success, -1 if the ADC could not be started */
+int optical_start(uint32_t unit_us) {
+
+    ADCBuf_Params params;
+
+    optical_init(&receiver, unit_us, OPTICAL_SAMPLE_RATE, keep_text);
+
+    ADCBuf_init();
+    ADCBuf_Params_init(&params);
+    params.returnMode = ADCBuf_RETURN_MODE_CALLBACK;
+    params.recurrenceMode = ADCBuf_RECURRENCE_MODE_CONTINUOUS;
+    params.callbackFxn = adc_callback;
+    params.samplingFrequency = OPTICAL_SAMPLE_RATE;
+
+    adc = ADCBuf_open(CONFIG_ADCBUF_0, &params);
+    if (adc == NULL) {
+        return -1;
+    }
+
+    conversion.adcChannel = CONFIG_ADCBUF_0_CHANNEL_0;
+    conversion.arg = NULL;
+    conversion.sampleBuffer = buffers[0];
+    conversion.sampleBufferTwo = buffers[1];
+    conversion.samplesRequestedCount = OPTICAL_BLOCK_LEN;
+    if (ADCBuf_convert(adc, &conversion, 1) != ADCBuf_STATUS_SUCCESS) {
+        ADCBuf_close(adc);
+        adc = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+#else
+/* the host tools feed a receiver of their own */
+int optical_start(uint32_t unit_us) {
+
+    optical_init(&receiver, unit_us, OPTICAL_SAMPLE_RATE, keep_text);
+    return 0;
+}
+#endif
+
+/* print whatever has been decoded since the last call */
+void optical_service(void) {
+
+    unsigned char head = text_head;
+
+    if (text_tail > head) {
+        console_write(&text[text_tail], sizeof(text) - text_tail);
+        text_tail = 0;
+    }
+    if (text_tail < head) {
+        console_write(&text[text_tail], head - text_tail);
+        text_tail = head;
+    }
+}
+
+/* have a function called, from the ADCBuf callback, whenever a block
+ * has left text waiting for optical_service()
+ * @param notify -> the function, or NULL for none */
+void optical_notify(void (*notify)(void)) {
+
+    text_notify = notify;
+}
+
+/* print the receiver's totals over the console */
+void optical_report(void) {
+
+    console_printf("optical: %u samples, %u marks, %u characters, %u unknown, %u dropped; "
+                   "unit %u levels, swing %d\r\n",
+                   receiver.samples, receiver.marks, receiver.decoder.characters,
+                   receiver.decoder.unknown, text_dropped, decoder_unit(&receiver.decoder),
+                   (int)receiver.swing);
+}
+
+#endif /* MORSE_OPTICAL_RX || MORSE_HOST */
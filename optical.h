@@ -0,0 +1,97 @@
+/*
+ *  ======== optical.h ========
+ *  OPTICAL RECEIVER. A PHOTODIODE ON AN ADC CHANNEL IS SAMPLED CONTINUOUSLY
+ *  BY DMA, EACH BUFFER IS BOILED DOWN TO A LIGHT LEVEL EVERY
+ *  OPTICAL_DECIMATION SAMPLES, AND A MOVING SUM OF THOSE LEVELS IS SLICED
+ *  INTO MARKS AND SPACES FOR THE STREAMING DECODER (decoder.h), WHICH
+ *  TURNS THEM BACK INTO TEXT. ON THE HOST (MORSE_HOST DEFINED) optical_feed() IS GIVEN
+ *  RECORDED SAMPLES INSTEAD (SEE host/optical_rx.c).
+ *
+ *  The slicer keeps the daylight level, which it follows over ~130 ms
+ *  while the light reads dark, and how much brighter than that the LED
+ *  makes it, followed likewise while it reads lit; each jumps to a new extreme at
+ *  once, and the swing fades over some 32 units while dark, slow beside
+ *  the longest gap the sender leaves. It switches half way up the swing,
+ *  with hysteresis of an eighth of it either side; a new state has to last
+ *  a quarter of the expected unit to count. Until the swing reaches
+ *  OPTICAL_MIN_CONTRAST it reads dark, so that a steady light,
+ *  noise included, never decodes as anything. All of it is integer
+ *  arithmetic; the only per-sample work is extracting the 12-bit result
+ *  and adding it up.
+ *
+ *  On target the ADC runs at its fixed 62.5 kHz on CONFIG_ADCBUF_0's first
+ *  channel, which SysConfig has to provide (an ADCBuf instance with
+ *  CONFIG_ADCBUF_0_CHANNEL_0 on one of the ADC pins; they read 0-1.46 V).
+ *  The photodiode is wired in photoconductive mode, with a load resistor
+ *  sized to keep the brightest light in that range. Buffers are worked
+ *  through in the ADCBuf callback, in interrupt context, and the decoded
+ *  text is printed on the console from the main loop by optical_service(),
+ *  or under an RTOS by the console thread, which the callback wakes.
+ */
+
+#ifndef OPTICAL_H
+#define OPTICAL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "decoder.h"
+
+/* set MORSE_OPTICAL_RX to 1, with an ADCBuf instance added in SysConfig,
+ * to decode Morse seen by a photodiode and print it on the console */
+#ifndef MORSE_OPTICAL_RX
+#define MORSE_OPTICAL_RX 0
+#endif
+
+/* the CC32xx ADC samples each channel at a fixed rate */
+#define OPTICAL_SAMPLE_RATE     62500
+
+/* samples summed into each light level, so ~1 kHz of levels */
+#define OPTICAL_DECIMATION      64
+
+/* samples per DMA buffer; there are two, filled in turn */
+#define OPTICAL_BLOCK_LEN       256
+
+/* levels in the moving sum the slicer sees: one cycle of 100 Hz mains
+ * flicker, which it all but cancels (120 Hz is cut to a sixth); marks
+ * shorter than this, 10 ms, are lost */
+#define OPTICAL_SMOOTHING       10
+
+/* least difference between the light and dark levels, as the slicer sees
+ * them, that counts as a signal (16 LSB each sample) */
+#define OPTICAL_MIN_CONTRAST    (16 * OPTICAL_DECIMATION * OPTICAL_SMOOTHING)
+
+/* a CC32xx ADC sample is a 32-bit word with the 12-bit result in bits 13:2
+ * and a timestamp above it; host recordings are packed the same way */
+#define OPTICAL_SAMPLE(word)    (((word) >> 2) & 0xFFF)
+
+/* --- receiver state --- */
+typedef struct {
+    uint32_t sum;                   /* of the samples in this level so far */
+    uint32_t summed;                /* how many */
+    int32_t levels[OPTICAL_SMOOTHING];  /* the last few, and their sum */
+    int32_t smoothed;
+    unsigned char newest;
+    int32_t dark;                   /* daylight */
+    int32_t swing;                  /* how much brighter the LED makes it */
+    unsigned char decay_shift;
+    unsigned char lit;              /* what the slicer last decided */
+    unsigned char started;          /* a level has been seen */
+    uint32_t run;                   /* levels since the last edge */
+    uint32_t changed;               /* levels the other state has lasted */
+    uint32_t debounce;              /* levels it has to last to be an edge */
+    morse_decoder decoder;          /* fed in levels */
+    uint32_t samples;               /* running totals */
+    uint32_t marks;
+} optical_receiver;
+
+/* function prototypes */
+void optical_init(optical_receiver *receiver, uint32_t unit_us, uint32_t sample_rate,
+                  decoder_emit_fxn emit);
+void optical_feed(optical_receiver *receiver, const uint32_t *samples, size_t count);
+int optical_start(uint32_t unit_us);
+void optical_service(void);
+void optical_notify(void (*notify)(void));
+void optical_report(void);
+
+#endif /* OPTICAL_H */
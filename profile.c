@@ -0,0 +1,263 @@
+/*
+ *  ======== profile.c ========
+ *  CYCLE-COUNT PROFILING OF THE INTERRUPT HANDLERS AND THE SEQUENCER.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "console.h"
+#include "profile.h"
+
+#if defined(MORSE_HOST)
+#include <time.h>
+#endif
+
+/* --- Cortex-M4 debug registers used to run the cycle counter --- */
+#define DEMCR           (*(volatile uint32_t *)0xE000EDFC)
+#define DEMCR_TRCENA    (1UL << 24)
+#define DWT_CTRL        (*(volatile uint32_t *)0xE0001000)
+#define DWT_CTRL_CYCCNTENA (1UL << 0)
+#define DWT_CYCCNT      (*(volatile uint32_t *)0xE0001004)
+
+/* stats block, one entry per profile_point */
+volatile profile_stat profile_stats[PROFILE_NUM_POINTS];
+
+/* names for profile_report(), in profile_point order */
+static const char *const point_names[PROFILE_NUM_POINTS] = {
+    "timerCallback",
+    "gpioButtonFxn0",
+    "gpioButtonFxn1",
+    "signal_message",
+    "set_leds",
+    "isr to edge",
+    "sequencer wake",
+    "button wake",
+    "optical block",
+};
+
+static const char *const task_names[PROFILE_NUM_TASKS] = {
+    "sequencer",
+    "buttons",
+    "console",
+    "ingest",
+};
+
+/* busy cycles per task, in all and as at the last load report */
+static volatile uint64_t task_busy[PROFILE_NUM_TASKS];
+static uint64_t task_reported[PROFILE_NUM_TASKS];
+static uint32_t window_start = 0;
+
+/* timestamp of the most recent timer ISR entry not yet matched by an edge,
+ * and of the last edge that came with no entry waiting for it */
+static volatile uint32_t isr_entry_time = 0;
+static volatile unsigned char isr_entry_pending = 0;
+static volatile uint32_t edge_time = 0;
+static volatile unsigned char edge_seen = 0;
+
+/* start the cycle counter from zero; touches no RAM, so it is safe to
+ * call before .data and .bss are set up (see boot.c) */
+void profile_start_counter(void) {
+
+#if !defined(MORSE_HOST)
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CYCCNT = 0;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+/* enable the cycle counter, if boot.c has not already, and clear the stats block */
+void profile_init(void) {
+
+#if !defined(MORSE_HOST)
+    if (!(DWT_CTRL & DWT_CTRL_CYCCNTENA)) {
+        profile_start_counter();
+    }
+#endif
+
+    profile_reset();
+}
+
+/* carry the cycle counter on across a deep sleep, which stops it and may
+ * clear it, by restarting it at the count it would have reached
+ * @param count -> what profile_now() would read had it kept counting */
+void profile_resume(uint32_t count) {
+
+#if !defined(MORSE_HOST)
+    DEMCR |= DEMCR_TRCENA;
+    DWT_CYCCNT = count;
+    DWT_CTRL |= DWT_CTRL_CYCCNTENA;
+#endif
+}
+
+/* clear every accumulator */
+void profile_reset(void) {
+
+    short unsigned int i;
+
+    for (i = 0; i < PROFILE_NUM_POINTS; ++i) {
+        profile_stats[i].count = 0;
+        profile_stats[i].min = UINT32_MAX;
+        profile_stats[i].max = 0;
+        profile_stats[i].total = 0;
+    }
+    isr_entry_pending = 0;
+    edge_seen = 0;
+
+    for (i = 0; i < PROFILE_NUM_TASKS; ++i) {
+        task_busy[i] = 0;
+        task_reported[i] = 0;
+    }
+    window_start = profile_now();
+}
+
+/* @return -> the current cycle count (nanoseconds on the host);
+ * wraps every 2^32 counts, so only differences are meaningful */
+uint32_t profile_now(void) {
+
+#if defined(MORSE_HOST)
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)((uint64_t)now.tv_sec * 1000000000ULL + (uint64_t)now.tv_nsec);
+#else
+    return DWT_CYCCNT;
+#endif
+}
+
+/* fold one measurement into a point's accumulator;
+ * each point is only ever recorded from a single context, so no locking
+ * @param point -> the point being measured
+ * @param cycles -> the elapsed cycle count */
+void profile_record(profile_point point, uint32_t cycles) {
+
+    volatile profile_stat *stat = &profile_stats[point];
+
+    ++stat->count;
+    stat->total += cycles;
+    if (cycles < stat->min) {
+        stat->min = cycles;
+    }
+    if (cycles > stat->max) {
+        stat->max = cycles;
+    }
+}
+
+/* @param point -> the point of interest
+ * @return -> the mean cycle count of the point, or 0 if never recorded */
+uint32_t profile_mean(profile_point point) {
+
+    if (profile_stats[point].count == 0) {
+        return 0;
+    }
+    return (uint32_t)(profile_stats[point].total / profile_stats[point].count);
+}
+
+/* note the time at which the timer ISR was entered, which the ISR latches
+ * first thing and records once its edge is out
+ * @param entry_time -> profile_now() as the ISR began
+ * @param written -> 1 if the ISR has written the tick's LEDs already, so
+ *                   that its edge, if it made one, has been seen; 0 if
+ *                   the edge is still to come */
+void profile_mark_isr_entry(uint32_t entry_time, unsigned char written) {
+
+    isr_entry_pending = 0;
+    if (written) {
+        /* an edge from before the entry was some other write's */
+        if (edge_seen && (int32_t)(edge_time - entry_time) >= 0) {
+            profile_record(PROFILE_EDGE_LATENCY, edge_time - entry_time);
+        }
+    }
+    else {
+        isr_entry_time = entry_time;
+        isr_entry_pending = 1;
+    }
+    edge_seen = 0;
+}
+
+/* called just after an LED GPIO has actually changed level; records the
+ * latency from the timer ISR entry that led to it, or if that has yet to
+ * be recorded, the time for profile_mark_isr_entry() */
+void profile_mark_edge(void) {
+
+    uint32_t now = profile_now();
+
+    if (isr_entry_pending) {
+        profile_record(PROFILE_EDGE_LATENCY, now - isr_entry_time);
+        isr_entry_pending = 0;
+    }
+    else {
+        edge_time = now;
+        edge_seen = 1;
+    }
+}
+
+/* print every point that has been recorded over the console */
+void profile_report(void) {
+
+    short unsigned int i;
+
+    console_printf("profile (cycles):\r\n");
+    for (i = 0; i < PROFILE_NUM_POINTS; ++i) {
+        if (profile_stats[i].count != 0) {
+            console_printf("  %-15s n=%-8u min=%-8u mean=%-8u max=%u\r\n", point_names[i],
+                           profile_stats[i].count, profile_stats[i].min,
+                           profile_mean((profile_point)i), profile_stats[i].max);
+        }
+    }
+}
+
+/* add to the cycles a task has spent busy; each task only ever adds to
+ * its own slot
+ * @param task -> the task that did the work
+ * @param cycles -> how long it was busy */
+void profile_task_busy(profile_task task, uint32_t cycles) {
+
+    task_busy[task] += cycles;
+}
+
+/* @param task -> the task of interest
+ * @return -> the cycles it has spent busy since profiling was reset */
+uint64_t profile_task_cycles(profile_task task) {
+
+    return task_busy[task];
+}
+
+/* @return -> the cycles the CPU has spent on anything measured since
+ *            profiling was reset: the timer and button interrupts and
+ *            every task, which never nest in one another */
+uint64_t profile_busy_cycles(void) {
+
+    uint64_t busy = profile_stats[PROFILE_TIMER_CALLBACK].total + profile_stats[PROFILE_BUTTON_FXN0].total +
+                    profile_stats[PROFILE_BUTTON_FXN1].total;
+    short unsigned int i;
+
+    for (i = 0; i < PROFILE_NUM_TASKS; ++i) {
+        busy += task_busy[i];
+    }
+    return busy;
+}
+
+/* print each task's share of the CPU since the last call and start a new
+ * window; windows must be shorter than the 2^32-cycle counter wrap */
+void profile_load_report(void) {
+
+    uint32_t now = profile_now();
+    uint32_t window = now - window_start;
+    uint64_t busy;
+    short unsigned int i;
+
+    if (window == 0) {
+        return;
+    }
+
+    console_printf("load over %u cycles:\r\n", window);
+    for (i = 0; i < PROFILE_NUM_TASKS; ++i) {
+        busy = task_busy[i] - task_reported[i];
+        console_printf("  %-15s %3u.%02u%%\r\n", task_names[i],
+                       (unsigned int)(busy * 100 / window),
+                       (unsigned int)(busy * 10000 / window % 100));
+        task_reported[i] += busy;
+    }
+    window_start = now;
+}
@@ -0,0 +1,96 @@
+/*
+ *  ======== profile.h ========
+ *  CYCLE-COUNT PROFILING OF THE INTERRUPT HANDLERS AND THE SEQUENCER.
+ *  ON TARGET THE COUNTS COME FROM THE CORTEX-M4 DWT CYCLE COUNTER; ON THE
+ *  HOST (MORSE_HOST DEFINED) A MONOTONIC CLOCK IN NANOSECONDS STANDS IN.
+ *
+ *  The results live in profile_stats[], a fixed-size block that can be read
+ *  directly from the debugger's expressions window.
+ */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <stdint.h>
+
+/* profile_now() counts per microsecond: the CC3220S's 80 MHz on target,
+ * nanoseconds on the host */
+#if defined(MORSE_HOST)
+#define PROFILE_COUNTS_PER_US   1000
+#else
+#define PROFILE_COUNTS_PER_US   80
+#endif
+
+/* set MORSE_PROFILE to 0 to compile all instrumentation out */
+#ifndef MORSE_PROFILE
+#define MORSE_PROFILE 1
+#endif
+
+/* --- points being measured, one stats slot each --- */
+typedef enum {
+    PROFILE_TIMER_CALLBACK = 0,
+    PROFILE_BUTTON_FXN0,
+    PROFILE_BUTTON_FXN1,
+    PROFILE_SIGNAL_MESSAGE,
+    PROFILE_SET_LEDS,
+    PROFILE_EDGE_LATENCY,       /* timer ISR entry -> LED GPIO edge */
+    PROFILE_SEQUENCER_WAKE,     /* timer ISR post -> sequencer thread running */
+    PROFILE_BUTTON_WAKE,        /* button ISR post -> button thread running */
+    PROFILE_OPTICAL_BLOCK,      /* one ADC buffer through the optical receiver */
+    PROFILE_NUM_POINTS
+} profile_point;
+
+/* --- units of work whose share of the CPU is measured --- */
+typedef enum {
+    PROFILE_TASK_SEQUENCER = 0,
+    PROFILE_TASK_BUTTONS,
+    PROFILE_TASK_CONSOLE,
+    PROFILE_TASK_INGEST,
+    PROFILE_NUM_TASKS
+} profile_task;
+
+/* --- min/max/mean accumulator for one point --- */
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t max;
+    uint64_t total;
+} profile_stat;
+
+extern volatile profile_stat profile_stats[PROFILE_NUM_POINTS];
+
+/* function prototypes */
+void profile_start_counter(void);
+void profile_init(void);
+void profile_resume(uint32_t count);
+void profile_reset(void);
+uint32_t profile_now(void);
+void profile_record(profile_point point, uint32_t cycles);
+uint32_t profile_mean(profile_point point);
+void profile_mark_isr_entry(uint32_t entry_time, unsigned char written);
+void profile_mark_edge(void);
+void profile_report(void);
+void profile_task_busy(profile_task task, uint32_t cycles);
+uint64_t profile_task_cycles(profile_task task);
+uint64_t profile_busy_cycles(void);
+void profile_load_report(void);
+
+/* --- wrappers so that instrumented code compiles unchanged with profiling off ---
+ * PROFILE_BEGIN(start) declares 'start' and samples the clock,
+ * PROFILE_END(point, start) records the cycles elapsed since then, and
+ * PROFILE_ISR_ENTRY(start, written) takes 'start' as the timer ISR's entry */
+#if MORSE_PROFILE
+#define PROFILE_BEGIN(start)        uint32_t start = profile_now()
+#define PROFILE_END(point, start)   profile_record((point), profile_now() - (start))
+#define PROFILE_ISR_ENTRY(entry, written) profile_mark_isr_entry((entry), (written))
+#define PROFILE_EDGE()              profile_mark_edge()
+#define PROFILE_TASK_END(task, start) profile_task_busy((task), profile_now() - (start))
+#else
+#define PROFILE_BEGIN(start)
+#define PROFILE_END(point, start)
+#define PROFILE_ISR_ENTRY(entry, written)
+#define PROFILE_EDGE()
+#define PROFILE_TASK_END(task, start)
+#endif
+
+#endif /* PROFILE_H */
@@ -0,0 +1,31 @@
+/*
+ *  ======== pt.h ========
+ *  STACKLESS COROUTINES (PROTOTHREADS) BUILT ON A SWITCH STATEMENT.
+ *
+ *  A protothread is a function that can return part way through with
+ *  PT_YIELD() and carry on from the same point on its next call. Only the
+ *  resume point is kept, so locals do not survive a yield: anything needed
+ *  afterwards has to be static. PT_YIELD() cannot be used inside a switch
+ *  statement of its own, nor twice on one source line.
+ */
+
+#ifndef PT_H
+#define PT_H
+
+/* resume point: 0 at the start, otherwise the line last yielded at */
+typedef short unsigned int pt_state;
+
+#define PT_BEGIN(state)     switch (state) { case 0:
+
+#define PT_YIELD(state)     do { (state) = __LINE__; return; case __LINE__:; } while (0)
+
+/* yield for 'ticks' (at least 1) calls in a row; the calls after the first
+ * are used up by PT_HOLDING() at the top of the function, so holding costs
+ * the same whatever the length and needs no resume point of its own */
+#define PT_HOLD(state, counter, ticks)  do { (counter) = (ticks) - 1; PT_YIELD(state); } while (0)
+
+#define PT_HOLDING(counter)     if ((counter) != 0) { --(counter); return; }
+
+#define PT_END(state)       } (state) = 0
+
+#endif /* PT_H */
@@ -0,0 +1,53 @@
+/*
+ *  ======== replay.c ========
+ *  RECORDING OF BUTTON EDGES FOR DETERMINISTIC RE-EXECUTION.
+ */
+
+#include <stdint.h>
+
+#include "replay.h"
+
+volatile replay_event replay_log[REPLAY_LOG_LEN];
+volatile uint32_t replay_head = 0;
+volatile uint32_t replay_tail = 0;
+volatile uint32_t replay_dropped = 0;
+
+/* append an edge to the log; called from the GPIO interrupt only
+ * @param button -> 0 for CONFIG_GPIO_BUTTON_0, 1 for CONFIG_GPIO_BUTTON_1
+ * @param tick -> the tick count at the time of the edge
+ * @param stage -> the main loop position at the time of the edge */
+void replay_record(unsigned char button, uint32_t tick, unsigned char stage) {
+
+    volatile replay_event *event;
+
+    if (replay_head - replay_tail >= REPLAY_LOG_LEN) {
+        ++replay_dropped;
+        return;
+    }
+
+    event = &replay_log[replay_head & (REPLAY_LOG_LEN - 1)];
+    event->tick = tick;
+    event->stage = stage;
+    event->button = button;
+    ++replay_head;
+}
+
+/* take the oldest event off the log; called from thread context only
+ * @param event -> receives the event
+ * @return -> 1 if an event was read, 0 if the log is empty */
+int replay_read(replay_event *event) {
+
+    volatile replay_event *oldest;
+
+    if (replay_tail == replay_head) {
+        return 0;
+    }
+
+    oldest = &replay_log[replay_tail & (REPLAY_LOG_LEN - 1)];
+    event->tick = oldest->tick;
+    event->stage = oldest->stage;
+    event->button = oldest->button;
+    ++replay_tail;
+
+    return 1;
+}
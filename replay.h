@@ -0,0 +1,38 @@
+/*
+ *  ======== replay.h ========
+ *  RECORDING OF BUTTON EDGES SO THAT A RUN CAN BE RE-EXECUTED
+ *  DETERMINISTICALLY BY THE HOST SIMULATOR (host/sim.c).
+ *
+ *  Each edge is stamped with the timer tick it arrived in and with the
+ *  position of the main loop at the time (loop_stage), which together fix
+ *  its effect on message_ended and next_message_index exactly.
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <stdint.h>
+
+/* number of events held; must be a power of two */
+#define REPLAY_LOG_LEN 64
+
+/* --- one recorded button edge --- */
+typedef struct {
+    uint32_t tick;
+    unsigned char stage;
+    unsigned char button;
+} replay_event;
+
+/* ring of recorded events, readable from the debugger; once full, new
+ * events are counted in replay_dropped rather than overwriting old ones,
+ * because a replay has to start from the first edge after reset */
+extern volatile replay_event replay_log[REPLAY_LOG_LEN];
+extern volatile uint32_t replay_head;
+extern volatile uint32_t replay_tail;
+extern volatile uint32_t replay_dropped;
+
+/* function prototypes */
+void replay_record(unsigned char button, uint32_t tick, unsigned char stage);
+int replay_read(replay_event *event);
+
+#endif /* REPLAY_H */
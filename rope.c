@@ -0,0 +1,192 @@
+/*
+ *  ======== rope.c ========
+ *  STREAMED MESSAGES HELD AS A ROPE OF CHUNKS.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "console.h"
+#include "rope.h"
+#include "slab.h"
+
+volatile rope_stat rope_stats;
+
+/* start a rope, empty and open; it must not be live already
+ * @param r -> the rope, which must stay put until rope_release() */
+void rope_open(rope *r) {
+
+    r->head = NULL;
+    r->tail = NULL;
+    r->head_pos = 0;
+    r->tail_len = 0;
+    r->chunks = 0;
+    r->waiting = 0;
+    r->appended = 0;
+    r->live = 1;
+    r->open = 1;
+
+    ++rope_stats.ropes;
+}
+
+/* add text at the tail, as much as fits in the window and the pool
+ * @param text -> the text, with no NUL in it
+ * @param length -> its length in bytes
+ * @return -> the bytes taken from the front of it; fewer than length if
+ *            the window or the pool is full, and none if the rope is closed */
+size_t rope_append(rope *r, const char *text, size_t length) {
+
+    size_t taken = 0, count;
+    rope_chunk *chunk;
+    unsigned char held;
+    uintptr_t key;
+
+    while (taken < length) {
+        key = HwiP_disable();
+        if (!r->open) {
+            HwiP_restore(key);
+            break;
+        }
+
+        /* fill the tail first; until it is full the cursor cannot leave it */
+        if (r->tail != NULL && r->tail_len < ROPE_CHUNK_LEN) {
+            count = ROPE_CHUNK_LEN - r->tail_len;
+            if (count > length - taken) {
+                count = length - taken;
+            }
+            memcpy(&r->tail->text[r->tail_len], &text[taken], count);
+            r->tail_len += (short unsigned int)count;
+            r->appended += (uint32_t)count;
+            HwiP_restore(key);
+            taken += count;
+            continue;
+        }
+        held = r->chunks;
+        HwiP_restore(key);
+
+        /* then a new chunk, filled while it is still the writer's own */
+        if (held >= ROPE_WINDOW || (chunk = slab_alloc(&slab_text)) == NULL) {
+            break;
+        }
+        count = length - taken < ROPE_CHUNK_LEN ? length - taken : ROPE_CHUNK_LEN;
+        memcpy(chunk->text, &text[taken], count);
+        chunk->next = NULL;
+
+        key = HwiP_disable();
+        if (!r->open) {
+            HwiP_restore(key);
+            slab_free(&slab_text, chunk);
+            break;
+        }
+        if (r->tail == NULL) {
+            r->head = chunk;
+            r->head_pos = 0;
+        }
+        else {
+            r->tail->next = chunk;
+        }
+        r->tail = chunk;
+        r->tail_len = (short unsigned int)count;
+        r->appended += (uint32_t)count;
+        if (++r->chunks > rope_stats.max_chunks) {
+            rope_stats.max_chunks = r->chunks;
+        }
+        ++rope_stats.chunks;
+        HwiP_restore(key);
+        taken += count;
+    }
+
+    rope_stats.bytes += (uint32_t)taken;
+    if (taken < length) {
+        ++rope_stats.short_appends;
+    }
+
+    return taken;
+}
+
+/* say that nothing more will be appended: the message ends once the
+ * sequencer has keyed what is there */
+void rope_close(rope *r) {
+
+    r->open = 0;
+}
+
+/* @return -> the character at the cursor; '\0' if the rope is closed and
+ *            all of it has been keyed, or ROPE_WAITING if it is open and
+ *            all of it so far has */
+int rope_peek(rope *r) {
+
+    uintptr_t key = HwiP_disable();
+    int c;
+
+    if (r->head == NULL || (r->head == r->tail && r->head_pos == r->tail_len)) {
+        c = r->open ? ROPE_WAITING : '\0';
+        if (c == ROPE_WAITING && !r->waiting) {
+            r->waiting = 1;
+            ++rope_stats.underruns;
+        }
+    }
+    else {
+        c = (unsigned char)r->head->text[r->head_pos];
+        r->waiting = 0;
+    }
+    HwiP_restore(key);
+
+    return c;
+}
+
+/* move the cursor past the character rope_peek() returned, handing the
+ * chunk it leaves back to the pool */
+void rope_advance(rope *r) {
+
+    rope_chunk *done = NULL;
+    uintptr_t key = HwiP_disable();
+
+    if (r->head != NULL && ++r->head_pos == ROPE_CHUNK_LEN) {
+        done = r->head;
+        r->head = done->next;
+        r->head_pos = 0;
+        if (done == r->tail) {
+            r->tail = NULL;
+            r->tail_len = 0;
+        }
+        --r->chunks;
+    }
+    HwiP_restore(key);
+
+    if (done != NULL) {
+        slab_free(&slab_text, done);
+    }
+}
+
+/* finish with a rope, keyed or not, handing back every chunk it holds;
+ * anything appended afterwards is refused */
+void rope_release(rope *r) {
+
+    uintptr_t key = HwiP_disable();
+    rope_chunk *chunk = r->head, *next;
+
+    r->head = NULL;
+    r->tail = NULL;
+    r->chunks = 0;
+    r->open = 0;
+    r->live = 0;
+    HwiP_restore(key);
+
+    for (; chunk != NULL; chunk = next) {
+        next = chunk->next;
+        slab_free(&slab_text, chunk);
+    }
+}
+
+/* print the totals over the console */
+void rope_report(void) {
+
+    console_printf("rope: %u streams, %u bytes in %u chunks of %u, at most %u of %u held, "
+                   "%u short appends, %u underruns\r\n",
+                   rope_stats.ropes, rope_stats.bytes, rope_stats.chunks, (uint32_t)ROPE_CHUNK_LEN,
+                   rope_stats.max_chunks, ROPE_WINDOW, rope_stats.short_appends, rope_stats.underruns);
+}
@@ -0,0 +1,86 @@
+/*
+ *  ======== rope.h ========
+ *  STREAMED MESSAGES OF ANY LENGTH, HELD AS A ROPE OF FIXED-SIZE CHUNKS
+ *  FROM THE TEXT POOL (SEE slab.h). TEXT IS APPENDED AT THE TAIL WHILE THE
+ *  SEQUENCER KEYS IT FROM THE HEAD, AND EACH CHUNK GOES BACK TO THE POOL
+ *  AS SOON AS THE LAST OF ITS CHARACTERS HAS BEEN KEYED, SO A ROPE NEVER
+ *  HOLDS MORE THAN ROPE_WINDOW CHUNKS HOWEVER LONG THE MESSAGE GROWS.
+ *
+ *  A rope is opened, queued like any other message (msgqueue_push_rope()),
+ *  appended to for as long as it is open, and closed; it ends once it is
+ *  closed and everything appended has been keyed. Should the sequencer
+ *  catch up with the text before then, it keys dark until more arrives,
+ *  giving way meanwhile to anything more urgent. Appending takes what fits
+ *  in the window and says how much that was; the rest can be offered again
+ *  once the sequencer has moved on.
+ *
+ *  One writer and one reader may use a rope at once, from any contexts.
+ *  Interrupts are only held off while a chunk is copied into or linked.
+ */
+
+#ifndef ROPE_H
+#define ROPE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "slab.h"
+
+/* chunks a rope can hold at once: the most text that can be waiting, and
+ * more than the one being keyed so that appending need not wait for it */
+#define ROPE_WINDOW         4
+
+/* text in a chunk, which is a text pool block less its link */
+#define ROPE_CHUNK_LEN      (SLAB_TEXT_LEN - sizeof(void *))
+
+/* from rope_peek(): the rope is open but the cursor has caught up */
+#define ROPE_WAITING        (-1)
+
+/* what a streamed message is called in the statistics */
+#define ROPE_NAME           "(stream)"
+
+/* --- status codes --- */
+#define ROPE_STATUS_SUCCESS (0)
+#define ROPE_STATUS_ERROR   (-1)
+
+/* --- one chunk, a text pool block --- */
+typedef struct rope_chunk_ {
+    struct rope_chunk_ *next;
+    char text[ROPE_CHUNK_LEN];
+} rope_chunk;
+
+/* --- one streamed message --- */
+typedef struct {
+    rope_chunk *head;               /* the chunk the cursor is in */
+    rope_chunk *tail;               /* the chunk being appended to */
+    short unsigned int head_pos;    /* the cursor, within head */
+    short unsigned int tail_len;    /* text in tail */
+    unsigned char chunks;
+    unsigned char waiting;          /* the cursor has caught up with the text */
+    volatile unsigned char open;    /* text may still be appended */
+    volatile unsigned char live;    /* from rope_open() until rope_release() */
+    uint32_t appended;              /* all the text so far */
+} rope;
+
+/* --- running totals over all ropes --- */
+typedef struct {
+    uint32_t ropes;
+    uint32_t bytes;                 /* appended */
+    uint32_t chunks;                /* taken from the pool */
+    uint32_t max_chunks;            /* most held by one rope at once */
+    uint32_t short_appends;         /* appends that did not all fit */
+    uint32_t underruns;             /* times the cursor caught up */
+} rope_stat;
+
+extern volatile rope_stat rope_stats;
+
+/* function prototypes */
+void rope_open(rope *r);
+size_t rope_append(rope *r, const char *text, size_t length);
+void rope_close(rope *r);
+int rope_peek(rope *r);
+void rope_advance(rope *r);
+void rope_release(rope *r);
+void rope_report(void);
+
+#endif /* ROPE_H */
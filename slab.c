@@ -0,0 +1,117 @@
+/*
+ *  ======== slab.c ========
+ *  FIXED-SIZE BLOCK POOLS.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <ti/drivers/dpl/HwiP.h>
+
+#include "console.h"
+#include "slab.h"
+
+#if SLAB_TEXT_LEN % 8 != 0
+#error "slab block lengths must be multiples of 8"
+#endif
+
+slab_pool slab_text;
+
+/* the blocks, as 64-bit words so that any of them can hold a pointer */
+static uint64_t text_blocks[SLAB_TEXT_BLOCKS][SLAB_TEXT_LEN / 8];
+
+/* set up the firmware's pools, all blocks free */
+void slab_init(void) {
+
+    slab_pool_init(&slab_text, "text", text_blocks, SLAB_TEXT_LEN, SLAB_TEXT_BLOCKS);
+}
+
+/* set up a pool over caller-provided blocks, all free
+ * @param name -> what slab_report() calls it
+ * @param blocks -> count blocks of block_len bytes, aligned for a pointer
+ * @param block_len -> bytes in a block, a multiple of a pointer's size */
+void slab_pool_init(slab_pool *pool, const char *name, void *blocks, size_t block_len, short unsigned int count) {
+
+    uintptr_t key = HwiP_disable();
+
+    pool->name = name;
+    pool->blocks = (uint8_t *)blocks;
+    pool->block_len = block_len;
+    pool->count = count;
+    pool->untouched = 0;
+    pool->free_list = NULL;
+    pool->stats.allocs = 0;
+    pool->stats.frees = 0;
+    pool->stats.failures = 0;
+    pool->stats.in_use = 0;
+    pool->stats.high_water = 0;
+
+    HwiP_restore(key);
+}
+
+/* @return -> a block of the pool's block_len bytes, with whatever it last
+ *            held, or NULL if every block is out */
+void *slab_alloc(slab_pool *pool) {
+
+    uintptr_t key = HwiP_disable();
+    void *block = pool->free_list;
+
+    if (block != NULL) {
+        pool->free_list = *(void **)block;
+    }
+    else if (pool->untouched < pool->count) {
+        block = &pool->blocks[(size_t)pool->untouched++ * pool->block_len];
+    }
+    else {
+        ++pool->stats.failures;
+        HwiP_restore(key);
+        return NULL;
+    }
+
+    ++pool->stats.allocs;
+    if (++pool->stats.in_use > pool->stats.high_water) {
+        pool->stats.high_water = pool->stats.in_use;
+    }
+    HwiP_restore(key);
+
+    return block;
+}
+
+/* hand a block back to the pool it came from
+ * @param block -> as returned by slab_alloc() on this pool, and not since freed
+ * @return -> SLAB_STATUS_SUCCESS, or SLAB_STATUS_ERROR if it is not one of
+ *            the pool's blocks, in which case nothing is done */
+int slab_free(slab_pool *pool, void *block) {
+
+    /* below the blocks, the offset wraps round to far beyond them */
+    size_t offset = (size_t)((uintptr_t)block - (uintptr_t)pool->blocks);
+    uintptr_t key;
+
+    if (offset >= (size_t)pool->untouched * pool->block_len || offset % pool->block_len != 0) {
+        return SLAB_STATUS_ERROR;
+    }
+
+    key = HwiP_disable();
+    *(void **)block = pool->free_list;
+    pool->free_list = block;
+    ++pool->stats.frees;
+    --pool->stats.in_use;
+    HwiP_restore(key);
+
+    return SLAB_STATUS_SUCCESS;
+}
+
+static void report_pool(const slab_pool *pool) {
+
+    console_printf("  %-6s %4u x %3u B, %3u in use, high water %3u (%u of %u B), %u allocs %u failed\r\n",
+                   pool->name, pool->count, (uint32_t)pool->block_len, pool->stats.in_use,
+                   pool->stats.high_water, (uint32_t)(pool->stats.high_water * pool->block_len),
+                   (uint32_t)(pool->count * pool->block_len), pool->stats.allocs, pool->stats.failures);
+}
+
+/* print each pool's use over the console */
+void slab_report(void) {
+
+    console_printf("slab:\r\n");
+    report_pool(&slab_text);
+}
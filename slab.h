@@ -0,0 +1,71 @@
+/*
+ *  ======== slab.h ========
+ *  FIXED-SIZE BLOCK POOLS FOR WHAT ARRIVES AT RUN TIME, WHICH IS THE TEXT
+ *  OF QUEUED AND STREAMED MESSAGES. EACH POOL IS A
+ *  STATICALLY ALLOCATED ARRAY OF EQUAL BLOCKS, SO ALLOCATING AND FREEING
+ *  ARE O(1) AND IT CANNOT FRAGMENT. ALL CALLS ARE SAFE FROM INTERRUPT
+ *  CONTEXT.
+ *
+ *  Blocks are handed out from the front of the array until it has all
+ *  been used once, and after that from a list of freed blocks threaded
+ *  through the blocks themselves, so a pool costs no memory beyond its
+ *  blocks and a few words, and starting one costs the same however large
+ *  it is. A pool never grows: when it is empty slab_alloc() fails, and the
+ *  caller says so rather than waiting.
+ *
+ *  Each pool keeps its high-water mark, the most blocks it has ever had
+ *  out at once. Nothing in the firmware uses malloc(), so the linker's heap
+ *  (--heap_size in cc32xxs_nortos.cmd) is only the drivers'; the pools
+ *  were carved out of it. Should a long run show a pool's high water well
+ *  short of its size, SLAB_TEXT_BLOCKS can come down and the space go to
+ *  something else. Timelines compiled at run time (msgstore.c, jitter.c)
+ *  are written into buffers of their own, so there is no pool for them.
+ */
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* message texts: the longest one, counting its NUL, and how many can be
+ * out at once, enough for a full queue, the message being keyed and the
+ * window of a streamed message (see rope.h), which is held in them too */
+#define SLAB_TEXT_LEN       64
+#define SLAB_TEXT_BLOCKS    21
+
+/* --- status codes --- */
+#define SLAB_STATUS_SUCCESS (0)
+#define SLAB_STATUS_ERROR   (-1)
+
+/* --- running totals for one pool --- */
+typedef struct {
+    uint32_t allocs;
+    uint32_t frees;
+    uint32_t failures;              /* allocs refused, the pool being empty */
+    short unsigned int in_use;
+    short unsigned int high_water;  /* most blocks ever out at once */
+} slab_stat;
+
+/* --- one pool; the blocks are the caller's, and must be aligned for a
+ * pointer and a multiple of one in size --- */
+typedef struct {
+    const char *name;
+    uint8_t *blocks;
+    size_t block_len;
+    short unsigned int count;
+    short unsigned int untouched;   /* index of the first block never handed out */
+    void *free_list;
+    slab_stat stats;
+} slab_pool;
+
+extern slab_pool slab_text;
+
+/* function prototypes */
+void slab_init(void);
+void slab_pool_init(slab_pool *pool, const char *name, void *blocks, size_t block_len, short unsigned int count);
+void *slab_alloc(slab_pool *pool);
+int slab_free(slab_pool *pool, void *block);
+void slab_report(void);
+
+#endif /* SLAB_H */
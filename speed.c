@@ -0,0 +1,167 @@
+/*
+ *  ======== speed.c ========
+ *  KEYING SPEED SWEEP.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "console.h"
+#include "profile.h"
+#include "speed.h"
+
+/* firmware entry points, see gpiointerrupt.c */
+extern int set_unit_us(uint32_t unit_us);
+extern uint32_t tick_period_us;
+extern volatile uint32_t tick_overruns;
+extern volatile unsigned int farnsworth_wpm;
+
+/* the periods stepped through, slowest first */
+static const uint32_t ladder[] = { 10000, 5000, 2000, 1000, 500, 200, 100, 50, SPEED_MIN_UNIT_US };
+
+#define NUM_STEPS   (sizeof(ladder) / sizeof(ladder[0]))
+
+/* --- what one step measured --- */
+typedef struct {
+    uint32_t ticks;
+    uint32_t overruns;
+    uint64_t busy;              /* profile_now() counts spent in the work */
+    uint32_t window;            /* and in all */
+} speed_result;
+
+static speed_result results[NUM_STEPS];
+
+/* idle, stepping through ladder[], or done and waiting to be printed */
+#define SWEEP_IDLE      0
+#define SWEEP_RUNNING   1
+#define SWEEP_DONE      2
+
+static volatile unsigned char state = SWEEP_IDLE;
+static unsigned char step;
+static uint32_t step_ticks;
+static uint32_t step_len;
+static uint32_t saved_unit_us;
+static void (*done_notify)(void) = NULL;
+
+/* where the counters stood when the step started */
+static uint32_t start_overruns;
+static uint64_t start_busy;
+static uint32_t start_time;
+
+/* @return -> the cycles the timer interrupt and the sequencer have spent so far */
+static uint64_t busy_cycles(void) {
+
+    return profile_stats[PROFILE_TIMER_CALLBACK].total + profile_task_cycles(PROFILE_TASK_SEQUENCER);
+}
+
+static void start_step(void) {
+
+    set_unit_us(ladder[step]);
+    step_len = SPEED_STEP_US / ladder[step];
+    step_ticks = 0;
+    start_overruns = tick_overruns;
+    start_busy = busy_cycles();
+    start_time = profile_now();
+}
+
+/* start a sweep, which takes some 10 s; the speed goes back to what it
+ * was at the end
+ * @return -> SPEED_STATUS_SUCCESS, or SPEED_STATUS_BUSY if one is under way */
+int speed_start(void) {
+
+    if (state != SWEEP_IDLE) {
+        return SPEED_STATUS_BUSY;
+    }
+    saved_unit_us = tick_period_us;
+    step = 0;
+    start_step();
+    state = SWEEP_RUNNING;
+
+    return SPEED_STATUS_SUCCESS;
+}
+
+/* count one tick, and move on a step when this one is over */
+void speed_tick(void) {
+
+    speed_result *result;
+
+    if (state != SWEEP_RUNNING || ++step_ticks < step_len) {
+        return;
+    }
+
+    result = &results[step];
+    result->ticks = step_ticks;
+    result->overruns = tick_overruns - start_overruns;
+    result->busy = busy_cycles() - start_busy;
+    result->window = profile_now() - start_time;
+
+    if (++step < NUM_STEPS) {
+        start_step();
+    }
+    else {
+        set_unit_us(saved_unit_us);
+        state = SWEEP_DONE;
+        if (done_notify != NULL) {
+            done_notify();
+        }
+    }
+}
+
+/* have a function called, from speed_tick(), when a sweep is over and
+ * waiting for speed_service()
+ * @param notify -> the function, or NULL for none */
+void speed_notify(void (*notify)(void)) {
+
+    done_notify = notify;
+}
+
+/* print the results of a sweep once it has finished */
+void speed_service(void) {
+
+    const speed_result *result;
+    uint32_t fastest = 0;
+    unsigned char clean = 1;
+    unsigned char i;
+#if MORSE_PROFILE
+    uint32_t hundredths;
+#endif
+
+    if (state != SWEEP_DONE) {
+        return;
+    }
+
+    console_printf("speed sweep:\r\n   unit us      wpm    ticks  overruns     load\r\n");
+    for (i = 0; i < NUM_STEPS; ++i) {
+        result = &results[i];
+        console_printf("  %8u %8u %8u  %8u", ladder[i], 1200000 / ladder[i], result->ticks, result->overruns);
+#if MORSE_PROFILE
+        hundredths = result->window == 0 ? 0 : (uint32_t)(result->busy * 10000 / result->window);
+        console_printf("  %3u.%02u%%", hundredths / 100, hundredths % 100);
+#endif
+        console_printf("\r\n");
+        /* the fastest of the unbroken run of steps that kept up */
+        if (result->overruns != 0) {
+            clean = 0;
+        }
+        else if (clean) {
+            fastest = ladder[i];
+        }
+    }
+    if (fastest != 0) {
+        console_printf("  fastest without overruns: %u us, %u wpm\r\n", fastest, 1200000 / fastest);
+    }
+    else {
+        console_printf("  overruns already at %u us\r\n", ladder[0]);
+    }
+    state = SWEEP_IDLE;
+}
+
+/* print the current speed and the ticks overrun so far */
+void speed_report(void) {
+
+    console_printf("speed: %u us per tick, %u wpm", tick_period_us, 1200000 / tick_period_us);
+    if (farnsworth_wpm != 0) {
+        console_printf(" (farnsworth %u wpm)", farnsworth_wpm);
+    }
+    console_printf(", %u ticks overrun%s\r\n", tick_overruns, state == SWEEP_RUNNING ? ", sweep under way" : "");
+}
@@ -0,0 +1,41 @@
+/*
+ *  ======== speed.h ========
+ *  KEYING SPEED LIMITS AND THE SPEED SWEEP. THE SWEEP KEYS FOR A SECOND AT
+ *  EACH OF A LADDER OF TICK PERIODS, FROM 10 MS DOWN TO SPEED_MIN_UNIT_US,
+ *  AND THEN REPORTS FOR EACH HOW MANY TICKS CAME ROUND BEFORE THE LAST
+ *  ONE'S WORK WAS DONE AND WHAT SHARE OF THE CPU THE TIMER INTERRUPT AND
+ *  THE SEQUENCER TOOK, SO THAT THE FASTEST RATE A BUILD CAN KEEP UP WITH
+ *  IS MEASURED ON THE BOARD ITSELF.
+ *
+ *  speed_tick() is called on every tick from sequencer_tick(), in whatever
+ *  context that runs in; it only counts, and moves the timer on to the
+ *  next period when a step is over. The results are printed afterwards by
+ *  speed_service(), from the main loop or, under an RTOS, the console
+ *  thread, which speed_notify() has woken when the sweep ends. The load is only measured with MORSE_PROFILE set; it leaves
+ *  out the Timer driver's own interrupt entry and exit.
+ */
+
+#ifndef SPEED_H
+#define SPEED_H
+
+#include <stdint.h>
+
+/* tick periods set_unit_us() accepts: down to tens of microseconds for
+ * optical and machine-to-machine links, up to 2 s for the slowest hand */
+#define SPEED_MIN_UNIT_US   20
+#define SPEED_MAX_UNIT_US   2000000
+
+/* how long the sweep keys at each period */
+#define SPEED_STEP_US       1000000
+
+#define SPEED_STATUS_SUCCESS    0
+#define SPEED_STATUS_BUSY       (-1)
+
+/* function prototypes */
+int speed_start(void);
+void speed_tick(void);
+void speed_service(void);
+void speed_notify(void (*notify)(void));
+void speed_report(void);
+
+#endif /* SPEED_H */
@@ -0,0 +1,390 @@
+/*
+ *  ======== timeline.c ========
+ *  READER, PLAYER AND WRITER FOR THE BINARY TIMELINE FORMAT DESCRIBED IN
+ *  timeline.h.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "alphabet.h"
+#include "morse.h"
+#include "timeline.h"
+#include "utf8.h"
+
+#if defined(MORSE_HOST)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/* --- little-endian field access --- */
+static uint32_t read_u32(const uint8_t *bytes) {
+
+    return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) |
+           ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+static void write_u32(uint8_t *bytes, uint32_t value) {
+
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+    bytes[2] = (uint8_t)(value >> 16);
+    bytes[3] = (uint8_t)(value >> 24);
+}
+
+/* check an image's header and position a cursor on its first run
+ * @param image -> the start of the image, which is read in place
+ * @param size -> the number of bytes available at image
+ * @param header -> receives the decoded header (may be NULL)
+ * @param cursor -> receives the read position
+ * @return -> TIMELINE_STATUS_SUCCESS or a negative status code */
+int timeline_open(const uint8_t *image, size_t size, timeline_header *header, timeline_cursor *cursor) {
+
+    unsigned char channels;
+
+    if (image == NULL || size < TIMELINE_HEADER_LEN) {
+        return TIMELINE_STATUS_ERROR;
+    }
+    if (image[0] != 'M' || image[1] != 'T' || image[2] != 'L') {
+        return TIMELINE_STATUS_BAD_MAGIC;
+    }
+    if (image[3] != TIMELINE_VERSION) {
+        return TIMELINE_STATUS_BAD_VERSION;
+    }
+
+    channels = image[8];
+    if (channels == 0 || channels > TIMELINE_MAX_CHANNELS) {
+        return TIMELINE_STATUS_ERROR;
+    }
+
+    if (header != NULL) {
+        header->unit_us = read_u32(&image[4]);
+        header->channels = channels;
+        header->run_count = read_u32(&image[12]);
+    }
+
+    cursor->pos = image + TIMELINE_HEADER_LEN;
+    cursor->end = image + size;
+    cursor->runs_left = read_u32(&image[12]);
+    cursor->channels = channels;
+
+    return TIMELINE_STATUS_SUCCESS;
+}
+
+/* read the next run
+ * @param cursor -> the read position, advanced past the run
+ * @param level_mask -> receives the channel levels of the run
+ * @param units -> receives the length of the run
+ * @return -> 1 if a run was read, 0 at the end of the stream,
+ *            or TIMELINE_STATUS_ERROR if the stream is truncated */
+int timeline_next(timeline_cursor *cursor, unsigned char *level_mask, uint32_t *units) {
+
+    uint32_t value = 0;
+    unsigned char shift = 0;
+    uint8_t byte;
+
+    if (cursor->runs_left == 0) {
+        return 0;
+    }
+
+    do {
+        if (cursor->pos >= cursor->end || shift > 28) {
+            return TIMELINE_STATUS_ERROR;
+        }
+        byte = *cursor->pos++;
+        value |= (uint32_t)(byte & 0x7f) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    --cursor->runs_left;
+    *level_mask = (unsigned char)(value & ((1u << cursor->channels) - 1));
+    *units = value >> cursor->channels;
+
+    return 1;
+}
+
+/* prepare a player to step through an image one unit at a time
+ * @return -> TIMELINE_STATUS_SUCCESS or a negative status code */
+int timeline_player_start(timeline_player *player, const uint8_t *image, size_t size) {
+
+    player->level_mask = 0;
+    player->units_left = 0;
+
+    return timeline_open(image, size, NULL, &player->cursor);
+}
+
+/* advance the player by one unit
+ * @param level_mask -> receives the channel levels for this unit
+ * @return -> 1 while playing, 0 once the image has finished */
+int timeline_player_tick(timeline_player *player, unsigned char *level_mask) {
+
+    /* skip any zero-length runs while fetching the next one */
+    while (player->units_left == 0) {
+        if (timeline_next(&player->cursor, &player->level_mask, &player->units_left) != 1) {
+            return 0;
+        }
+    }
+
+    --player->units_left;
+    *level_mask = player->level_mask;
+
+    return 1;
+}
+
+/* start writing an image into a caller-provided buffer; the header is
+ * reserved now and filled in by timeline_writer_finish()
+ * @param channels -> number of output channels the runs describe */
+void timeline_writer_init(timeline_writer *writer, uint8_t *buffer, size_t capacity, unsigned char channels) {
+
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+    writer->length = TIMELINE_HEADER_LEN;
+    writer->run_count = 0;
+    writer->channels = channels;
+    writer->pending_mask = 0;
+    writer->pending_units = 0;
+}
+
+/* append one varint-encoded run to the buffer */
+static int emit_run(timeline_writer *writer, unsigned char level_mask, uint32_t units) {
+
+    uint32_t value = (units << writer->channels) | level_mask;
+
+    do {
+        if (writer->length >= writer->capacity) {
+            return TIMELINE_STATUS_NO_SPACE;
+        }
+        writer->buffer[writer->length++] = (uint8_t)((value & 0x7f) | (value > 0x7f ? 0x80 : 0));
+        value >>= 7;
+    } while (value != 0);
+
+    ++writer->run_count;
+
+    return TIMELINE_STATUS_SUCCESS;
+}
+
+/* add a run, merging it with the previous one if the levels are unchanged
+ * @param level_mask -> the channel levels held for the run
+ * @param units -> the length of the run
+ * @return -> TIMELINE_STATUS_SUCCESS or TIMELINE_STATUS_NO_SPACE */
+int timeline_writer_add(timeline_writer *writer, unsigned char level_mask, uint32_t units) {
+
+    int status;
+
+    if (units == 0) {
+        return TIMELINE_STATUS_SUCCESS;
+    }
+
+    if (writer->pending_units != 0 && writer->pending_mask != level_mask) {
+        status = emit_run(writer, writer->pending_mask, writer->pending_units);
+        if (status != TIMELINE_STATUS_SUCCESS) {
+            return status;
+        }
+        writer->pending_units = 0;
+    }
+
+    writer->pending_mask = level_mask;
+    writer->pending_units += units;
+
+    return TIMELINE_STATUS_SUCCESS;
+}
+
+/* flush the last run and fill in the header
+ * @param unit_us -> duration of one unit in microseconds
+ * @return -> the total image length in bytes, or a negative status code */
+int timeline_writer_finish(timeline_writer *writer, uint32_t unit_us) {
+
+    int status;
+
+    if (writer->pending_units != 0) {
+        status = emit_run(writer, writer->pending_mask, writer->pending_units);
+        if (status != TIMELINE_STATUS_SUCCESS) {
+            return status;
+        }
+        writer->pending_units = 0;
+    }
+
+    if (writer->capacity < TIMELINE_HEADER_LEN) {
+        return TIMELINE_STATUS_NO_SPACE;
+    }
+
+    writer->buffer[0] = 'M';
+    writer->buffer[1] = 'T';
+    writer->buffer[2] = 'L';
+    writer->buffer[3] = TIMELINE_VERSION;
+    write_u32(&writer->buffer[4], unit_us);
+    writer->buffer[8] = writer->channels;
+    writer->buffer[9] = 0;
+    writer->buffer[10] = 0;
+    writer->buffer[11] = 0;
+    write_u32(&writer->buffer[12], writer->run_count);
+
+    return (int)writer->length;
+}
+
+/* the codes of a message a character at a time, as the sequencer reads
+ * them: decoded from UTF-8, and looked up in the alphabet selected
+ * @param message -> advanced past each character
+ * @param mark -> NULL to start with, and then between calls
+ * @return -> the next code, or NULL at the end of the message */
+static const char *next_code(const char **message, utf8_decoder *utf8, const char **mark) {
+
+    const char *code;
+    int32_t code_point;
+
+    /* a voiced kana is keyed as two characters */
+    if (*mark != NULL) {
+        code = *mark;
+        *mark = NULL;
+        return code;
+    }
+    while (**message != '\0') {
+        code_point = utf8_decode(utf8, (uint8_t)*(*message)++);
+        if (code_point != UTF8_MORE) {
+            return alphabet_code((uint32_t)code_point, mark);
+        }
+    }
+
+    return NULL;
+}
+
+/* append one full cycle of a message as signal_message() keys it, one
+ * unit per timer tick, red (bit 0) for dots and green (bit 1) for dashes:
+ *   - a dot or dash is keyed for its length less one tick, then dark for
+ *     one tick plus the tick that advances to the next symbol
+ *   - a space (or unknown character) is dark for word_pause_len + 1 ticks
+ *   - each character ends with character_pause_len + 2 dark ticks
+ *   - the message ends with word_pause_len + 2 dark ticks
+ * or, built with MORSE_PARALLEL, as timeline_encode_parallel() does
+ * @param message -> the NUL-terminated UTF-8 text to encode
+ * @return -> TIMELINE_STATUS_SUCCESS or TIMELINE_STATUS_NO_SPACE */
+int timeline_encode_message(timeline_writer *writer, const char *message) {
+
+    const char *morse, *mark = NULL;
+    utf8_decoder utf8;
+    int status = TIMELINE_STATUS_SUCCESS;
+
+#if MORSE_PARALLEL
+    return timeline_encode_parallel(writer, message);
+#endif
+
+    utf8_reset(&utf8);
+    while (status == TIMELINE_STATUS_SUCCESS && (morse = next_code(&message, &utf8, &mark)) != NULL) {
+        for (; *morse != '\0' && status == TIMELINE_STATUS_SUCCESS; ++morse) {
+            switch (*morse) {
+                case '.':
+                    status = timeline_writer_add(writer, 0b01, dot_len - 1);
+                    if (status == TIMELINE_STATUS_SUCCESS) {
+                        status = timeline_writer_add(writer, 0, 2);
+                    }
+                    break;
+
+                case '-':
+                    status = timeline_writer_add(writer, 0b10, dash_len - 1);
+                    if (status == TIMELINE_STATUS_SUCCESS) {
+                        status = timeline_writer_add(writer, 0, 2);
+                    }
+                    break;
+
+                default:
+                    status = timeline_writer_add(writer, 0, word_pause_len + 1);
+                    break;
+            }
+        }
+        if (status == TIMELINE_STATUS_SUCCESS) {
+            status = timeline_writer_add(writer, 0, character_pause_len + 2);
+        }
+    }
+
+    if (status == TIMELINE_STATUS_SUCCESS) {
+        status = timeline_writer_add(writer, 0, word_pause_len + 2);
+    }
+
+    return status;
+}
+
+/* append one full cycle of a message in the two-LED code (see morse.h):
+ *   - a dot is red, a dash green and a space (or unknown character) both,
+ *     each for one tick and then dark for parallel_symbol_pause_len ticks
+ *   - each character ends with the rest of parallel_character_pause_len
+ *   - the message ends with word_pause_len + 2 dark ticks
+ * @param message -> the NUL-terminated UTF-8 text to encode
+ * @return -> TIMELINE_STATUS_SUCCESS or TIMELINE_STATUS_NO_SPACE */
+int timeline_encode_parallel(timeline_writer *writer, const char *message) {
+
+    const char *morse, *mark = NULL;
+    utf8_decoder utf8;
+    unsigned char level_mask;
+    int status = TIMELINE_STATUS_SUCCESS;
+
+    utf8_reset(&utf8);
+    while (status == TIMELINE_STATUS_SUCCESS && (morse = next_code(&message, &utf8, &mark)) != NULL) {
+        for (; *morse != '\0' && status == TIMELINE_STATUS_SUCCESS; ++morse) {
+            level_mask = (*morse == '.') ? 0b01 : (*morse == '-') ? 0b10 : 0b11;
+            status = timeline_writer_add(writer, level_mask, 1);
+            if (status == TIMELINE_STATUS_SUCCESS) {
+                status = timeline_writer_add(writer, 0, parallel_symbol_pause_len);
+            }
+        }
+        if (status == TIMELINE_STATUS_SUCCESS) {
+            status = timeline_writer_add(writer, 0, parallel_character_pause_len - parallel_symbol_pause_len);
+        }
+    }
+
+    if (status == TIMELINE_STATUS_SUCCESS) {
+        status = timeline_writer_add(writer, 0, word_pause_len + 2);
+    }
+
+    return status;
+}
+
+#if defined(MORSE_HOST)
+/* map an image file read-only so that it can be read in place
+ * @param path -> the file to map
+ * @param image -> receives the start of the mapping
+ * @param size -> receives the length of the file
+ * @return -> TIMELINE_STATUS_SUCCESS or a negative status code */
+int timeline_map(const char *path, const uint8_t **image, size_t *size) {
+
+    struct stat info;
+    timeline_cursor cursor;
+    void *mapping;
+    int status;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return TIMELINE_STATUS_ERROR;
+    }
+    if (fstat(fd, &info) != 0 || info.st_size < TIMELINE_HEADER_LEN) {
+        close(fd);
+        return TIMELINE_STATUS_ERROR;
+    }
+
+    mapping = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        return TIMELINE_STATUS_ERROR;
+    }
+
+    /* refuse files that are not timelines */
+    status = timeline_open((const uint8_t *)mapping, (size_t)info.st_size, NULL, &cursor);
+    if (status != TIMELINE_STATUS_SUCCESS) {
+        munmap(mapping, (size_t)info.st_size);
+        return status;
+    }
+
+    *image = (const uint8_t *)mapping;
+    *size = (size_t)info.st_size;
+
+    return TIMELINE_STATUS_SUCCESS;
+}
+
+/* release a mapping made by timeline_map() */
+void timeline_unmap(const uint8_t *image, size_t size) {
+
+    munmap((void *)image, size);
+}
+#endif
@@ -0,0 +1,97 @@
+/*
+ *  ======== timeline.h ========
+ *  VERSIONED BINARY TIMELINE FORMAT FOR ENCODED MESSAGES, SHARED BY THE
+ *  DEVICE PLAYER AND THE HOST TOOLS.
+ *
+ *  An image is a 16-byte header followed by a stream of varints. All
+ *  multi-byte header fields are little-endian.
+ *
+ *    offset  size  field
+ *    0       3     magic, the bytes 'M' 'T' 'L'
+ *    3       1     version, TIMELINE_VERSION
+ *    4       4     unit_us, duration of one unit in microseconds
+ *    8       1     channels, number of output channels (1 to 4)
+ *    9       3     reserved, must be zero
+ *    12      4     run_count, number of runs in the stream
+ *
+ *  Each run is one unsigned LEB128 varint (7 bits per byte, least
+ *  significant group first, high bit set on every byte but the last):
+ *
+ *    value = (units << channels) | level_mask
+ *
+ *  where bit i of level_mask is 1 while channel i is keyed down and units
+ *  (at least 1) is how long that level is held. With two channels the mask
+ *  is exactly what set_leds() takes: bit 0 red, bit 1 green.
+ *
+ *  Readers walk the stream in place, so an image can be played straight
+ *  out of a const array on the device or an mmap'd file on the host.
+ */
+
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define TIMELINE_VERSION        1
+#define TIMELINE_HEADER_LEN     16
+#define TIMELINE_MAX_CHANNELS   4
+
+/* --- status codes --- */
+#define TIMELINE_STATUS_SUCCESS         (0)
+#define TIMELINE_STATUS_ERROR           (-1)
+#define TIMELINE_STATUS_BAD_MAGIC       (-2)
+#define TIMELINE_STATUS_BAD_VERSION     (-3)
+#define TIMELINE_STATUS_NO_SPACE        (-4)
+
+/* --- decoded header --- */
+typedef struct {
+    uint32_t unit_us;
+    unsigned char channels;
+    uint32_t run_count;
+} timeline_header;
+
+/* --- read position within an image --- */
+typedef struct {
+    const uint8_t *pos;
+    const uint8_t *end;
+    uint32_t runs_left;
+    unsigned char channels;
+} timeline_cursor;
+
+/* --- tick-by-tick player built on a cursor --- */
+typedef struct {
+    timeline_cursor cursor;
+    unsigned char level_mask;
+    uint32_t units_left;
+} timeline_player;
+
+/* --- in-progress image being written into a caller-provided buffer --- */
+typedef struct {
+    uint8_t *buffer;
+    size_t capacity;
+    size_t length;
+    uint32_t run_count;
+    unsigned char channels;
+    unsigned char pending_mask;
+    uint32_t pending_units;
+} timeline_writer;
+
+/* function prototypes */
+int timeline_open(const uint8_t *image, size_t size, timeline_header *header, timeline_cursor *cursor);
+int timeline_next(timeline_cursor *cursor, unsigned char *level_mask, uint32_t *units);
+int timeline_player_start(timeline_player *player, const uint8_t *image, size_t size);
+int timeline_player_tick(timeline_player *player, unsigned char *level_mask);
+
+void timeline_writer_init(timeline_writer *writer, uint8_t *buffer, size_t capacity, unsigned char channels);
+int timeline_writer_add(timeline_writer *writer, unsigned char level_mask, uint32_t units);
+int timeline_writer_finish(timeline_writer *writer, uint32_t unit_us);
+int timeline_encode_message(timeline_writer *writer, const char *message);
+int timeline_encode_parallel(timeline_writer *writer, const char *message);
+
+#if defined(MORSE_HOST)
+int timeline_map(const char *path, const uint8_t **image, size_t *size);
+void timeline_unmap(const uint8_t *image, size_t size);
+#endif
+
+#endif /* TIMELINE_H */
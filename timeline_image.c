@@ -0,0 +1,33 @@
+/*
+ *  ======== timeline_image.c ========
+ *  PRECOMPILED TIMELINES FOR messages[], PLAYED IN PLACE WHEN
+ *  MORSE_PLAY_TIMELINE IS SET. GENERATED BY tools/mtl.c - DO NOT EDIT.
+ */
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* "ss" */
+static const uint8_t timeline_0[28] = {
+    0x4d, 0x54, 0x4c, 0x01, 0x20, 0xa1, 0x07, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x0c, 0x00, 0x00, 0x00, 0x05, 0x08, 0x05, 0x08, 0x05, 0x18, 0x05, 0x08,
+    0x05, 0x08, 0x05, 0x30
+};
+
+/* "oo" */
+static const uint8_t timeline_1[28] = {
+    0x4d, 0x54, 0x4c, 0x01, 0x20, 0xa1, 0x07, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x0c, 0x00, 0x00, 0x00, 0x0e, 0x08, 0x0e, 0x08, 0x0e, 0x18, 0x0e, 0x08,
+    0x0e, 0x08, 0x0e, 0x30
+};
+
+/* "sos" */
+static const uint8_t timeline_2[34] = {
+    0x4d, 0x54, 0x4c, 0x01, 0x20, 0xa1, 0x07, 0x00, 0x02, 0x00, 0x00, 0x00,
+    0x12, 0x00, 0x00, 0x00, 0x05, 0x08, 0x05, 0x08, 0x05, 0x18, 0x0e, 0x08,
+    0x0e, 0x08, 0x0e, 0x18, 0x05, 0x08, 0x05, 0x08, 0x05, 0x30
+};
+
+const uint8_t *const timeline_images[] = {timeline_0, timeline_1, timeline_2};
+
+const size_t timeline_image_sizes[] = {sizeof(timeline_0), sizeof(timeline_1), sizeof(timeline_2)};
@@ -0,0 +1,439 @@
+/*
+ *  ======== alphabet.c ========
+ *  HOST TOOL THAT GENERATES alphabet_tables.c, THE PERFECT-HASH TABLES OF
+ *  THE ALPHABETS IN alphabet.h, FROM THE LETTERS BELOW.
+ *
+ *    alphabet OUT.c
+ *
+ *  For each alphabet it tries a few bucket counts, finds for each the
+ *  fewest slots in which every bucket has a seed placing its code points
+ *  in empty slots, largest buckets first, and keeps whichever takes the
+ *  fewest bytes. Every code point is then looked up again, and every one
+ *  in the blocks around it checked not to be found, before anything is
+ *  written. The search is deterministic, so running it again on the same
+ *  letters gives the same file.
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -I. -o alphabet tools/alphabet.c
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "alphabet.h"
+
+#define MAX_LETTERS     256
+#define MAX_CODES       256
+#define MAX_SLOTS       (2 * MAX_LETTERS)
+#define NUM_SEEDS       256
+
+#define DAKUTEN         ".."
+#define HANDAKUTEN      "..--."
+
+/* --- one code point and what it keys as --- */
+typedef struct {
+    uint16_t code_point;
+    const char *code;
+    const char *mark;
+} letter;
+
+/* --- one alphabet, as it is built up and then hashed --- */
+typedef struct {
+    const char *name;
+    letter letters[MAX_LETTERS];
+    int count;
+    uint8_t seeds[MAX_LETTERS];
+    int buckets;
+    int size;
+    int placed[MAX_SLOTS];          /* index into letters[] for each slot, or -1 */
+} alphabet;
+
+/* --- the base letters; the other forms are added from these --- */
+typedef struct {
+    uint16_t code_point;
+    const char *code;
+} base_letter;
+
+/* Russian, capitals U+0410 to U+042F and U+0401 */
+static const base_letter cyrillic[] = {
+    {0x0410, ".-"}, {0x0411, "-..."}, {0x0412, ".--"}, {0x0413, "--."}, {0x0414, "-.."},
+    {0x0415, "."}, {0x0401, "."}, {0x0416, "...-"}, {0x0417, "--.."}, {0x0418, ".."},
+    {0x0419, ".---"}, {0x041a, "-.-"}, {0x041b, ".-.."}, {0x041c, "--"}, {0x041d, "-."},
+    {0x041e, "---"}, {0x041f, ".--."}, {0x0420, ".-."}, {0x0421, "..."}, {0x0422, "-"},
+    {0x0423, "..-"}, {0x0424, "..-."}, {0x0425, "...."}, {0x0426, "-.-."}, {0x0427, "---."},
+    {0x0428, "----"}, {0x0429, "--.-"}, {0x042a, "--.--"}, {0x042b, "-.--"}, {0x042c, "-..-"},
+    {0x042d, "..-.."}, {0x042e, "..--"}, {0x042f, ".-.-"},
+};
+
+/* Greek capitals U+0391 to U+03A9 */
+static const base_letter greek[] = {
+    {0x0391, ".-"}, {0x0392, "-..."}, {0x0393, "--."}, {0x0394, "-.."}, {0x0395, "."},
+    {0x0396, "--.."}, {0x0397, "...."}, {0x0398, "-.-."}, {0x0399, ".."}, {0x039a, "-.-"},
+    {0x039b, ".-.."}, {0x039c, "--"}, {0x039d, "-."}, {0x039e, "-..-"}, {0x039f, "---"},
+    {0x03a0, ".--."}, {0x03a1, ".-."}, {0x03a3, "..."}, {0x03a4, "-"}, {0x03a5, "-.--"},
+    {0x03a6, "..-."}, {0x03a7, "----"}, {0x03a8, "--.-"}, {0x03a9, ".--"},
+};
+
+/* Greek letters keyed as another: the tonos and dialytika forms, and the
+ * final sigma, each with the capital it is keyed as */
+static const uint16_t greek_forms[][2] = {
+    {0x0386, 0x0391}, {0x0388, 0x0395}, {0x0389, 0x0397}, {0x038a, 0x0399}, {0x038c, 0x039f},
+    {0x038e, 0x03a5}, {0x038f, 0x03a9}, {0x03aa, 0x0399}, {0x03ab, 0x03a5}, {0x03ac, 0x0391},
+    {0x03ad, 0x0395}, {0x03ae, 0x0397}, {0x03af, 0x0399}, {0x03ca, 0x0399}, {0x03cb, 0x03a5},
+    {0x03cc, 0x039f}, {0x03cd, 0x03a5}, {0x03ce, 0x03a9}, {0x03c2, 0x03a3},
+};
+
+/* Wabun, katakana, and the marks and punctuation */
+static const base_letter wabun[] = {
+    {0x30a2, "--.--"}, {0x30a4, ".-"}, {0x30a6, "..-"}, {0x30a8, "-.---"}, {0x30aa, ".-..."},
+    {0x30ab, ".-.."}, {0x30ad, "-.-.."}, {0x30af, "...-"}, {0x30b1, "-.--"}, {0x30b3, "----"},
+    {0x30b5, "-.-.-"}, {0x30b7, "--.-."}, {0x30b9, "---.-"}, {0x30bb, ".---."}, {0x30bd, "---."},
+    {0x30bf, "-."}, {0x30c1, "..-."}, {0x30c4, ".--."}, {0x30c6, ".-.--"}, {0x30c8, "..-.."},
+    {0x30ca, ".-."}, {0x30cb, "-.-."}, {0x30cc, "...."}, {0x30cd, "--.-"}, {0x30ce, "..--"},
+    {0x30cf, "-..."}, {0x30d2, "--..-"}, {0x30d5, "--.."}, {0x30d8, "."}, {0x30db, "-.."},
+    {0x30de, "-..-"}, {0x30df, "..-.-"}, {0x30e0, "-"}, {0x30e1, "-...-"}, {0x30e2, "-..-."},
+    {0x30e4, ".--"}, {0x30e6, "-..--"}, {0x30e8, "--"}, {0x30e9, "..."}, {0x30ea, "--."},
+    {0x30eb, "-.--."}, {0x30ec, "---"}, {0x30ed, ".-.-"}, {0x30ef, "-.-"}, {0x30f0, ".-..-"},
+    {0x30f1, ".--.."}, {0x30f2, ".---"}, {0x30f3, ".-.-."},
+    {0x309b, DAKUTEN}, {0x3099, DAKUTEN}, {0x309c, HANDAKUTEN}, {0x309a, HANDAKUTEN},
+    {0x30fc, ".--.-"}, {0x3001, ".-.-.-"}, {0x3002, ".-.-.."},
+};
+
+/* the small kana, keyed as the full-size kana after each */
+static const uint16_t wabun_small[] = {
+    0x30a1, 0x30a3, 0x30a5, 0x30a7, 0x30a9, 0x30c3, 0x30e3, 0x30e5, 0x30e7, 0x30ee,
+};
+
+/* the voiced kana, keyed as the kana before each and the dakuten */
+static const uint16_t wabun_voiced[] = {
+    0x30ac, 0x30ae, 0x30b0, 0x30b2, 0x30b4, 0x30b6, 0x30b8, 0x30ba, 0x30bc, 0x30be,
+    0x30c0, 0x30c2, 0x30c5, 0x30c7, 0x30c9, 0x30d0, 0x30d3, 0x30d6, 0x30d9, 0x30dc,
+};
+
+/* the half-voiced kana, keyed as the kana two before each and the handakuten */
+static const uint16_t wabun_half_voiced[] = {0x30d1, 0x30d4, 0x30d7, 0x30da, 0x30dd};
+
+static alphabet alphabets[ALPHABET_COUNT];
+static const char *codes[MAX_CODES];
+static int num_codes = 1;
+
+static void add(alphabet *a, uint16_t code_point, const char *code, const char *mark) {
+
+    if (a->count == MAX_LETTERS) {
+        fprintf(stderr, "alphabet: too many letters in %s\n", a->name);
+        exit(1);
+    }
+    a->letters[a->count].code_point = code_point;
+    a->letters[a->count].code = code;
+    a->letters[a->count].mark = mark;
+    ++a->count;
+}
+
+/* @return -> the letter already added for a code point */
+static const letter *find(const alphabet *a, uint16_t code_point) {
+
+    int i;
+
+    for (i = 0; i < a->count; ++i) {
+        if (a->letters[i].code_point == code_point) {
+            return &a->letters[i];
+        }
+    }
+    fprintf(stderr, "alphabet: U+%04X is not in %s\n", code_point, a->name);
+    exit(1);
+}
+
+static void build_letters(void) {
+
+    alphabet *a;
+    const letter *base;
+    size_t i;
+    int j, count;
+
+    alphabets[ALPHABET_LATIN].name = "latin";
+
+    /* capitals, and the small letters 0x20 on, or 0x50 for U+0401 */
+    a = &alphabets[ALPHABET_CYRILLIC];
+    a->name = "cyrillic";
+    for (i = 0; i < sizeof(cyrillic) / sizeof(cyrillic[0]); ++i) {
+        add(a, cyrillic[i].code_point, cyrillic[i].code, NULL);
+        add(a, (uint16_t)(cyrillic[i].code_point + (cyrillic[i].code_point < 0x0410 ? 0x50 : 0x20)),
+            cyrillic[i].code, NULL);
+    }
+
+    a = &alphabets[ALPHABET_GREEK];
+    a->name = "greek";
+    for (i = 0; i < sizeof(greek) / sizeof(greek[0]); ++i) {
+        add(a, greek[i].code_point, greek[i].code, NULL);
+        add(a, (uint16_t)(greek[i].code_point + 0x20), greek[i].code, NULL);
+    }
+    for (i = 0; i < sizeof(greek_forms) / sizeof(greek_forms[0]); ++i) {
+        add(a, greek_forms[i][0], find(a, greek_forms[i][1])->code, NULL);
+    }
+
+    a = &alphabets[ALPHABET_WABUN];
+    a->name = "wabun";
+    for (i = 0; i < sizeof(wabun) / sizeof(wabun[0]); ++i) {
+        add(a, wabun[i].code_point, wabun[i].code, NULL);
+    }
+    for (i = 0; i < sizeof(wabun_small) / sizeof(wabun_small[0]); ++i) {
+        add(a, wabun_small[i], find(a, (uint16_t)(wabun_small[i] + 1))->code, NULL);
+    }
+    for (i = 0; i < sizeof(wabun_voiced) / sizeof(wabun_voiced[0]); ++i) {
+        add(a, wabun_voiced[i], find(a, (uint16_t)(wabun_voiced[i] - 1))->code, DAKUTEN);
+    }
+    add(a, 0x30f4, find(a, 0x30a6)->code, DAKUTEN);
+    for (i = 0; i < sizeof(wabun_half_voiced) / sizeof(wabun_half_voiced[0]); ++i) {
+        add(a, wabun_half_voiced[i], find(a, (uint16_t)(wabun_half_voiced[i] - 2))->code, HANDAKUTEN);
+    }
+
+    /* and every kana again as hiragana, 0x60 before */
+    count = a->count;
+    for (j = 0; j < count; ++j) {
+        base = &a->letters[j];
+        if (base->code_point >= 0x30a1 && base->code_point <= 0x30f6) {
+            add(a, (uint16_t)(base->code_point - 0x60), base->code, base->mark);
+        }
+    }
+}
+
+/* @return -> the index of a code in codes[], added if it is new */
+static int code_index(const char *code) {
+
+    int i;
+
+    if (code == NULL) {
+        return 0;
+    }
+    for (i = 1; i < num_codes; ++i) {
+        if (strcmp(codes[i], code) == 0) {
+            return i;
+        }
+    }
+    if (num_codes == MAX_CODES) {
+        fprintf(stderr, "alphabet: too many codes\n");
+        exit(1);
+    }
+    codes[num_codes] = code;
+
+    return num_codes++;
+}
+
+/* try to hash an alphabet into size slots through buckets buckets
+ * @return -> 1 if every bucket found a seed */
+static int place(alphabet *a, int buckets, int size) {
+
+    static int members[MAX_LETTERS][MAX_LETTERS];
+    int bucket_size[MAX_LETTERS] = {0};
+    int order[MAX_LETTERS];
+    int slot[MAX_LETTERS];
+    int i, j, k, b, seed, best, ok;
+
+    for (i = 0; i < size; ++i) {
+        a->placed[i] = -1;
+    }
+    for (i = 0; i < a->count; ++i) {
+        b = (int)ALPHABET_REDUCE(ALPHABET_HASH(a->letters[i].code_point, 0), buckets);
+        members[b][bucket_size[b]++] = i;
+    }
+
+    /* largest buckets first, ties in bucket order */
+    for (i = 0; i < buckets; ++i) {
+        order[i] = i;
+    }
+    for (i = 0; i < buckets; ++i) {
+        best = i;
+        for (j = i + 1; j < buckets; ++j) {
+            if (bucket_size[order[j]] > bucket_size[order[best]]) {
+                best = j;
+            }
+        }
+        b = order[i];
+        order[i] = order[best];
+        order[best] = b;
+    }
+
+    for (i = 0; i < buckets; ++i) {
+        b = order[i];
+        a->seeds[b] = 0;
+        if (bucket_size[b] == 0) {
+            continue;
+        }
+        for (seed = 0; seed < NUM_SEEDS; ++seed) {
+            ok = 1;
+            for (j = 0; j < bucket_size[b] && ok; ++j) {
+                slot[j] = (int)ALPHABET_REDUCE(ALPHABET_HASH(a->letters[members[b][j]].code_point, seed + 1), size);
+                ok = a->placed[slot[j]] < 0;
+                for (k = 0; k < j && ok; ++k) {
+                    ok = slot[k] != slot[j];
+                }
+            }
+            if (ok) {
+                break;
+            }
+        }
+        if (seed == NUM_SEEDS) {
+            return 0;
+        }
+        a->seeds[b] = (uint8_t)seed;
+        for (j = 0; j < bucket_size[b]; ++j) {
+            a->placed[slot[j]] = members[b][j];
+        }
+    }
+
+    return 1;
+}
+
+/* hash an alphabet in as few bytes as the search finds */
+static void hash(alphabet *a) {
+
+    static const int per_bucket[] = {1, 2, 3, 4, 5};
+    int best_bytes = 0, best_buckets = 0, best_size = 0;
+    int p, buckets, size;
+
+    for (p = 0; p < (int)(sizeof(per_bucket) / sizeof(per_bucket[0])); ++p) {
+        buckets = (a->count + per_bucket[p] - 1) / per_bucket[p];
+        for (size = a->count; size <= 2 * a->count && !place(a, buckets, size); ++size) {
+        }
+        if (size <= 2 * a->count &&
+            (best_bytes == 0 || buckets + size * (int)sizeof(alphabet_slot) < best_bytes)) {
+            best_bytes = buckets + size * (int)sizeof(alphabet_slot);
+            best_buckets = buckets;
+            best_size = size;
+        }
+    }
+    if (best_bytes == 0) {
+        fprintf(stderr, "alphabet: no perfect hash for %s\n", a->name);
+        exit(1);
+    }
+
+    a->buckets = best_buckets;
+    a->size = best_size;
+    place(a, best_buckets, best_size);
+}
+
+/* look every code point up again as alphabet_lookup() will, and the rest
+ * of the blocks they are in
+ * @return -> code points misplaced or found that should not be */
+static int check(const alphabet *a) {
+
+    uint32_t code_point, bucket, slot;
+    int i, found, bad = 0;
+
+    for (code_point = 0x0080; code_point < 0x10000; ++code_point) {
+        bucket = ALPHABET_REDUCE(ALPHABET_HASH(code_point, 0), a->buckets);
+        slot = ALPHABET_REDUCE(ALPHABET_HASH(code_point, a->seeds[bucket] + 1), a->size);
+        found = a->placed[slot] >= 0 && a->letters[a->placed[slot]].code_point == code_point;
+        for (i = 0; i < a->count && a->letters[i].code_point != code_point; ++i) {
+        }
+        if (found != (i < a->count)) {
+            fprintf(stderr, "alphabet: U+%04X misplaced in %s\n", code_point, a->name);
+            ++bad;
+        }
+    }
+
+    return bad;
+}
+
+static int write_source(const char *path) {
+
+    FILE *out;
+    const alphabet *a;
+    const letter *l;
+    int id, i;
+
+    out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    fprintf(out, "/*\n *  ======== %s ========\n", strrchr(path, '/') ? strrchr(path, '/') + 1 : path);
+    fprintf(out, " *  PERFECT-HASH TABLES FOR THE ALPHABETS OF alphabet.h. GENERATED BY\n");
+    fprintf(out, " *  tools/alphabet.c - DO NOT EDIT.\n */\n\n");
+    fprintf(out, "#include <stdint.h>\n#include <stddef.h>\n\n#include \"alphabet.h\"\n\n");
+
+    fprintf(out, "const char *const alphabet_codes[%d] = {", num_codes);
+    for (i = 0; i < num_codes; ++i) {
+        fprintf(out, "%s\"%s\"", (i % 8) ? ", " : (i ? ",\n    " : "\n    "), i ? codes[i] : "");
+    }
+    fprintf(out, "\n};\n\n");
+
+    for (id = 0; id < ALPHABET_COUNT; ++id) {
+        a = &alphabets[id];
+        if (a->count == 0) {
+            continue;
+        }
+        fprintf(out, "/* %s: %d code points in %d slots, through %d buckets (%d bytes) */\n",
+                a->name, a->count, a->size, a->buckets, a->buckets + a->size * (int)sizeof(alphabet_slot));
+        fprintf(out, "static const uint8_t %s_seeds[%d] = {", a->name, a->buckets);
+        for (i = 0; i < a->buckets; ++i) {
+            fprintf(out, "%s%3u", (i % 12) ? ", " : (i ? ",\n    " : "\n    "), a->seeds[i]);
+        }
+        fprintf(out, "\n};\n\n");
+        fprintf(out, "static const alphabet_slot %s_slots[%d] = {", a->name, a->size);
+        for (i = 0; i < a->size; ++i) {
+            l = a->placed[i] >= 0 ? &a->letters[a->placed[i]] : NULL;
+            fprintf(out, "%s{0x%04x, %2d, %d}", (i % 4) ? ", " : (i ? ",\n    " : "\n    "),
+                    l ? l->code_point : 0, l ? code_index(l->code) : 0, l ? code_index(l->mark) : 0);
+        }
+        fprintf(out, "\n};\n\n");
+    }
+
+    fprintf(out, "const alphabet_table alphabet_tables[ALPHABET_COUNT] = {\n");
+    for (id = 0; id < ALPHABET_COUNT; ++id) {
+        a = &alphabets[id];
+        if (a->count == 0) {
+            fprintf(out, "    {\"%s\", NULL, NULL, 0, 0, 0},\n", a->name);
+        }
+        else {
+            fprintf(out, "    {\"%s\", %s_seeds, %s_slots, %d, %d, %d},\n", a->name, a->name, a->name,
+                    a->buckets, a->size, a->count);
+        }
+    }
+    fprintf(out, "};\n");
+    fclose(out);
+
+    return 0;
+}
+
+int main(int argc, char **argv) {
+
+    alphabet *a;
+    int id, i, bad = 0;
+
+    if (argc != 2) {
+        fprintf(stderr, "usage: alphabet OUT.c\n");
+        return 2;
+    }
+
+    build_letters();
+    for (id = 0; id < ALPHABET_COUNT; ++id) {
+        a = &alphabets[id];
+        if (a->count == 0) {
+            continue;
+        }
+        hash(a);
+        bad += check(a);
+
+        /* number the codes in alphabet order, so the file reads in order */
+        for (i = 0; i < a->count; ++i) {
+            code_index(a->letters[i].code);
+            code_index(a->letters[i].mark);
+        }
+        printf("%-9s %3d code points in %3d slots, %3d buckets, %4d bytes\n", a->name, a->count, a->size,
+               a->buckets, a->buckets + a->size * (int)sizeof(alphabet_slot));
+    }
+    if (bad != 0) {
+        return 1;
+    }
+
+    return write_source(argv[1]);
+}
+
+#endif /* MORSE_HOST */
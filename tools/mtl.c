@@ -0,0 +1,159 @@
+/*
+ *  ======== mtl.c ========
+ *  HOST TOOL FOR THE BINARY TIMELINE FORMAT (SEE timeline.h).
+ *
+ *    mtl encode OUT.mtl MESSAGE     encode one message to an image file
+ *    mtl csource OUT.c MESSAGE...   emit timeline_images[] for the firmware
+ *    mtl dump IN.mtl                mmap an image and list its runs
+ *
+ *  Build from the repository root with:
+ *    gcc -DMORSE_HOST -I. -o mtl tools/mtl.c alphabet.c alphabet_tables.c \
+ *        morse.c timeline.c utf8.c
+ */
+
+#if defined(MORSE_HOST)
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "timeline.h"
+
+/* 500 ms units, the tick period set up by initTimer() */
+#define UNIT_US 500000
+
+/* large enough for any message the firmware carries */
+static uint8_t image[65536];
+
+/* encode a message into the static buffer
+ * @return -> the image length, or a negative status code */
+static int encode(const char *message) {
+
+    timeline_writer writer;
+    int status;
+
+    timeline_writer_init(&writer, image, sizeof(image), 2);
+    status = timeline_encode_message(&writer, message);
+    if (status != TIMELINE_STATUS_SUCCESS) {
+        return status;
+    }
+    return timeline_writer_finish(&writer, UNIT_US);
+}
+
+static int encode_file(const char *path, const char *message) {
+
+    FILE *out;
+    int length = encode(message);
+
+    if (length < 0) {
+        fprintf(stderr, "mtl: cannot encode '%s' (%d)\n", message, length);
+        return 1;
+    }
+
+    out = fopen(path, "wb");
+    if (out == NULL) {
+        perror(path);
+        return 1;
+    }
+    fwrite(image, 1, (size_t)length, out);
+    fclose(out);
+
+    return 0;
+}
+
+static int encode_csource(const char *path, int count, char **messages) {
+
+    FILE *out;
+    int length;
+    int i, j;
+
+    out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return 1;
+    }
+
+    fprintf(out, "/*\n *  ======== %s ========\n", strrchr(path, '/') ? strrchr(path, '/') + 1 : path);
+    fprintf(out, " *  PRECOMPILED TIMELINES FOR messages[], PLAYED IN PLACE WHEN\n");
+    fprintf(out, " *  MORSE_PLAY_TIMELINE IS SET. GENERATED BY tools/mtl.c - DO NOT EDIT.\n */\n\n");
+    fprintf(out, "#include <stdint.h>\n#include <stddef.h>\n\n");
+
+    for (i = 0; i < count; ++i) {
+        length = encode(messages[i]);
+        if (length < 0) {
+            fprintf(stderr, "mtl: cannot encode '%s' (%d)\n", messages[i], length);
+            fclose(out);
+            return 1;
+        }
+        fprintf(out, "/* \"%s\" */\nstatic const uint8_t timeline_%d[%d] = {", messages[i], i, length);
+        for (j = 0; j < length; ++j) {
+            fprintf(out, "%s0x%02x", (j % 12) ? ", " : (j ? ",\n    " : "\n    "), image[j]);
+        }
+        fprintf(out, "\n};\n\n");
+    }
+
+    fprintf(out, "const uint8_t *const timeline_images[] = {");
+    for (i = 0; i < count; ++i) {
+        fprintf(out, "%stimeline_%d", i ? ", " : "", i);
+    }
+    fprintf(out, "};\n\nconst size_t timeline_image_sizes[] = {");
+    for (i = 0; i < count; ++i) {
+        fprintf(out, "%ssizeof(timeline_%d)", i ? ", " : "", i);
+    }
+    fprintf(out, "};\n");
+    fclose(out);
+
+    return 0;
+}
+
+static int dump(const char *path) {
+
+    const uint8_t *mapped;
+    size_t size;
+    timeline_header header;
+    timeline_cursor cursor;
+    unsigned char level_mask;
+    uint32_t units;
+    uint32_t total = 0;
+    int status;
+
+    if (timeline_map(path, &mapped, &size) != TIMELINE_STATUS_SUCCESS) {
+        fprintf(stderr, "mtl: %s is not a timeline image\n", path);
+        return 1;
+    }
+
+    timeline_open(mapped, size, &header, &cursor);
+    printf("version %d, %u us/unit, %u channel(s), %u runs\n",
+           TIMELINE_VERSION, header.unit_us, header.channels, header.run_count);
+
+    while ((status = timeline_next(&cursor, &level_mask, &units)) == 1) {
+        printf("%8u  mask %x  x%u\n", total, level_mask, units);
+        total += units;
+    }
+    printf("%u units total\n", total);
+
+    timeline_unmap(mapped, size);
+
+    return status == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+
+    if (argc == 4 && strcmp(argv[1], "encode") == 0) {
+        return encode_file(argv[2], argv[3]);
+    }
+    if (argc >= 4 && strcmp(argv[1], "csource") == 0) {
+        return encode_csource(argv[2], argc - 3, &argv[3]);
+    }
+    if (argc == 3 && strcmp(argv[1], "dump") == 0) {
+        return dump(argv[2]);
+    }
+
+    fprintf(stderr, "usage: mtl encode OUT.mtl MESSAGE\n"
+                    "       mtl csource OUT.c MESSAGE...\n"
+                    "       mtl dump IN.mtl\n");
+    return 2;
+}
+
+#endif /* MORSE_HOST */
@@ -0,0 +1,80 @@
+/*
+ *  ======== utf8.c ========
+ *  STREAMING UTF-8 DECODER.
+ */
+
+#include <stdint.h>
+
+#include "utf8.h"
+
+/* start afresh, as at the start of a message */
+void utf8_reset(utf8_decoder *decoder) {
+
+    decoder->code_point = 0;
+    decoder->needed = 0;
+    decoder->low = 0x80;
+    decoder->high = 0xbf;
+}
+
+/* take the next byte
+ * @return -> the code point it completes, UTF8_MORE if it does not
+ *            complete one, or UTF8_REPLACEMENT if it is out of place */
+int32_t utf8_decode(utf8_decoder *decoder, uint8_t byte) {
+
+    if (decoder->needed != 0) {
+        if (byte >= decoder->low && byte <= decoder->high) {
+            decoder->code_point = (decoder->code_point << 6) | (byte & 0x3f);
+            decoder->low = 0x80;
+            decoder->high = 0xbf;
+            return --decoder->needed == 0 ? (int32_t)decoder->code_point : UTF8_MORE;
+        }
+
+        /* cut short: drop what there was and start again on this byte */
+        decoder->needed = 0;
+        decoder->low = 0x80;
+        decoder->high = 0xbf;
+    }
+
+    if (byte < 0x80) {
+        return byte;
+    }
+
+    /* a lead byte: how many follow, and where the second must fall to
+     * rule out overlong forms, surrogates and anything past U+10FFFF */
+    if (byte >= 0xc2 && byte <= 0xdf) {
+        decoder->needed = 1;
+        decoder->code_point = byte & 0x1f;
+    }
+    else if (byte >= 0xe0 && byte <= 0xef) {
+        decoder->needed = 2;
+        decoder->code_point = byte & 0x0f;
+        if (byte == 0xe0) {
+            decoder->low = 0xa0;
+        }
+        else if (byte == 0xed) {
+            decoder->high = 0x9f;
+        }
+    }
+    else if (byte >= 0xf0 && byte <= 0xf4) {
+        decoder->needed = 3;
+        decoder->code_point = byte & 0x07;
+        if (byte == 0xf0) {
+            decoder->low = 0x90;
+        }
+        else if (byte == 0xf4) {
+            decoder->high = 0x8f;
+        }
+    }
+    else {
+        /* a continuation byte with nothing before it, or one never used */
+        return UTF8_REPLACEMENT;
+    }
+
+    return UTF8_MORE;
+}
+
+/* @return -> 1 if the decoder is between characters, 0 part-way into one */
+int utf8_idle(const utf8_decoder *decoder) {
+
+    return decoder->needed == 0;
+}
@@ -0,0 +1,39 @@
+/*
+ *  ======== utf8.h ========
+ *  STREAMING UTF-8 DECODER: BYTES GO IN ONE AT A TIME, AS THE SEQUENCER
+ *  READS THEM, AND A CODE POINT COMES OUT WITH THE LAST BYTE OF EACH. THE
+ *  BYTES OF ONE CHARACTER NEED NOT ARRIVE TOGETHER, SO A STREAMED MESSAGE
+ *  (SEE rope.h) MAY BE SPLIT ANYWHERE.
+ *
+ *  Only well-formed UTF-8 is accepted (Unicode 3.9, table 3-7): overlong
+ *  forms, surrogates, code points past U+10FFFF and bytes that cannot
+ *  start a character each come out as U+FFFD, which has no code and is
+ *  keyed as one. A character cut short by the start of another is dropped
+ *  and the new one decoded, so each byte gives at most one code point.
+ */
+
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stdint.h>
+
+/* from utf8_decode(): more bytes are needed */
+#define UTF8_MORE           (-1)
+
+/* what a malformed byte decodes to */
+#define UTF8_REPLACEMENT    0xfffd
+
+/* --- one stream of bytes --- */
+typedef struct {
+    uint32_t code_point;            /* bits gathered so far */
+    unsigned char needed;           /* continuation bytes still to come */
+    unsigned char low;              /* bounds on the next one, which the */
+    unsigned char high;             /* lead byte can narrow */
+} utf8_decoder;
+
+/* function prototypes */
+void utf8_reset(utf8_decoder *decoder);
+int32_t utf8_decode(utf8_decoder *decoder, uint8_t byte);
+int utf8_idle(const utf8_decoder *decoder);
+
+#endif /* UTF8_H */